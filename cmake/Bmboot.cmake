@@ -1,15 +1,48 @@
 set(BMBOOT_ALL_CPUS 1 2 3)
 
+# second payload slot of each CPU (see src/bmboot_memmap.hpp), used for hot swapping
+set(BMBOOT_CPU1_PAYLOAD_B_ADDRESS 0x809E00000)
+set(BMBOOT_CPU2_PAYLOAD_B_ADDRESS 0x80BE00000)
+set(BMBOOT_CPU3_PAYLOAD_B_ADDRESS 0x80DE00000)
+
 
 # see build.rst for usage information
 function(add_bmboot_payload NAME)
+    cmake_parse_arguments(PARSE_ARGV 1 ARG "HOT_SWAP;INSTRUMENT_FUNCTIONS;SMP" "" "")
+
     set(ALL_TARGETS)
 
     # Use an "object library" so that source files will be compiled only once
-    add_library("${NAME}" OBJECT ${ARGN})
+    add_library("${NAME}" OBJECT ${ARG_UNPARSED_ARGUMENTS})
 
     target_link_libraries("${NAME}" PRIVATE bmboot_payload_runtime)
 
+    if (ARG_INSTRUMENT_FUNCTIONS)
+        # Record every function entry & exit (see instrument_functions.cpp). Inline functions from the Bmboot headers
+        # and the C++ standard library are excluded, as they would drown out everything else.
+        target_compile_options("${NAME}" PRIVATE
+                -finstrument-functions
+                -finstrument-functions-exclude-file-list=include/bmboot,/c++/)
+    endif()
+
+    if (ARG_SMP)
+        # a single image for all three cores, running from the payload window of cpu1 (see smp.hpp)
+        set(TARGET "${NAME}_smp")
+        add_executable("${TARGET}" $<TARGET_OBJECTS:${NAME}>)
+        target_link_libraries("${TARGET}" PRIVATE "${NAME}")
+        set_target_properties("${TARGET}" PROPERTIES SUFFIX ".elf")
+
+        target_link_options(${TARGET} PUBLIC
+                -specs=nosys.specs
+                -Wl,--defsym=_SMP_CORES=3
+                -Wl,-T,${CMAKE_CURRENT_FUNCTION_LIST_DIR}/../src/executor/payload/payload_cpu1.ld)
+
+        Bmboot_PayloadPostBuild("${TARGET}")
+
+        set("${NAME}_TARGETS" "${TARGET}" PARENT_SCOPE)
+        return()
+    endif()
+
     # link the payload separately for each CPU core
     foreach(CPU ${BMBOOT_ALL_CPUS})
         set(TARGET "${NAME}_cpu${CPU}")
@@ -24,6 +57,23 @@ function(add_bmboot_payload NAME)
         Bmboot_PayloadPostBuild("${TARGET}")
 
         list(APPEND ALL_TARGETS "${TARGET}")
+
+        if (ARG_HOT_SWAP)
+            # link once more for the second payload slot, so that the payload can be preloaded while another one runs
+            set(TARGET_B "${NAME}_cpu${CPU}_b")
+            add_executable("${TARGET_B}" $<TARGET_OBJECTS:${NAME}>)
+            target_link_libraries("${TARGET_B}" PRIVATE "${NAME}")
+            set_target_properties("${TARGET_B}" PROPERTIES SUFFIX ".elf")
+
+            target_link_options(${TARGET_B} PUBLIC
+                    -specs=nosys.specs
+                    -Wl,--defsym=_PAYLOAD_ADDRESS=${BMBOOT_CPU${CPU}_PAYLOAD_B_ADDRESS}
+                    -Wl,-T,${CMAKE_CURRENT_FUNCTION_LIST_DIR}/../src/executor/payload/payload_cpu${CPU}.ld)
+
+            Bmboot_PayloadPostBuild("${TARGET_B}")
+
+            list(APPEND ALL_TARGETS "${TARGET_B}")
+        endif()
     endforeach()
 
     set("${NAME}_TARGETS" "${ALL_TARGETS}" PARENT_SCOPE)
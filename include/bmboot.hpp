@@ -27,6 +27,19 @@ enum DomainState
     invalid_state,              //!< The executors reports an invalid state
 };
 
+//! Type of an event in the monitor event log (see IDomain::getMonitorEvents)
+enum class MonitorEventType : uint32_t
+{
+    monitor_started,            //!< The monitor has (re)started; arg0 = DomainState reported before the restart
+    state_changed,              //!< The domain state has changed; arg0 = new DomainState
+    command,                    //!< A command from the manager was received; arg0 = command, arg1 = payload address
+    command_response,           //!< A command has been answered; arg0 = response code
+    smc,                        //!< The payload made a secure monitor call; arg0 = function ID, arg1 = first argument
+    fiq,                        //!< An FIQ was taken (profiler ticks excepted); arg0 = interrupt ID, arg1 = interrupted PC
+    ipi_request,                //!< A request was received via IPI; arg0 = request code, arg1 = request argument
+    crash,                      //!< A crash was reported; arg0 = 1 if the monitor crashed, 0 for the payload, arg1 = PC
+};
+
 enum DomainIndex
 {
     cpu1,
@@ -53,6 +66,11 @@ enum ErrorCode
     // TODO: might want to just propagate the OS error for these?
     dev_mem_access_failed,              //!< Failed to access the @c /dev/mem special device
     mmap_failed,                        //!< The @c mmap function returned an error
+
+    invalid_argument,                   //!< An argument is out of the permitted range
+    file_access_failed,                 //!< A file could not be created or written
+    payload_start_time_passed,          //!< The start time of a synchronized start had passed by the time the monitor was
+                                        //!< ready to start the payload
 };
 
 //! Parse a domain index from its string representation
@@ -67,4 +85,7 @@ std::string toString(bmboot::DomainState state);
 //! Convert an error code into its string representation
 std::string toString(bmboot::ErrorCode err);
 
+//! Convert a monitor event type into its string representation
+std::string toString(bmboot::MonitorEventType type);
+
 }
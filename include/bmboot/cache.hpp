@@ -0,0 +1,56 @@
+//! @file
+//! @brief  Cache maintenance for buffers shared with other bus masters
+//! @author Martin Cejp
+//!
+//! The APU cores are coherent among themselves, but not with masters which access memory directly: Linux through
+//! a non-cacheable mapping of /dev/mem, DMA engines in the PL, the RPU... When exchanging data with those through
+//! cacheable memory, the payload must:
+//!
+//!  - clean the buffer after writing it and before handing it over, so that the data reaches DDR
+//!  - invalidate the buffer before reading data written by the other master, so that no stale lines are hit
+//!
+//! Alternatively, such buffers can be allocated from @link bmboot::MemoryTier::ddr_uncached @endlink.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bmboot
+{
+
+//! Above this size, range operations which write back data (clean, clean & invalidate) process the entire data cache
+//! by set/way instead of going line by line. Set/way operations only affect the caches of the calling core.
+constexpr size_t DCACHE_SET_WAY_THRESHOLD = 1024 * 1024;
+
+//! Write back dirty data cache lines covering the range to the point of coherency (DDR).
+void cleanDcacheRange(void const* address, size_t size);
+
+//! Discard data cache lines covering the range, so that subsequent reads fetch the data from memory.
+//!
+//! Partially covered lines at the start and the end of the range are cleaned first, so that unrelated data sharing
+//! a cache line with the buffer is not lost. Ideally, shared buffers should be aligned to the cache line size
+//! (@link bmboot::getDcacheLineSize @endlink) anyway.
+//!
+//! Unlike the other operations, this one never falls back to set/way maintenance, since that would discard
+//! unrelated data.
+void invalidateDcacheRange(void const* address, size_t size);
+
+//! Write back and discard data cache lines covering the range.
+void cleanInvalidateDcacheRange(void const* address, size_t size);
+
+//! Write back and discard the entire data cache of the calling core (all levels) by set/way.
+void cleanInvalidateDcacheAll();
+
+//! Discard instruction cache lines covering the range, typically after writing code into memory.
+//!
+//! The corresponding data must have been cleaned first.
+void invalidateIcacheRange(void const* address, size_t size);
+
+//! @return The smallest data cache line size in bytes, per CTR_EL0
+size_t getDcacheLineSize();
+
+//! @return The smallest instruction cache line size in bytes, per CTR_EL0
+size_t getIcacheLineSize();
+
+}
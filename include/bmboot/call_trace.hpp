@@ -0,0 +1,57 @@
+//! @file
+//! @brief  Function call traces of payloads built with INSTRUMENT_FUNCTIONS
+//! @author Martin Cejp
+
+#pragma once
+
+#include "bmboot/domain.hpp"
+#include "bmboot/elf_symbolizer.hpp"
+
+#include <cstdio>
+#include <span>
+#include <vector>
+
+namespace bmboot
+{
+
+//! Function entry or exit recorded by an instrumented payload
+struct CallTraceRecord
+{
+    //! Value of the built-in timer (CNTPCT)
+    uint64_t timestamp;
+
+    //! Address of the function entered or left
+    uintptr_t function;
+
+    //! true for function entry, false for exit
+    bool enter;
+
+    //! Number of interrupt handlers active, 0 in the main program
+    int nesting_level;
+
+    //! Priority of the innermost active interrupt handler, 0xFF in the main program
+    int priority;
+};
+
+//! Read the call trace buffer of a payload built with INSTRUMENT_FUNCTIONS.
+//!
+//! The buffer is located using the symbol table of the payload ELF. It is kept in the payload memory, so it can be
+//! read even after the payload has crashed (and is included in core dumps as the variable `bmboot_call_trace`).
+//!
+//! @param domain Domain running the payload
+//! @param symbols Symbols of the payload ELF
+//! @param records_out Receives the records, oldest first (at most 8192)
+//! @return ErrorCode::invalid_argument if the payload is not instrumented
+MaybeError readCallTrace(IDomain& domain, ElfSymbolizer const& symbols, std::vector<CallTraceRecord>& records_out);
+
+//! Print call trace records as an indented call tree with the duration of each call.
+//!
+//! Each interrupt context (nesting level) is tracked separately and its lines are marked with the interrupt priority.
+//!
+//! @param timer_frequency Frequency of the built-in timer in Hz, see IDomain::getTimerFrequency
+void printCallTrace(FILE* file,
+                    std::span<CallTraceRecord const> records,
+                    ElfSymbolizer const& symbols,
+                    uint32_t timer_frequency);
+
+}
@@ -0,0 +1,62 @@
+//! @file
+//! @brief  Writer for the Chrome trace event format
+//! @author Martin Cejp
+//!
+//! The JSON format is understood by Perfetto (https://ui.perfetto.dev), chrome://tracing and other trace viewers.
+//! Reference: "Trace Event Format", https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+namespace bmboot
+{
+
+//! Streams trace events into a JSON file as they are added, so that arbitrarily long traces can be captured.
+//!
+//! Each process (pid) corresponds to a timeline group in the viewer; each thread (tid) is one track within it.
+class ChromeTraceWriter
+{
+public:
+    //! Start writing a trace. The file must be open for writing and stays owned by the caller.
+    explicit ChromeTraceWriter(FILE* file);
+
+    //! Finish the trace, if not done yet
+    ~ChromeTraceWriter();
+
+    ChromeTraceWriter(ChromeTraceWriter const&) = delete;
+    ChromeTraceWriter& operator=(ChromeTraceWriter const&) = delete;
+
+    //! Name a process (timeline group)
+    void setProcessName(int pid, std::string_view name);
+
+    //! Name a thread (track) and set its position within the process
+    void setThreadName(int pid, int tid, std::string_view name, int sort_index);
+
+    //! Begin of a duration event (phase 'B')
+    void addBeginEvent(int pid, int tid, double timestamp_us, std::string_view name);
+
+    //! End of a duration event (phase 'E')
+    void addEndEvent(int pid, int tid, double timestamp_us, std::string_view name);
+
+    //! Instant event (phase 'i'), drawn as a marker on the track
+    void addInstantEvent(int pid, int tid, double timestamp_us, std::string_view name);
+
+    //! Counter event (phase 'C'), drawn as a separate graph
+    void addCounterEvent(int pid, double timestamp_us, std::string_view name, double value);
+
+    //! Close the JSON structure. No more events may be added afterwards.
+    void finish();
+
+private:
+    FILE* file;
+    bool first_event = true;
+    bool finished = false;
+
+    void beginEvent();
+    void writeString(std::string_view str);
+};
+
+}
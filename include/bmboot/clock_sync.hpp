@@ -0,0 +1,91 @@
+//! @file
+//! @brief  Correlation of executor timestamps with Linux clocks
+//! @author Martin Cejp
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace bmboot
+{
+
+//! Converts timestamps taken by the executors (values of the system counter, CNTPCT) into Linux time.
+//!
+//! The system counter is shared by all cores of the APU, and Linux can read it as CNTVCT_EL0 (with a virtual offset of
+//! zero, which is the case in the absence of a hypervisor). Each sample reads the counter bracketed by two readings of
+//! CLOCK_MONOTONIC; the bracket is retried a few times to reject samples disturbed by preemption. A straight line is
+//! then fitted through the recent samples, so that the actual counter frequency is measured rather than taken from the
+//! configuration, and drift against NTP-disciplined CLOCK_MONOTONIC is followed.
+//!
+//! Until samples spanning at least a second have been collected, the nominal frequency is used.
+//!
+//! All methods are thread-safe.
+class ClockSync
+{
+public:
+    //! @param nominal_frequency_hz Counter frequency to assume until it has been measured (see IDomain::getTimerFrequency)
+    explicit ClockSync(uint32_t nominal_frequency_hz);
+
+    //! Stops periodic sampling, if running
+    ~ClockSync();
+
+    ClockSync(ClockSync const&) = delete;
+    ClockSync& operator=(ClockSync const&) = delete;
+
+    //! Take one sample of the counter and the Linux clocks
+    void sample();
+
+    //! Sample periodically in a background thread. The first sample is taken immediately.
+    void startPeriodicSampling(std::chrono::milliseconds period = std::chrono::milliseconds(100));
+
+    //! Stop the background thread started by #startPeriodicSampling
+    void stopPeriodicSampling();
+
+    //! Convert a counter value to CLOCK_MONOTONIC time. A sample must have been taken first.
+    std::chrono::steady_clock::time_point toMonotonic(uint64_t counter) const;
+
+    //! Convert a counter value to CLOCK_REALTIME time. A sample must have been taken first.
+    std::chrono::system_clock::time_point toRealtime(uint64_t counter) const;
+
+    //! Convert a duration in counter ticks into seconds, using the measured frequency
+    double toSeconds(int64_t ticks) const;
+
+    //! @return Counter frequency in Hz, as measured (or the nominal frequency, if not measured yet)
+    double getFrequency() const;
+
+    //! @return Current value of the system counter
+    static uint64_t readCounter();
+
+private:
+    struct Sample
+    {
+        uint64_t counter;
+        int64_t monotonic_ns;
+    };
+
+    static constexpr size_t MAX_SAMPLES = 64;
+
+    mutable std::mutex mutex;
+    double nominal_ns_per_tick;
+
+    // Mapping: monotonic_ns = reference_ns + (counter - reference_counter) * ns_per_tick
+    double ns_per_tick;
+    uint64_t reference_counter = 0;
+    int64_t reference_ns = 0;
+    int64_t realtime_offset_ns = 0;             // CLOCK_REALTIME - CLOCK_MONOTONIC at the last sample
+
+    std::deque<Sample> samples;
+
+    std::thread thread;
+    std::condition_variable stop_condition;
+    bool stop_requested = false;
+
+    void fit();
+};
+
+}
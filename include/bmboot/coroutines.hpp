@@ -0,0 +1,427 @@
+//! @file
+//! @brief  Cooperative scheduler based on C++20 coroutines
+//! @author Martin Cejp
+//!
+//! Intended for logic that is not time-critical, but is naturally expressed as a sequence of waits
+//! (protocol handling, housekeeping). Coroutines are run from the payload's main loop, i.e. at a lower priority than
+//! any interrupt or @link bmboot::Task @endlink. Switching between coroutines costs about as much as an indirect
+//! function call; when no coroutine is ready, the CPU waits for an interrupt.
+//!
+//! Coroutine frames are allocated from a fixed pool in the payload runtime, never from the heap.
+
+#pragma once
+
+#include "deadline_timer.hpp"
+#include "payload_runtime.hpp"
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace bmboot
+{
+
+namespace internal
+{
+
+//! An entry of the scheduler's ready queue. Embedded in the awaiter of a suspended coroutine.
+struct CoroutineWaiter
+{
+    CoroutineWaiter* next;
+    std::coroutine_handle<> handle;
+};
+
+//! Append a waiter to the ready queue. Can be called from interrupt handlers.
+void makeCoroutineReady(CoroutineWaiter& waiter);
+
+//! Remove a waiter from the ready queue, if it is queued there.
+//! Used when a suspended coroutine is destroyed after being woken up, but before having been resumed.
+//!
+//! @return true if the waiter was removed
+bool cancelCoroutineReady(CoroutineWaiter& waiter);
+
+void* allocateCoroutineFrame(size_t size) noexcept;
+void freeCoroutineFrame(void* frame) noexcept;
+
+}
+
+//! Return type of a cooperative coroutine.
+//!
+//! A coroutine does not start executing when called. It can either be started independently using
+//! @link bmboot::spawnCoroutine @endlink, or awaited by another coroutine (`co_await doSomething();`), in which case
+//! it runs immediately and the caller is resumed when it finishes.
+//!
+//! If the frame pool is exhausted, the returned object is empty (see @link bmboot::Coroutine::valid @endlink).
+class [[nodiscard]] Coroutine
+{
+public:
+    struct promise_type;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+
+        std::coroutine_handle<> await_suspend(Handle handle) noexcept
+        {
+            auto& promise = handle.promise();
+
+            if (promise.continuation)
+            {
+                return promise.continuation;
+            }
+
+            if (promise.detached)
+            {
+                handle.destroy();
+            }
+
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    struct promise_type
+    {
+        std::coroutine_handle<> continuation;
+        bool detached = false;
+        internal::CoroutineWaiter start_waiter {};
+
+        Coroutine get_return_object() noexcept { return Coroutine(Handle::from_promise(*this)); }
+        static Coroutine get_return_object_on_allocation_failure() noexcept { return Coroutine(); }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+
+        static void* operator new(size_t size) noexcept { return internal::allocateCoroutineFrame(size); }
+        static void operator delete(void* frame) noexcept { internal::freeCoroutineFrame(frame); }
+    };
+
+    Coroutine() = default;
+    Coroutine(Coroutine&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Coroutine& operator=(Coroutine&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            handle = std::exchange(other.handle, {});
+        }
+
+        return *this;
+    }
+
+    ~Coroutine() { reset(); }
+
+    //! @return false if the coroutine frame could not be allocated
+    bool valid() const { return (bool) handle; }
+
+    //! @return true if the coroutine has finished executing
+    bool done() const { return handle && handle.done(); }
+
+    // Awaiting a coroutine: start it and continue with the awaiting one once it is done
+    bool await_ready() const noexcept { return !handle; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    void await_resume() noexcept {}
+
+private:
+    explicit Coroutine(Handle handle) : handle(handle) {}
+
+    void reset()
+    {
+        if (handle)
+        {
+            handle.destroy();
+            handle = {};
+        }
+    }
+
+    Handle handle;
+
+    friend bool spawnCoroutine(Coroutine&& coroutine);
+};
+
+//! Start a coroutine independently of the caller.
+//!
+//! The coroutine is queued to run the next time the scheduler gets control. Its frame is released when it finishes.
+//!
+//! @return false if the coroutine is empty (its frame could not be allocated)
+bool spawnCoroutine(Coroutine&& coroutine);
+
+//! Run coroutines until none are left, idling in WFI while waiting for events.
+//!
+//! Typically called at the end of `main`. Returns only when there are no coroutines waiting on any event
+//! (and no events pending); for a payload that is meant to run forever, this is never the case.
+void runCoroutineScheduler();
+
+//! Run all coroutines that are ready, then return. For integration into an existing main loop.
+//!
+//! @return Number of coroutines resumed
+int pollCoroutineScheduler();
+
+// ************************************************************
+// Awaitables
+// ************************************************************
+
+//! Awaitable which resumes the coroutine once the built-in timer reaches a deadline.
+//!
+//! If the coroutine is destroyed while suspended, the deadline is cancelled.
+class TimerAwaiter
+{
+public:
+    explicit TimerAwaiter(uint64_t deadline)
+    {
+        node.deadline = deadline;
+    }
+
+    ~TimerAwaiter()
+    {
+        if (scheduled && !internal::cancelDeadline(node))
+        {
+            // Expired already, so the coroutine might be sitting in the ready queue
+            internal::cancelCoroutineReady(waiter);
+        }
+    }
+
+    bool await_ready() const noexcept { return getBuiltinTimerValue() >= node.deadline; }
+
+    void await_suspend(std::coroutine_handle<> handle) noexcept
+    {
+        waiter.handle = handle;
+        node.on_expired = [](internal::DeadlineTimerNode& node) {
+            internal::makeCoroutineReady(static_cast<Node&>(node).owner->waiter);
+        };
+        node.owner = this;
+        scheduled = true;
+        internal::scheduleDeadline(node);
+    }
+
+    void await_resume() noexcept { scheduled = false; }
+
+private:
+    struct Node : internal::DeadlineTimerNode
+    {
+        TimerAwaiter* owner;
+    };
+
+    Node node {};
+    internal::CoroutineWaiter waiter {};
+    bool scheduled = false;                 // suspended, and not resumed yet
+};
+
+//! Suspend the coroutine until the built-in timer reaches the given value.
+//!
+//! @param deadline Value of @link bmboot::getBuiltinTimerValue @endlink
+inline TimerAwaiter sleepUntil(uint64_t deadline)
+{
+    return TimerAwaiter(deadline);
+}
+
+//! Suspend the coroutine for (at least) the given duration.
+inline TimerAwaiter sleepFor(std::chrono::microseconds duration)
+{
+    return TimerAwaiter(getBuiltinTimerValue() + (uint64_t) duration.count() * getBuiltinTimerFrequency() / 1'000'000);
+}
+
+//! An event that can be signalled from an interrupt handler and awaited by coroutines.
+//!
+//! Signals are counted, so that none are lost while no coroutine is waiting: every `co_await event.wait()` consumes
+//! one signal. When multiple coroutines are waiting, they are woken in FIFO order, one per signal. A coroutine which is
+//! destroyed while waiting leaves the queue; if it had already been woken, its signal is passed on.
+//!
+//! Example:
+//!
+//!     static bmboot::InterruptEvent rx_event;
+//!     bmboot::setupInterruptHandling(RX_IRQ, bmboot::PayloadInterruptPriority::p3, [] { rx_event.signal(); });
+class InterruptEvent
+{
+public:
+    class Awaiter
+    {
+    public:
+        explicit Awaiter(InterruptEvent& event) : event(event) {}
+        ~Awaiter();
+
+        bool await_ready() noexcept { return event.tryConsume(); }
+        bool await_suspend(std::coroutine_handle<> handle) noexcept;
+        void await_resume() noexcept { waiting = false; }
+
+    private:
+        InterruptEvent& event;
+        internal::CoroutineWaiter waiter {};
+        bool waiting = false;               // suspended, and not resumed yet
+    };
+
+    //! Signal the event. Can be called from any context.
+    void signal();
+
+    //! @return Awaitable which completes once the event has been signalled
+    Awaiter wait() { return Awaiter(*this); }
+
+private:
+    bool tryConsume();
+
+    unsigned int pending_signals = 0;
+    internal::CoroutineWaiter* waiters_head = nullptr;
+    internal::CoroutineWaiter* waiters_tail = nullptr;
+};
+
+//! Bounded message queue with coroutine receivers.
+//!
+//! Messages can be pushed from any context, including interrupt handlers and @link bmboot::Task @endlink handlers.
+//! Storage is fixed; nothing is allocated.
+//!
+//! @tparam T Message type
+//! @tparam Capacity Maximum number of messages in the queue
+template <typename T, size_t Capacity>
+class MessageQueue
+{
+public:
+    class ReceiveAwaiter
+    {
+    public:
+        explicit ReceiveAwaiter(MessageQueue& queue) : queue(queue) {}
+
+        ~ReceiveAwaiter()
+        {
+            if (!waiting)
+            {
+                return;
+            }
+
+            CriticalSection cs;
+
+            if (queue.receiver == this)
+            {
+                queue.receiver = nullptr;
+            }
+            else
+            {
+                // Woken up already; the message stays in the queue for the next receiver
+                internal::cancelCoroutineReady(waiter);
+            }
+        }
+
+        bool await_ready() noexcept
+        {
+            received = queue.tryPop();
+            return received.has_value();
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) noexcept
+        {
+            CriticalSection cs;
+
+            // Re-check with interrupts masked, a message could have arrived in the meantime
+            received = queue.tryPop();
+
+            if (received)
+            {
+                return false;
+            }
+
+            waiter.handle = handle;
+            waiter.next = nullptr;
+            queue.receiver = this;
+            waiting = true;
+            return true;
+        }
+
+        T await_resume() noexcept
+        {
+            waiting = false;
+
+            if (!received)
+            {
+                received = queue.tryPop();
+            }
+
+            return std::move(*received);
+        }
+
+    private:
+        MessageQueue& queue;
+        std::optional<T> received;
+        internal::CoroutineWaiter waiter {};
+        bool waiting = false;               // suspended, and not resumed yet
+
+        friend class MessageQueue;
+    };
+
+    //! Append a message to the queue.
+    //!
+    //! @return true if successful, false if the queue is full
+    bool push(T message)
+    {
+        ReceiveAwaiter* to_wake;
+
+        {
+            CriticalSection cs;
+
+            if (count == Capacity)
+            {
+                return false;
+            }
+
+            new (&storage[(head + count) % Capacity]) T(std::move(message));
+            count++;
+
+            to_wake = std::exchange(receiver, nullptr);
+        }
+
+        if (to_wake)
+        {
+            internal::makeCoroutineReady(to_wake->waiter);
+        }
+
+        return true;
+    }
+
+    //! Take the oldest message, if any, without waiting.
+    std::optional<T> tryPop()
+    {
+        CriticalSection cs;
+
+        if (count == 0)
+        {
+            return std::nullopt;
+        }
+
+        auto& slot = *std::launder(reinterpret_cast<T*>(&storage[head]));
+        std::optional<T> message(std::move(slot));
+        slot.~T();
+
+        head = (head + 1) % Capacity;
+        count--;
+        return message;
+    }
+
+    //! @return Awaitable which completes with the oldest message in the queue (waiting for one if necessary).
+    //!
+    //! Only one coroutine may be waiting to receive at any time.
+    ReceiveAwaiter receive() { return ReceiveAwaiter(*this); }
+
+    //! @return Number of messages currently in the queue
+    size_t size() const { return count; }
+
+private:
+    struct alignas(T) Storage { std::byte bytes[sizeof(T)]; };
+
+    Storage storage[Capacity];
+    size_t head = 0;
+    size_t count = 0;
+    ReceiveAwaiter* receiver = nullptr;
+};
+
+}
@@ -0,0 +1,37 @@
+//! @file
+//! @brief  Deadline timer service shared by the payload schedulers
+//! @author Martin Cejp
+
+#pragma once
+
+#include <cstdint>
+
+namespace bmboot::internal
+{
+
+//! An entry in the deadline timer queue.
+//!
+//! The node is intrusive: it is embedded in the object that is waiting for the deadline, so no memory is allocated
+//! when scheduling. While a node is queued, its memory must not be reused.
+struct DeadlineTimerNode
+{
+    DeadlineTimerNode* next;
+    uint64_t deadline;                                  //!< Value of CNTPCT_EL0 at which the node expires
+    void (*on_expired)(DeadlineTimerNode& node);        //!< Called from the timer interrupt handler
+};
+
+//! Schedule a node to expire at `node.deadline`.
+//!
+//! Expiry callbacks are invoked from the EL1 virtual timer interrupt (PPI 27) at the highest payload priority,
+//! so they should do no more than mark some work as ready.
+//! A deadline in the past expires immediately (as soon as interrupts are unmasked).
+//!
+//! Can be called from any context, including interrupt handlers.
+void scheduleDeadline(DeadlineTimerNode& node);
+
+//! Remove a node from the timer queue, if it is still queued.
+//!
+//! @return true if the node was removed before expiring, false otherwise
+bool cancelDeadline(DeadlineTimerNode& node);
+
+}
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "bmboot.hpp"
+#include "bmboot/telemetry.hpp"
 
 #include <cstdint>
 #include <cstdlib>
@@ -13,6 +14,7 @@
 #include <optional>
 #include <span>
 #include <variant>
+#include <vector>
 
 namespace bmboot
 {
@@ -27,6 +29,128 @@ struct CrashInfo
     std::string desc;
 };
 
+//! Snapshot of the payload heap, as published by the payload runtime
+struct HeapStatistics
+{
+    //! Usage of blocks in one size class. A block belongs to the class if `min_size <= size <= max_size`.
+    struct SizeClass
+    {
+        size_t min_size;
+        size_t max_size;
+        uint32_t blocks_in_use;
+        uint32_t blocks_in_use_high_water;
+    };
+
+    size_t heap_size;
+    size_t bytes_in_use;
+    size_t bytes_in_use_high_water;
+    size_t bytes_free;
+    size_t largest_free_block;
+    uint64_t num_allocations;
+    uint64_t num_frees;
+    uint64_t num_failed_allocations;
+
+    //! 0 if all free memory is in a single block, approaching 1 as it gets split into many small blocks
+    float fragmentation;
+
+    std::vector<SizeClass> size_classes;
+};
+
+//! Sample taken by the sampling profiler
+struct ProfileSample
+{
+    //! Interrupted code address, or 0 if the monitor was executing (no payload running, or between commands)
+    uintptr_t pc;
+
+    //! Return addresses found by following the frame pointer chain, innermost first.
+    //! At most 7 levels are recorded; the chain stops early in code compiled without frame pointers.
+    std::vector<uintptr_t> callers;
+};
+
+//! State of the sampling profiler
+struct ProfilerStatus
+{
+    //! Sampling rate in effect, 0 if the profiler is stopped
+    int sampling_rate_hz;
+
+    //! Number of samples taken since the monitor was started
+    uint64_t num_samples;
+
+    //! Average time spent taking one sample, excluding exception entry and return
+    double time_per_sample_us;
+};
+
+//! Begin or end of a region traced with BMBOOT_TRACE_SCOPE
+struct TraceEvent
+{
+    //! Value of the built-in timer (CNTPCT); see #IDomain::getTimerFrequency
+    uint64_t timestamp;
+
+    //! Name of the region, as read from the payload memory
+    std::string name;
+
+    //! true for the beginning of a region, false for its end
+    bool begin;
+
+    //! Number of interrupt handlers active when the event was recorded, 0 in the main program
+    int nesting_level;
+
+    //! Priority of the innermost active interrupt handler (see PayloadInterruptPriority), 0xFF in the main program
+    int priority;
+};
+
+//! Entry of the monitor event log
+struct MonitorEvent
+{
+    //! Value of the built-in timer (CNTPCT); see #IDomain::getTimerFrequency
+    uint64_t timestamp;
+
+    MonitorEventType type;
+
+    //! Raw arguments; their meaning depends on the event type (see MonitorEventType)
+    uint32_t arg0;
+    uint64_t arg1;
+
+    //! Human-readable decoding of the arguments, for example "SMC_WRITE_STDOUT" or "crashed_payload"
+    std::string description;
+};
+
+//! Timeline of the last boot of the monitor (by #IDomain::startup or #IDomain::restartMonitor), in ticks of the system
+//! counter (see #IDomain::getTimerFrequency). Checkpoints not reached (yet) are 0.
+struct BootTiming
+{
+    //! The manager released the core from reset (#IDomain::startup only)
+    uint64_t reset_released;
+
+    //! First instruction of the monitor's boot code
+    uint64_t entry;
+
+    //! Set/way invalidation of the data caches done
+    uint64_t caches_invalidated;
+
+    //! MMU and caches enabled
+    uint64_t mmu_enabled;
+
+    //! C runtime initialized, entering `main`
+    uint64_t main_entered;
+
+    //! Interrupt controller and IPI reception set up
+    uint64_t interrupts_set_up;
+
+    //! The monitor reported the state @link bmboot::monitor_ready monitor_ready@endlink
+    uint64_t ready;
+
+    //! The manager noticed the state change (#IDomain::startup only)
+    uint64_t ready_observed;
+};
+
+//! One of the two payload memory windows of a domain (see IDomain::preloadPayload)
+enum class PayloadSlot
+{
+    a,                          //!< The usual one; #IDomain::loadAndStartPayload always loads here
+    b,                          //!< For payloads linked with `add_bmboot_payload(... HOT_SWAP)` (the `*_b.elf` files)
+};
+
 //! An abstract class representing an executor domain
 class IDomain
 {
@@ -52,8 +176,18 @@ public:
     virtual DomainState getState() = 0;
 
     //! Terminate the payload, returning control to the monitor.
+    //!
+    //! The monitor goes straight back to its command loop, without re-running its boot code. On the way, it writes
+    //! back and discards the data cache, so that nothing left behind by the payload can overwrite the next image.
+    //! This normally takes well under a millisecond.
     virtual MaybeError terminatePayload() = 0;
 
+    //! Terminate the payload and restart the monitor from its entry point, going through the complete boot sequence
+    //! (cache invalidation, MMU and GIC set-up) as on #startup.
+    //!
+    //! This is much slower than #terminatePayload and should only be needed for recovery or for comparison.
+    virtual MaybeError restartMonitor() = 0;
+
     //! A shortcut function to call #startup or #terminatePayload, if necessary
     //!
     //! If the function returns with success, the domain state will be @link bmboot::monitor_ready monitor_ready@endlink.
@@ -83,11 +217,83 @@ public:
     virtual MaybeError loadElfPayload(std::span<uint8_t const> payload_binary,
                                       uintptr_t payload_argument) = 0;
 
+    //! Load a payload into the inactive payload slot, while the current payload keeps running; start it with
+    //! #swapPayload.
+    //!
+    //! The payload must have been built for the inactive slot (see #getActivePayloadSlot). Nothing is sent to the
+    //! monitor until #swapPayload; preloading again replaces the previously preloaded payload.
+    //!
+    //! This operation is permissible when the domain state is @link bmboot::monitor_ready monitor_ready@endlink,
+    //! @link bmboot::running_payload running_payload@endlink or @link bmboot::crashed_payload crashed_payload@endlink.
+    virtual MaybeError preloadPayload(std::span<uint8_t const> payload_binary,
+                                      uint32_t payload_crc32,
+                                      uintptr_t payload_argument) = 0;
+
+    //! Like #preloadPayload, for a payload in ELF format.
+    //!
+    //! The OCM slice belongs to the running payload, so segments placed there (`BMBOOT_FAST_CODE`/`BMBOOT_FAST_DATA`)
+    //! are rejected with ErrorCode::program_too_large.
+    virtual MaybeError preloadElfPayload(std::span<uint8_t const> payload_binary,
+                                         uintptr_t payload_argument) = 0;
+
+    //! Terminate the current payload and start the one loaded by #preloadPayload or #preloadElfPayload.
+    //!
+    //! The start command is queued before the payload is terminated, so the monitor enters the new payload as soon
+    //! as it has restarted and has checked the CRC of the preloaded image (for ELF payloads, computed when loading
+    //! them); only this check depends on the size of the payload. The function returns once the new payload is
+    //! running (or has failed to start, e.g. with ErrorCode::payload_checksum_mismatch if the image was damaged).
+    virtual MaybeError swapPayload() = 0;
+
+    //! @return The slot holding the payload started last (PayloadSlot::a if none has been started yet)
+    virtual PayloadSlot getActivePayloadSlot() = 0;
+
+    //! Load a payload like #loadAndStartPayload, but have the monitor start it only once the built-in timer (see
+    //! #getTimerFrequency) reaches @p start_time. The timer is common to all cores, so arming several domains with the
+    //! same start time starts their payloads together (see bmboot::startPayloadsSynchronized).
+    //!
+    //! The function returns as soon as the monitor has validated the payload and armed the start; use
+    //! #awaitPayloadStart to wait until the payload is running. Until then, #terminatePayload disarms the start.
+    //!
+    //! This operation is permissible only when the domain state is @link bmboot::monitor_ready monitor_ready@endlink.
+    //!
+    //! @return ErrorCode::payload_start_time_passed if the start time had already passed once the payload was
+    //!         validated; the payload is then not started at all
+    virtual MaybeError loadAndArmPayload(std::span<uint8_t const> payload_binary,
+                                         uint32_t payload_crc32,
+                                         uintptr_t payload_argument,
+                                         uint64_t start_time) = 0;
+
+    //! Load a payload in ELF format like #loadElfPayload, and arm its start like #loadAndArmPayload.
+    virtual MaybeError loadElfAndArmPayload(std::span<uint8_t const> payload_binary,
+                                            uintptr_t payload_argument,
+                                            uint64_t start_time) = 0;
+
+    //! Wait until a payload armed by #loadAndArmPayload or #loadElfAndArmPayload is running. The timeout only begins
+    //! at the start time.
+    virtual MaybeError awaitPayloadStart() = 0;
+
+    //! @return Value of the built-in timer at the moment the monitor last handed control to a payload, or 0 if it has
+    //!         not done so since it was booted
+    virtual uint64_t getPayloadStartTimestamp() = 0;
+
+    //! Arm the start of the payload last armed on another domain, without loading it again: the payload runs from the
+    //! memory of @p loader. This is how the cores of an SMP payload are started (see bmboot::startSmpPayload).
+    //!
+    //! This operation is permissible only when the domain state is @link bmboot::monitor_ready monitor_ready@endlink
+    //! and the start of @p loader is still armed.
+    virtual MaybeError armPayloadOf(IDomain& loader, uint64_t start_time) = 0;
+
     //! Read a character from the executor's standard output. This function should be polled on a regular basis.
     //!
     //! @return The character read, or -1 if no output is pending.
     virtual int getchar() = 0;
 
+    //! Get the time at which the payload wrote the current line of standard output.
+    //!
+    //! @return Value of the built-in timer (see #getTimerFrequency) recorded by the payload when it wrote the line to
+    //!         which the character last returned by #getchar belongs, or 0 if no line has been read yet
+    virtual uint64_t getConsoleLineTimestamp() = 0;
+
     //! Produce a Linux-compatible core dump for a crashed executor.
     //!
     //! @param filename Name of the file to be generated
@@ -100,6 +306,92 @@ public:
     //! Return some information about a crash of the executor
     virtual CrashInfo getCrashInfo() = 0;
 
+    //! Read statistics of the payload heap.
+    //!
+    //! The statistics are published by the payload, either on demand (`bmboot::publishHeapStatistics`) or after every
+    //! heap operation (`bmboot::setHeapStatisticsAutoPublish`), and are still available after the payload has crashed.
+    //! Until the payload publishes them for the first time, they only describe the empty heap.
+    //!
+    //! @return The statistics, or `std::nullopt` if no payload has initialized its heap yet
+    virtual std::optional<HeapStatistics> getHeapStatistics() = 0;
+
+    //! Start the sampling profiler, or change its sampling rate.
+    //!
+    //! The profiler runs in the monitor and requires no cooperation from the payload. The samples are kept in a ring
+    //! buffer of 2048 entries, which must be drained by calling #readProfileSamples often enough.
+    //! Profiling stops when the monitor is restarted, which includes #terminatePayload.
+    //!
+    //! @param sampling_rate_hz Sampling rate, 1 to 100 000 Hz
+    virtual MaybeError startProfiler(int sampling_rate_hz) = 0;
+
+    //! Stop the sampling profiler. Samples taken so far can still be read.
+    virtual MaybeError stopProfiler() = 0;
+
+    //! Retrieve the samples taken since the previous call (or since the profiler was started).
+    //!
+    //! @param samples New samples are appended here
+    //! @return Number of samples lost because they have been overwritten before they could be read
+    virtual uint64_t readProfileSamples(std::vector<ProfileSample>& samples) = 0;
+
+    //! Query the state of the sampling profiler
+    virtual ProfilerStatus getProfilerStatus() = 0;
+
+    //! Retrieve the trace events recorded by the payload since the previous call.
+    //!
+    //! The payload keeps the last 4096 events in a ring buffer, so this must be called often enough to keep up.
+    //!
+    //! @param events New events are appended here
+    //! @return Number of events lost because they have been overwritten before they could be read
+    virtual uint64_t readTraceEvents(std::vector<TraceEvent>& events) = 0;
+
+    //! Retrieve the monitor event log, oldest event first.
+    //!
+    //! The monitor always records the commands it receives, secure monitor calls, IPIs, state changes and crashes;
+    //! the last 1024 events are kept. The log survives restarts of the monitor (including #terminatePayload) and is
+    //! only cleared by #startup.
+    virtual std::vector<MonitorEvent> getMonitorEvents() = 0;
+
+    //! Read the telemetry counters of the domain; see #computeTelemetryRates for turning two snapshots into rates.
+    //!
+    //! @return The counters, or `std::nullopt` if the monitor has not initialized them (or is of an older version)
+    virtual std::optional<TelemetrySnapshot> getTelemetry() = 0;
+
+    //! Read the timestamps of the phases of the last boot of the monitor, to see where the start-up time goes.
+    //!
+    //! Returning to the monitor after #terminatePayload does not count as a boot and leaves them unchanged.
+    //!
+    //! @return The timestamps, or `std::nullopt` if the monitor has not been booted
+    virtual std::optional<BootTiming> getBootTiming() = 0;
+
+    //! @return Frequency of the built-in timer in Hz, as configured when the domain was started up
+    virtual uint32_t getTimerFrequency() = 0;
+
+    //! Copy data from the payload memory, for example a buffer located through the payload's symbol table.
+    //!
+    //! This works regardless of the state of the payload, including after a crash.
+    //! The payload might be modifying the data concurrently.
+    //!
+    //! @param address Physical address; the whole range must lie within one of the payload slots
+    //! @param buffer Destination
+    virtual MaybeError readPayloadMemory(uintptr_t address, std::span<uint8_t> buffer) = 0;
+
+    //! Map a part of the uncached DDR block of the domain (where BMBOOT_SHARED_DATA variables live) for direct access.
+    //!
+    //! The memory is mapped as Device, so it must only be accessed with naturally aligned loads and stores (no
+    //! `memcpy`, no atomic read-modify-write operations). The mapping remains valid for the lifetime of the domain
+    //! object, even across payload restarts.
+    //!
+    //! @param address Physical address; the whole range must lie within the uncached DDR block of the domain
+    //! @param size Size in bytes
+    virtual std::variant<std::span<uint8_t>, ErrorCode> mapUncachedMemory(uintptr_t address, size_t size) = 0;
+
+    //! Map the stream ring of the domain (see StreamRecorder). The same restrictions apply as for #mapUncachedMemory.
+    virtual std::variant<std::span<uint8_t>, ErrorCode> mapStreamRing() = 0;
+
+    //! Map the host I/O area of the domain (see HostFileServer). The same restrictions apply as for
+    //! #mapUncachedMemory.
+    virtual std::variant<std::span<uint8_t>, ErrorCode> mapHostIoArea() = 0;
+
     //! Start an idle payload. This mechanism is used to enable payloads to be started from Vitis.
     virtual void startDummyPayload() = 0;
 };
@@ -8,6 +8,7 @@
 #include "bmboot/domain.hpp"
 
 #include <filesystem>
+#include <span>
 
 namespace bmboot
 {
@@ -16,6 +17,9 @@ void runConsoleUntilInterrupted(IDomain& domain);
 void startConsoleThread(IDomain& domain);
 
 void loadPayloadFromFileOrThrow(IDomain & domain, std::filesystem::path const& path);
+void preloadPayloadFromFileOrThrow(IDomain& domain, std::filesystem::path const& path);
+void startSmpPayloadFromFileOrThrow(IDomain& cpu1, std::span<IDomain* const> other_domains,
+                                    std::filesystem::path const& path);
 std::unique_ptr<IDomain> throwOnError(DomainInstanceOrErrorCode maybe_domain, const char* function_name);
 void throwOnError(MaybeError err, const char* function_name);
 
@@ -0,0 +1,51 @@
+//! @file
+//! @brief  Address-to-function lookup in a payload ELF
+//! @author Martin Cejp
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bmboot
+{
+
+//! Resolves code addresses to function names using the symbol table of an ELF file.
+//!
+//! Only the symbol table is used (no DWARF), so the granularity is one function. C++ names are demangled.
+class ElfSymbolizer
+{
+public:
+    //! Load the function and variable symbols of a 64-bit ELF file.
+    //!
+    //! @return An empty optional if the file cannot be read or is not a 64-bit ELF with a symbol table.
+    static std::optional<ElfSymbolizer> load(std::filesystem::path const& path);
+
+    //! @return Name of the function containing @p address, or the address formatted as hexadecimal if not found
+    std::string symbolize(uintptr_t address) const;
+
+    //! Look up a global variable by its (mangled) name.
+    //!
+    //! @return Address of the variable, or an empty optional if there is no such symbol
+    std::optional<uintptr_t> findObject(std::string_view name) const;
+
+private:
+    struct Symbol
+    {
+        uintptr_t address;
+        size_t size;
+        std::string name;
+    };
+
+    // functions, sorted by address
+    std::vector<Symbol> m_symbols;
+
+    std::map<std::string, uintptr_t, std::less<>> m_objects;
+};
+
+}
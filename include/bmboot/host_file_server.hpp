@@ -0,0 +1,81 @@
+//! @file
+//! @brief  Serving file operations of a payload from a Linux directory
+//! @author Martin Cejp
+
+#pragma once
+
+#include "bmboot/domain.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace bmboot
+{
+
+//! Carries out the file operations of a payload (`fopen`, `fread`, ... and the functions of host_io.hpp) on the files
+//! in a Linux directory, in a background thread.
+//!
+//! Paths given by the payload are relative to the directory. Absolute paths and paths containing `..` are refused.
+//! Symbolic links inside the directory are followed only as long as they stay inside it (`RESOLVE_BENEATH`); on
+//! kernels older than 5.6, which lack `openat2`, symbolic links are not followed at all.
+//!
+//! Files opened by a payload are closed when the next payload makes its first request, and when the server stops.
+//! Only one server may be attached to a domain at a time.
+class HostFileServer
+{
+public:
+    //! Start serving requests.
+    //!
+    //! @param domain Domain whose payload is to be served
+    //! @param root Directory which the payload has access to
+    //! @param poll_interval How often to check for a request while idle. Each request waits for half of this on
+    //!                      average, in addition to the time it takes to perform.
+    //! @return The server, or an error if the host I/O area cannot be mapped (or `file_access_failed` if the
+    //!         directory cannot be opened)
+    static std::variant<std::unique_ptr<HostFileServer>, ErrorCode> start(
+            IDomain& domain,
+            std::filesystem::path const& root,
+            std::chrono::microseconds poll_interval = std::chrono::microseconds(100));
+
+    //! Stops the server, if still running
+    ~HostFileServer();
+
+    HostFileServer(HostFileServer const&) = delete;
+    HostFileServer& operator=(HostFileServer const&) = delete;
+
+    //! Stop serving requests and close all files. A request in progress is completed first; subsequent requests
+    //! fail with `ENODEV`.
+    void stop();
+
+    //! @return Number of requests served so far
+    uint64_t getNumRequestsServed() const { return m_num_requests_served; }
+
+private:
+    HostFileServer(std::span<uint8_t> area, int root_fd, std::chrono::microseconds poll_interval);
+
+    void run();
+    void serveRequest();
+    void closeAllFiles();
+
+    std::span<uint8_t> m_area;
+    int m_root_fd;
+    std::chrono::microseconds m_poll_interval;
+
+    std::thread m_thread;
+    std::atomic<bool> m_stop_requested = false;
+    std::atomic<uint64_t> m_num_requests_served = 0;
+
+    // Used by the server thread only
+    uint32_t m_session = 0;
+    std::vector<int> m_files;           // Linux file descriptors, indexed by payload descriptor - FIRST_FD; -1 if free
+    std::vector<uint8_t> m_buffer;      // for moving data in and out of the transfer buffer
+};
+
+}
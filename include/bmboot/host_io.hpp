@@ -0,0 +1,55 @@
+//! @file
+//! @brief  File I/O performed by the manager on behalf of the payload
+//! @author Martin Cejp
+//!
+//! When the manager runs a HostFileServer (e.g. `bmctl run ... --files <dir>`), the payload can use the standard file
+//! functions (`fopen`, `fread`, `fwrite`, `fseek`, `fclose`, or `open`, `read`, ...) on the files in the served
+//! directory. Each operation is a request to the manager through the host I/O area, a 2 MiB block of memory shared
+//! with it (see the memory map), and waits for the manager to carry it out -- typically a few hundred microseconds.
+//!
+//! To keep a time-critical loop going in the meantime, reads and writes can also be started asynchronously, with the
+//! data placed directly in the transfer buffer of the host I/O area.
+//!
+//! Only one operation can be in progress at a time. While an asynchronous operation is in progress, or its result has
+//! not been collected by #pollHostIo yet, the standard file functions fail with `EBUSY`. The functions are not
+//! thread-safe; use them from a single execution context.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace bmboot
+{
+
+//! The transfer buffer of the host I/O area (just under 2 MiB), for #startHostRead and #startHostWrite.
+//!
+//! After an asynchronous read, its contents stay valid until the next host I/O operation is started, including those
+//! made by the standard file functions.
+std::span<uint8_t> getHostIoBuffer();
+
+//! @return `true` if the manager is serving file requests
+bool isHostIoServerAttached();
+
+//! Start reading from a file into the transfer buffer.
+//!
+//! @param fd File descriptor obtained from `open` (or `fileno` of a `FILE*`; mind its buffering)
+//! @param size Maximum number of bytes to read; at most the size of the transfer buffer
+//! @return `false` if no server is attached, the size is too large, or another operation is still in progress
+bool startHostRead(int fd, size_t size);
+
+//! Start writing the first @p size bytes of the transfer buffer to a file. Do not modify the buffer until the
+//! operation has completed.
+//!
+//! @return `false` if no server is attached, the size is too large, or another operation is still in progress
+bool startHostWrite(int fd, size_t size);
+
+//! Check for completion of the operation started by #startHostRead or #startHostWrite. Never blocks.
+//!
+//! @return `std::nullopt` while still in progress; otherwise the number of bytes transferred, or a negative `errno`
+//!         value (`-EINVAL` if no operation was started)
+std::optional<int> pollHostIo();
+
+}
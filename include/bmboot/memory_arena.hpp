@@ -0,0 +1,106 @@
+//! @file
+//! @brief  Arena allocation from memory tiers with different latency and caching
+//! @author Martin Cejp
+//!
+//! Each tier is a fixed region of memory managed as a stack (arena): allocation just bumps a pointer, and memory is
+//! released in bulk by rewinding to a previously taken mark. This gives explicit, predictable lifetimes and O(1)
+//! allocation, but individual blocks cannot be freed. Use the heap (`malloc`/`new`) when that is needed.
+//!
+//! The arenas are not thread-safe; allocate during initialization or from a single execution context.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace bmboot
+{
+
+//! Memory tier to allocate from
+enum class MemoryTier
+{
+    //! On-chip SRAM, cached. Lowest and most consistent latency, but small (32 KiB per core).
+    ocm,
+    //! DDR memory inside the payload window, cached (write-back). Large, fast on cache hit.
+    ddr_cached,
+    //! DDR memory mapped as Normal non-cacheable (2 MiB per core). For buffers shared with other masters
+    //! (Linux via /dev/mem, PL DMA) without the need for cache maintenance.
+    ddr_uncached,
+    //! DDR memory outside of all per-core regions, cached (write-back). Large (512 MiB), but shared by all cores, so
+    //! only one payload at a time may use it -- intended for benchmarks and other large, temporary buffers.
+    ddr_scratch,
+};
+
+//! Position in an arena, used to release everything allocated after it
+struct ArenaMark
+{
+    uintptr_t position;
+};
+
+//! Allocate a block from a memory tier.
+//!
+//! @param tier Tier to allocate from
+//! @param size Size in bytes
+//! @param alignment Alignment in bytes; must be a power of two
+//! @return Pointer to the block, or `nullptr` if the tier is exhausted
+void* allocateFromTier(MemoryTier tier, size_t size, size_t alignment = alignof(std::max_align_t));
+
+//! Allocate and default-construct an array of objects in a memory tier.
+//!
+//! Destructors are never called; the type should be trivially destructible or the objects must be destroyed manually
+//! before the memory is released.
+//!
+//! @return Pointer to the first object, or `nullptr` if the tier is exhausted
+template <typename T>
+T* allocateFromTier(MemoryTier tier, size_t count = 1)
+{
+    void* memory = allocateFromTier(tier, sizeof(T) * count, alignof(T));
+
+    if (!memory)
+    {
+        return nullptr;
+    }
+
+    return new (memory) T[count];
+}
+
+//! Get the current position of an arena, to be later passed to @link bmboot::rewindArena @endlink.
+ArenaMark getArenaMark(MemoryTier tier);
+
+//! Release all allocations made after the mark was taken.
+void rewindArena(MemoryTier tier, ArenaMark mark);
+
+//! Release all allocations in a tier.
+void resetArena(MemoryTier tier);
+
+//! @return Number of bytes available in the tier (disregarding alignment)
+size_t getArenaFreeSpace(MemoryTier tier);
+
+//! @return Total size of the tier in bytes
+size_t getArenaSize(MemoryTier tier);
+
+//! Releases all allocations made in a tier during its lifetime.
+//!
+//! Example:
+//!
+//!     {
+//!         bmboot::ArenaScope scratch(bmboot::MemoryTier::ocm);
+//!         auto buffer = bmboot::allocateFromTier<float>(bmboot::MemoryTier::ocm, 1024);
+//!         // ...
+//!     }   // buffer is released here
+class ArenaScope
+{
+public:
+    explicit ArenaScope(MemoryTier tier) : tier(tier), mark(getArenaMark(tier)) {}
+    ~ArenaScope() { rewindArena(tier, mark); }
+
+    ArenaScope(ArenaScope const&) = delete;
+    ArenaScope& operator=(ArenaScope const&) = delete;
+
+private:
+    MemoryTier tier;
+    ArenaMark mark;
+};
+
+}
@@ -0,0 +1,138 @@
+//! @file
+//! @brief  Run-time configuration of the payload's translation tables
+//! @author Martin Cejp
+//!
+//! The payload starts with the static, identity-mapped translation table from translation_table.S. This API lets it
+//! change the memory type of address ranges and the block sizes used to map them, typically once during start-up.
+//!
+//! The mapping always stays an identity mapping (virtual address = physical address).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bmboot
+{
+
+//! Memory type (attributes) of a mapped range
+enum class MemoryType
+{
+    normal_write_back,          //!< Normal memory, write-back cacheable (default for DDR and OCM)
+    normal_write_through,       //!< Normal memory, write-through cacheable (reads cached, writes reach memory)
+    normal_non_cacheable,       //!< Normal memory, non-cacheable (shared buffers without cache maintenance)
+    device_nGnRnE,              //!< Device memory, strongly ordered (default for peripherals and PL)
+    device_nGnRE,               //!< Device memory with early write acknowledgement (posted writes)
+    device_GRE,                 //!< Device memory with gathering, reordering and early write acknowledgement
+    fault,                      //!< Unmapped; any access raises an exception
+};
+
+//! Translation granularity
+enum class PageSize
+{
+    size_4k,
+    size_2m,
+    size_1g,
+};
+
+//! Order preceding stores to Device memory (e.g. FPGA registers) before any subsequent stores.
+//!
+//! With @link bmboot::MemoryType::device_nGnRE @endlink, writes are posted and may still be in flight after this
+//! barrier; it only guarantees the order in which they arrive. With @link bmboot::MemoryType::device_GRE @endlink,
+//! it also separates writes which could otherwise be gathered or reordered.
+inline void ioWriteBarrier()
+{
+    asm volatile("dmb oshst" ::: "memory");
+}
+
+//! Order preceding loads from Device memory before any subsequent loads and stores.
+inline void ioReadBarrier()
+{
+    asm volatile("dmb oshld" ::: "memory");
+}
+
+//! Order all preceding Device memory accesses before any subsequent accesses.
+inline void ioBarrier()
+{
+    asm volatile("dmb osh" ::: "memory");
+}
+
+//! Wait until all preceding Device memory accesses have completed.
+//!
+//! For posted writes, completion means acknowledgement by the interconnect, not necessarily by the peripheral. To be
+//! sure that a write has taken effect, read back a register of the same peripheral.
+inline void ioCompletionBarrier()
+{
+    asm volatile("dsb osh" ::: "memory");
+}
+
+//! Builds a new set of translation tables based on the ones currently in effect, and activates them.
+//!
+//! Unmodified parts of the tables are shared with the current ones; new tables are taken from a fixed pool of 32 tables
+//! in the payload runtime and are never released. Each 2 MiB mapped in 4 KiB pages takes one table. The builder itself
+//! is cheap and can be discarded after activation.
+//!
+//! Example:
+//!
+//!     bmboot::TranslationTableBuilder mmu;
+//!     mmu.map(SHARED_BUFFER_ADDRESS, SHARED_BUFFER_SIZE, bmboot::MemoryType::normal_non_cacheable);
+//!     mmu.map(DMA_TARGET_ADDRESS, DMA_TARGET_SIZE, bmboot::MemoryType::normal_write_through);
+//!     mmu.activate();
+//!     mmu.printMapping();
+class TranslationTableBuilder
+{
+public:
+    //! Start from the translation tables currently in use
+    TranslationTableBuilder();
+
+    //! Use only one builder at a time; tables of a builder must be allocated contiguously from the pool.
+    TranslationTableBuilder(TranslationTableBuilder const&) = delete;
+    TranslationTableBuilder& operator=(TranslationTableBuilder const&) = delete;
+
+    //! Set the memory type of an address range.
+    //!
+    //! The range is mapped using the largest blocks that fit its alignment, up to @p max_page_size. Parts of larger
+    //! blocks outside of the range keep their previous attributes.
+    //!
+    //! @param address Start address, must be aligned to 4 KiB
+    //! @param size Size in bytes, must be a multiple of 4 KiB
+    //! @param type Memory type
+    //! @param max_page_size Largest block size to use
+    //! @return false if the arguments are invalid or the table pool has been exhausted.
+    //!         In the latter case, the range may have been modified partially.
+    bool map(uintptr_t address, size_t size, MemoryType type, PageSize max_page_size = PageSize::size_1g);
+
+    //! Switch the MMU to the new tables.
+    //!
+    //! Interrupts are masked while switching. Caches are cleaned and invalidated over any range that was remapped
+    //! from a cacheable type, so that no stale or dirty lines remain.
+    //!
+    //! In an SMP payload, this must be called on cpu1, and not from within @link bmboot::parallelFor @endlink; it
+    //! returns once the other cores have switched to the new tables as well.
+    void activate();
+
+    //! Print the mapping described by the tables to the standard output, merging adjacent blocks of equal attributes.
+    void printMapping() const;
+
+    //! @return Number of tables allocated from the pool by this builder
+    int getNumTablesAllocated() const { return num_tables_allocated; }
+
+private:
+    uint64_t* root;
+    uint64_t* first_table = nullptr;
+    int num_tables_allocated = 0;
+
+    struct Range { uintptr_t address; size_t size; };
+    static constexpr int MAX_FLUSH_RANGES = 16;
+    Range flush_ranges[MAX_FLUSH_RANGES];
+    int num_flush_ranges = 0;
+    bool flush_everything = false;
+
+    uint64_t* allocateTable();
+    bool isOwnTable(uint64_t const* table) const;
+    uint64_t* getWritableRoot();
+    bool mapBlock(uint64_t* table, int level, uintptr_t address, size_t size, MemoryType type, int min_block_level);
+    void recordFlushRange(uintptr_t address, size_t size);
+};
+
+}
@@ -0,0 +1,158 @@
+//! @file
+//! @brief  Parameter block shared between Linux and a payload, protected by a sequence lock
+//! @author Martin Cejp
+//!
+//! A parameter block carries a user-defined struct (gains, limits, setpoints...) from the manager to a running
+//! payload. There is a single writer on the Linux side and any number of readers in the payload. The writer never
+//! waits for the readers, and a reader never waits for the writer: if an update is in progress, it simply tries again,
+//! a bounded number of times. A reader therefore never blocks, which makes it suitable for use in interrupt handlers.
+//!
+//! The block must be placed in memory which both sides access without caching, normally by declaring it
+//! with @link BMBOOT_SHARED_DATA @endlink in the payload. The payload initializes it with default values, after which
+//! the manager opens it with ParameterBlockWriter (see parameter_block_writer.hpp) and can start writing.
+//!
+//! This header is used on both sides.
+
+#pragma once
+
+#include "bmboot/shared_memory.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace bmboot
+{
+
+namespace internal
+{
+
+constexpr uint32_t PARAMETER_BLOCK_MAGIC = 0x4B4C4250;      // 'PBLK'
+
+}
+
+//! A block of parameters of type `T`, shared between the manager (writer) and a payload (readers).
+//!
+//! The struct is copied 64 bits at a time, using aligned accesses only, because Linux maps the memory as Device.
+//! No atomic read-modify-write instructions are used either, since exclusive accesses to non-cacheable memory
+//! are not guaranteed to work.
+//!
+//! To detect a mismatch between the struct definitions used to build the payload and the manager, the size and
+//! alignment of `T` are recorded in the block along with `LayoutVersion`. Bump the version whenever the meaning
+//! of the fields changes without changing the size.
+//!
+//! The block has no constructor, so that it can be placed in a NOLOAD section; call #initialize before use.
+//!
+//! @tparam T Parameter struct; must be trivially copyable
+//! @tparam LayoutVersion User-defined version of the layout of `T`
+template <typename T, uint32_t LayoutVersion = 0>
+struct ParameterBlock
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Parameter block contents must be trivially copyable");
+    static_assert(alignof(T) <= 8, "Parameter block contents must not require alignment above 8 bytes");
+
+    //! Number of 64-bit words needed to hold `T`
+    static constexpr size_t NUM_WORDS = (sizeof(T) + 7) / 8;
+
+    //! Value identifying the layout of `T`, compared by the writer against the payload's
+    static constexpr uint64_t LAYOUT = internal::SHARED_LAYOUT<T, LayoutVersion>;
+
+    //! Default number of attempts made by #readConsistent
+    static constexpr int DEFAULT_READ_ATTEMPTS = 4;
+
+    uint32_t magic;
+    uint32_t sequence;              // odd while an update is in progress
+    uint64_t layout;
+    uint64_t words[NUM_WORDS];
+
+    //! Fill in initial values and mark the block as valid. Called by the payload, before the manager opens the block.
+    void initialize(T const& defaults)
+    {
+        internal::sharedStore(magic, 0);
+        internal::sharedMemoryWriteBarrier();
+
+        internal::sharedStore(sequence, 0);
+        internal::sharedStore(layout, LAYOUT);
+        storeWords(defaults);
+
+        internal::sharedMemoryWriteBarrier();
+        internal::sharedStore(magic, internal::PARAMETER_BLOCK_MAGIC);
+    }
+
+    //! @return `true` if the block has been initialized (with any layout)
+    bool isInitialized() const
+    {
+        return internal::sharedLoad(magic) == internal::PARAMETER_BLOCK_MAGIC;
+    }
+
+    //! @return `true` if the block has been initialized with the same layout of `T`
+    bool isCompatible() const
+    {
+        return isInitialized() && internal::sharedLoad(layout) == LAYOUT;
+    }
+
+    //! Publish new values. Only one writer may exist at a time.
+    void write(T const& value)
+    {
+        auto seq = internal::sharedLoad(sequence);
+
+        internal::sharedStore(sequence, seq + 1);
+        internal::sharedMemoryWriteBarrier();
+
+        storeWords(value);
+
+        internal::sharedMemoryWriteBarrier();
+        internal::sharedStore(sequence, seq + 2);
+    }
+
+    //! Read a consistent copy of the values. Wait-free: gives up after `max_attempts` if updates keep coming.
+    //!
+    //! @param value_out Receives the values. Left untouched if no consistent copy could be obtained.
+    //! @param max_attempts Maximum number of attempts. Each attempt costs one pass over the struct.
+    //! @return `true` on success; `false` if the writer was busy during all attempts (the caller should continue
+    //!         using the values it got last time)
+    bool readConsistent(T& value_out, int max_attempts = DEFAULT_READ_ATTEMPTS) const
+    {
+        uint64_t copy[NUM_WORDS];
+
+        for (int attempt = 0; attempt < max_attempts; attempt++)
+        {
+            auto seq_before = internal::sharedLoad(sequence);
+            internal::sharedMemoryReadBarrier();
+
+            if (seq_before & 1)
+            {
+                continue;
+            }
+
+            for (size_t i = 0; i < NUM_WORDS; i++)
+            {
+                copy[i] = internal::sharedLoad(words[i]);
+            }
+
+            internal::sharedMemoryReadBarrier();
+
+            if (internal::sharedLoad(sequence) == seq_before)
+            {
+                memcpy(&value_out, copy, sizeof(T));
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    void storeWords(T const& value)
+    {
+        uint64_t copy[NUM_WORDS] {};
+        memcpy(copy, &value, sizeof(T));
+
+        for (size_t i = 0; i < NUM_WORDS; i++)
+        {
+            internal::sharedStore(words[i], copy[i]);
+        }
+    }
+};
+
+}
@@ -0,0 +1,104 @@
+//! @file
+//! @brief  Manager side of a parameter block shared with a payload
+//! @author Martin Cejp
+
+#pragma once
+
+#include "bmboot/domain.hpp"
+#include "bmboot/elf_symbolizer.hpp"
+#include "bmboot/parameter_block.hpp"
+
+#include <string_view>
+#include <variant>
+
+namespace bmboot
+{
+
+//! Writes parameters into a ParameterBlock declared by a payload.
+//!
+//! Example, with `ControlParameters` defined in a header shared by both sides:
+//!
+//!     // payload
+//!     BMBOOT_SHARED_DATA bmboot::ParameterBlock<ControlParameters> g_parameters;
+//!
+//!     // manager
+//!     auto writer = ParameterBlockWriter<ControlParameters>::open(*domain, symbols, "g_parameters");
+//!
+//! The writer is not thread-safe; only one may be used for a given block at a time. Writing does not involve any
+//! system calls, so it can be done at kHz rates.
+template <typename T, uint32_t LayoutVersion = 0>
+class ParameterBlockWriter
+{
+public:
+    using Block = ParameterBlock<T, LayoutVersion>;
+
+    //! Open a parameter block at a known physical address.
+    //!
+    //! The payload must have initialized the block already.
+    //!
+    //! @return The writer, or an error: bad_domain_state if the block has not been initialized, invalid_argument
+    //!         if it was initialized with a different layout or lies outside the uncached DDR block of the domain
+    static std::variant<ParameterBlockWriter, ErrorCode> open(IDomain& domain, uintptr_t address)
+    {
+        if (address % alignof(Block) != 0)
+        {
+            return ErrorCode::invalid_argument;
+        }
+
+        auto memory = domain.mapUncachedMemory(address, sizeof(Block));
+
+        if (std::holds_alternative<ErrorCode>(memory))
+        {
+            return std::get<ErrorCode>(memory);
+        }
+
+        ParameterBlockWriter writer((Block*) std::get<std::span<uint8_t>>(memory).data());
+
+        if (!writer.m_block->isInitialized())
+        {
+            return ErrorCode::bad_domain_state;
+        }
+
+        if (!writer.isCompatible())
+        {
+            return ErrorCode::invalid_argument;
+        }
+
+        return writer;
+    }
+
+    //! Open a parameter block declared in the payload as a global variable named @p symbol_name.
+    static std::variant<ParameterBlockWriter, ErrorCode> open(IDomain& domain,
+                                                               ElfSymbolizer const& symbols,
+                                                               std::string_view symbol_name)
+    {
+        auto address = symbols.findObject(symbol_name);
+
+        if (!address.has_value())
+        {
+            return ErrorCode::invalid_argument;
+        }
+
+        return open(domain, *address);
+    }
+
+    //! Publish new parameter values. The payload will see either all of them or none.
+    void write(T const& value)
+    {
+        m_block->write(value);
+    }
+
+    //! @return `false` if the block has been reinitialized with a different layout (e.g. a different payload has
+    //!         been started), in which case writing must stop
+    bool isCompatible() const
+    {
+        return m_block->isCompatible();
+    }
+
+private:
+    explicit ParameterBlockWriter(Block* block) : m_block(block) {}
+
+    Block* m_block;
+};
+
+}
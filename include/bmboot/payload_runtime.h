@@ -4,10 +4,17 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 // For documentation, see the corresponding functions in paylaod_runtime.hpp. Sorry.
 
+#ifndef BMBOOT_FAST_CODE
+#define BMBOOT_FAST_CODE __attribute__((section(".ocm_text"), noinline))
+#define BMBOOT_FAST_DATA __attribute__((section(".ocm_data")))
+#define BMBOOT_SHARED_DATA __attribute__((section(".ddr_uncached_data")))
+#endif
+
 inline uint32_t bmGetBuiltinTimerFrequency()
 {
     uint64_t freq;
@@ -29,5 +36,77 @@ inline uint64_t bmGetCycleCounterValue()
     return cntval;
 }
 
+typedef enum
+{
+    BM_MEMORY_TIER_OCM = 0,
+    BM_MEMORY_TIER_DDR_CACHED = 1,
+    BM_MEMORY_TIER_DDR_UNCACHED = 2,
+    BM_MEMORY_TIER_DDR_SCRATCH = 3,
+} BmMemoryTier;
+
+// Must match bmboot::MemoryType
+typedef enum
+{
+    BM_MEMORY_TYPE_NORMAL_WRITE_BACK = 0,
+    BM_MEMORY_TYPE_NORMAL_WRITE_THROUGH = 1,
+    BM_MEMORY_TYPE_NORMAL_NON_CACHEABLE = 2,
+    BM_MEMORY_TYPE_DEVICE_nGnRnE = 3,
+    BM_MEMORY_TYPE_DEVICE_nGnRE = 4,
+    BM_MEMORY_TYPE_DEVICE_GRE = 5,
+    BM_MEMORY_TYPE_FAULT = 6,
+} BmMemoryType;
+
+// Must match bmboot::PageSize
+typedef enum
+{
+    BM_PAGE_SIZE_4K = 0,
+    BM_PAGE_SIZE_2M = 1,
+    BM_PAGE_SIZE_1G = 2,
+} BmPageSize;
+
+#define BM_PMU_MAX_EVENT_COUNTERS 6
+
+// Must match bmboot::PmuCounts
+typedef struct
+{
+    uint64_t cycles;
+    uint64_t events[BM_PMU_MAX_EVENT_COUNTERS];
+} BmPmuCounts;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void* bmAllocateFromTier(BmMemoryTier tier, size_t size, size_t alignment);
+void bmCleanDcacheRange(void const* address, size_t size);
+void bmCleanInvalidateDcacheRange(void const* address, size_t size);
+// Event numbers as in bmboot::PmuEvent. Returns 0 if too many events were requested.
+int bmConfigurePmu(uint16_t const* events, size_t num_events);
+// Transfer buffer for bmStartHostRead/bmStartHostWrite
+void* bmGetHostIoBuffer(size_t* size_out);
+uintptr_t bmGetPayloadArgument();
+void bmInvalidateDcacheRange(void const* address, size_t size);
+void bmInvalidateIcacheRange(void const* address, size_t size);
+// Build new translation tables with the given range remapped and activate them immediately. Returns 0 on failure.
+int bmMmuMap(uintptr_t address, size_t size, BmMemoryType type, BmPageSize max_page_size);
 void bmNotifyPayloadStarted();
+// Returns 0 while the operation is in progress; otherwise 1, with the byte count or -errno in *result_out
+int bmPollHostIo(int* result_out);
+void bmPublishHeapStatistics();
+void bmReadPmu(BmPmuCounts* counts_out);
+void bmResetArena(BmMemoryTier tier);
+void bmSetHeapStatisticsAutoPublish(int enable);
 void bmStartCycleCounter();
+// Return 0 if the operation could not be started (see bmboot::startHostRead)
+int bmStartHostRead(int fd, size_t size);
+int bmStartHostWrite(int fd, size_t size);
+void bmStartPmu();
+// Returns 0 if the record size is invalid
+int bmStartStream(size_t record_size);
+void bmStopPmu();
+// Returns 0 if the records were not stored (no recorder attached, or dropped for lack of space)
+int bmWriteStreamRecords(void const* records, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
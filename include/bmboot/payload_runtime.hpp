@@ -13,6 +13,23 @@
 
 #include <functional>
 
+//! Place a function in the on-chip memory (OCM) slice of the core, for deterministic instruction fetch latency.
+//!
+//! Calls between OCM and DDR go through linker-generated veneers, so the hot path should stay within OCM code.
+//! Not applicable to inline functions and templates.
+#define BMBOOT_FAST_CODE __attribute__((section(".ocm_text"), noinline))
+
+//! Place a variable in the on-chip memory (OCM) slice of the core.
+//!
+//! Constant and non-constant variables cannot be mixed in one translation unit.
+#define BMBOOT_FAST_DATA __attribute__((section(".ocm_data")))
+
+//! Place a variable in the uncached DDR block of the core, for data shared with Linux (e.g. a ParameterBlock).
+//!
+//! The section is not loaded: such variables are not initialized, and must be set up by the payload at run time.
+//! Their addresses can be looked up in the payload ELF by the manager (see ElfSymbolizer::findObject).
+#define BMBOOT_SHARED_DATA __attribute__((section(".ddr_uncached_data")))
+
 namespace bmboot
 {
 
@@ -88,6 +105,30 @@ inline uint64_t getCycleCounterValue()
     return cntval;
 }
 
+//! Mask IRQs on the current CPU core for the lifetime of the object.
+//!
+//! Used to protect data shared between the main loop and interrupt handlers (or between handlers of different
+//! priorities). Critical sections can be nested, since the previous mask state is restored on destruction.
+class CriticalSection
+{
+public:
+    CriticalSection()
+    {
+        asm volatile("mrs %0, DAIF; msr DAIFSet, #2" : "=r" (saved_daif) :: "memory");
+    }
+
+    ~CriticalSection()
+    {
+        asm volatile("msr DAIF, %0" :: "r" (saved_daif) : "memory");
+    }
+
+    CriticalSection(CriticalSection const&) = delete;
+    CriticalSection& operator=(CriticalSection const&) = delete;
+
+private:
+    uint64_t saved_daif;
+};
+
 //! Get the ABI version of the monitor
 //!
 //! \return ABI version
@@ -113,6 +154,19 @@ void notifyPayloadCrashed(const char* desc, uintptr_t address);
 //! Notify the manager that the payload has started successfully.
 void notifyPayloadStarted();
 
+//! Publish a snapshot of the heap statistics, to be read by the manager using `IDomain::getHeapStatistics`.
+//!
+//! The heap keeps its counters up to date at all times, but does not publish them by itself unless
+//! @link bmboot::setHeapStatisticsAutoPublish @endlink has been called; call this function periodically instead
+//! (e.g. from the main loop) to give the manager a reasonably fresh view at no cost to the allocator.
+void publishHeapStatistics();
+
+//! Publish the heap statistics after every heap operation.
+//!
+//! This keeps the manager's view exact, including after a crash, but makes every `malloc` and `free` copy the whole
+//! statistics block (about 300 bytes) with IRQs masked. Disabled by default.
+void setHeapStatisticsAutoPublish(bool enable);
+
 //! Configure the built-in periodic interrupt.
 //!
 //! \param period_us Interrupt period in microseconds
@@ -154,6 +208,9 @@ void disableInterruptHandling(int interruptId);
 
 //! Write to the standard output.
 //!
+//! Each line is tagged with the value of the system counter at the time of the call, which the manager uses to
+//! timestamp it. The byte 0x1E (ASCII Record Separator) is reserved for this purpose and is replaced by '?'.
+//!
 //! @param data Data to write (normally in ASCII encoding)
 //! @param size Number of bytes to written
 //! @return Number of bytes actually written, which might be limited by available buffer space
@@ -0,0 +1,151 @@
+//! @file
+//! @brief  Performance Monitor Unit event counters
+//! @author Martin Cejp
+//!
+//! The Cortex-A53 PMU has one cycle counter and six 32-bit event counters, each of which can count one of the events
+//! listed in @link bmboot::PmuEvent @endlink. The event counters are extended to 64 bits in software, using the
+//! overflow interrupt. Events are counted in EL1 only; time spent in the monitor (for example, serving SMCs) is not
+//! included.
+//!
+//! Example:
+//!
+//!     bmboot::PmuEvent events[] { bmboot::PmuEvent::l1d_cache_refill, bmboot::PmuEvent::br_mis_pred };
+//!     bmboot::configurePmu(events);
+//!     bmboot::startPmu();
+//!
+//!     bmboot::PmuCounts fft_counts;
+//!
+//!     for (;;)
+//!     {
+//!         bmboot::PmuScope scope(fft_counts);
+//!         doFft();
+//!     }
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace bmboot
+{
+
+//! Maximum number of event counters that can be in use simultaneously
+constexpr inline int PMU_MAX_EVENT_COUNTERS = 6;
+
+//! PMU event numbers.
+//!
+//! Architectural events are common to all Armv8-A cores, the others are specific to the Cortex-A53 (see its TRM,
+//! section 12.9 Events). Any other event number can be used by casting it to PmuEvent.
+enum class PmuEvent : uint16_t
+{
+    sw_incr =                   0x00,   //!< Software increment (write to PMSWINC_EL0)
+    l1i_cache_refill =          0x01,   //!< L1 instruction cache refill
+    l1i_tlb_refill =            0x02,   //!< L1 instruction TLB refill
+    l1d_cache_refill =          0x03,   //!< L1 data cache refill
+    l1d_cache =                 0x04,   //!< L1 data cache access
+    l1d_tlb_refill =            0x05,   //!< L1 data TLB refill
+    ld_retired =                0x06,   //!< Load instruction architecturally executed
+    st_retired =                0x07,   //!< Store instruction architecturally executed
+    inst_retired =              0x08,   //!< Instruction architecturally executed
+    exc_taken =                 0x09,   //!< Exception taken
+    exc_return =                0x0A,   //!< Exception return
+    br_mis_pred =               0x10,   //!< Mispredicted or not predicted branch
+    cpu_cycles =                0x11,   //!< Cycle
+    br_pred =                   0x12,   //!< Predictable branch speculatively executed
+    mem_access =                0x13,   //!< Data memory access
+    l1i_cache =                 0x14,   //!< L1 instruction cache access
+    l1d_cache_wb =              0x15,   //!< L1 data cache write-back
+    l2d_cache =                 0x16,   //!< L2 data cache access
+    l2d_cache_refill =          0x17,   //!< L2 data cache refill
+    l2d_cache_wb =              0x18,   //!< L2 data cache write-back
+    bus_access =                0x19,   //!< Bus access
+    bus_cycles =                0x1D,   //!< Bus cycle
+    a53_ext_mem_req =           0xC0,   //!< External memory request
+    a53_ext_mem_req_nc =        0xC1,   //!< Non-cacheable external memory request
+    a53_prefetch_linefill =     0xC2,   //!< Linefill because of prefetch
+    a53_stall_sb_full =         0xC7,   //!< Data write stalled because the store buffer is full
+    a53_br_cond_mispred =       0xCC,   //!< Conditional branch mispredicted
+    a53_stall_icache_miss =     0xE1,   //!< Cycles with the instruction queue empty due to an instruction cache miss
+    a53_stall_load_miss =       0xE7,   //!< Cycles stalled in the Wr stage because of a load miss
+    a53_stall_store =           0xE8,   //!< Cycles stalled in the Wr stage because of a store
+};
+
+//! Snapshot of the cycle counter and the configured event counters
+struct PmuCounts
+{
+    uint64_t cycles = 0;
+    uint64_t events[PMU_MAX_EVENT_COUNTERS] = {};   //!< In the order passed to @link bmboot::configurePmu @endlink
+
+    PmuCounts& operator+=(PmuCounts const& other)
+    {
+        cycles += other.cycles;
+
+        for (int i = 0; i < PMU_MAX_EVENT_COUNTERS; i++)
+        {
+            events[i] += other.events[i];
+        }
+
+        return *this;
+    }
+
+    PmuCounts operator-(PmuCounts const& other) const
+    {
+        PmuCounts result;
+        result.cycles = cycles - other.cycles;
+
+        for (int i = 0; i < PMU_MAX_EVENT_COUNTERS; i++)
+        {
+            result.events[i] = events[i] - other.events[i];
+        }
+
+        return result;
+    }
+};
+
+//! Assign events to the event counters, in order, and reset all counters (including the cycle counter).
+//!
+//! Also installs the overflow interrupt handler that extends the event counters to 64 bits. Counting does not start
+//! until @link bmboot::startPmu @endlink is called.
+//!
+//! @param events Events to count, at most @link bmboot::getNumPmuEventCounters @endlink
+//! @return false if too many events were requested
+bool configurePmu(std::span<PmuEvent const> events);
+
+//! Start the cycle counter and the configured event counters.
+void startPmu();
+
+//! Stop all counters. Their values are preserved.
+void stopPmu();
+
+//! Read the cycle counter and the configured event counters.
+//!
+//! Can be called from interrupt handlers; IRQs are masked during the read for consistency.
+PmuCounts readPmu();
+
+//! @return Number of event counters implemented by the core (6 on the Cortex-A53), capped to PMU_MAX_EVENT_COUNTERS
+int getNumPmuEventCounters();
+
+//! Accumulate the PMU counts of a region of code, delimited by the lifetime of the object.
+//!
+//! Scopes can be nested; the counts of the inner scope are then included in the outer one. The overhead of entering
+//! and leaving a scope is two @link bmboot::readPmu @endlink calls, each in the order of 100 cycles.
+class PmuScope
+{
+public:
+    explicit PmuScope(PmuCounts& accumulator) : accumulator(accumulator), start(readPmu()) {}
+
+    ~PmuScope()
+    {
+        accumulator += readPmu() - start;
+    }
+
+    PmuScope(PmuScope const&) = delete;
+    PmuScope& operator=(PmuScope const&) = delete;
+
+private:
+    PmuCounts& accumulator;
+    PmuCounts start;
+};
+
+}
@@ -0,0 +1,133 @@
+//! @file
+//! @brief  Access primitives for memory shared between Linux and a payload
+//! @author Martin Cejp
+//!
+//! The payload maps its uncached DDR block as Normal non-cacheable, Linux maps it (through /dev/mem) as Device. Both
+//! are outer shareable, so barriers must cover the outer shareable domain; the DMBs emitted for std::atomic_thread_fence
+//! only cover the inner one. Exclusive accesses are not guaranteed to work on such memory, so no atomic
+//! read-modify-write operations can be used: every shared word must have a single writer.
+//!
+//! On other architectures (unit tests on a PC), the standard fences are used.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace bmboot::internal
+{
+
+//! Order preceding stores to shared memory before subsequent stores
+inline void sharedMemoryWriteBarrier()
+{
+#if defined(__aarch64__)
+    asm volatile("dmb oshst" ::: "memory");
+#else
+    std::atomic_thread_fence(std::memory_order_release);
+#endif
+}
+
+//! Order preceding loads from shared memory before subsequent loads and stores
+inline void sharedMemoryReadBarrier()
+{
+#if defined(__aarch64__)
+    asm volatile("dmb oshld" ::: "memory");
+#else
+    std::atomic_thread_fence(std::memory_order_acquire);
+#endif
+}
+
+//! Order all preceding accesses before all subsequent ones, including stores before loads
+inline void sharedMemoryFullBarrier()
+{
+#if defined(__aarch64__)
+    asm volatile("dmb osh" ::: "memory");
+#else
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
+}
+
+//! Single-copy atomic load of a naturally aligned word
+template <typename Word>
+Word sharedLoad(Word const& word)
+{
+    return std::atomic_ref<Word>(const_cast<Word&>(word)).load(std::memory_order_relaxed);
+}
+
+//! Single-copy atomic store to a naturally aligned word
+template <typename Word>
+void sharedStore(Word& word, std::type_identity_t<Word> value)
+{
+    std::atomic_ref<Word>(word).store(value, std::memory_order_relaxed);
+}
+
+//! Copy a block out of shared memory. Linux maps it as Device memory, which only permits aligned accesses; memcpy
+//! makes no such promise.
+inline void copyFromSharedMemory(void* dest, void const* src, size_t size)
+{
+    auto d = (uint8_t*) dest;
+    auto s = (uint8_t const*) src;
+
+    for (; size > 0 && (uintptr_t) s % 16 != 0; size--)
+    {
+        *d++ = *(uint8_t const volatile*) s++;
+    }
+
+    for (; size >= 16; size -= 16, s += 16, d += 16)
+    {
+#if defined(__aarch64__)
+        uint64_t a, b;
+        asm volatile("ldp %0, %1, [%2]" : "=r" (a), "=r" (b) : "r" (s) : "memory");
+#else
+        uint64_t a = ((uint64_t const volatile*) s)[0];
+        uint64_t b = ((uint64_t const volatile*) s)[1];
+#endif
+        memcpy(d, &a, 8);
+        memcpy(d + 8, &b, 8);
+    }
+
+    for (; size > 0; size--)
+    {
+        *d++ = *(uint8_t const volatile*) s++;
+    }
+}
+
+//! Copy a block into shared memory; see #copyFromSharedMemory
+inline void copyToSharedMemory(void* dest, void const* src, size_t size)
+{
+    auto d = (uint8_t*) dest;
+    auto s = (uint8_t const*) src;
+
+    for (; size > 0 && (uintptr_t) d % 16 != 0; size--)
+    {
+        *(uint8_t volatile*) d++ = *s++;
+    }
+
+    for (; size >= 16; size -= 16, s += 16, d += 16)
+    {
+        uint64_t a, b;
+        memcpy(&a, s, 8);
+        memcpy(&b, s + 8, 8);
+#if defined(__aarch64__)
+        asm volatile("stp %0, %1, [%2]" :: "r" (a), "r" (b), "r" (d) : "memory");
+#else
+        ((uint64_t volatile*) d)[0] = a;
+        ((uint64_t volatile*) d)[1] = b;
+#endif
+    }
+
+    for (; size > 0; size--)
+    {
+        *(uint8_t volatile*) d++ = *s++;
+    }
+}
+
+//! Value identifying the layout of a type shared between separately compiled programs: its size, its alignment and
+//! a user-defined version, to be bumped when the meaning of the fields changes without changing the size
+template <typename T, uint32_t LayoutVersion>
+constexpr uint64_t SHARED_LAYOUT = ((uint64_t) LayoutVersion << 32) | ((uint64_t) alignof(T) << 24) | sizeof(T);
+
+}
@@ -0,0 +1,107 @@
+//! @file
+//! @brief  Payloads running on several cores at once
+//! @author Martin Cejp
+//!
+//! An SMP payload (built with `add_bmboot_payload(... SMP)`) is a single image which runs on cpu1, cpu2 and cpu3 at
+//! the same time, from the payload window of cpu1. The manager loads it once and has all three monitors enter it
+//! together (see bmboot::startSmpPayload). Each core gets a stack of its own; everything else is shared.
+//!
+//! Only cpu1 sets up the C run-time environment and runs `main`. The other cores wait until the global constructors
+//! have run, and then serve #parallelFor as workers, sleeping (WFE) while there is nothing to do.
+//!
+//! The rest of the payload runtime has not been made thread-safe: the heap, stdio, interrupt and timer set-up, the
+//! tracer, the stream, host I/O and the task executor must only be used from cpu1 (or under a #Spinlock shared by all
+//! users). Code running inside #parallelFor should stick to computing.
+//!
+//! The translation tables are shared as well. bmboot::TranslationTableBuilder may only be used on cpu1, outside of
+//! #parallelFor; the other cores switch to the activated tables when they are next idle, and `activate` waits for that.
+//!
+//! In an ordinary payload, #getSmpCoreCount returns 1 and #parallelFor simply calls the body on the calling core.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace bmboot
+{
+
+//! Maximum number of cores running an SMP payload
+constexpr inline int MAX_SMP_CORES = 3;
+
+//! @return Number of cores running this payload: 3 for an SMP payload, 1 otherwise
+int getSmpCoreCount();
+
+//! @return Index of the calling core within the payload, from 0 (cpu1, which runs `main`) to #getSmpCoreCount - 1
+int getSmpCoreIndex();
+
+//! Ticket lock for data shared between the cores of an SMP payload. Waiting cores sleep in WFE.
+//!
+//! Meets the requirements of *Lockable*, so it can be used with `std::lock_guard`.
+//! Not for use in interrupt handlers which may preempt a holder of the lock on the same core.
+class Spinlock
+{
+public:
+    void lock();
+    bool try_lock();
+    void unlock();
+
+private:
+    std::atomic<uint32_t> m_next_ticket {0};
+    std::atomic<uint32_t> m_now_serving {0};
+};
+
+//! Reusable barrier for a fixed number of cores
+class Barrier
+{
+public:
+    //! @param num_cores Number of cores taking part; by default, all cores running the payload
+    explicit Barrier(int num_cores = getSmpCoreCount()) : m_num_cores(num_cores) {}
+
+    //! Block until @p num_cores cores (including this one) have arrived
+    void arriveAndWait();
+
+private:
+    uint32_t m_num_cores;
+    std::atomic<uint32_t> m_arrived {0};
+    std::atomic<uint32_t> m_generation {0};
+};
+
+namespace internal
+{
+
+using ParallelForBody = void (*)(void* context, uint32_t begin, uint32_t end);
+
+void runParallelFor(uint32_t begin, uint32_t end, uint32_t grain, ParallelForBody body, void* context, int max_cores);
+
+}
+
+//! Process the index range [@p begin, @p end) on up to @p max_cores cores, by calling `body(sub_begin, sub_end)` for
+//! disjoint sub-ranges which together cover the range. Returns once all of them have been processed.
+//!
+//! Load is balanced by work stealing: the range is split in halves on demand, each core keeps the halves it has split
+//! off in a deque of its own and works from its bottom, and an idle core steals from the top of another core's deque,
+//! taking the largest piece available. The calling core takes part in the work.
+//!
+//! Must be called from `main` on cpu1 (not from an interrupt handler). A nested call, or a call from any other core,
+//! runs the body serially on the calling core, as does any call in an ordinary payload.
+//!
+//! @param grain Sub-ranges are not split below this size; choose it so that a call of the body takes at least a few
+//!              microseconds, to amortize the cost of a steal
+//! @param max_cores Limit the number of cores taking part (e.g. to measure scaling)
+template <typename Body>
+void parallelFor(uint32_t begin, uint32_t end, uint32_t grain, Body&& body, int max_cores = MAX_SMP_CORES)
+{
+    using BodyType = std::remove_reference_t<Body>;
+
+    internal::runParallelFor(begin, end, grain,
+                             [](void* context, uint32_t sub_begin, uint32_t sub_end)
+                             {
+                                 (*(BodyType*) context)(sub_begin, sub_end);
+                             },
+                             (void*) &body,
+                             max_cores);
+}
+
+}
@@ -0,0 +1,173 @@
+//! @file
+//! @brief  Triple-buffered "latest value" channel from a payload to Linux
+//! @author Martin Cejp
+//!
+//! A snapshot channel carries a user-defined struct (typically the state of a control loop, published every cycle)
+//! from a payload to the manager, which only needs the most recent complete snapshot, at its own pace. The payload
+//! never waits for the manager and the manager never sees a snapshot which is being written.
+//!
+//! There are three buffers. At any time, one holds the latest published snapshot, one may be held by the manager while
+//! it reads, and the payload writes into a remaining one -- in place, so no snapshot is ever copied by the channel.
+//!
+//! The block must be placed in memory which both sides access without caching, normally by declaring it
+//! with @link BMBOOT_SHARED_DATA @endlink in the payload. The payload initializes it, after which the manager opens it
+//! with SnapshotReader (see snapshot_reader.hpp).
+//!
+//! This header is used on both sides.
+
+#pragma once
+
+#include "bmboot/shared_memory.hpp"
+
+#include <cstdint>
+#include <type_traits>
+
+namespace bmboot
+{
+
+namespace internal
+{
+
+constexpr uint32_t SNAPSHOT_CHANNEL_MAGIC = 0x4E484353;     // 'SCHN'
+
+}
+
+//! Triple-buffered channel publishing snapshots of type `T` from a payload (writer) to the manager (reader).
+//!
+//! The usual triple buffer hands buffers over by atomically exchanging an index. That is not possible here, because
+//! exclusive accesses do not work reliably on memory which Linux maps as Device. Instead, each side only ever writes
+//! its own word: the payload publishes the index of the latest buffer, the manager announces the index of the buffer
+//! it is reading. After publishing, the payload picks a buffer which is neither; after announcing, the manager checks
+//! that nothing has been published in the meantime, and tries again otherwise. A full barrier on each side between
+//! its store and its load guarantees that at least one of them notices the other.
+//!
+//! The block has no constructor, so that it can be placed in a NOLOAD section; call #initialize before use.
+//!
+//! @tparam T Snapshot struct; must be trivially copyable
+//! @tparam LayoutVersion User-defined version of the layout of `T` (see ParameterBlock)
+template <typename T, uint32_t LayoutVersion = 0>
+struct SnapshotChannel
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Snapshot contents must be trivially copyable");
+
+    static constexpr uint32_t NUM_BUFFERS = 3;
+
+    //! Value of #reading when the manager does not hold any buffer
+    static constexpr uint32_t NO_BUFFER = NUM_BUFFERS;
+
+    //! Value identifying the layout of `T`, compared by the reader against the payload's
+    static constexpr uint64_t LAYOUT = internal::SHARED_LAYOUT<T, LayoutVersion>;
+
+    //! Default number of attempts made by #acquireLatest
+    static constexpr int DEFAULT_ACQUIRE_ATTEMPTS = 4;
+
+    uint32_t magic;
+    uint32_t write_index;           // private to the payload
+    uint64_t layout;
+    uint64_t latest;                // written by the payload: (sequence << 2) | buffer index; sequence 0 = none yet
+    uint64_t reading;               // written by the manager
+    alignas(64) T buffers[NUM_BUFFERS];
+
+    //! Reset the channel and mark it as valid. Called by the payload, before the manager opens the channel.
+    void initialize()
+    {
+        internal::sharedStore(magic, 0);
+        internal::sharedMemoryWriteBarrier();
+
+        write_index = 0;
+        internal::sharedStore(layout, LAYOUT);
+        internal::sharedStore(latest, 0);
+        internal::sharedStore(reading, NO_BUFFER);
+
+        internal::sharedMemoryWriteBarrier();
+        internal::sharedStore(magic, internal::SNAPSHOT_CHANNEL_MAGIC);
+    }
+
+    //! @return `true` if the channel has been initialized (with any layout)
+    bool isInitialized() const
+    {
+        return internal::sharedLoad(magic) == internal::SNAPSHOT_CHANNEL_MAGIC;
+    }
+
+    //! @return `true` if the channel has been initialized with the same layout of `T`
+    bool isCompatible() const
+    {
+        return isInitialized() && internal::sharedLoad(layout) == LAYOUT;
+    }
+
+    //! Payload: get the buffer to fill in with the next snapshot.
+    //!
+    //! The buffer holds an older snapshot; fields which are not overwritten keep their old values.
+    T& getWriteBuffer()
+    {
+        return buffers[write_index];
+    }
+
+    //! Payload: publish the snapshot written into #getWriteBuffer. Never waits.
+    void publish()
+    {
+        auto published = write_index;
+
+        // Contents of the snapshot before its index
+        internal::sharedMemoryWriteBarrier();
+
+        auto sequence = (internal::sharedLoad(latest) >> 2) + 1;
+        internal::sharedStore(latest, (sequence << 2) | published);
+
+        // Publication before looking at what the manager holds (store -> load)
+        internal::sharedMemoryFullBarrier();
+
+        auto held = internal::sharedLoad(reading);
+
+        for (uint32_t i = 0; i < NUM_BUFFERS; i++)
+        {
+            if (i != published && i != held)
+            {
+                write_index = i;
+                break;
+            }
+        }
+    }
+
+    //! Manager: take hold of the buffer with the latest snapshot. The buffer held previously is released.
+    //!
+    //! @param sequence_out Receives the sequence number of the snapshot (1 for the first one published)
+    //! @param max_attempts Maximum number of attempts if the payload keeps publishing in the meantime
+    //! @return Index of the buffer, or -1 if nothing has been published yet or all attempts were unsuccessful
+    int acquireLatest(uint64_t& sequence_out, int max_attempts = DEFAULT_ACQUIRE_ATTEMPTS)
+    {
+        for (int attempt = 0; attempt < max_attempts; attempt++)
+        {
+            auto seen = internal::sharedLoad(latest);
+
+            if ((seen >> 2) == 0)
+            {
+                return -1;
+            }
+
+            internal::sharedStore(reading, seen & 3);
+
+            // Announcement before checking that the buffer is still the latest one (store -> load); this also keeps
+            // the reads of the snapshot from being performed early
+            internal::sharedMemoryFullBarrier();
+
+            if (internal::sharedLoad(latest) == seen)
+            {
+                sequence_out = seen >> 2;
+                return (int)(seen & 3);
+            }
+        }
+
+        release();
+        return -1;
+    }
+
+    //! Manager: release the buffer held, if any
+    void release()
+    {
+        internal::sharedMemoryFullBarrier();
+        internal::sharedStore(reading, NO_BUFFER);
+    }
+};
+
+}
@@ -0,0 +1,136 @@
+//! @file
+//! @brief  Manager side of a snapshot channel published by a payload
+//! @author Martin Cejp
+
+#pragma once
+
+#include "bmboot/domain.hpp"
+#include "bmboot/elf_symbolizer.hpp"
+#include "bmboot/snapshot_channel.hpp"
+
+#include <string_view>
+#include <variant>
+
+namespace bmboot
+{
+
+//! Reads the latest snapshot from a SnapshotChannel declared by a payload.
+//!
+//! Example, with `ControllerState` defined in a header shared by both sides:
+//!
+//!     // payload
+//!     BMBOOT_SHARED_DATA bmboot::SnapshotChannel<ControllerState> g_state;
+//!
+//!     g_state.initialize();
+//!     // every cycle:
+//!     auto& state = g_state.getWriteBuffer();
+//!     state.position = ...;
+//!     g_state.publish();
+//!
+//!     // manager
+//!     auto reader = SnapshotReader<ControllerState>::open(*domain, symbols, "g_state");
+//!
+//!     if (auto state = std::get<0>(reader).acquireLatest()) { use(state->position); }
+//!
+//! The snapshot is accessed in place, in a Device mapping of the shared memory. Read its fields individually; do not
+//! `memcpy` it, since that may use unaligned or cache-zeroing accesses which fault on Device memory.
+//!
+//! The reader is not thread-safe; only one may be used for a given channel at a time.
+template <typename T, uint32_t LayoutVersion = 0>
+class SnapshotReader
+{
+public:
+    using Channel = SnapshotChannel<T, LayoutVersion>;
+
+    //! Open a snapshot channel at a known physical address.
+    //!
+    //! The payload must have initialized the channel already.
+    //!
+    //! @return The reader, or an error: bad_domain_state if the channel has not been initialized, invalid_argument
+    //!         if it was initialized with a different layout or lies outside the uncached DDR block of the domain
+    static std::variant<SnapshotReader, ErrorCode> open(IDomain& domain, uintptr_t address)
+    {
+        if (address % alignof(Channel) != 0)
+        {
+            return ErrorCode::invalid_argument;
+        }
+
+        auto memory = domain.mapUncachedMemory(address, sizeof(Channel));
+
+        if (std::holds_alternative<ErrorCode>(memory))
+        {
+            return std::get<ErrorCode>(memory);
+        }
+
+        SnapshotReader reader((Channel*) std::get<std::span<uint8_t>>(memory).data());
+
+        if (!reader.m_channel->isInitialized())
+        {
+            return ErrorCode::bad_domain_state;
+        }
+
+        if (!reader.isCompatible())
+        {
+            return ErrorCode::invalid_argument;
+        }
+
+        return reader;
+    }
+
+    //! Open a snapshot channel declared in the payload as a global variable named @p symbol_name.
+    static std::variant<SnapshotReader, ErrorCode> open(IDomain& domain,
+                                                         ElfSymbolizer const& symbols,
+                                                         std::string_view symbol_name)
+    {
+        auto address = symbols.findObject(symbol_name);
+
+        if (!address.has_value())
+        {
+            return ErrorCode::invalid_argument;
+        }
+
+        return open(domain, *address);
+    }
+
+    //! Get the latest complete snapshot.
+    //!
+    //! The snapshot stays valid (the payload will not write into it) until the next call of #acquireLatest or
+    //! #release. Calling this again before anything new has been published returns the same snapshot.
+    //!
+    //! @return Pointer into the shared memory, or `nullptr` if nothing has been published yet (or, exceptionally,
+    //!         if the payload kept publishing during all attempts)
+    T const* acquireLatest()
+    {
+        auto index = m_channel->acquireLatest(m_sequence);
+
+        return (index >= 0) ? &m_channel->buffers[index] : nullptr;
+    }
+
+    //! Let the payload reuse the buffer of the snapshot returned last
+    void release()
+    {
+        m_channel->release();
+    }
+
+    //! @return Sequence number of the snapshot returned last by #acquireLatest (counting from 1). The difference
+    //!         between two calls is the number of snapshots published in between.
+    uint64_t getSequence() const
+    {
+        return m_sequence;
+    }
+
+    //! @return `false` if the channel has been reinitialized with a different layout (e.g. a different payload has
+    //!         been started), in which case reading must stop
+    bool isCompatible() const
+    {
+        return m_channel->isCompatible();
+    }
+
+private:
+    explicit SnapshotReader(Channel* channel) : m_channel(channel) {}
+
+    Channel* m_channel;
+    uint64_t m_sequence = 0;
+};
+
+}
@@ -0,0 +1,42 @@
+//! @file
+//! @brief  Streaming of fixed-size records from the payload to files on the Linux side
+//! @author Martin Cejp
+//!
+//! Each core has a 16 MiB stream ring in DDR, next to the uncached DDR blocks. The payload appends batches of records
+//! to it; on the Linux side, a StreamRecorder (or `bmctl record`) drains the ring into files.
+//!
+//! Appending never blocks. If the recorder does not keep up and the ring is full, the batch is dropped as a whole and
+//! counted, so that gaps in the recording are never silent. While no recorder is attached, records are discarded
+//! without being counted as dropped.
+//!
+//! The stream functions are not thread-safe; use them from a single execution context (e.g. one interrupt handler).
+
+#pragma once
+
+#include <cstddef>
+
+namespace bmboot
+{
+
+//! Start (or restart) the stream with records of a fixed size. Anything not yet read by the recorder is discarded,
+//! and the recorder, if attached, starts over with the new record size.
+//!
+//! @param record_size Size of one record in bytes. For the best throughput, use a multiple of 16.
+//! @return `false` if the record size is zero or larger than the ring
+bool startStream(size_t record_size);
+
+//! Append a batch of records to the stream.
+//!
+//! The records are copied into the ring (which is mapped as Normal non-cacheable, so no cache maintenance is needed).
+//! Larger batches amortize the fixed cost of the call.
+//!
+//! @param records Pointer to `count` records of the size given to #startStream
+//! @param count Number of records
+//! @return `true` if the records were stored; `false` if no recorder is attached or there was not enough space for
+//!         the whole batch (in which case the records are counted as dropped)
+bool writeStreamRecords(void const* records, size_t count);
+
+//! @return `true` if a recorder is attached to the current stream session
+bool isStreamRecorderAttached();
+
+}
@@ -0,0 +1,123 @@
+//! @file
+//! @brief  Recording of the record stream of a payload into files
+//! @author Martin Cejp
+
+#pragma once
+
+#include "bmboot/domain.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <variant>
+
+namespace bmboot
+{
+
+struct StreamRecorderOptions
+{
+    //! Files are named `<path_prefix>_0000.bin`, `<path_prefix>_0001.bin`, ... and contain the raw records, back to back
+    std::string path_prefix;
+
+    //! Once a file has reached this size, the next write goes into a new file; 0 to never rotate.
+    //! Files always contain whole records.
+    uint64_t max_file_size = 1024ull * 1024 * 1024;
+
+    //! Maximum size of a single write to the file system
+    size_t chunk_size = 4 * 1024 * 1024;
+
+    //! Open the files with `O_DIRECT`, bypassing the page cache. Writes are then multiples of 4 KiB (and of the record
+    //! size); the remainder is written without `O_DIRECT` when the recording stops.
+    bool direct_io = false;
+};
+
+struct StreamRecorderStatistics
+{
+    //! Record size of the current stream session; 0 until the payload has started the stream
+    uint32_t record_size;
+
+    //! Number of stream sessions recorded (each call of `startStream` in the payload starts a new one)
+    uint32_t sessions;
+
+    //! Bytes written to files
+    uint64_t bytes_recorded;
+
+    //! Records dropped by the payload because the ring was full, summed over all sessions
+    uint64_t records_dropped;
+
+    //! Bytes waiting in the ring at the last check, and the highest value seen
+    uint64_t ring_fill;
+    uint64_t max_ring_fill;
+
+    //! Size of the ring of the current session, in bytes
+    uint64_t ring_capacity;
+
+    //! Number of files created
+    int num_files;
+
+    //! A file could not be created or written; the recording has stopped
+    bool write_error;
+};
+
+//! Drains the stream ring of a domain into files, in a background thread.
+//!
+//! The recorder attaches to the stream as soon as the payload starts it (which may be before or after the recorder
+//! is started), and re-attaches whenever the payload restarts it; each session begins a new file. The payload only
+//! writes into the ring while a recorder is attached.
+//!
+//! Only one recorder may be attached to a domain at a time.
+class StreamRecorder
+{
+public:
+    //! Start recording. The first file is only created once there is something to write.
+    //!
+    //! @return The recorder, or an error if the stream ring cannot be mapped
+    static std::variant<std::unique_ptr<StreamRecorder>, ErrorCode> start(IDomain& domain,
+                                                                         StreamRecorderOptions options);
+
+    //! Stops the recording, if still running
+    ~StreamRecorder();
+
+    StreamRecorder(StreamRecorder const&) = delete;
+    StreamRecorder& operator=(StreamRecorder const&) = delete;
+
+    //! Detach from the stream, write out everything which the payload has written until then, and close the file
+    void stop();
+
+    StreamRecorderStatistics getStatistics() const;
+
+private:
+    StreamRecorder(std::span<uint8_t> ring, StreamRecorderOptions options);
+
+    void run();
+    bool drain(bool final);
+    bool writeToFile(uint8_t const* data, size_t size, bool final);
+    void closeFile();
+
+    std::span<uint8_t> m_ring;
+    StreamRecorderOptions m_options;
+
+    std::thread m_thread;
+    std::atomic<bool> m_stop_requested = false;
+
+    mutable std::mutex m_mutex;
+    StreamRecorderStatistics m_statistics {};
+
+    // Used by the recording thread only
+    uint32_t m_session = 0;
+    uint64_t m_read_position = 0;
+    std::optional<uint64_t> m_dropped_baseline;     // value of the payload's drop counter when first seen
+    uint64_t m_dropped_previous = 0;
+    size_t m_granularity = 1;
+    bool m_direct_io = false;
+    int m_fd = -1;
+    uint64_t m_file_size = 0;
+    std::unique_ptr<uint8_t, void (*)(void*)> m_buffer;
+};
+
+}
@@ -0,0 +1,64 @@
+//! @file
+//! @brief  Starting payloads on several domains at the same time
+//! @author Martin Cejp
+
+#pragma once
+
+#include "bmboot/domain.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <variant>
+
+namespace bmboot
+{
+
+//! One payload of a synchronized start
+struct SynchronizedStart
+{
+    IDomain* domain;
+
+    std::span<uint8_t const> payload_binary;
+
+    //! The payload is in ELF format (see IDomain::loadElfPayload); otherwise it is a raw binary
+    bool elf = false;
+
+    //! Raw binaries only
+    uint32_t payload_crc32 = 0;
+
+    uintptr_t payload_argument = 0;
+};
+
+//! Load payloads into several domains and start them at the same moment.
+//!
+//! All payloads are loaded and armed (see IDomain::loadAndArmPayload) with a common start time, @p lead_time from
+//! now; each monitor then waits on the system counter, which is shared by all cores, and enters its payload once the
+//! counter reaches the start time. The remaining skew between the cores is that of leaving the wait, typically a few
+//! counter ticks; see IDomain::getPayloadStartTimestamp.
+//!
+//! The lead time must cover loading and validating all payloads. If it does not, no payload is started: the ones
+//! already armed are terminated, and ErrorCode::payload_start_time_passed is returned.
+//!
+//! All domains must be in the state @link bmboot::monitor_ready monitor_ready@endlink.
+//!
+//! @return The start time (a value of the built-in timer), or the first error encountered
+std::variant<uint64_t, ErrorCode> startPayloadsSynchronized(std::span<SynchronizedStart const> payloads,
+                                                            std::chrono::microseconds lead_time);
+
+//! Load an SMP payload (see smp.hpp) and start it on cpu1, cpu2 and cpu3 at the same moment.
+//!
+//! The image is loaded only once, into the payload window of cpu1, and armed there like in #startPayloadsSynchronized;
+//! the other domains are then armed to start the same image (see IDomain::armPayloadOf).
+//!
+//! To stop the payload, terminate all three domains. Diagnostics of cpu2 and cpu3 which read the payload image, such
+//! as core dumps and IDomain::readPayloadMemory, refer to their own payload windows and so do not apply.
+//!
+//! @param payload The payload to load; `payload.domain` must be cpu1
+//! @param other_domains The other domains to start it on, normally cpu2 and cpu3
+//! @return The start time (a value of the built-in timer), or the first error encountered
+std::variant<uint64_t, ErrorCode> startSmpPayload(SynchronizedStart const& payload,
+                                                  std::span<IDomain* const> other_domains,
+                                                  std::chrono::microseconds lead_time);
+
+}
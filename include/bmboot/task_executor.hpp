@@ -0,0 +1,199 @@
+//! @file
+//! @brief  Priority-driven preemptive task executor
+//! @author Martin Cejp
+//!
+//! Tasks are bound to a @link bmboot::PayloadInterruptPriority @endlink level. Each level has a dispatcher running
+//! in the handler of a dedicated Software Generated Interrupt (SGI), so the GIC's priority-based preemption acts as
+//! the scheduler: a task runs to completion, unless a higher-priority task (or interrupt) becomes ready.
+//! There is no context switching code and no per-task stack.
+//!
+//! Messages are kept in a fixed number of slots embedded in each task; spawning never allocates memory.
+
+#pragma once
+
+#include "deadline_timer.hpp"
+#include "payload_runtime.hpp"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace bmboot
+{
+
+//! Message type for tasks that do not take any input
+struct NoMessage {};
+
+namespace internal
+{
+
+class TaskBase;
+
+void dispatchReadyTasks(int priority_level);
+
+struct TaskSlot : DeadlineTimerNode
+{
+    TaskBase* owner;
+};
+
+class TaskBase
+{
+public:
+    TaskBase(TaskBase const&) = delete;
+    TaskBase& operator=(TaskBase const&) = delete;
+
+protected:
+    explicit TaskBase(PayloadInterruptPriority priority) : priority(priority), free_slots(nullptr) {}
+
+    //! Take a free slot, or return nullptr if all are in use.
+    TaskSlot* acquireSlot();
+
+    //! Return a slot into the free list.
+    void releaseSlot(TaskSlot& slot);
+
+    //! Queue a filled slot for execution and trigger the dispatcher.
+    void makeReady(TaskSlot& slot);
+
+    //! Queue a filled slot for execution at the given CNTPCT value.
+    void makeReadyAt(TaskSlot& slot, uint64_t deadline);
+
+    //! Convert a delay to an absolute deadline in timer ticks.
+    static uint64_t deadlineAfter(std::chrono::microseconds delay);
+
+    //! Execute the task for a message. Called by the dispatcher.
+    virtual void run(TaskSlot& slot) = 0;
+
+    PayloadInterruptPriority priority;
+    TaskSlot* free_slots;
+
+    friend void dispatchReadyTasks(int priority_level);
+};
+
+}
+
+//! Number of distinct task priority levels (one per PayloadInterruptPriority value)
+constexpr inline int NUM_TASK_PRIORITY_LEVELS = 8;
+
+//! First SGI used by the task executor; the dispatchers occupy SGIs
+//! `TASK_DISPATCH_FIRST_SGI` to `TASK_DISPATCH_FIRST_SGI + NUM_TASK_PRIORITY_LEVELS - 1`.
+constexpr inline int TASK_DISPATCH_FIRST_SGI = 8;
+
+//! A task that can be spawned with a message.
+//!
+//! Up to `Capacity` messages can be pending (queued or waiting for their start time) at any moment.
+//! Tasks should be declared as global objects, since they must outlive any pending message.
+//!
+//! @tparam Message Type of the message passed to the task handler. Must be move-constructible.
+//! @tparam Capacity Maximum number of pending messages
+template <typename Message = NoMessage, size_t Capacity = 1>
+class Task final : private internal::TaskBase
+{
+    static_assert(Capacity > 0);
+    static_assert(std::is_nothrow_move_constructible_v<Message>);
+
+public:
+    using Handler = void (*)(Message message);
+
+    //! @param priority Priority at which the task executes.
+    //! @param handler Function to call for each message
+    Task(PayloadInterruptPriority priority, Handler handler) : TaskBase(priority), handler(handler)
+    {
+        for (auto& slot : slots)
+        {
+            slot.owner = this;
+            releaseSlot(slot);
+        }
+    }
+
+    //! Queue a message for execution as soon as possible.
+    //!
+    //! Can be called from any context. If the caller has a lower priority than the task, it will be preempted
+    //! as soon as the GIC delivers the dispatcher interrupt.
+    //!
+    //! @return true if successful, false if the message queue is full
+    bool spawn(Message message)
+    {
+        auto slot = fill(std::move(message));
+
+        if (!slot)
+        {
+            return false;
+        }
+
+        makeReady(*slot);
+        return true;
+    }
+
+    //! Queue a message for execution once the built-in timer reaches the given value.
+    //!
+    //! @param deadline Value of @link bmboot::getBuiltinTimerValue @endlink at which the task should start
+    //! @return true if successful, false if the message queue is full
+    bool spawnAt(uint64_t deadline, Message message)
+    {
+        auto slot = fill(std::move(message));
+
+        if (!slot)
+        {
+            return false;
+        }
+
+        makeReadyAt(*slot, deadline);
+        return true;
+    }
+
+    //! Queue a message for execution after a delay.
+    //!
+    //! @return true if successful, false if the message queue is full
+    bool spawnAfter(std::chrono::microseconds delay, Message message)
+    {
+        return spawnAt(deadlineAfter(delay), std::move(message));
+    }
+
+    bool spawn() requires std::is_same_v<Message, NoMessage> { return spawn(NoMessage {}); }
+    bool spawnAt(uint64_t deadline) requires std::is_same_v<Message, NoMessage> { return spawnAt(deadline, NoMessage {}); }
+    bool spawnAfter(std::chrono::microseconds delay) requires std::is_same_v<Message, NoMessage> { return spawnAfter(delay, NoMessage {}); }
+
+private:
+    struct Slot : internal::TaskSlot
+    {
+        alignas(Message) std::byte storage[sizeof(Message)];
+
+        Message* message() { return std::launder(reinterpret_cast<Message*>(storage)); }
+    };
+
+    Slot* fill(Message&& message)
+    {
+        auto slot = static_cast<Slot*>(acquireSlot());
+
+        if (slot)
+        {
+            new (slot->storage) Message(std::move(message));
+        }
+
+        return slot;
+    }
+
+    void run(internal::TaskSlot& task_slot) override
+    {
+        auto& slot = static_cast<Slot&>(task_slot);
+
+        // Free the slot before calling the handler, so that a task can re-spawn itself
+        Message message(std::move(*slot.message()));
+        slot.message()->~Message();
+        releaseSlot(slot);
+
+        handler(std::move(message));
+    }
+
+    Handler handler;
+    Slot slots[Capacity];
+};
+
+//! Configure the dispatcher interrupts of all priority levels.
+//!
+//! This is done automatically on the first spawn at each priority level, but calling this function during
+//! initialization avoids the one-time configuration cost (a few monitor calls) at a later, possibly critical moment.
+void initializeTaskExecutor();
+
+}
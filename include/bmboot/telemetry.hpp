@@ -0,0 +1,74 @@
+//! @file
+//! @brief  Operational counters of a domain
+//! @author Martin Cejp
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace bmboot
+{
+
+//! Values of the telemetry counters of a domain at one point in time.
+//!
+//! The counters are kept by the monitor and the payload runtime since the monitor was booted, so they are not reset
+//! by starting a new payload. Each counter is read atomically, but different counters may be a few updates apart.
+struct TelemetrySnapshot
+{
+    //! Host time at which the snapshot was taken
+    std::chrono::steady_clock::time_point time;
+
+    //! Number of times the monitor has started, including the restarts which terminate a payload
+    uint64_t monitor_starts;
+    uint64_t payload_starts;
+    uint64_t payload_crashes;
+
+    //! Time spent in the monitor handling secure monitor calls and FIQs (including profiler samples), in seconds
+    double monitor_time_s;
+
+    //! FIQs taken by the monitor other than profiler samples, and how many of them were requests from the manager
+    uint64_t fiqs;
+    uint64_t ipi_requests;
+
+    //! Secure monitor calls served, by function name. Only functions which have been called at least once are listed.
+    std::map<std::string, uint64_t> smc_calls;
+
+    //! Interrupts dispatched to payload handlers, by interrupt ID. Only interrupts which have occurred are listed.
+    std::map<int, uint64_t> irqs;
+
+    //! Bytes of standard output passed to the manager
+    uint64_t stdout_bytes_written;
+
+    //! Bytes of standard output discarded because the manager did not read the buffer in time
+    uint64_t stdout_bytes_dropped;
+};
+
+//! Rates of change of the telemetry counters between two snapshots, in events per second
+struct TelemetryRates
+{
+    //! Length of the interval between the snapshots
+    double interval_s;
+
+    double payload_starts;
+    double payload_crashes;
+
+    //! Fraction of the time spent in the monitor, 0 to 1
+    double monitor_load;
+
+    double fiqs;
+    double ipi_requests;
+    std::map<std::string, double> smc_calls;
+    std::map<int, double> irqs;
+    double stdout_bytes_written;
+    double stdout_bytes_dropped;
+};
+
+//! Compute the rates of change between two snapshots of the same domain.
+//!
+//! If the monitor has been rebooted in between (which resets the counters), the rates are relative to zero.
+TelemetryRates computeTelemetryRates(TelemetrySnapshot const& earlier, TelemetrySnapshot const& later);
+
+}
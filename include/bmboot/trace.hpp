@@ -0,0 +1,64 @@
+//! @file
+//! @brief  Scoped timing tracer
+//! @author Martin Cejp
+//!
+//! Records timestamped begin/end events into a ring buffer shared with the manager, which can turn them into a
+//! timeline (see `bmctl timeline`). Each event also records the interrupt nesting level and the priority of the
+//! interrupt handler in which it occurred, so that preemption is visible in the timeline.
+//!
+//! Recording an event takes a few dozen cycles and the ring is overwritten when full, so tracing can stay enabled in
+//! production builds. Define BMBOOT_TRACE_DISABLE before including this header to compile the macros out.
+//!
+//! Example:
+//!
+//!     void controlLoopIteration()
+//!     {
+//!         BMBOOT_TRACE_SCOPE("control loop");
+//!
+//!         readSensors();
+//!         {
+//!             BMBOOT_TRACE_SCOPE("compute");
+//!             compute();
+//!         }
+//!         writeActuators();
+//!     }
+
+#pragma once
+
+namespace bmboot
+{
+
+//! Record the beginning of a traced region.
+//!
+//! @param name Name of the region. Must be a string literal (or otherwise have static storage duration in the payload
+//!             memory), since only the pointer is recorded; the manager reads the string when processing the trace.
+void traceBegin(char const* name);
+
+//! Record the end of a traced region. The name must match the corresponding @link bmboot::traceBegin @endlink.
+void traceEnd(char const* name);
+
+//! Trace the lifetime of the object as a region. Normally used through BMBOOT_TRACE_SCOPE.
+class TraceScope
+{
+public:
+    explicit TraceScope(char const* name) : name(name) { traceBegin(name); }
+    ~TraceScope() { traceEnd(name); }
+
+    TraceScope(TraceScope const&) = delete;
+    TraceScope& operator=(TraceScope const&) = delete;
+
+private:
+    char const* name;
+};
+
+}
+
+#define BMBOOT_TRACE_CONCAT_(a, b) a ## b
+#define BMBOOT_TRACE_CONCAT(a, b) BMBOOT_TRACE_CONCAT_(a, b)
+
+#ifndef BMBOOT_TRACE_DISABLE
+//! Trace the rest of the enclosing block as a region called @p name (a string literal)
+#define BMBOOT_TRACE_SCOPE(name) ::bmboot::TraceScope BMBOOT_TRACE_CONCAT(bmboot_trace_scope_, __LINE__)(name)
+#else
+#define BMBOOT_TRACE_SCOPE(name) do {} while (0)
+#endif
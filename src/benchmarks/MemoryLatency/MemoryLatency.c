@@ -58,6 +58,10 @@ float RunTlbTest(uint32_t size_kb, uint32_t iterations, uint32_t *preallocatedAr
 float RunMlpTest(uint32_t size_kb, uint32_t iterations, uint32_t parallelism);
 #ifndef __bmboot__
 void RunStlfTest(uint32_t iterations, int mode);
+#else
+void RunTierTests(uint32_t iterations);
+void RunCodeFetchTest(uint32_t iterations);
+void RunTlbBlockSizeTests(uint32_t iterations);
 #endif
 
 float (*testFunc)(uint32_t, uint32_t, uint32_t *) = RunTest;
@@ -152,6 +156,19 @@ int main(int argc, char* argv[]) {
 #ifdef __bmboot__
     testFunc = RunAsmTest;
     fprintf(stderr, "Using ASM (simple address) test\n");
+
+    // payload argument 1: compare memory tiers (see bmboot/memory_arena.hpp)
+    if (bmGetPayloadArgument() == 1) {
+        RunTierTests(ITERATIONS / 100);
+        RunCodeFetchTest(1000);
+        return 0;
+    }
+
+    // payload argument 2: compare TLB behavior with 4 KiB pages and 2 MiB blocks (see bmboot/mmu.hpp)
+    if (bmGetPayloadArgument() == 2) {
+        RunTlbBlockSizeTests(ITERATIONS / 100);
+        return 0;
+    }
 #endif
 
 #if !defined(__MINGW32__) && !defined(__bmboot__)
@@ -373,12 +390,9 @@ float RunAsmTest(uint32_t size_kb, uint32_t iterations, uint32_t *preallocatedAr
     POINTER_INT *A;
     if (preallocatedArr == NULL) {
 #ifdef __bmboot__
-        if (POINTER_SIZE * list_size < 0x40000000) {
-            A = (POINTER_INT *) 0x807900000;
-        }
-        else {
-            A = NULL;
-        }
+        // Large test sizes don't fit in the payload window; the scratch tier lies outside of all per-core regions
+        bmResetArena(BM_MEMORY_TIER_DDR_SCRATCH);
+        A = bmAllocateFromTier(BM_MEMORY_TIER_DDR_SCRATCH, POINTER_SIZE * list_size, 4096);
 #else
         A = malloc(POINTER_SIZE * list_size);
 #endif
@@ -567,3 +581,120 @@ void RunStlfTest(uint32_t iterations, int mode) {
     return;
 }
 #endif
+
+#ifdef __bmboot__
+// Run the latency test in each memory tier provided by the payload runtime, up to the size of the tier
+void RunTierTests(uint32_t iterations) {
+    static const struct { BmMemoryTier tier; const char *name; } tiers[] = {
+        { BM_MEMORY_TIER_OCM, "ocm" },
+        { BM_MEMORY_TIER_DDR_CACHED, "ddr_cached" },
+        { BM_MEMORY_TIER_DDR_UNCACHED, "ddr_uncached" },
+    };
+
+    printf("Tier,Region,Latency (ns)\n");
+
+    for (int t = 0; t < sizeof(tiers) / sizeof(tiers[0]); t++) {
+        for (int i = 0; i < sizeof(default_test_sizes) / sizeof(int); i++) {
+            uint32_t *arr = bmAllocateFromTier(tiers[t].tier, default_test_sizes[i] * 1024, CACHELINE_SIZE);
+
+            if (!arr) {
+                break;
+            }
+
+            printf("%s,%d,%f\n", tiers[t].name, default_test_sizes[i], RunAsmTest(default_test_sizes[i], iterations, arr));
+            bmResetArena(tiers[t].tier);
+        }
+    }
+}
+
+// 4 KiB of straight-line code, once in DDR and once in OCM
+#define NOP_SLED asm volatile(".rept 1024\n nop\n .endr")
+
+__attribute__((noinline)) void NopSledDdr(void) { NOP_SLED; }
+BMBOOT_FAST_CODE void NopSledOcm(void) { NOP_SLED; }
+
+static uint64_t TimeCodeFetch(void (*func)(void), uint32_t iterations, int cold) {
+    uint64_t total = 0;
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        if (cold) {
+            asm volatile("ic iallu; dsb sy; isb" ::: "memory");
+        }
+
+        uint64_t start = bmGetCycleCounterValue();
+        func();
+        total += bmGetCycleCounterValue() - start;
+    }
+
+    return total / iterations;
+}
+
+// Compare instruction fetch from DDR and OCM, with the instruction cache cold (invalidated before each call) and warm
+void RunCodeFetchTest(uint32_t iterations) {
+    bmStartCycleCounter();
+
+    printf("Code region,Cold (cycles per 1024 instructions),Warm (cycles per 1024 instructions)\n");
+    printf("ddr,%lu,%lu\n", TimeCodeFetch(NopSledDdr, iterations, 1), TimeCodeFetch(NopSledDdr, iterations, 0));
+    printf("ocm,%lu,%lu\n", TimeCodeFetch(NopSledOcm, iterations, 1), TimeCodeFetch(NopSledOcm, iterations, 0));
+}
+
+// Taken from the DDR scratch tier, like the buffer used by RunAsmTest, but aligned to 2 MiB so that it can be mapped
+// with blocks. Remapping it must not touch any other region.
+#define TLB_TEST_ALIGNMENT  (2 * 1024 * 1024)
+#define TLB_TEST_MAX_SIZE   (32 * 1024 * 1024)
+
+// Pointer chasing with one element per 4 KiB page; all elements together fit in L2, so misses are dominated by
+// translation
+static float RunPageStrideTest(uint64_t *arr, uint32_t num_pages, uint32_t iterations) {
+    uint32_t *next_page = (uint32_t *)malloc(num_pages * sizeof(uint32_t));
+    if (!next_page) {
+        return 0;
+    }
+
+    FillPatternArr(next_page, num_pages, sizeof(uint32_t));
+
+    // offset each element by a cache line per page to avoid conflict misses
+#define PAGE_ELEMENT(p) (&arr[(p) * (PAGE_SIZE / sizeof(uint64_t)) + ((p) * CACHELINE_SIZE % PAGE_SIZE) / sizeof(uint64_t)])
+    for (uint32_t p = 0; p < num_pages; p++) {
+        *PAGE_ELEMENT(p) = (uint64_t)PAGE_ELEMENT(next_page[p]);
+    }
+
+    free(next_page);
+
+    uint64_t startCnt = bmGetBuiltinTimerValue();
+    uint32_t sum = latencytest(iterations, PAGE_ELEMENT(0));
+    uint64_t endCnt = bmGetBuiltinTimerValue();
+#undef PAGE_ELEMENT
+
+    if (sum == 0) printf("sum == 0 (?)\n");
+    return 1e9f * (float)(endCnt - startCnt) / bmGetBuiltinTimerFrequency() / iterations;
+}
+
+void RunTlbBlockSizeTests(uint32_t iterations) {
+    static const struct { BmPageSize page_size; const char *name; } configs[] = {
+        { BM_PAGE_SIZE_4K, "4K" },
+        { BM_PAGE_SIZE_2M, "2M" },
+    };
+
+    bmResetArena(BM_MEMORY_TIER_DDR_SCRATCH);
+    uint64_t *buffer = bmAllocateFromTier(BM_MEMORY_TIER_DDR_SCRATCH, TLB_TEST_MAX_SIZE, TLB_TEST_ALIGNMENT);
+    if (!buffer) {
+        fprintf(stderr, "Failed to allocate TLB test buffer\n");
+        return;
+    }
+
+    printf("Page size,Region (KB),Latency (ns)\n");
+
+    for (int c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        if (!bmMmuMap((uintptr_t)buffer, TLB_TEST_MAX_SIZE, BM_MEMORY_TYPE_NORMAL_WRITE_BACK, configs[c].page_size)) {
+            fprintf(stderr, "Failed to remap test buffer with %s pages\n", configs[c].name);
+            continue;
+        }
+
+        for (uint32_t size_kb = 64; size_kb <= TLB_TEST_MAX_SIZE / 1024; size_kb *= 2) {
+            printf("%s,%u,%f\n", configs[c].name, size_kb,
+                   RunPageStrideTest(buffer, size_kb / (PAGE_SIZE / 1024), iterations));
+        }
+    }
+}
+#endif
@@ -0,0 +1,52 @@
+#include <cstring>
+
+#include <bmboot/cache.hpp>
+#include <bmboot/payload_runtime.hpp>
+
+// Measures the cost of cache maintenance operations as a function of the range size.
+// Before each measurement, the buffer is written to, so that all its lines are cached and dirty (worst case).
+
+using MaintenanceFunc = void (*)(void const* address, size_t size);
+
+static void doTest(MaintenanceFunc func, char const* test_name, size_t size);
+
+constexpr size_t MAX_SIZE = 4 * 1024 * 1024;
+constexpr int REPETITIONS = 5;
+
+alignas(4096) static uint8_t buffer[MAX_SIZE];
+
+int main()
+{
+    bmboot::notifyPayloadStarted();
+
+    printf("D-cache line: %zu bytes, I-cache line: %zu bytes, set/way threshold: %zu KiB\n",
+           bmboot::getDcacheLineSize(), bmboot::getIcacheLineSize(), bmboot::DCACHE_SET_WAY_THRESHOLD / 1024);
+    printf("Operation,Size (bytes),Time (ns),Cost (ns/KiB)\n");
+
+    for (size_t size = 64; size <= MAX_SIZE; size *= 4)
+    {
+        doTest(bmboot::cleanDcacheRange, "clean", size);
+        doTest(bmboot::invalidateDcacheRange, "invalidate", size);
+        doTest(bmboot::cleanInvalidateDcacheRange, "clean+invalidate", size);
+        doTest(bmboot::invalidateIcacheRange, "invalidate I", size);
+    }
+}
+
+static void doTest(MaintenanceFunc func, char const* test_name, size_t size)
+{
+    uint64_t total_ticks = 0;
+
+    for (int i = 0; i < REPETITIONS; i++)
+    {
+        memset(buffer, i, size);
+
+        auto start_cnt = bmboot::getBuiltinTimerValue();
+        func(buffer, size);
+        auto end_cnt = bmboot::getBuiltinTimerValue();
+
+        total_ticks += end_cnt - start_cnt;
+    }
+
+    double time_ns = (double) total_ticks / REPETITIONS / (bmboot::getBuiltinTimerFrequency() / 1.0e9);
+    printf("%s,%zu,%.0f,%.1f\n", test_name, size, time_ns, time_ns / (size / 1024.0));
+}
@@ -1,25 +1,53 @@
 #include <chrono>
 #include <functional>
 
+#include <bmboot/mmu.hpp>
 #include <bmboot/payload_runtime.hpp>
 
 using BenchmarkFunc = std::function<void(int iterations)>;
 using std::chrono::duration;
 
 static void doTest(BenchmarkFunc callback, char const* test_name, int iterations);
+static void doTestsWithMemoryType(bmboot::MemoryType type, char const* type_name);
 
 // defined in fpga_latency.s
 extern "C" void ld32_fixed_address(uint32_t volatile* addr, size_t iterations);
 extern "C" void ld32_dsb_fixed_address(uint32_t volatile* addr, size_t iterations);
 extern "C" void st32_fixed_address(uint32_t volatile* addr, size_t iterations);
 extern "C" void st32_dsb_fixed_address(uint32_t volatile* addr, size_t iterations);
+extern "C" void st32_dmb_fixed_address(uint32_t volatile* addr, size_t iterations);
 
 inline uint32_t* volatile FPGA_REGISTER = (uint32_t* volatile) 0xb000'0000;
 
+// Smallest block that can be remapped without splitting into 4 KiB pages
+constexpr size_t FPGA_REGISTER_BLOCK_SIZE = 2 * 1024 * 1024;
+
 int main()
 {
     bmboot::notifyPayloadStarted();
 
+    // The whole PL window is mapped as Device-nGnRnE by default, so every write is non-posted
+    doTestsWithMemoryType(bmboot::MemoryType::device_nGnRnE, "nGnRnE");
+    doTestsWithMemoryType(bmboot::MemoryType::device_nGnRE, "nGnRE");
+
+    // Repeated stores to the same address may be gathered into fewer bus transactions
+    doTestsWithMemoryType(bmboot::MemoryType::device_GRE, "GRE");
+}
+
+static void doTestsWithMemoryType(bmboot::MemoryType type, char const* type_name)
+{
+    bmboot::TranslationTableBuilder mmu;
+
+    if (!mmu.map((uintptr_t) FPGA_REGISTER, FPGA_REGISTER_BLOCK_SIZE, type))
+    {
+        printf("failed to remap FPGA registers as %s\n", type_name);
+        return;
+    }
+
+    mmu.activate();
+
+    printf("Device-%s:\n", type_name);
+
     doTest([](int iterations) {
         ld32_fixed_address(FPGA_REGISTER, iterations);
     }, "Read", 5'000'000);
@@ -34,9 +62,14 @@ int main()
         st32_fixed_address(FPGA_REGISTER, iterations);
     }, "Write (pipelined)", 10'000'000);
 
+    // Only orders the writes; with early acknowledgement, it should not have to wait for the round-trip
+    doTest([](int iterations) {
+        st32_dmb_fixed_address(FPGA_REGISTER, iterations);
+    }, "Write (w/ DMB)", 5'000'000);
+
     doTest([](int iterations) {
         st32_dsb_fixed_address(FPGA_REGISTER, iterations);
-    }, "Write (w/ barrier)", 5'000'000);
+    }, "Write (w/ DSB)", 5'000'000);
 }
 
 static void doTest(BenchmarkFunc callback, char const* test_name, int iterations)
@@ -48,5 +81,5 @@ static void doTest(BenchmarkFunc callback, char const* test_name, int iterations
     auto time_per_iter = duration<double, std::nano>((double)(end_cnt - start_cnt)
                                                      / iterations
                                                      / (bmboot::getBuiltinTimerFrequency() / 1.0e9));
-    printf("%-20s %5.1f ns\n", test_name, time_per_iter.count());
+    printf("  %-20s %5.1f ns\n", test_name, time_per_iter.count());
 }
@@ -4,6 +4,7 @@
 .global ld32_dsb_fixed_address
 .global st32_fixed_address
 .global st32_dsb_fixed_address
+.global st32_dmb_fixed_address
 
 /*
  * x0 = addr
@@ -46,3 +47,14 @@ st32_dsb_fixed_address:
   sub x1, x1, 1
   cbnz x1, st32_dsb_fixed_address
   ret
+
+/*
+ * x0 = addr
+ * x1 = iteration count
+ */
+st32_dmb_fixed_address:
+  str wzr, [x0]
+  dmb oshst
+  sub x1, x1, 1
+  cbnz x1, st32_dmb_fixed_address
+  ret
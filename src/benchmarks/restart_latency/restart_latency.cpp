@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <bmboot/domain.hpp>
+#include <bmboot/domain_helpers.hpp>
+
+// Measures how long it takes to get from a running payload back to monitor_ready, for terminatePayload (which returns
+// straight to the command loop of the monitor) and for restartMonitor (which re-runs the complete boot sequence).
+//
+// Two times are reported for each:
+//  - monitor: from the arrival of the IPI until the monitor is ready again, according to the monitor event log
+//  - manager: the duration of the call as seen by the application, including the IPI and the polling of the state
+//
+// usage: restart_latency <domain> <payload> [iterations]
+// The payload must keep running until terminated (e.g. payload_hello_world).
+
+using namespace bmboot;
+using TerminateFunc = MaybeError (IDomain::*)();
+
+static void doTest(IDomain& domain, char const* payload_filename, TerminateFunc func, char const* test_name,
+                   char const* request_name, int iterations);
+
+int main(int argc, char** argv)
+{
+    if (argc < 3 || argc > 4)
+    {
+        fprintf(stderr, "usage: restart_latency <domain> <payload> [iterations]\n");
+        return -1;
+    }
+
+    auto domain_index = parseDomainIndex(argv[1]);
+
+    if (!domain_index.has_value())
+    {
+        fprintf(stderr, "restart_latency: unknown domain '%s'\n", argv[1]);
+        return -1;
+    }
+
+    int iterations = (argc == 4) ? atoi(argv[3]) : 20;
+
+    auto domain = throwOnError(IDomain::open(*domain_index), "IDomain::open");
+    throwOnError(domain->ensureReadyToLoadPayload(), "IDomain::ensureReadyToLoadPayload");
+
+    printf("Path,Monitor min (us),Monitor median (us),Monitor max (us),Manager min (us),Manager median (us),"
+           "Manager max (us)\n");
+
+    doTest(*domain, argv[2], &IDomain::terminatePayload, "terminatePayload", "kill", iterations);
+    doTest(*domain, argv[2], &IDomain::restartMonitor, "restartMonitor", "restart", iterations);
+}
+
+static void doTest(IDomain& domain, char const* payload_filename, TerminateFunc func, char const* test_name,
+                   char const* request_name, int iterations)
+{
+    auto cntfrq = domain.getTimerFrequency();
+
+    std::vector<double> monitor_us, manager_us;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        loadPayloadFromFileOrThrow(domain, payload_filename);
+
+        auto start = std::chrono::steady_clock::now();
+        throwOnError((domain.*func)(), test_name);
+        auto end = std::chrono::steady_clock::now();
+
+        manager_us.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+
+        auto events = domain.getMonitorEvents();
+
+        auto request = std::find_if(events.rbegin(), events.rend(), [=](MonitorEvent const& event)
+        {
+            return event.type == MonitorEventType::ipi_request && event.description == request_name;
+        });
+
+        // The first monitor_ready following the request (base() of a reverse iterator points just past its element)
+        auto ready = std::find_if(request.base(), events.end(), [](MonitorEvent const& event)
+        {
+            return event.type == MonitorEventType::state_changed && event.arg0 == DomainState::monitor_ready;
+        });
+
+        if (request != events.rend() && ready != events.end() && cntfrq != 0)
+        {
+            monitor_us.push_back((double) (ready->timestamp - request->timestamp) / cntfrq * 1e6);
+        }
+    }
+
+    auto print = [](std::vector<double>& values)
+    {
+        if (values.empty())
+        {
+            printf(",-,-,-");
+            return;
+        }
+
+        std::sort(values.begin(), values.end());
+        printf(",%.1f,%.1f,%.1f", values.front(), values[values.size() / 2], values.back());
+    };
+
+    printf("%s", test_name);
+    print(monitor_us);
+    print(manager_us);
+    printf("\n");
+}
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+
+#include <bmboot/payload_runtime.hpp>
+#include <bmboot/smp.hpp>
+
+// Scaling of bmboot::parallelFor across 1, 2 and 3 cores. Built as an SMP payload; start it with
+//
+//     bmctl start cpu1,cpu2,cpu3 payload_smp_scaling_smp.bin
+//
+// Two kernels are measured:
+//  - mandelbrot: compute-bound, with a cost per row that varies by two orders of magnitude, so that a static split of
+//    the rows would leave cores idle; this is where work stealing shows
+//  - triad: a[i] = b[i] + s * c[i] over arrays much larger than the L2 cache, bound by the DDR bandwidth shared by
+//    all cores
+//
+// The checksum must not depend on the number of cores.
+
+constexpr int REPETITIONS = 5;
+
+constexpr int MANDELBROT_SIZE = 512;
+constexpr int MANDELBROT_MAX_ITERATIONS = 1000;
+
+constexpr uint32_t TRIAD_SIZE = 512 * 1024;
+
+static uint16_t mandelbrot_image[MANDELBROT_SIZE][MANDELBROT_SIZE];
+
+static float triad_a[TRIAD_SIZE], triad_b[TRIAD_SIZE], triad_c[TRIAD_SIZE];
+
+static uint64_t mandelbrot(int max_cores)
+{
+    bmboot::parallelFor(0, MANDELBROT_SIZE, 1, [](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t row = begin; row < end; row++)
+        {
+            for (int column = 0; column < MANDELBROT_SIZE; column++)
+            {
+                float c_re = -2.0f + 2.5f * column / MANDELBROT_SIZE;
+                float c_im = -1.25f + 2.5f * row / MANDELBROT_SIZE;
+                float re = 0, im = 0;
+                int iteration = 0;
+
+                while (iteration < MANDELBROT_MAX_ITERATIONS && re * re + im * im <= 4.0f)
+                {
+                    float re_next = re * re - im * im + c_re;
+                    im = 2.0f * re * im + c_im;
+                    re = re_next;
+                    iteration++;
+                }
+
+                mandelbrot_image[row][column] = iteration;
+            }
+        }
+    }, max_cores);
+
+    uint64_t checksum = 0;
+
+    for (auto const& row : mandelbrot_image)
+    {
+        for (auto iterations : row)
+        {
+            checksum += iterations;
+        }
+    }
+
+    return checksum;
+}
+
+static uint64_t triad(int max_cores)
+{
+    bmboot::parallelFor(0, TRIAD_SIZE, 4096, [](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            triad_a[i] = triad_b[i] + 3.0f * triad_c[i];
+        }
+    }, max_cores);
+
+    uint64_t checksum = 0;
+
+    for (uint32_t i = 0; i < TRIAD_SIZE; i += 1024)
+    {
+        checksum += (uint64_t) triad_a[i];
+    }
+
+    return checksum;
+}
+
+static void doTest(uint64_t (*kernel)(int max_cores), char const* test_name)
+{
+    double single_core_us = 0;
+
+    for (int cores = 1; cores <= bmboot::getSmpCoreCount(); cores++)
+    {
+        uint64_t best_ticks = UINT64_MAX;
+        uint64_t checksum = 0;
+
+        for (int i = 0; i < REPETITIONS; i++)
+        {
+            auto start_cnt = bmboot::getBuiltinTimerValue();
+            checksum = kernel(cores);
+            auto end_cnt = bmboot::getBuiltinTimerValue();
+
+            best_ticks = std::min(best_ticks, end_cnt - start_cnt);
+        }
+
+        double time_us = (double) best_ticks / (bmboot::getBuiltinTimerFrequency() / 1.0e6);
+
+        if (cores == 1)
+        {
+            single_core_us = time_us;
+        }
+
+        printf("%s,%d,%.0f,%.2f,%" PRIu64 "\n", test_name, cores, time_us, single_core_us / time_us, checksum);
+    }
+}
+
+int main()
+{
+    bmboot::notifyPayloadStarted();
+
+    for (uint32_t i = 0; i < TRIAD_SIZE; i++)
+    {
+        triad_b[i] = i % 1000;
+        triad_c[i] = i % 7;
+    }
+
+    printf("Running on %d cores\n", bmboot::getSmpCoreCount());
+    printf("Kernel,Cores,Time (us),Speedup,Checksum\n");
+
+    doTest(mandelbrot, "mandelbrot");
+    doTest(triad, "triad");
+}
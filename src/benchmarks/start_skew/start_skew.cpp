@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <bmboot/domain.hpp>
+#include <bmboot/domain_helpers.hpp>
+#include <bmboot/synchronized_start.hpp>
+
+#include "../../utility/crc32.hpp"
+
+// Measures how far apart in time the payloads on cpu1, cpu2 and cpu3 are entered, when started with
+// startPayloadsSynchronized and, for comparison, one after another with loadAndStartPayload.
+//
+// The skew of an iteration is the difference between the earliest and the latest IDomain::getPayloadStartTimestamp,
+// i.e. it is measured at the moment each monitor hands over to its payload. The boot code of the payloads (and its
+// first fetches from DDR, which the cores compete for) comes on top of that.
+//
+// usage: start_skew <payload_cpu1> <payload_cpu2> <payload_cpu3> [iterations] [lead_time_us]
+// The payloads must keep running until terminated (e.g. payload_hello_world, built for each core).
+
+using namespace bmboot;
+
+static constexpr DomainIndex DOMAINS[] { DomainIndex::cpu1, DomainIndex::cpu2, DomainIndex::cpu3 };
+static constexpr int NUM_DOMAINS = (int) std::size(DOMAINS);
+
+static std::vector<uint8_t> readFile(char const* filename);
+static uint64_t getSkew(std::vector<std::unique_ptr<IDomain>> const& domains);
+
+int main(int argc, char** argv)
+{
+    if (argc < 1 + NUM_DOMAINS || argc > 3 + NUM_DOMAINS)
+    {
+        fprintf(stderr, "usage: start_skew <payload_cpu1> <payload_cpu2> <payload_cpu3> [iterations] [lead_time_us]\n");
+        return -1;
+    }
+
+    int iterations = (argc > 1 + NUM_DOMAINS) ? atoi(argv[1 + NUM_DOMAINS]) : 20;
+    auto lead_time = std::chrono::microseconds((argc > 2 + NUM_DOMAINS) ? atoi(argv[2 + NUM_DOMAINS]) : 200'000);
+
+    std::vector<std::unique_ptr<IDomain>> domains;
+    std::vector<std::vector<uint8_t>> binaries;
+    std::vector<SynchronizedStart> payloads;
+
+    for (int i = 0; i < NUM_DOMAINS; i++)
+    {
+        domains.push_back(throwOnError(IDomain::open(DOMAINS[i]), "IDomain::open"));
+        binaries.push_back(readFile(argv[1 + i]));
+    }
+
+    for (int i = 0; i < NUM_DOMAINS; i++)
+    {
+        auto& binary = binaries[i];
+
+        payloads.push_back(SynchronizedStart {
+            .domain = domains[i].get(),
+            .payload_binary = binary,
+            .elf = std::filesystem::path(argv[1 + i]).extension() == ".elf",
+            .payload_crc32 = crc32(0, binary.data(), binary.size()),
+            .payload_argument = 0,
+        });
+    }
+
+    auto cntfrq = domains[0]->getTimerFrequency();
+
+    std::vector<double> synchronized_ns, sequential_ns;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        for (auto& domain : domains)
+        {
+            throwOnError(domain->ensureReadyToLoadPayload(), "IDomain::ensureReadyToLoadPayload");
+        }
+
+        auto start_time = startPayloadsSynchronized(payloads, lead_time);
+
+        if (std::holds_alternative<ErrorCode>(start_time))
+        {
+            throwOnError(MaybeError(std::get<ErrorCode>(start_time)), "startPayloadsSynchronized");
+        }
+
+        synchronized_ns.push_back((double) getSkew(domains) / cntfrq * 1e9);
+
+        for (auto& domain : domains)
+        {
+            throwOnError(domain->ensureReadyToLoadPayload(), "IDomain::ensureReadyToLoadPayload");
+        }
+
+        for (int j = 0; j < NUM_DOMAINS; j++)
+        {
+            auto const& payload = payloads[j];
+
+            if (payload.elf)
+            {
+                throwOnError(domains[j]->loadElfPayload(payload.payload_binary, payload.payload_argument),
+                             "IDomain::loadElfPayload");
+            }
+            else
+            {
+                throwOnError(domains[j]->loadAndStartPayload(payload.payload_binary,
+                                                             payload.payload_crc32,
+                                                             payload.payload_argument),
+                             "IDomain::loadAndStartPayload");
+            }
+        }
+
+        sequential_ns.push_back((double) getSkew(domains) / cntfrq * 1e9);
+    }
+
+    for (auto& domain : domains)
+    {
+        throwOnError(domain->ensureReadyToLoadPayload(), "IDomain::ensureReadyToLoadPayload");
+    }
+
+    printf("Method,Skew min (ns),Skew median (ns),Skew max (ns)\n");
+
+    auto print = [](char const* method, std::vector<double>& values)
+    {
+        std::sort(values.begin(), values.end());
+        printf("%s,%.0f,%.0f,%.0f\n", method, values.front(), values[values.size() / 2], values.back());
+    };
+
+    if (iterations > 0)
+    {
+        print("startPayloadsSynchronized", synchronized_ns);
+        print("loadAndStartPayload", sequential_ns);
+    }
+}
+
+static std::vector<uint8_t> readFile(char const* filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+
+    if (!file)
+    {
+        fprintf(stderr, "start_skew: failed to open %s\n", filename);
+        exit(-1);
+    }
+
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static uint64_t getSkew(std::vector<std::unique_ptr<IDomain>> const& domains)
+{
+    uint64_t earliest = UINT64_MAX, latest = 0;
+
+    for (auto const& domain : domains)
+    {
+        auto timestamp = domain->getPayloadStartTimestamp();
+        earliest = std::min(earliest, timestamp);
+        latest = std::max(latest, timestamp);
+    }
+
+    return latest - earliest;
+}
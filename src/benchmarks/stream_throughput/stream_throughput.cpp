@@ -0,0 +1,80 @@
+#include <cinttypes>
+#include <cstdio>
+
+#include <bmboot/payload_runtime.hpp>
+#include <bmboot/stream.hpp>
+
+// Loopback throughput test of the stream ring. Run it together with `bmctl record`:
+//
+//     bmctl start cpu1 payload_stream_throughput.bin
+//     bmctl record cpu1 /tmp/stream --duration 30
+//
+// The payload writes records as fast as it can, in batches of increasing size. Each record carries a sequence number,
+// so that the recording can be checked for gaps (which must only occur where records were reported as dropped).
+// `bmctl record` reports the sustained rate at which the recording reaches the file system; the payload reports the
+// rate at which records were offered to, and accepted by, the ring.
+
+struct Record
+{
+    uint64_t sequence;
+    uint64_t timestamp;
+    uint64_t payload[6];
+};
+
+static_assert(sizeof(Record) == 64);
+
+constexpr size_t MAX_BATCH = 256;
+constexpr double SECONDS_PER_BATCH_SIZE = 5.0;
+
+static Record batch[MAX_BATCH];
+
+int main()
+{
+    bmboot::notifyPayloadStarted();
+
+    bmboot::startStream(sizeof(Record));
+
+    printf("waiting for recorder\n");
+
+    while (!bmboot::isStreamRecorderAttached())
+    {
+    }
+
+    printf("Batch (records),Offered (MB/s),Accepted (MB/s),Dropped (records)\n");
+
+    auto ticks_per_test = (uint64_t)(bmboot::getBuiltinTimerFrequency() * SECONDS_PER_BATCH_SIZE);
+    uint64_t sequence = 0;
+
+    for (size_t batch_size = 1; batch_size <= MAX_BATCH; batch_size *= 4)
+    {
+        uint64_t offered = 0, accepted = 0;
+
+        auto start_cnt = bmboot::getBuiltinTimerValue();
+        auto now = start_cnt;
+
+        while (now - start_cnt < ticks_per_test)
+        {
+            for (size_t i = 0; i < batch_size; i++)
+            {
+                batch[i].sequence = sequence++;
+                batch[i].timestamp = now;
+            }
+
+            offered += batch_size;
+
+            if (bmboot::writeStreamRecords(batch, batch_size))
+            {
+                accepted += batch_size;
+            }
+
+            now = bmboot::getBuiltinTimerValue();
+        }
+
+        double seconds = (double)(now - start_cnt) / bmboot::getBuiltinTimerFrequency();
+
+        printf("%zu,%.1f,%.1f,%" PRIu64 "\n", batch_size,
+               offered * sizeof(Record) / seconds / 1e6,
+               accepted * sizeof(Record) / seconds / 1e6,
+               offered - accepted);
+    }
+}
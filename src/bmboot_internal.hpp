@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <cstdlib>
 
@@ -23,9 +24,15 @@ constexpr inline Cookie MONITOR_CODE_COOKIE = 0x7150ABCD;
 constexpr inline int GIC_MIN_USER_INTERRUPT_ID = 0;
 constexpr inline int GIC_MAX_USER_INTERRUPT_ID = 187;
 
+// IPI messages from the manager to the monitor consist of 32-bit words: the request code, followed by arguments
 enum
 {
     IPI_REQ_KILL = 0x01,            // request to kill the payload & return to 'ready' state
+    IPI_REQ_PROFILER = 0x02,        // start/stop the sampling profiler; argument: sampling period in microseconds,
+                                    // or 0 to stop
+    IPI_REQ_SWAP = 0x03,            // like IPI_REQ_KILL, but a start_payload command has been queued beforehand; the
+                                    // restarted monitor picks it up right away
+    IPI_REQ_RESTART = 0x04,         // like IPI_REQ_KILL, but re-run the complete boot sequence of the monitor
 };
 
 enum {
@@ -33,6 +40,7 @@ enum {
     SMC_NOTIFY_PAYLOAD_STARTED,
     SMC_NOTIFY_PAYLOAD_CRASHED,
     SMC_WRITE_STDOUT,
+    SMC_WRITE_STDOUT_TIMESTAMPED,   // like SMC_WRITE_STDOUT, with the CNTPCT value of the write as 3rd argument
 
     SMC_ZYNQMP_GIC_IRQ_CONFIGURE = 0xF2000080,
     SMC_ZYNQMP_GIC_IRQ_ENABLE,
@@ -43,6 +51,7 @@ enum Command
 {
     noop = 0x00,
     start_payload = 0x01,
+    start_payload_at = 0x02,        // like start_payload, but do not enter the payload before PayloadStartBlock::start_time
 };
 
 enum Response
@@ -51,8 +60,106 @@ enum Response
     crc_mismatched,
     image_malformed,
     abi_incompatible,
+    start_time_passed,              // start_payload_at only; the payload is not started
 };
 
+// Number of first-level size classes of the TLSF heap: class 0 covers blocks below 512 bytes, class N covers
+// [2^(N+8), 2^(N+9)) bytes
+constexpr inline int HEAP_NUM_SIZE_CLASSES = 24;
+
+// Written by the payload runtime after each heap operation, read by the manager.
+// Consistent snapshots are obtained by checking that `seq` is even and unchanged across the read.
+struct HeapStatisticsBlock
+{
+    uint32_t seq;
+    uint32_t valid;                 // nonzero once the payload heap has been initialized
+
+    uint64_t heap_size;
+    uint64_t bytes_in_use;          // sum of allocated block sizes
+    uint64_t bytes_in_use_high_water;
+    uint64_t bytes_free;            // including block headers
+    uint64_t largest_free_block;    // approximate
+    uint64_t num_allocations;
+    uint64_t num_frees;
+    uint64_t num_failed_allocations;
+
+    uint32_t blocks_in_use[HEAP_NUM_SIZE_CLASSES];
+    uint32_t blocks_in_use_high_water[HEAP_NUM_SIZE_CLASSES];
+};
+
+constexpr inline uint32_t TELEMETRY_VERSION = 1;
+
+// SMC function IDs are allocated in two ranges, generic and platform-specific; calls are counted per function ID within
+// the first TELEMETRY_SMC_RANGE_SIZE IDs of each range, and in smc_calls_other beyond that
+constexpr inline int TELEMETRY_SMC_RANGE_SIZE = 8;
+
+// Operational counters, accumulated since the monitor was booted (so they survive payload restarts).
+// Each counter has a single writer -- either the monitor or the payload runtime of the domain -- and is updated with a
+// relaxed atomic store (see incrementCounter); there is no consistency between different counters.
+struct TelemetryBlock
+{
+    uint32_t version;                           // TELEMETRY_VERSION once initialized by the monitor
+    uint32_t reserved;
+
+    // Written by the monitor
+    uint64_t monitor_starts;                    // including restarts to terminate a payload
+    uint64_t payload_starts;
+    uint64_t payload_crashes;
+    uint64_t monitor_ticks;                     // CNTPCT ticks spent in the monitor's SMC and FIQ handlers
+    uint64_t fiqs;
+    uint64_t ipi_requests;
+    uint64_t smc_calls[2 * TELEMETRY_SMC_RANGE_SIZE];
+    uint64_t smc_calls_other;
+    uint64_t stdout_bytes_written;
+    uint64_t stdout_bytes_dropped;              // buffer full; the payload is told they were written anyway
+
+    // Written by the payload runtime
+    uint64_t irqs[GIC_MAX_USER_INTERRUPT_ID - GIC_MIN_USER_INTERRUPT_ID + 1];
+};
+
+// Bump a telemetry counter. With a single writer, a relaxed load and store are enough -- and unlike a read-modify-write
+// atomic, they do not need exclusive monitors.
+inline void incrementCounter(uint64_t& counter, uint64_t amount = 1)
+{
+    std::atomic_ref<uint64_t> ref(counter);
+    ref.store(ref.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// Checkpoints of the boot sequence of the monitor (_boot to monitor_ready), in the order they are reached
+enum BootCheckpoint
+{
+    BOOT_CHECKPOINT_ENTRY,                      // start of _boot
+    BOOT_CHECKPOINT_CACHES_INVALIDATED,         // after the set/way invalidation of the data caches
+    BOOT_CHECKPOINT_MMU_ENABLED,                // translation tables & caches enabled, before _startup
+    BOOT_CHECKPOINT_MAIN,                       // C runtime initialized (.bss cleared, constructors run)
+    BOOT_CHECKPOINT_INTERRUPTS,                 // GIC & IPI set up
+    BOOT_CHECKPOINT_READY,                      // about to report monitor_ready
+    BOOT_CHECKPOINT_COUNT,
+};
+
+// Values of the system counter at the boot checkpoints, written by the monitor every time it goes through _boot
+// (but not on returnToMonitor). The manager timestamps are CNTVCT readings, equal to CNTPCT in the absence of a
+// hypervisor (see ClockSync); they are only written by startup.
+struct BootTimingBlock
+{
+    uint64_t manager_reset_released;
+    uint64_t checkpoints[BOOT_CHECKPOINT_COUNT];
+    uint64_t manager_ready_observed;
+};
+
+// Timing of payload starts, in CNTPCT ticks
+struct PayloadStartBlock
+{
+    uint64_t start_time;                        // written by the manager along with Command::start_payload_at
+    uint64_t payload_entered;                   // written by the monitor right before it enters a payload (any command)
+};
+
+// Each line of standard output is preceded by an out-of-band record holding the CNTPCT value at which the payload wrote
+// it: the marker byte (ASCII Record Separator), followed by the 64-bit timestamp, little-endian. The monitor replaces
+// any marker bytes in the payload output, so that the stream can be parsed unambiguously.
+constexpr inline uint8_t STDOUT_TIMESTAMP_MARKER = 0x1E;
+constexpr inline size_t STDOUT_TIMESTAMP_RECORD_SIZE = 1 + sizeof(uint64_t);
+
 // zeroed in bmboot::startup_domain
 struct IpcBlock
 {
@@ -92,10 +199,218 @@ struct IpcBlock
         char stdout_buf[1024];
     }
     executor_to_manager;
+
+    // Sections below are appended to keep the offsets of the above fields stable
+
+    HeapStatisticsBlock heap_statistics;        // reset by the monitor when starting a payload
+    TelemetryBlock telemetry;
+    BootTimingBlock boot_timing;
+    PayloadStartBlock payload_start;
 };
 
 static_assert(sizeof(IpcBlock) <= bmboot_cpu1_monitor_ipc_SIZE);
 static_assert(sizeof(IpcBlock) <= bmboot_cpu2_monitor_ipc_SIZE);
 static_assert(sizeof(IpcBlock) <= bmboot_cpu3_monitor_ipc_SIZE);
 
+// Number of return addresses recorded per profiler sample, in addition to the PC
+constexpr inline int PROFILER_MAX_CALLERS = 7;
+constexpr inline int PROFILER_RING_SIZE = 2048;
+
+struct ProfilerSampleRecord
+{
+    uint64_t pc;                                // 0 if the monitor itself was interrupted
+    uint64_t callers[PROFILER_MAX_CALLERS];     // innermost first, terminated by 0 if shorter
+};
+
+// Written by the monitor, read by the manager.
+// A record is complete once num_samples has been incremented past it; the manager must re-check num_samples after
+// copying records out, because the ring may have wrapped around in the meantime.
+struct ProfilerBlock
+{
+    uint32_t period_us;                         // sampling period in effect, 0 when stopped
+    uint32_t reserved;
+    uint64_t num_samples;                       // total written since monitor start; next index = num_samples % ring size
+    uint64_t handler_ticks;                     // CNTPCT ticks spent in the sampling handler, for overhead estimation
+
+    ProfilerSampleRecord samples[PROFILER_RING_SIZE];
+};
+
+constexpr inline int TRACE_RING_SIZE = 4096;
+
+// Trace event: 16 bytes, so that recording one costs just a pair of stores
+struct TraceEventRecord
+{
+    uint64_t timestamp;                         // CNTPCT
+    uint64_t info;                              // see TRACE_INFO_*
+};
+
+// Layout of TraceEventRecord::info. The name is a pointer to a string literal in the payload memory.
+constexpr inline uint64_t TRACE_INFO_NAME_MASK =        0x0000'00FF'FFFF'FFFF;
+constexpr inline int TRACE_INFO_PRIORITY_SHIFT =        40;     // priority of the running interrupt handler, 0xFF if none
+constexpr inline int TRACE_INFO_NESTING_SHIFT =         48;     // interrupt nesting level, 0 in the main program
+constexpr inline uint64_t TRACE_INFO_BEGIN =            (1ull << 63);
+
+struct TraceBlock
+{
+    uint64_t num_events;                        // total written since payload start; next index = num_events % ring size
+    uint64_t reserved;
+
+    TraceEventRecord events[TRACE_RING_SIZE];
+};
+
+// Function entry/exit records of payloads built with INSTRUMENT_FUNCTIONS. Unlike the blocks above, the buffer lives in
+// the payload's .bss (symbol name below), so that it ends up in core dumps; the manager locates it via the ELF symbol
+// table. Records use the TraceEventRecord layout, with the function address in place of the name and
+// TRACE_INFO_BEGIN marking function entry.
+constexpr inline int CALL_TRACE_RING_SIZE = 8192;
+constexpr inline char CALL_TRACE_SYMBOL[] = "bmboot_call_trace";
+
+struct CallTraceBuffer
+{
+    uint64_t num_records;                       // total written since payload start
+    uint64_t reserved;
+
+    TraceEventRecord records[CALL_TRACE_RING_SIZE];
+};
+
+constexpr inline int MONITOR_EVENT_RING_SIZE = 1024;
+
+// Event recorded by the monitor, see MonitorEventType
+struct MonitorEventRecord
+{
+    uint64_t timestamp;                         // CNTPCT
+    uint32_t type;
+    uint32_t arg0;
+    uint64_t arg1;
+};
+
+// Written by the monitor, read by the manager; same protocol as ProfilerBlock.
+// Unlike the other sections, this one survives monitor restarts (so that the events leading up to a kill or a crash
+// can be inspected afterwards) and is only reset by the manager when it boots the monitor.
+struct MonitorEventBlock
+{
+    uint64_t num_events;                        // total written since monitor boot; next index = num_events % ring size
+    uint64_t reserved;
+
+    MonitorEventRecord events[MONITOR_EVENT_RING_SIZE];
+};
+
+// Diagnostic data too large for the IPC block; each section is reset by the monitor at start-up, unless noted otherwise
+struct DiagnosticsBlock
+{
+    ProfilerBlock profiler;
+    TraceBlock trace;                           // written by the payload; also reset when starting a payload
+    MonitorEventBlock monitor_events;           // not reset by the monitor
+
+    // Sections below are appended to keep the offsets of the above fields stable
+};
+
+static_assert(sizeof(DiagnosticsBlock) <= bmboot_cpu1_diagnostics_SIZE);
+static_assert(sizeof(DiagnosticsBlock) <= bmboot_cpu2_diagnostics_SIZE);
+static_assert(sizeof(DiagnosticsBlock) <= bmboot_cpu3_diagnostics_SIZE);
+
+constexpr inline uint32_t STREAM_RING_MAGIC = 0x4D525453;    // 'STRM'
+constexpr inline size_t STREAM_RING_HEADER_SIZE = 4096;     // data starts on the next page
+
+// Header of the stream ring, a byte FIFO from the payload to the manager occupying the whole stream region.
+// Positions count bytes since the payload (re)started the stream; the offset in the ring is position % capacity.
+// Each word has a single writer, since neither side can use atomic read-modify-write operations on this memory.
+// The payload only writes while the manager is attached to the current session, i.e. attached_session == session.
+struct StreamRingHeader
+{
+    // Written by the payload
+    uint32_t magic;
+    uint32_t record_size;
+    uint32_t session;                           // incremented each time the payload (re)starts the stream
+    uint32_t reserved;
+    uint64_t capacity;                          // bytes; a multiple of record_size
+    uint64_t write_position;
+    uint64_t records_written;
+    uint64_t records_dropped;                   // rejected for lack of space while the manager was attached;
+                                                // not reset when restarting the stream
+
+    // Written by the manager
+    alignas(64) uint64_t read_position;
+    uint64_t attached_session;                  // 0 if not attached
+};
+
+static_assert(sizeof(StreamRingHeader) <= STREAM_RING_HEADER_SIZE);
+
+constexpr inline uint32_t HOST_IO_MAGIC = 0x4F494F48;        // 'HOIO'
+constexpr inline size_t HOST_IO_HEADER_SIZE = 4096;         // transfer buffer starts on the next page
+
+enum class HostIoOp : uint32_t
+{
+    open,                                       // path in the transfer buffer, `size` bytes without terminator
+    close,
+    read,                                       // into the transfer buffer
+    write,                                      // from the transfer buffer
+    lseek,
+    fstat,
+};
+
+// Flags of HostIoOp::open; the O_* values of newlib and of Linux differ
+constexpr inline uint32_t HOST_IO_O_RDONLY = 0;
+constexpr inline uint32_t HOST_IO_O_WRONLY = 1;
+constexpr inline uint32_t HOST_IO_O_RDWR = 2;
+constexpr inline uint32_t HOST_IO_O_ACCMODE = 3;
+constexpr inline uint32_t HOST_IO_O_CREAT = 0x10;
+constexpr inline uint32_t HOST_IO_O_TRUNC = 0x20;
+constexpr inline uint32_t HOST_IO_O_APPEND = 0x40;
+constexpr inline uint32_t HOST_IO_O_EXCL = 0x80;
+
+// Errors reported by the manager; likewise, the errno values of newlib and of Linux differ
+enum class HostIoError : int32_t
+{
+    none,
+    io_error,                                   // anything not listed below
+    bad_file,
+    not_found,
+    access_denied,
+    exists,
+    invalid_argument,
+    no_space,
+    is_directory,
+    not_directory,
+    too_many_open_files,
+    name_too_long,
+};
+
+enum class HostIoFileType : uint32_t
+{
+    other,
+    regular,
+    directory,
+};
+
+// Header of the host I/O area, a single request slot through which the payload has the manager perform file
+// operations. The rest of the area is the transfer buffer.
+// The payload fills in the request, then publishes it by writing `request`; the manager performs it, fills in the
+// response and writes `response` = `request`. The session half of the request word changes with each payload, so that
+// the manager knows to close the files of the previous one.
+struct HostIoHeader
+{
+    // Written by the payload
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t request;                           // (session << 32) | sequence number
+    HostIoOp op;
+    int32_t fd;
+    uint32_t flags;                             // HOST_IO_O_*
+    uint32_t mode;
+    int64_t offset;                             // lseek only
+    uint64_t size;
+    int32_t whence;                             // lseek only; SEEK_SET, SEEK_CUR, SEEK_END have the same values
+
+    // Written by the manager
+    alignas(64) uint64_t server_attached;       // 1 while a server is serving requests
+    uint64_t response;                          // equal to `request` once it has been served
+    int64_t result;                             // op-specific, valid if error == none
+    HostIoError error;
+    HostIoFileType file_type;                   // fstat only
+    uint64_t file_size;                         // fstat only
+};
+
+static_assert(sizeof(HostIoHeader) <= HOST_IO_HEADER_SIZE);
+
 }
@@ -6,17 +6,55 @@
 #define bmboot_cpu1_monitor_SIZE         0x00010000
 #define bmboot_cpu1_monitor_ipc_ADDRESS  0x800030000
 #define bmboot_cpu1_monitor_ipc_SIZE     0x00004000
+#define bmboot_cpu1_diagnostics_ADDRESS  0x800040000
+#define bmboot_cpu1_diagnostics_SIZE     0x00040000
 #define bmboot_cpu1_payload_ADDRESS      0x800100000
 #define bmboot_cpu1_payload_SIZE         0x02000000
+#define bmboot_cpu1_ocm_ADDRESS          0xFFFC0000
+#define bmboot_cpu1_ocm_SIZE             0x00008000
+#define bmboot_cpu1_ddr_uncached_ADDRESS 0x806200000
+#define bmboot_cpu1_ddr_uncached_SIZE    0x00200000
+#define bmboot_cpu1_stream_ADDRESS       0x806800000
+#define bmboot_cpu1_stream_SIZE          0x01000000
+#define bmboot_cpu1_host_io_ADDRESS      0x809800000
+#define bmboot_cpu1_host_io_SIZE         0x00200000
+#define bmboot_cpu1_payload_b_ADDRESS    0x809E00000
+#define bmboot_cpu1_payload_b_SIZE       0x02000000
 #define bmboot_cpu2_monitor_ADDRESS      0x800010000
 #define bmboot_cpu2_monitor_SIZE         0x00010000
 #define bmboot_cpu2_monitor_ipc_ADDRESS  0x800034000
 #define bmboot_cpu2_monitor_ipc_SIZE     0x00004000
+#define bmboot_cpu2_diagnostics_ADDRESS  0x800080000
+#define bmboot_cpu2_diagnostics_SIZE     0x00040000
 #define bmboot_cpu2_payload_ADDRESS      0x802100000
 #define bmboot_cpu2_payload_SIZE         0x02000000
+#define bmboot_cpu2_ocm_ADDRESS          0xFFFC8000
+#define bmboot_cpu2_ocm_SIZE             0x00008000
+#define bmboot_cpu2_ddr_uncached_ADDRESS 0x806400000
+#define bmboot_cpu2_ddr_uncached_SIZE    0x00200000
+#define bmboot_cpu2_stream_ADDRESS       0x807800000
+#define bmboot_cpu2_stream_SIZE          0x01000000
+#define bmboot_cpu2_host_io_ADDRESS      0x809A00000
+#define bmboot_cpu2_host_io_SIZE         0x00200000
+#define bmboot_cpu2_payload_b_ADDRESS    0x80BE00000
+#define bmboot_cpu2_payload_b_SIZE       0x02000000
 #define bmboot_cpu3_monitor_ADDRESS      0x800020000
 #define bmboot_cpu3_monitor_SIZE         0x00010000
 #define bmboot_cpu3_monitor_ipc_ADDRESS  0x800038000
 #define bmboot_cpu3_monitor_ipc_SIZE     0x00004000
+#define bmboot_cpu3_diagnostics_ADDRESS  0x8000C0000
+#define bmboot_cpu3_diagnostics_SIZE     0x00040000
 #define bmboot_cpu3_payload_ADDRESS      0x804100000
 #define bmboot_cpu3_payload_SIZE         0x02000000
+#define bmboot_cpu3_ocm_ADDRESS          0xFFFD0000
+#define bmboot_cpu3_ocm_SIZE             0x00008000
+#define bmboot_cpu3_ddr_uncached_ADDRESS 0x806600000
+#define bmboot_cpu3_ddr_uncached_SIZE    0x00200000
+#define bmboot_cpu3_stream_ADDRESS       0x808800000
+#define bmboot_cpu3_stream_SIZE          0x01000000
+#define bmboot_cpu3_host_io_ADDRESS      0x809C00000
+#define bmboot_cpu3_host_io_SIZE         0x00200000
+#define bmboot_cpu3_payload_b_ADDRESS    0x80DE00000
+#define bmboot_cpu3_payload_b_SIZE       0x02000000
+#define bmboot_ddr_scratch_ADDRESS       0x810000000
+#define bmboot_ddr_scratch_SIZE          0x20000000
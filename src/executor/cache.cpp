@@ -0,0 +1,196 @@
+//! @file
+//! @brief  Cache maintenance
+//! @author Martin Cejp
+
+#include <bmboot/cache.hpp>
+
+#include "armv8a.hpp"
+
+using namespace bmboot;
+
+// ************************************************************
+
+enum class SetWayOp
+{
+    clean,
+    clean_invalidate,
+};
+
+size_t bmboot::getDcacheLineSize()
+{
+    return 4 << ((readSysReg(CTR_EL0) >> 16) & 0xf);
+}
+
+size_t bmboot::getIcacheLineSize()
+{
+    return 4 << (readSysReg(CTR_EL0) & 0xf);
+}
+
+// Apply a set/way operation to all data and unified caches up to the level of coherency
+static void maintainDcacheAllBySetWay(SetWayOp op)
+{
+    auto clidr = readSysReg(CLIDR_EL1);
+    int level_of_coherence = (clidr >> 24) & 0b111;
+
+    asm volatile("dsb sy" ::: "memory");
+
+    for (int level = 0; level < level_of_coherence; level++)
+    {
+        int cache_type = (clidr >> (level * 3)) & 0b111;
+
+        if (cache_type < 2)
+        {
+            // no data cache at this level
+            continue;
+        }
+
+        writeSysReg(CSSELR_EL1, level << 1);
+        asm volatile("isb");
+        auto ccsidr = readSysReg(CCSIDR_EL1);
+
+        int line_shift = (ccsidr & 0b111) + 4;
+        int num_ways = ((ccsidr >> 3) & 0x3ff) + 1;
+        int num_sets = ((ccsidr >> 13) & 0x7fff) + 1;
+        int way_shift = (num_ways > 1) ? __builtin_clz(num_ways - 1) : 0;
+
+        for (int way = 0; way < num_ways; way++)
+        {
+            for (int set = 0; set < num_sets; set++)
+            {
+                uint64_t set_way = ((uint64_t) way << way_shift) | ((uint64_t) set << line_shift) | (level << 1);
+
+                if (op == SetWayOp::clean)
+                {
+                    asm volatile("dc csw, %0" : : "r" (set_way) : "memory");
+                }
+                else
+                {
+                    asm volatile("dc cisw, %0" : : "r" (set_way) : "memory");
+                }
+            }
+        }
+    }
+
+    asm volatile("dsb sy; isb" ::: "memory");
+}
+
+// ************************************************************
+
+// Apply a by-VA operation to every line overlapping [address, address + size).
+// The instruction must be a string literal, hence a macro.
+#define FOR_EACH_LINE(INSTRUCTION, address, size, line_size)                                        \
+    do                                                                                              \
+    {                                                                                               \
+        auto start_ = (uintptr_t) (address) & ~((line_size) - 1);                                   \
+        auto end_ = (uintptr_t) (address) + (size);                                                 \
+                                                                                                    \
+        for (auto line_ = start_; line_ < end_; line_ += (line_size))                               \
+        {                                                                                           \
+            asm volatile(INSTRUCTION ", %0" : : "r" (line_) : "memory");                            \
+        }                                                                                           \
+    }                                                                                               \
+    while (0)
+
+void bmboot::cleanDcacheRange(void const* address, size_t size)
+{
+    auto line_size = getDcacheLineSize();
+
+    if (size == 0)
+    {
+        return;
+    }
+    else if (((uintptr_t) address & (line_size - 1)) + size <= line_size)
+    {
+        // fast path: single line
+        asm volatile("dc cvac, %0; dsb sy" : : "r" (address) : "memory");
+    }
+    else if (size > DCACHE_SET_WAY_THRESHOLD)
+    {
+        maintainDcacheAllBySetWay(SetWayOp::clean);
+    }
+    else
+    {
+        FOR_EACH_LINE("dc cvac", address, size, line_size);
+        asm volatile("dsb sy" ::: "memory");
+    }
+}
+
+void bmboot::invalidateDcacheRange(void const* address, size_t size)
+{
+    auto line_size = getDcacheLineSize();
+    auto start = (uintptr_t) address;
+    auto end = start + size;
+
+    if (size == 0)
+    {
+        return;
+    }
+
+    // Partial lines at the edges might hold somebody else's dirty data: clean & invalidate those
+    if (start & (line_size - 1))
+    {
+        asm volatile("dc civac, %0" : : "r" (start) : "memory");
+        start = (start | (line_size - 1)) + 1;
+    }
+
+    if (end & (line_size - 1) && end > start)
+    {
+        end &= ~(line_size - 1);
+        asm volatile("dc civac, %0" : : "r" (end) : "memory");
+    }
+
+    for (auto line = start; line < end; line += line_size)
+    {
+        asm volatile("dc ivac, %0" : : "r" (line) : "memory");
+    }
+
+    asm volatile("dsb sy" ::: "memory");
+}
+
+void bmboot::cleanInvalidateDcacheRange(void const* address, size_t size)
+{
+    auto line_size = getDcacheLineSize();
+
+    if (size == 0)
+    {
+        return;
+    }
+    else if (((uintptr_t) address & (line_size - 1)) + size <= line_size)
+    {
+        asm volatile("dc civac, %0; dsb sy" : : "r" (address) : "memory");
+    }
+    else if (size > DCACHE_SET_WAY_THRESHOLD)
+    {
+        maintainDcacheAllBySetWay(SetWayOp::clean_invalidate);
+    }
+    else
+    {
+        FOR_EACH_LINE("dc civac", address, size, line_size);
+        asm volatile("dsb sy" ::: "memory");
+    }
+}
+
+void bmboot::cleanInvalidateDcacheAll()
+{
+    maintainDcacheAllBySetWay(SetWayOp::clean_invalidate);
+}
+
+void bmboot::invalidateIcacheRange(void const* address, size_t size)
+{
+    auto line_size = getIcacheLineSize();
+
+    if (size == 0)
+    {
+        return;
+    }
+    else if (((uintptr_t) address & (line_size - 1)) + size <= line_size)
+    {
+        asm volatile("ic ivau, %0" : : "r" (address) : "memory");
+    }
+    else
+    {
+        FOR_EACH_LINE("ic ivau", address, size, line_size);
+    }
+
+    asm volatile("dsb ish; isb" ::: "memory");
+}
@@ -25,3 +25,14 @@ IpcBlock& internal::getIpcBlock()
         default: abort();
     }
 }
+
+DiagnosticsBlock& internal::getDiagnosticsBlock()
+{
+    switch (getCpuIndex())
+    {
+        case 1: return *(DiagnosticsBlock*) bmboot_cpu1_diagnostics_ADDRESS;
+        case 2: return *(DiagnosticsBlock*) bmboot_cpu2_diagnostics_ADDRESS;
+        case 3: return *(DiagnosticsBlock*) bmboot_cpu3_diagnostics_ADDRESS;
+        default: abort();
+    }
+}
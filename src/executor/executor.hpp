@@ -11,5 +11,6 @@ namespace bmboot::internal
 
 int getCpuIndex();
 IpcBlock& getIpcBlock();
+DiagnosticsBlock& getDiagnosticsBlock();
 
 }
@@ -75,6 +75,19 @@ struct GICD
     volatile uint32_t reserved_bfc;
 
     volatile uint32_t ICFGRn[64];           // Interrupt Configuration Registers
+    volatile uint32_t impl_def_d00[64];
+    volatile uint32_t NSACRn[64];           // Non-secure Access Control Registers
+
+    volatile uint32_t SGIR;                 // Software Generated Interrupt Register
+    volatile uint32_t reserved_f04[3];
+    volatile uint8_t  CPENDSGIRn[16];       // SGI Clear-Pending Registers
+    volatile uint8_t  SPENDSGIRn[16];       // SGI Set-Pending Registers
+
+    // per Table 4-21 GICD_SGIR bit assignments
+    static constexpr inline uint32_t SGIR_TargetListFilter_SELF = (0b10 << 24);
+    static constexpr inline uint32_t SGIR_SGIINTID_MASK =         0x0000000FU;
+
+    static constexpr inline int NUM_SGIS = 16;
 
     inline void clearActive(int interrupt_id)
     {
@@ -91,6 +104,12 @@ struct GICD
         ICPENDRn[interrupt_id / 32] = (1 << (interrupt_id % 32));
     }
 
+    // The pending state of an SGI is tracked separately for each source CPU and ICPENDRn has no effect on it
+    inline void clearPendingSgi(int interrupt_id)
+    {
+        CPENDSGIRn[interrupt_id] = 0xFF;
+    }
+
     inline void setEnable(int interrupt_id)
     {
         ISENABLERn[interrupt_id / 32] = (1 << (interrupt_id % 32));
@@ -115,6 +134,6 @@ struct GICD
     }
 };
 
-static_assert(sizeof(GICD) == 0xD00);
+static_assert(sizeof(GICD) == 0xF30);
 
 }
@@ -0,0 +1,46 @@
+//! @file
+//! @brief  Monitor event log
+//! @author Martin Cejp
+//!
+//! An always-on record of what the monitor has been doing: commands, secure monitor calls, IPIs, state changes and
+//! crashes. Recording an event costs a handful of stores, so nothing needs to be switched on in advance to be able to
+//! find out, after the fact, why a payload got stuck or how it ended.
+
+#include "armv8a.hpp"
+#include "executor.hpp"
+#include "executor_asm.hpp"
+#include "monitor_internal.hpp"
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+// ************************************************************
+
+void internal::logEvent(MonitorEventType type, uint32_t arg0, uint64_t arg1)
+{
+    auto& log = getDiagnosticsBlock().monitor_events;
+
+    // Mask FIQs so that an IPI taken in the middle does not record into the same slot
+    uint64_t saved_daif;
+    asm volatile("mrs %0, DAIF; msr DAIFSet, #1" : "=r" (saved_daif) :: "memory");
+
+    auto index = log.num_events;
+    auto& record = log.events[index % MONITOR_EVENT_RING_SIZE];
+
+    record.timestamp = readSysReg(CNTPCT_EL0);
+    record.type = (uint32_t) type;
+    record.arg0 = arg0;
+    record.arg1 = arg1;
+
+    memory_write_reorder_barrier();
+    ((volatile MonitorEventBlock&) log).num_events = index + 1;
+
+    asm volatile("msr DAIF, %0" :: "r" (saved_daif) : "memory");
+}
+
+void internal::setDomainState(DomainState state)
+{
+    ((volatile IpcBlock&) getIpcBlock()).executor_to_manager.state = state;
+
+    logEvent(MonitorEventType::state_changed, state);
+}
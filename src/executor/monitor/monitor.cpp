@@ -11,6 +11,8 @@
 #include "platform_interrupt_controller.hpp"
 #include "utility/crc32.hpp"
 
+#include <bmboot/cache.hpp>
+
 #include <string.h>
 
 using namespace bmboot;
@@ -19,22 +21,49 @@ using namespace bmboot::internal;
 // ************************************************************
 
 static void dummy_payload();
+[[noreturn]] static void enterPayload(uintptr_t entry_address);
+static void resetPerformanceMonitors();
+static void waitForCounter(uint64_t deadline);
 static Response validatePayload(void const* image, size_t image_size, uint32_t crc_expected);
 
 // ************************************************************
 
 extern "C" int main()
+{
+    auto& ipc_block = (volatile IpcBlock &) getIpcBlock();
+
+    // This is normally set by the firmware... plot twist -- we're the firmware now.
+    writeSysReg(CNTFRQ_EL0, ipc_block.manager_to_executor.cntfrq);
+
+    recordBootCheckpoint(BOOT_CHECKPOINT_MAIN);
+    monitorMain();
+}
+
+extern "C" void cleanUpPayloadCaches()
+{
+    // By set/way: walking both payload windows (2x 32 MiB) and the OCM slice by address would take milliseconds,
+    // while the caches only hold about 1 MiB
+    cleanInvalidateDcacheAll();
+}
+
+// Entered from main() after a full boot, and from returnToMonitor when a payload is terminated
+void internal::monitorMain()
 {
     auto& ipc_block = (volatile IpcBlock &) getIpcBlock();
     volatile const auto& inbox = ipc_block.manager_to_executor;
     volatile auto& outbox = ipc_block.executor_to_manager;
 
-    // This is normally set by the firmware... plot twist -- we're the firmware now.
-    writeSysReg(CNTFRQ_EL0, inbox.cntfrq);
+    logEvent(MonitorEventType::monitor_started, outbox.state);
+    initializeTelemetry();
 
+    initializeProfiler();
     platform::setupInterrupts();
+    recordBootCheckpoint(BOOT_CHECKPOINT_INTERRUPTS);
 
-    outbox.state = DomainState::monitor_ready;
+    // Before the state, so that the manager finds the complete record once it sees monitor_ready
+    recordBootCheckpoint(BOOT_CHECKPOINT_READY);
+    memory_write_reorder_barrier();
+    setDomainState(DomainState::monitor_ready);
 
     for (;;)
     {
@@ -42,6 +71,8 @@ extern "C" int main()
         {
             // TODO: must check for sequence breaks
 
+            logEvent(MonitorEventType::command, inbox.cmd, inbox.payload_entry_address);
+
             switch (inbox.cmd)
             {
             case Command::noop:
@@ -49,17 +80,27 @@ extern "C" int main()
                 break;
 
             case Command::start_payload:
-                outbox.state = DomainState::starting_payload;
+            case Command::start_payload_at:
+                setDomainState(DomainState::starting_payload);
 
-                // FLush all I-cache. Overkill?
-                // FIXME: Must also flush D-cache, since the binary contains data
-                //        Ah, but what if we have dirty lines? Should flush when payload exits, now's too late!
+                // Do not let the manager see the heap or the trace of the previous payload
+                memset((void*) &ipc_block.heap_statistics, 0, sizeof(ipc_block.heap_statistics));
+                memset(&getDiagnosticsBlock().trace, 0, sizeof(TraceBlock));
+
+                resetPerformanceMonitors();
+
+                // The payload's boot code runs with the MMU and caches disabled until it has set up its translation
+                // tables, so anything still cached here must reach memory and no stale lines may survive.
+                // The dirty lines of a terminated payload are not the concern here: returnToMonitor has already written
+                // them back, before the manager was allowed to load the new image.
+                cleanInvalidateDcacheAll();
                 platform::flushICache();
 
                 // TODO: legitimize this h_a_c_k
                 if (inbox.payload_entry_address == 0xbaadf00d)
                 {
-                    enterEL1Payload((uintptr_t) &dummy_payload);
+                    incrementCounter(getTelemetry().payload_starts);
+                    enterPayload((uintptr_t) &dummy_payload);
                 }
                 else
                 {
@@ -67,17 +108,36 @@ extern "C" int main()
                                                 inbox.payload_size,
                                                 inbox.payload_crc);
 
+                    bool timed = (inbox.cmd == Command::start_payload_at);
+                    uint64_t start_time = ipc_block.payload_start.start_time;
+
+                    // Only now, since validation takes time in proportion to the size of the image. A late start would
+                    // defeat the purpose of a synchronized one, so it is refused instead.
+                    if (resp == Response::crc_ok && timed && readSysReg(CNTPCT_EL0) >= start_time)
+                    {
+                        resp = Response::start_time_passed;
+                    }
+
+                    logEvent(MonitorEventType::command_response, resp);
+
                     outbox.cmd_resp = resp;
                     memory_write_reorder_barrier();
                     outbox.cmd_ack = (outbox.cmd_ack + 1);
 
                     if (resp == Response::crc_ok)
                     {
-                        enterEL1Payload(inbox.payload_entry_address);
+                        incrementCounter(getTelemetry().payload_starts);
+
+                        if (timed)
+                        {
+                            waitForCounter(start_time);
+                        }
+
+                        enterPayload(inbox.payload_entry_address);
                     }
                 }
 
-                outbox.state = DomainState::monitor_ready;
+                setDomainState(DomainState::monitor_ready);
                 break;
             }
         }
@@ -132,6 +192,83 @@ static Response validatePayload(void const* image, size_t image_size, uint32_t c
 
 // ************************************************************
 
+static void enterPayload(uintptr_t entry_address)
+{
+    auto& payload_start = (volatile PayloadStartBlock&) getIpcBlock().payload_start;
+
+    payload_start.payload_entered = readSysReg(CNTPCT_EL0);
+    enterEL1Payload(entry_address);
+
+    // enterEL1Payload does not return; the payload only ever leaves through an exception
+    __builtin_unreachable();
+}
+
+// Wait until the system counter reaches the deadline, with FIQs masked for the last stretch (they are unmasked again by
+// entering the payload).
+//
+// While the deadline is far, the core sleeps in WFE and is woken by the event stream of the counter, every
+// 2^(EVENT_STREAM_BIT + 1) ticks (2.56 us at 100 MHz). Since the event stream has no phase relation to the deadline,
+// the last two periods are spent polling CNTPCT, so that the payload is entered within a few ticks of the deadline.
+static void waitForCounter(uint64_t deadline)
+{
+    constexpr uint64_t EVENT_STREAM_BIT = 7;
+    constexpr uint64_t EVENT_STREAM_PERIOD = 2ull << EVENT_STREAM_BIT;
+
+    auto cntkctl = readSysReg(CNTKCTL_EL1);
+
+    // EVNTI = EVENT_STREAM_BIT, EVNTDIR = 0 (0-to-1 transitions), EVNTEN = 1
+    writeSysReg(CNTKCTL_EL1, (cntkctl & ~0xfcull) | (EVENT_STREAM_BIT << 4) | (1 << 2));
+    asm volatile("isb");
+
+    while (readSysReg(CNTPCT_EL0) + 2 * EVENT_STREAM_PERIOD < deadline)
+    {
+        asm volatile("wfe");
+    }
+
+    // The payload should not inherit the event stream
+    writeSysReg(CNTKCTL_EL1, cntkctl);
+    asm volatile("msr DAIFSet, #0x3" ::: "memory");
+    asm volatile("isb");
+
+    while (readSysReg(CNTPCT_EL0) < deadline)
+    {
+    }
+}
+
+// ************************************************************
+
+// Give the payload full access to the PMU and make sure it does not inherit any counts or configuration from its
+// predecessor
+static void resetPerformanceMonitors()
+{
+    auto num_counters = (readSysReg(PMCR_EL0) >> 11) & 0x1f;
+
+    // MDCR_EL3: TPM=0 (no trapping of PMU accesses), SPME=0 (no counting in Secure state, i.e. in the monitor)
+    writeSysReg(MDCR_EL3, 0);
+    // MDCR_EL2: HPMN=N (all event counters accessible from EL1), TPM=TPMCR=0, HPME=0
+    writeSysReg(MDCR_EL2, num_counters);
+    // The payload does not use EL0
+    writeSysReg(PMUSERENR_EL0, 0);
+
+    writeSysReg(PMCNTENCLR_EL0, ~0u);
+    writeSysReg(PMINTENCLR_EL1, ~0u);
+    writeSysReg(PMOVSCLR_EL0, ~0u);
+    // Disable & reset all counters
+    writeSysReg(PMCR_EL0, (1 << 1) | (1 << 2));
+    writeSysReg(PMCCFILTR_EL0, 0);
+
+    for (uint64_t i = 0; i < num_counters; i++)
+    {
+        writeSysReg(PMSELR_EL0, i);
+        asm volatile("isb");
+        writeSysReg(PMXEVTYPER_EL0, 0);
+    }
+
+    asm volatile("isb");
+}
+
+// ************************************************************
+
 // this exists so that we have *something* to jump to in EL1 when the real payload is to be hot-loaded by a debugger
 static void dummy_payload()
 {
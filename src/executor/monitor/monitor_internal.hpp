@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "bmboot.hpp"
 #include "bmboot_internal.hpp"
 
 namespace bmboot::internal
@@ -15,11 +16,63 @@ enum class CrashingEntity
     payload,
 };
 
+// Part of the stack frame built by FIQInterruptHandler in asm_vectors.S, lowest address first
+struct FiqFrame
+{
+    uint64_t spsr;
+    uint64_t reserved;
+    uint64_t cptr;
+    uint64_t elr;
+    uint64_t x29;
+    uint64_t x30;
+    // further registers follow
+};
+
 void reportCrash(CrashingEntity who, const char* desc, uintptr_t address);
 void handleSmc(Aarch64_Regs& saved_regs);
 
+// Event log (event_log.cpp)
+void logEvent(MonitorEventType type, uint32_t arg0 = 0, uint64_t arg1 = 0);
+void setDomainState(DomainState state);                 // also logs the change
+
+// Telemetry counters (telemetry.cpp)
+TelemetryBlock& getTelemetry();
+void initializeTelemetry();
+void countSmc(uint64_t function_id);
+void recordBootCheckpoint(BootCheckpoint checkpoint);   // only until monitor_ready is first reached after _boot
+
+// Adds the time until the end of the scope to the monitor_ticks counter
+class MonitorTimeScope
+{
+public:
+    MonitorTimeScope();
+    ~MonitorTimeScope();
+
+    MonitorTimeScope(MonitorTimeScope const&) = delete;
+    MonitorTimeScope& operator=(MonitorTimeScope const&) = delete;
+
+    // Add the time so far right away; for paths which leave the scope without unwinding (returnToMonitor, _boot)
+    void finish();
+
+private:
+    uint64_t start;
+    bool finished = false;
+};
+
+// Sampling profiler (profiler.cpp)
+void initializeProfiler();
+void configureProfiler(uint32_t period_us);
+void handleProfilerTimer(FiqFrame const& frame);
+
+// Initialization up to the monitor_ready state & command loop (monitor.cpp)
+extern "C" [[noreturn]] void monitorMain();
+
+// Write back and discard the data cache lines of a terminated payload (monitor.cpp, called by returnToMonitor)
+extern "C" void cleanUpPayloadCaches();
+
 // Assembly functions
 extern "C" void _boot();
 extern "C" void enterEL1Payload(uintptr_t address);
+extern "C" [[noreturn]] void returnToMonitor();
 
 }
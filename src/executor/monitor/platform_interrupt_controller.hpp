@@ -43,6 +43,12 @@ enum class InterruptTrigger
 
 void flushICache();
 
+//! Route the secure physical timer interrupt to the monitor (FIQ) and enable it. Used by the sampling profiler.
+void enableProfilerTimerInterrupt();
+
+//! Disable the secure physical timer interrupt
+void disableProfilerTimerInterrupt();
+
 //! Disable all interrupts that have been routed to EL1
 //! This is necessary when the monitor restarts, since the IRQ/FIQ routing options will be reset and the interrupts
 //! would be delivered to EL3 (and we crash pretty hard on any spurious interrupt. that's by design.)
@@ -0,0 +1,150 @@
+//! @file
+//! @brief  Sampling profiler
+//! @author Martin Cejp
+//!
+//! The secure physical timer (CNTPS) is owned by EL3 and invisible to the payload. While the profiler is active, it
+//! interrupts the core periodically; each FIQ records the interrupted PC and a few return addresses found by following
+//! the frame pointer chain. The payload needs no cooperation beyond being compiled with frame pointers.
+
+#include "armv8a.hpp"
+#include "executor.hpp"
+#include "executor_asm.hpp"
+#include "monitor_internal.hpp"
+#include "platform_interrupt_controller.hpp"
+
+#include <string.h>
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+// ************************************************************
+
+static uint64_t period_ticks;
+
+// Frame records must lie in the payload memory (either slot, or the window of cpu1, from which an SMP payload runs on all
+// cores); anything else means that the chain is broken (or the code was compiled without frame pointers) and following
+// it further could fault in EL3
+static bool isPlausibleFrameRecord(uintptr_t fp, uintptr_t previous_fp)
+{
+    uintptr_t start, end, start_b, end_b;
+
+    switch (getCpuIndex())
+    {
+        case 1:
+            start = bmboot_cpu1_payload_ADDRESS; end = start + bmboot_cpu1_payload_SIZE;
+            start_b = bmboot_cpu1_payload_b_ADDRESS; end_b = start_b + bmboot_cpu1_payload_b_SIZE;
+            break;
+        case 2:
+            start = bmboot_cpu2_payload_ADDRESS; end = start + bmboot_cpu2_payload_SIZE;
+            start_b = bmboot_cpu2_payload_b_ADDRESS; end_b = start_b + bmboot_cpu2_payload_b_SIZE;
+            break;
+        case 3:
+            start = bmboot_cpu3_payload_ADDRESS; end = start + bmboot_cpu3_payload_SIZE;
+            start_b = bmboot_cpu3_payload_b_ADDRESS; end_b = start_b + bmboot_cpu3_payload_b_SIZE;
+            break;
+        default: return false;
+    }
+
+    bool in_payload = (fp >= start && fp + 16 <= end) || (fp >= start_b && fp + 16 <= end_b)
+            || (fp >= bmboot_cpu1_payload_ADDRESS && fp + 16 <= bmboot_cpu1_payload_ADDRESS + bmboot_cpu1_payload_SIZE);
+
+    // The stack grows downwards, so callers' frames are found at higher addresses
+    return fp % 16 == 0 && in_payload && fp > previous_fp;
+}
+
+// ************************************************************
+
+void internal::initializeProfiler()
+{
+    // The timer keeps running through a monitor restart
+    writeSysReg(CNTPS_CTL_EL1, 0);
+    platform::disableProfilerTimerInterrupt();
+
+    memset(&getDiagnosticsBlock().profiler, 0, sizeof(ProfilerBlock));
+}
+
+void internal::configureProfiler(uint32_t period_us)
+{
+    auto& profiler = (volatile ProfilerBlock&) getDiagnosticsBlock().profiler;
+
+    if (period_us == 0)
+    {
+        writeSysReg(CNTPS_CTL_EL1, 0);
+        platform::disableProfilerTimerInterrupt();
+        profiler.period_us = 0;
+        return;
+    }
+
+    period_ticks = readSysReg(CNTFRQ_EL0) * period_us / 1'000'000;
+
+    if (period_ticks == 0)
+    {
+        period_ticks = 1;
+    }
+
+    writeSysReg(CNTPS_CVAL_EL1, readSysReg(CNTPCT_EL0) + period_ticks);
+    writeSysReg(CNTPS_CTL_EL1, 1);                                              // ENABLE=1, IMASK=0
+    platform::enableProfilerTimerInterrupt();
+
+    profiler.period_us = period_us;
+}
+
+void internal::handleProfilerTimer(FiqFrame const& frame)
+{
+    auto start_ticks = readSysReg(CNTPCT_EL0);
+
+    // Schedule relative to the previous deadline, so that the sampling rate does not drift. If we have fallen behind
+    // (for example, FIQs were masked for a long time), do not try to catch up.
+    auto next_deadline = readSysReg(CNTPS_CVAL_EL1) + period_ticks;
+
+    if (next_deadline <= start_ticks)
+    {
+        next_deadline = start_ticks + period_ticks;
+    }
+
+    writeSysReg(CNTPS_CVAL_EL1, next_deadline);
+
+    auto& profiler = getDiagnosticsBlock().profiler;
+    auto& record = profiler.samples[profiler.num_samples % PROFILER_RING_SIZE];
+
+    int num_callers = 0;
+
+    // SPSR_EL3.M[3:2] is the exception level that was interrupted
+    if (((frame.spsr >> 2) & 0b11) == 3)
+    {
+        // Interrupted the monitor itself (idle, or between commands)
+        record.pc = 0;
+    }
+    else
+    {
+        record.pc = frame.elr;
+
+        // Frame record: [fp] = caller's fp, [fp + 8] = return address
+        uintptr_t previous_fp = 0;
+
+        for (uintptr_t fp = frame.x29;
+             num_callers < PROFILER_MAX_CALLERS && isPlausibleFrameRecord(fp, previous_fp);
+             previous_fp = fp, fp = ((uint64_t const*) fp)[0])
+        {
+            auto return_address = ((uint64_t const*) fp)[1];
+
+            if (return_address == 0)
+            {
+                break;
+            }
+
+            record.callers[num_callers++] = return_address;
+        }
+    }
+
+    if (num_callers < PROFILER_MAX_CALLERS)
+    {
+        record.callers[num_callers] = 0;
+    }
+
+    // The record must be complete before the manager is allowed to see it
+    memory_write_reorder_barrier();
+    ((volatile ProfilerBlock&) profiler).num_samples = profiler.num_samples + 1;
+
+    profiler.handler_ticks += readSysReg(CNTPCT_EL0) - start_ticks;
+}
@@ -17,12 +17,16 @@ using namespace bmboot::internal;
 
 static void reportPayloadStarted()
 {
-    getIpcBlock().executor_to_manager.state = DomainState::running_payload;
+    setDomainState(DomainState::running_payload);
 }
 
 // ************************************************************
 
-static int writeToStdout(void const* data, size_t size)
+// Whether the last byte written did not end a line; otherwise the next one is preceded by a timestamp record.
+// Lives in .bss, so that it is cleared whenever the monitor restarts.
+static bool stdout_mid_line;
+
+static int writeToStdout(void const* data, size_t size, uint64_t timestamp)
 {
     auto& ipc_block = getIpcBlock();
     auto& outbox = ipc_block.executor_to_manager;
@@ -35,33 +39,66 @@ static int writeToStdout(void const* data, size_t size)
 
         // printf bloats the monitor binary too much, so we cannot easily report the observed value
         char const message[] = "unexpected dom_stdout_wrpos, reset to 0\n";
-        writeToStdout(message, sizeof(message) - 1);
+        stdout_mid_line = false;
+        writeToStdout(message, sizeof(message) - 1, timestamp);
     }
 
     auto data_bytes = static_cast<uint8_t const*>(data);
     size_t wrote = 0;
+    size_t dropped = 0;
+
+    // The write position is only published at the end, so the manager never sees a partial timestamp record
+    auto wrpos = outbox.stdout_wrpos;
+    auto rdpos = ipc_block.manager_to_executor.stdout_rdpos;
+
+    auto space = [&]() { return (rdpos + sizeof(outbox.stdout_buf) - wrpos - 1) % sizeof(outbox.stdout_buf); };
+
+    auto put = [&](uint8_t byte)
+    {
+        outbox.stdout_buf[wrpos] = byte;
+        wrpos = (wrpos + 1) % sizeof(outbox.stdout_buf);
+    };
 
     // TODO: can be replaced with a more efficient implementation instead of writing one byte at a time
     while (size > 0) {
-        auto wrpos_new = (outbox.stdout_wrpos + 1) % sizeof(outbox.stdout_buf);
-        if (wrpos_new == ipc_block.manager_to_executor.stdout_rdpos) {
+        auto needed = stdout_mid_line ? 1 : STDOUT_TIMESTAMP_RECORD_SIZE + 1;
+
+        if (space() < needed) {
             // Buffer full, abort!
             // However, we must lie about number of characters written, otherwise stdout error flag will be set and
             // printf will refuse to print any more
             // (on a non-rt OS, a write to clogged stdout would just block instead)
 
+            dropped = size;
             wrote += size;
+            stdout_mid_line = (data_bytes[size - 1] != '\n');
             break;
         }
 
-        outbox.stdout_buf[outbox.stdout_wrpos] = *data_bytes;
-        outbox.stdout_wrpos = wrpos_new;
+        if (!stdout_mid_line) {
+            put(STDOUT_TIMESTAMP_MARKER);
+
+            for (size_t i = 0; i < sizeof(timestamp); i++) {
+                put((uint8_t)(timestamp >> (i * 8)));
+            }
+        }
+
+        auto byte = *data_bytes;
+        put(byte != STDOUT_TIMESTAMP_MARKER ? byte : '?');
+        stdout_mid_line = (byte != '\n');
 
         wrote++;
         data_bytes++;
         size--;
     }
 
+    memory_write_reorder_barrier();
+    outbox.stdout_wrpos = wrpos;
+
+    auto& telemetry = getTelemetry();
+    incrementCounter(telemetry.stdout_bytes_written, wrote - dropped);
+    incrementCounter(telemetry.stdout_bytes_dropped, dropped);
+
     return wrote;
 }
 
@@ -69,6 +106,9 @@ static int writeToStdout(void const* data, size_t size)
 
 void internal::handleSmc(Aarch64_Regs& saved_regs)
 {
+    logEvent(MonitorEventType::smc, saved_regs.regs[0], saved_regs.regs[1]);
+    countSmc(saved_regs.regs[0]);
+
     switch (saved_regs.regs[0])
     {
         case SMC_GET_ABI_VERSION:
@@ -85,7 +125,16 @@ void internal::handleSmc(Aarch64_Regs& saved_regs)
             break;
 
         case SMC_WRITE_STDOUT:
-            saved_regs.regs[0] = writeToStdout((void const*) saved_regs.regs[1], (size_t) saved_regs.regs[2]);
+            // Payloads built before SMC_WRITE_STDOUT_TIMESTAMPED was introduced; timestamp the output here
+            saved_regs.regs[0] = writeToStdout((void const*) saved_regs.regs[1],
+                                               (size_t) saved_regs.regs[2],
+                                               readSysReg(CNTPCT_EL0));
+            break;
+
+        case SMC_WRITE_STDOUT_TIMESTAMPED:
+            saved_regs.regs[0] = writeToStdout((void const*) saved_regs.regs[1],
+                                               (size_t) saved_regs.regs[2],
+                                               (uint64_t) saved_regs.regs[3]);
             break;
 
         case SMC_ZYNQMP_GIC_IRQ_CONFIGURE: {
@@ -97,9 +146,9 @@ void internal::handleSmc(Aarch64_Regs& saved_regs)
                 break;
             }
 
-            if (interruptId >= 16 && interruptId < 32)
+            if (interruptId >= 0 && interruptId < 32)
             {
-                // PPI
+                // SGI or PPI (both are banked per CPU)
                 platform::configurePrivatePeripheralInterrupt(interruptId,
                                                               platform::InterruptGroup::group1_irq_el1,
                                                               (platform::MonitorInterruptPriority) requestedPriority);
@@ -147,7 +196,15 @@ void internal::reportCrash(CrashingEntity who, const char* desc, uintptr_t addre
     outbox.fault_pc = address;
     outbox.fault_el = readSysReg(currentEL);
     strncpy(outbox.fault_desc, desc, sizeof(outbox.fault_desc));
-    outbox.state = (who == CrashingEntity::payload) ? DomainState::crashed_payload : DomainState::crashed_monitor;
+
+    logEvent(MonitorEventType::crash, (who == CrashingEntity::monitor) ? 1 : 0, address);
+
+    if (who == CrashingEntity::payload)
+    {
+        incrementCounter(getTelemetry().payload_crashes);
+    }
+
+    setDomainState((who == CrashingEntity::payload) ? DomainState::crashed_payload : DomainState::crashed_monitor);
 
     // Force data propagation
     memory_write_reorder_barrier();
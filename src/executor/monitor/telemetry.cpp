@@ -0,0 +1,95 @@
+//! @file
+//! @brief  Telemetry counters of the monitor
+//! @author Martin Cejp
+
+#include "armv8a.hpp"
+#include "executor.hpp"
+#include "monitor_internal.hpp"
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+// ************************************************************
+
+TelemetryBlock& internal::getTelemetry()
+{
+    return getIpcBlock().telemetry;
+}
+
+void internal::initializeTelemetry()
+{
+    auto& telemetry = getTelemetry();
+
+    // The counters are zeroed by the manager before the monitor is booted, and kept across monitor restarts
+    ((volatile TelemetryBlock&) telemetry).version = TELEMETRY_VERSION;
+    incrementCounter(telemetry.monitor_starts);
+}
+
+void internal::countSmc(uint64_t function_id)
+{
+    auto& telemetry = getTelemetry();
+
+    if (function_id - SMC_GET_ABI_VERSION < TELEMETRY_SMC_RANGE_SIZE)
+    {
+        incrementCounter(telemetry.smc_calls[function_id - SMC_GET_ABI_VERSION]);
+    }
+    else if (function_id - SMC_ZYNQMP_GIC_IRQ_CONFIGURE < TELEMETRY_SMC_RANGE_SIZE)
+    {
+        incrementCounter(telemetry.smc_calls[TELEMETRY_SMC_RANGE_SIZE + function_id - SMC_ZYNQMP_GIC_IRQ_CONFIGURE]);
+    }
+    else
+    {
+        incrementCounter(telemetry.smc_calls_other);
+    }
+}
+
+// ************************************************************
+
+MonitorTimeScope::MonitorTimeScope() : start(readSysReg(CNTPCT_EL0))
+{
+}
+
+MonitorTimeScope::~MonitorTimeScope()
+{
+    finish();
+}
+
+void MonitorTimeScope::finish()
+{
+    if (!finished)
+    {
+        incrementCounter(getTelemetry().monitor_ticks, readSysReg(CNTPCT_EL0) - start);
+        finished = true;
+    }
+}
+
+// ************************************************************
+
+// Called from boot.S once the MMU is on, before the C runtime has been initialized (so this must not rely on .bss or
+// constructors). The earlier timestamps were kept in registers, since memory written with the MMU off could still be
+// overwritten by the clean & invalidate of stale cache lines.
+extern "C" void recordEarlyBootCheckpoints(uint64_t entry, uint64_t caches_invalidated)
+{
+    auto& timing = (volatile BootTimingBlock&) getIpcBlock().boot_timing;
+
+    timing.checkpoints[BOOT_CHECKPOINT_ENTRY] = entry;
+    timing.checkpoints[BOOT_CHECKPOINT_CACHES_INVALIDATED] = caches_invalidated;
+    timing.checkpoints[BOOT_CHECKPOINT_MMU_ENABLED] = readSysReg(CNTPCT_EL0);
+
+    // Values left over from a previous boot
+    for (int i = BOOT_CHECKPOINT_MMU_ENABLED + 1; i < BOOT_CHECKPOINT_COUNT; i++)
+    {
+        timing.checkpoints[i] = 0;
+    }
+}
+
+void internal::recordBootCheckpoint(BootCheckpoint checkpoint)
+{
+    auto& timing = (volatile BootTimingBlock&) getIpcBlock().boot_timing;
+
+    // Once the boot has completed, restarts through returnToMonitor must not overwrite the record
+    if (timing.checkpoints[BOOT_CHECKPOINT_READY] == 0)
+    {
+        timing.checkpoints[checkpoint] = readSysReg(CNTPCT_EL0);
+    }
+}
@@ -0,0 +1,383 @@
+//! @file
+//! @brief  Cooperative scheduler based on C++20 coroutines
+//! @author Martin Cejp
+
+#include <bmboot/coroutines.hpp>
+
+#include "armv8a.hpp"
+
+#include <cstdint>
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+// ************************************************************
+// Frame pool
+// ************************************************************
+
+// Coroutine frame sizes are only known to the compiler, so we provide a few size classes.
+// A frame is served from the smallest class which can fit it.
+
+template <size_t BlockSize, size_t NumBlocks>
+class FramePool
+{
+public:
+    FramePool()
+    {
+        for (auto& block : blocks)
+        {
+            release(&block);
+        }
+    }
+
+    static constexpr size_t block_size = BlockSize;
+
+    bool owns(void* ptr) const
+    {
+        return ptr >= (void const*) &blocks[0] && ptr < (void const*) &blocks[NumBlocks];
+    }
+
+    void* acquire()
+    {
+        auto block = free_list;
+
+        if (block)
+        {
+            free_list = block->next;
+        }
+
+        return block;
+    }
+
+    void release(void* ptr)
+    {
+        auto block = static_cast<Block*>(ptr);
+        block->next = free_list;
+        free_list = block;
+    }
+
+private:
+    union alignas(std::max_align_t) Block
+    {
+        Block* next;
+        std::byte storage[BlockSize];
+    };
+
+    Block blocks[NumBlocks];
+    Block* free_list = nullptr;
+};
+
+static FramePool<256, 32> small_frames;
+static FramePool<1024, 16> medium_frames;
+static FramePool<4096, 4> large_frames;
+
+static int frames_in_use;
+
+void* internal::allocateCoroutineFrame(size_t size) noexcept
+{
+    CriticalSection cs;
+
+    void* frame = nullptr;
+
+    if (size <= small_frames.block_size && !frame)
+    {
+        frame = small_frames.acquire();
+    }
+
+    if (size <= medium_frames.block_size && !frame)
+    {
+        frame = medium_frames.acquire();
+    }
+
+    if (size <= large_frames.block_size && !frame)
+    {
+        frame = large_frames.acquire();
+    }
+
+    if (frame)
+    {
+        frames_in_use++;
+    }
+
+    return frame;
+}
+
+void internal::freeCoroutineFrame(void* frame) noexcept
+{
+    CriticalSection cs;
+
+    if (small_frames.owns(frame))
+    {
+        small_frames.release(frame);
+    }
+    else if (medium_frames.owns(frame))
+    {
+        medium_frames.release(frame);
+    }
+    else if (large_frames.owns(frame))
+    {
+        large_frames.release(frame);
+    }
+    else
+    {
+        return;
+    }
+
+    frames_in_use--;
+}
+
+// ************************************************************
+// Scheduler
+// ************************************************************
+
+static CoroutineWaiter* ready_head;
+static CoroutineWaiter* ready_tail;
+
+void internal::makeCoroutineReady(CoroutineWaiter& waiter)
+{
+    CriticalSection cs;
+
+    waiter.next = nullptr;
+
+    if (ready_tail)
+    {
+        ready_tail->next = &waiter;
+    }
+    else
+    {
+        ready_head = &waiter;
+    }
+
+    ready_tail = &waiter;
+}
+
+bool internal::cancelCoroutineReady(CoroutineWaiter& waiter)
+{
+    CriticalSection cs;
+
+    CoroutineWaiter* previous = nullptr;
+
+    for (auto link = &ready_head; *link; previous = *link, link = &(*link)->next)
+    {
+        if (*link == &waiter)
+        {
+            *link = waiter.next;
+
+            if (ready_tail == &waiter)
+            {
+                ready_tail = previous;
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static CoroutineWaiter* popReady()
+{
+    CriticalSection cs;
+
+    auto waiter = ready_head;
+
+    if (waiter)
+    {
+        ready_head = waiter->next;
+
+        if (!ready_head)
+        {
+            ready_tail = nullptr;
+        }
+    }
+
+    return waiter;
+}
+
+bool bmboot::spawnCoroutine(Coroutine&& coroutine)
+{
+    if (!coroutine.handle)
+    {
+        return false;
+    }
+
+    auto handle = std::exchange(coroutine.handle, {});
+    auto& promise = handle.promise();
+
+    promise.detached = true;
+    promise.start_waiter.handle = handle;
+    makeCoroutineReady(promise.start_waiter);
+    return true;
+}
+
+int bmboot::pollCoroutineScheduler()
+{
+    CoroutineWaiter* last;
+
+    {
+        CriticalSection cs;
+        last = ready_tail;
+    }
+
+    // Only run what is ready now; coroutines made ready in the meantime wait for the next call
+    for (int num_resumed = 1; last; num_resumed++)
+    {
+        auto waiter = popReady();
+
+        if (!waiter)
+        {
+            // The last one was cancelled by a coroutine destroyed in the meantime
+            return num_resumed - 1;
+        }
+
+        // Evaluate before resuming, since the waiter lives in the coroutine frame
+        bool was_last = (waiter == last);
+
+        waiter->handle.resume();
+
+        if (was_last)
+        {
+            return num_resumed;
+        }
+    }
+
+    return 0;
+}
+
+void bmboot::runCoroutineScheduler()
+{
+    for (;;)
+    {
+        if (auto waiter = popReady())
+        {
+            waiter->handle.resume();
+            continue;
+        }
+
+        CriticalSection cs;
+
+        if (ready_head)
+        {
+            continue;
+        }
+
+        if (frames_in_use == 0)
+        {
+            return;
+        }
+
+        // WFI with IRQs masked still wakes up on a pending interrupt, which will be taken once the critical section
+        // ends. This avoids missing a wake-up between the check above and going to sleep.
+        arm::armv8a::waitForInterrupt();
+    }
+}
+
+// ************************************************************
+// InterruptEvent
+// ************************************************************
+
+void InterruptEvent::signal()
+{
+    CoroutineWaiter* to_wake;
+
+    {
+        CriticalSection cs;
+
+        to_wake = waiters_head;
+
+        if (to_wake)
+        {
+            waiters_head = to_wake->next;
+
+            if (!waiters_head)
+            {
+                waiters_tail = nullptr;
+            }
+        }
+        else
+        {
+            pending_signals++;
+        }
+    }
+
+    if (to_wake)
+    {
+        makeCoroutineReady(*to_wake);
+    }
+}
+
+bool InterruptEvent::tryConsume()
+{
+    CriticalSection cs;
+
+    if (pending_signals > 0)
+    {
+        pending_signals--;
+        return true;
+    }
+
+    return false;
+}
+
+bool InterruptEvent::Awaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    CriticalSection cs;
+
+    // Re-check with interrupts masked, the event could have been signalled in the meantime
+    if (event.pending_signals > 0)
+    {
+        event.pending_signals--;
+        return false;
+    }
+
+    waiter.handle = handle;
+    waiter.next = nullptr;
+
+    if (event.waiters_tail)
+    {
+        event.waiters_tail->next = &waiter;
+    }
+    else
+    {
+        event.waiters_head = &waiter;
+    }
+
+    event.waiters_tail = &waiter;
+    waiting = true;
+    return true;
+}
+
+InterruptEvent::Awaiter::~Awaiter()
+{
+    if (!waiting)
+    {
+        return;
+    }
+
+    {
+        CriticalSection cs;
+
+        CoroutineWaiter* previous = nullptr;
+
+        for (auto link = &event.waiters_head; *link; previous = *link, link = &(*link)->next)
+        {
+            if (*link == &waiter)
+            {
+                *link = waiter.next;
+
+                if (event.waiters_tail == &waiter)
+                {
+                    event.waiters_tail = previous;
+                }
+
+                return;
+            }
+        }
+    }
+
+    // Not among the waiters any more, so the event has been signalled for us; hand the signal on
+    if (cancelCoroutineReady(waiter))
+    {
+        event.signal();
+    }
+}
@@ -0,0 +1,129 @@
+//! @file
+//! @brief  Deadline timer service based on the EL1 virtual timer
+//! @author Martin Cejp
+
+#include <bmboot/deadline_timer.hpp>
+#include <bmboot/payload_runtime.hpp>
+
+#include "armv8a.hpp"
+#include "zynqmp.hpp"
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+// The physical timer is already taken by the periodic interrupt, so we use the virtual one.
+// The monitor sets CNTVOFF_EL2 to zero, which means that CNTVCT_EL0 == CNTPCT_EL0 and deadlines can be expressed
+// in the same units as bmboot::getBuiltinTimerValue().
+
+// CNTV_CTL_EL0 bit assignments
+static constexpr uint64_t CNTV_CTL_ENABLE = (1<<0);
+
+// Sorted by deadline, earliest first. Nodes with equal deadlines are kept in FIFO order.
+static DeadlineTimerNode* timer_queue_head;
+static bool timer_interrupt_configured;
+
+// ************************************************************
+
+// Must be called with IRQs masked
+static void programTimer()
+{
+    if (timer_queue_head)
+    {
+        writeSysReg(CNTV_CVAL_EL0, timer_queue_head->deadline);
+        writeSysReg(CNTV_CTL_EL0, CNTV_CTL_ENABLE);
+    }
+    else
+    {
+        writeSysReg(CNTV_CTL_EL0, 0);
+    }
+
+    asm volatile("isb");
+}
+
+// ************************************************************
+
+static void handleVirtualTimerIrq()
+{
+    for (;;)
+    {
+        DeadlineTimerNode* expired;
+
+        {
+            CriticalSection cs;
+
+            if (!timer_queue_head || timer_queue_head->deadline > getBuiltinTimerValue())
+            {
+                // Re-arming (or disabling) the timer also de-asserts the level-sensitive interrupt
+                programTimer();
+                return;
+            }
+
+            expired = timer_queue_head;
+            timer_queue_head = expired->next;
+            expired->next = nullptr;
+        }
+
+        expired->on_expired(*expired);
+    }
+}
+
+// ************************************************************
+
+static void ensureTimerInterruptConfigured()
+{
+    // Benign race: in the worst case, the interrupt is configured twice with identical parameters
+    if (timer_interrupt_configured)
+    {
+        return;
+    }
+
+    setupInterruptHandling(zynqmp::scugic::CNTV_INTERRUPT_ID, PayloadInterruptPriority::p7_max, handleVirtualTimerIrq);
+    enableInterruptHandling(zynqmp::scugic::CNTV_INTERRUPT_ID);
+    timer_interrupt_configured = true;
+}
+
+// ************************************************************
+
+void internal::scheduleDeadline(DeadlineTimerNode& node)
+{
+    ensureTimerInterruptConfigured();
+
+    CriticalSection cs;
+
+    auto link = &timer_queue_head;
+
+    while (*link && (*link)->deadline <= node.deadline)
+    {
+        link = &(*link)->next;
+    }
+
+    node.next = *link;
+    *link = &node;
+
+    if (timer_queue_head == &node)
+    {
+        programTimer();
+    }
+}
+
+// ************************************************************
+
+bool internal::cancelDeadline(DeadlineTimerNode& node)
+{
+    CriticalSection cs;
+
+    for (auto link = &timer_queue_head; *link; link = &(*link)->next)
+    {
+        if (*link == &node)
+        {
+            *link = node.next;
+            node.next = nullptr;
+
+            // If the head was removed, the timer might now fire needlessly early; that is harmless, since the handler
+            // re-checks the deadline
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,408 @@
+//! @file
+//! @brief  File I/O performed by the manager on behalf of the payload
+//! @author Martin Cejp
+
+#include <bmboot/host_io.hpp>
+#include <bmboot/payload_runtime.h>
+#include <bmboot/payload_runtime.hpp>
+#include <bmboot/shared_memory.hpp>
+
+#include "bmboot_internal.hpp"
+#include "payload_runtime_internal.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+// Defined by the linker script
+extern "C" char __host_io_start[], __host_io_end[];
+
+// A synchronous operation gives up on the manager after this long
+static constexpr uint64_t TIMEOUT_SECONDS = 10;
+
+// Request last published, and whether its response is still to be collected
+static uint32_t s_session;
+static uint32_t s_sequence;
+static uint64_t s_request;
+static bool s_outstanding;
+static bool s_outstanding_async;
+
+// Result of a completed asynchronous operation, until collected by pollHostIo
+static std::optional<int> s_async_result;
+
+// ************************************************************
+
+static HostIoHeader& getHeader()
+{
+    return *(HostIoHeader*) __host_io_start;
+}
+
+static uint8_t* getBuffer()
+{
+    return (uint8_t*) __host_io_start + HOST_IO_HEADER_SIZE;
+}
+
+static size_t getBufferSize()
+{
+    return (__host_io_end - __host_io_start) - HOST_IO_HEADER_SIZE;
+}
+
+static int toErrno(HostIoError error)
+{
+    switch (error)
+    {
+        case HostIoError::none:                 return 0;
+        case HostIoError::io_error:             return EIO;
+        case HostIoError::bad_file:             return EBADF;
+        case HostIoError::not_found:            return ENOENT;
+        case HostIoError::access_denied:        return EACCES;
+        case HostIoError::exists:               return EEXIST;
+        case HostIoError::invalid_argument:     return EINVAL;
+        case HostIoError::no_space:             return ENOSPC;
+        case HostIoError::is_directory:         return EISDIR;
+        case HostIoError::not_directory:        return ENOTDIR;
+        case HostIoError::too_many_open_files:  return EMFILE;
+        case HostIoError::name_too_long:        return ENAMETOOLONG;
+    }
+
+    return EIO;
+}
+
+static void collectResponse()
+{
+    auto& header = getHeader();
+
+    // Response before its contents
+    sharedMemoryReadBarrier();
+
+    auto error = sharedLoad(header.error);
+    int result = (error == HostIoError::none) ? (int) sharedLoad(header.result) : -toErrno(error);
+
+    if (s_outstanding_async)
+    {
+        s_async_result = result;
+    }
+
+    s_outstanding = false;
+}
+
+// Wait for the outstanding request, if any, to be served. Returns false on timeout.
+static bool waitForSlot()
+{
+    if (!s_outstanding)
+    {
+        return true;
+    }
+
+    auto& header = getHeader();
+    auto deadline = getBuiltinTimerValue() + TIMEOUT_SECONDS * getBuiltinTimerFrequency();
+
+    while (sharedLoad(header.response) != s_request)
+    {
+        if (getBuiltinTimerValue() > deadline)
+        {
+            return false;
+        }
+    }
+
+    collectResponse();
+    return true;
+}
+
+// Returns 0 if a request can be filled in, or -errno
+static int beginRequest()
+{
+    if (!isHostIoServerAttached())
+    {
+        return -ENODEV;
+    }
+
+    // The transfer buffer belongs to the asynchronous operation until its result has been collected
+    if ((s_outstanding && s_outstanding_async) || s_async_result.has_value())
+    {
+        return -EBUSY;
+    }
+
+    if (!waitForSlot())
+    {
+        return -ETIMEDOUT;
+    }
+
+    auto& header = getHeader();
+
+    if (s_session == 0)
+    {
+        // The area is not cleared when a payload is loaded; carry on with the session numbering if it is valid
+        s_session = (sharedLoad(header.magic) == HOST_IO_MAGIC) ? (uint32_t)(sharedLoad(header.request) >> 32) + 1 : 1;
+
+        if (s_session == 0)
+        {
+            s_session = 1;
+        }
+
+        sharedStore(header.magic, HOST_IO_MAGIC);
+    }
+
+    return 0;
+}
+
+static void publishRequest(HostIoOp op, int fd, uint64_t size, bool async)
+{
+    auto& header = getHeader();
+
+    sharedStore(header.op, op);
+    sharedStore(header.fd, fd);
+    sharedStore(header.size, size);
+
+    // Sequence number 0 means "no request"
+    if (++s_sequence == 0)
+    {
+        s_sequence = 1;
+    }
+
+    s_request = ((uint64_t) s_session << 32) | s_sequence;
+    s_outstanding = true;
+    s_outstanding_async = async;
+
+    // Request (and the data in the transfer buffer) before its publication
+    sharedMemoryWriteBarrier();
+    sharedStore(header.request, s_request);
+}
+
+// Returns the result of the request, or -errno
+static int execute(HostIoOp op, int fd, uint64_t size)
+{
+    publishRequest(op, fd, size, false);
+
+    if (!waitForSlot())
+    {
+        return -ETIMEDOUT;
+    }
+
+    auto& header = getHeader();
+    auto error = sharedLoad(header.error);
+
+    return (error == HostIoError::none) ? (int) sharedLoad(header.result) : -toErrno(error);
+}
+
+// ************************************************************
+
+int internal::hostOpen(char const* path, int flags, int mode)
+{
+    if (auto err = beginRequest(); err < 0)
+    {
+        return err;
+    }
+
+    size_t length = strlen(path);
+
+    if (length >= getBufferSize())
+    {
+        return -ENAMETOOLONG;
+    }
+
+    uint32_t host_flags = 0;
+
+    switch (flags & O_ACCMODE)
+    {
+        case O_RDONLY:  host_flags = HOST_IO_O_RDONLY; break;
+        case O_WRONLY:  host_flags = HOST_IO_O_WRONLY; break;
+        case O_RDWR:    host_flags = HOST_IO_O_RDWR; break;
+        default:        return -EINVAL;
+    }
+
+    if (flags & O_CREAT)  { host_flags |= HOST_IO_O_CREAT; }
+    if (flags & O_TRUNC)  { host_flags |= HOST_IO_O_TRUNC; }
+    if (flags & O_APPEND) { host_flags |= HOST_IO_O_APPEND; }
+    if (flags & O_EXCL)   { host_flags |= HOST_IO_O_EXCL; }
+
+    auto& header = getHeader();
+    sharedStore(header.flags, host_flags);
+    sharedStore(header.mode, mode);
+    memcpy(getBuffer(), path, length);
+
+    return execute(HostIoOp::open, -1, length);
+}
+
+int internal::hostClose(int fd)
+{
+    if (auto err = beginRequest(); err < 0)
+    {
+        return err;
+    }
+
+    return execute(HostIoOp::close, fd, 0);
+}
+
+int internal::hostRead(int fd, void* data, size_t size)
+{
+    if (auto err = beginRequest(); err < 0)
+    {
+        return err;
+    }
+
+    // Short reads are allowed; the C library asks again for the rest
+    size = std::min(size, getBufferSize());
+    auto result = execute(HostIoOp::read, fd, size);
+
+    if (result > 0)
+    {
+        memcpy(data, getBuffer(), result);
+    }
+
+    return result;
+}
+
+int internal::hostWrite(int fd, void const* data, size_t size)
+{
+    if (auto err = beginRequest(); err < 0)
+    {
+        return err;
+    }
+
+    // Short writes are allowed as well
+    size = std::min(size, getBufferSize());
+    memcpy(getBuffer(), data, size);
+
+    return execute(HostIoOp::write, fd, size);
+}
+
+int internal::hostLseek(int fd, int offset, int whence)
+{
+    if (auto err = beginRequest(); err < 0)
+    {
+        return err;
+    }
+
+    auto& header = getHeader();
+    sharedStore(header.offset, offset);
+    sharedStore(header.whence, whence);
+
+    return execute(HostIoOp::lseek, fd, 0);
+}
+
+int internal::hostFstat(int fd, struct stat* st)
+{
+    if (auto err = beginRequest(); err < 0)
+    {
+        return err;
+    }
+
+    auto result = execute(HostIoOp::fstat, fd, 0);
+
+    if (result < 0)
+    {
+        return result;
+    }
+
+    auto& header = getHeader();
+
+    memset(st, 0, sizeof(*st));
+
+    switch (sharedLoad(header.file_type))
+    {
+        case HostIoFileType::regular:   st->st_mode = S_IFREG; break;
+        case HostIoFileType::directory: st->st_mode = S_IFDIR; break;
+        case HostIoFileType::other:     st->st_mode = S_IFCHR; break;
+    }
+
+    st->st_size = sharedLoad(header.file_size);
+
+    // Lets the C library size its buffers so that each request moves a sizeable block
+    st->st_blksize = 64 * 1024;
+    return 0;
+}
+
+// ************************************************************
+
+std::span<uint8_t> bmboot::getHostIoBuffer()
+{
+    return { getBuffer(), getBufferSize() };
+}
+
+bool bmboot::isHostIoServerAttached()
+{
+    return sharedLoad(getHeader().server_attached) != 0;
+}
+
+bool bmboot::startHostRead(int fd, size_t size)
+{
+    if (s_outstanding || s_async_result.has_value() || size > getBufferSize() || beginRequest() < 0)
+    {
+        return false;
+    }
+
+    publishRequest(HostIoOp::read, fd, size, true);
+    return true;
+}
+
+bool bmboot::startHostWrite(int fd, size_t size)
+{
+    if (s_outstanding || s_async_result.has_value() || size > getBufferSize() || beginRequest() < 0)
+    {
+        return false;
+    }
+
+    publishRequest(HostIoOp::write, fd, size, true);
+    return true;
+}
+
+std::optional<int> bmboot::pollHostIo()
+{
+    if (s_outstanding && s_outstanding_async && sharedLoad(getHeader().response) == s_request)
+    {
+        collectResponse();
+    }
+
+    if (s_async_result.has_value())
+    {
+        auto result = *s_async_result;
+        s_async_result.reset();
+        return result;
+    }
+
+    if (s_outstanding && s_outstanding_async)
+    {
+        return std::nullopt;
+    }
+
+    return -EINVAL;
+}
+
+// ************************************************************
+// C API
+// ************************************************************
+
+extern "C" void* bmGetHostIoBuffer(size_t* size_out)
+{
+    *size_out = getBufferSize();
+    return getBuffer();
+}
+
+extern "C" int bmStartHostRead(int fd, size_t size)
+{
+    return startHostRead(fd, size);
+}
+
+extern "C" int bmStartHostWrite(int fd, size_t size)
+{
+    return startHostWrite(fd, size);
+}
+
+extern "C" int bmPollHostIo(int* result_out)
+{
+    auto result = pollHostIo();
+
+    if (!result.has_value())
+    {
+        return 0;
+    }
+
+    *result_out = *result;
+    return 1;
+}
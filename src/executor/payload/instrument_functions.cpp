@@ -0,0 +1,52 @@
+//! @file
+//! @brief  Function entry/exit hooks for payloads built with -finstrument-functions
+//! @author Martin Cejp
+//!
+//! Only linked in when the payload is instrumented (see INSTRUMENT_FUNCTIONS in cmake/Bmboot.cmake). The payload
+//! runtime itself is never instrumented, so these hooks do not recurse, and runtime functions are not traced.
+
+#include <bmboot/payload_runtime.hpp>
+
+#include "armv8a.hpp"
+#include "executor_asm.hpp"
+#include "payload_runtime_internal.hpp"
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+// ************************************************************
+
+extern "C" CallTraceBuffer bmboot_call_trace;
+
+// Zero-initialized, so a fresh payload starts with an empty buffer
+CallTraceBuffer bmboot_call_trace;
+
+[[gnu::no_instrument_function]]
+static inline void recordCall(void* function, uint64_t enter_flag)
+{
+    uint64_t info = ((uintptr_t) function & TRACE_INFO_NAME_MASK) |
+                    ((uint64_t) running_irq_priority << TRACE_INFO_PRIORITY_SHIFT) |
+                    ((uint64_t) irq_nesting_level << TRACE_INFO_NESTING_SHIFT) |
+                    enter_flag;
+
+    CriticalSection cs;
+
+    auto index = bmboot_call_trace.num_records;
+    auto& record = bmboot_call_trace.records[index % CALL_TRACE_RING_SIZE];
+
+    record.timestamp = readSysReg(CNTPCT_EL0);
+    record.info = info;
+
+    memory_write_reorder_barrier();
+    ((volatile CallTraceBuffer&) bmboot_call_trace).num_records = index + 1;
+}
+
+extern "C" [[gnu::no_instrument_function]] void __cyg_profile_func_enter(void* this_fn, void*)
+{
+    recordCall(this_fn, TRACE_INFO_BEGIN);
+}
+
+extern "C" [[gnu::no_instrument_function]] void __cyg_profile_func_exit(void* this_fn, void*)
+{
+    recordCall(this_fn, 0);
+}
@@ -0,0 +1,98 @@
+//! @file
+//! @brief  Arena allocation from memory tiers
+//! @author Martin Cejp
+
+#include <bmboot/memory_arena.hpp>
+#include <bmboot/payload_runtime.h>
+
+using namespace bmboot;
+
+// Defined by the linker script
+extern "C" char __ocm_arena_start[], __ocm_arena_end[];
+extern "C" char __ddr_arena_start[], __ddr_arena_end[];
+extern "C" char __ddr_uncached_start[], __ddr_uncached_end[];
+extern "C" char __ddr_scratch_start[], __ddr_scratch_end[];
+
+struct Arena
+{
+    uintptr_t start;
+    uintptr_t end;
+    uintptr_t position;
+};
+
+// Indexed by MemoryTier
+static Arena arenas[] = {
+    { (uintptr_t) __ocm_arena_start, (uintptr_t) __ocm_arena_end, (uintptr_t) __ocm_arena_start },
+    { (uintptr_t) __ddr_arena_start, (uintptr_t) __ddr_arena_end, (uintptr_t) __ddr_arena_start },
+    { (uintptr_t) __ddr_uncached_start, (uintptr_t) __ddr_uncached_end, (uintptr_t) __ddr_uncached_start },
+    { (uintptr_t) __ddr_scratch_start, (uintptr_t) __ddr_scratch_end, (uintptr_t) __ddr_scratch_start },
+};
+
+static_assert((int) MemoryTier::ocm == BM_MEMORY_TIER_OCM);
+static_assert((int) MemoryTier::ddr_cached == BM_MEMORY_TIER_DDR_CACHED);
+static_assert((int) MemoryTier::ddr_uncached == BM_MEMORY_TIER_DDR_UNCACHED);
+static_assert((int) MemoryTier::ddr_scratch == BM_MEMORY_TIER_DDR_SCRATCH);
+
+// ************************************************************
+
+void* bmboot::allocateFromTier(MemoryTier tier, size_t size, size_t alignment)
+{
+    auto& arena = arenas[(int) tier];
+
+    auto start = (arena.position + alignment - 1) & ~(alignment - 1);
+
+    if (start < arena.position || start > arena.end || size > arena.end - start)
+    {
+        return nullptr;
+    }
+
+    arena.position = start + size;
+    return (void*) start;
+}
+
+ArenaMark bmboot::getArenaMark(MemoryTier tier)
+{
+    return ArenaMark { arenas[(int) tier].position };
+}
+
+void bmboot::rewindArena(MemoryTier tier, ArenaMark mark)
+{
+    auto& arena = arenas[(int) tier];
+
+    if (mark.position >= arena.start && mark.position <= arena.position)
+    {
+        arena.position = mark.position;
+    }
+}
+
+void bmboot::resetArena(MemoryTier tier)
+{
+    auto& arena = arenas[(int) tier];
+    arena.position = arena.start;
+}
+
+size_t bmboot::getArenaFreeSpace(MemoryTier tier)
+{
+    auto& arena = arenas[(int) tier];
+    return arena.end - arena.position;
+}
+
+size_t bmboot::getArenaSize(MemoryTier tier)
+{
+    auto& arena = arenas[(int) tier];
+    return arena.end - arena.start;
+}
+
+// ************************************************************
+// C API
+// ************************************************************
+
+extern "C" void* bmAllocateFromTier(BmMemoryTier tier, size_t size, size_t alignment)
+{
+    return allocateFromTier((MemoryTier) tier, size, alignment);
+}
+
+extern "C" void bmResetArena(BmMemoryTier tier)
+{
+    resetArena((MemoryTier) tier);
+}
@@ -0,0 +1,449 @@
+//! @file
+//! @brief  Run-time configuration of the payload's translation tables
+//! @author Martin Cejp
+
+#include <bmboot/cache.hpp>
+#include <bmboot/mmu.hpp>
+#include <bmboot/payload_runtime.h>
+#include <bmboot/payload_runtime.hpp>
+
+#include "armv8a.hpp"
+#include "payload_runtime_internal.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using namespace bmboot;
+
+// Translation regime set up by boot.S: 4 KiB granule, T0SZ = 24 (40-bit VA), so the walk starts at level 0
+constexpr int VA_BITS = 40;
+constexpr int NUM_ENTRIES = 512;
+constexpr int MMU_TABLE_POOL_SIZE = 32;
+
+// VMSAv8-64 descriptor bits
+constexpr uint64_t DESC_TYPE_MASK =     0b11;
+constexpr uint64_t DESC_BLOCK =         0b01;       // levels 1, 2
+constexpr uint64_t DESC_TABLE =         0b11;       // levels 0, 1, 2
+constexpr uint64_t DESC_PAGE =          0b11;       // level 3
+constexpr uint64_t DESC_ADDRESS_MASK =  0x0000'FFFF'FFFF'F000;
+constexpr uint64_t DESC_NS =            (1 << 5);
+constexpr uint64_t DESC_SH_OUTER =      (2 << 8);
+constexpr uint64_t DESC_AF =            (1 << 10);
+constexpr uint64_t DESC_PXN =           (1ull << 53);
+constexpr uint64_t DESC_UXN =           (1ull << 54);
+
+// Indexes into MAIR_EL1 as set up by boot.S
+enum MairIndex
+{
+    MAIR_NORMAL_NC = 0,
+    MAIR_NORMAL_WB = 1,
+    MAIR_DEVICE_nGnRnE = 2,
+    MAIR_DEVICE_nGnRE = 3,
+    MAIR_NORMAL_WT = 4,
+    MAIR_DEVICE_GRE = 5,
+};
+
+alignas(4096) static uint64_t table_pool[MMU_TABLE_POOL_SIZE][NUM_ENTRIES];
+static int table_pool_used;
+
+// ************************************************************
+
+static int getLevelShift(int level)
+{
+    return 39 - 9 * level;
+}
+
+static int getAttrIndex(uint64_t desc)
+{
+    return (desc >> 2) & 0b111;
+}
+
+static bool isTableDescriptor(uint64_t desc, int level)
+{
+    return level < 3 && (desc & DESC_TYPE_MASK) == DESC_TABLE;
+}
+
+static bool isCacheable(uint64_t desc)
+{
+    return (desc & 1) && (getAttrIndex(desc) == MAIR_NORMAL_WB || getAttrIndex(desc) == MAIR_NORMAL_WT);
+}
+
+static uint64_t makeBlockDescriptor(int level, uintptr_t address, MemoryType type)
+{
+    uint64_t attributes;
+
+    switch (type)
+    {
+        case MemoryType::normal_write_back:     attributes = (MAIR_NORMAL_WB << 2) | DESC_NS | DESC_SH_OUTER; break;
+        case MemoryType::normal_write_through:  attributes = (MAIR_NORMAL_WT << 2) | DESC_NS | DESC_SH_OUTER; break;
+        case MemoryType::normal_non_cacheable:  attributes = (MAIR_NORMAL_NC << 2) | DESC_NS | DESC_SH_OUTER; break;
+        case MemoryType::device_nGnRnE:         attributes = (MAIR_DEVICE_nGnRnE << 2) | DESC_PXN | DESC_UXN; break;
+        case MemoryType::device_nGnRE:          attributes = (MAIR_DEVICE_nGnRE << 2) | DESC_PXN | DESC_UXN; break;
+        case MemoryType::device_GRE:            attributes = (MAIR_DEVICE_GRE << 2) | DESC_PXN | DESC_UXN; break;
+        case MemoryType::fault:
+        default:
+            return 0;
+    }
+
+    return address | attributes | DESC_AF | (level == 3 ? DESC_PAGE : DESC_BLOCK);
+}
+
+// Re-express a block descriptor as one of the 512 entries of the next-level table
+static uint64_t splitBlockDescriptor(uint64_t desc, int next_level, int index)
+{
+    if (!(desc & 1))
+    {
+        return 0;
+    }
+
+    uintptr_t address = (desc & DESC_ADDRESS_MASK) + ((uintptr_t) index << getLevelShift(next_level));
+    return address | (desc & ~DESC_ADDRESS_MASK & ~DESC_TYPE_MASK) | (next_level == 3 ? DESC_PAGE : DESC_BLOCK);
+}
+
+static char const* getAttrIndexName(int attr_index)
+{
+    switch (attr_index)
+    {
+        case MAIR_NORMAL_NC: return "normal non-cacheable";
+        case MAIR_NORMAL_WB: return "normal write-back";
+        case MAIR_DEVICE_nGnRnE: return "device nGnRnE";
+        case MAIR_DEVICE_nGnRE: return "device nGnRE";
+        case MAIR_NORMAL_WT: return "normal write-through";
+        case MAIR_DEVICE_GRE: return "device GRE";
+        default: return "?";
+    }
+}
+
+// ************************************************************
+
+TranslationTableBuilder::TranslationTableBuilder()
+{
+    root = (uint64_t*) (readSysReg(TTBR0_EL1) & DESC_ADDRESS_MASK);
+}
+
+uint64_t* TranslationTableBuilder::allocateTable()
+{
+    CriticalSection cs;
+
+    // Our own tables must be contiguous in the pool, see isOwnTable
+    if (table_pool_used == MMU_TABLE_POOL_SIZE ||
+        (num_tables_allocated > 0 && table_pool[table_pool_used] != first_table + num_tables_allocated * NUM_ENTRIES))
+    {
+        return nullptr;
+    }
+
+    auto table = table_pool[table_pool_used++];
+
+    if (num_tables_allocated++ == 0)
+    {
+        first_table = table;
+    }
+
+    return table;
+}
+
+bool TranslationTableBuilder::isOwnTable(uint64_t const* table) const
+{
+    return num_tables_allocated > 0 && table >= first_table && table < first_table + num_tables_allocated * NUM_ENTRIES;
+}
+
+uint64_t* TranslationTableBuilder::getWritableRoot()
+{
+    if (!isOwnTable(root))
+    {
+        auto copy = allocateTable();
+
+        if (!copy)
+        {
+            return nullptr;
+        }
+
+        memcpy(copy, root, sizeof(table_pool[0]));
+        root = copy;
+    }
+
+    return root;
+}
+
+bool TranslationTableBuilder::map(uintptr_t address, size_t size, MemoryType type, PageSize max_page_size)
+{
+    if ((address | size) & 0xfff || size == 0 || address + size > (1ull << VA_BITS) || address + size < address)
+    {
+        return false;
+    }
+
+    auto table = getWritableRoot();
+
+    if (!table)
+    {
+        return false;
+    }
+
+    int min_block_level = (max_page_size == PageSize::size_1g) ? 1 : (max_page_size == PageSize::size_2m) ? 2 : 3;
+
+    return mapBlock(table, 0, address, size, type, min_block_level);
+}
+
+bool TranslationTableBuilder::mapBlock(uint64_t* table, int level, uintptr_t address, size_t size, MemoryType type,
+                                       int min_block_level)
+{
+    auto const block_size = (size_t) 1 << getLevelShift(level);
+    auto const end = address + size;
+
+    for (auto addr = address; addr < end; )
+    {
+        auto& entry = table[(addr >> getLevelShift(level)) % NUM_ENTRIES];
+        auto entry_start = addr & ~(block_size - 1);
+        auto entry_end = entry_start + block_size;
+        auto chunk_end = std::min(end, entry_end);
+
+        if (level >= 1 && level >= min_block_level && addr == entry_start && chunk_end == entry_end)
+        {
+            // Entire entry covered -- replace it with a block (any sub-table is simply abandoned)
+            auto new_entry = makeBlockDescriptor(level, entry_start, type);
+
+            if (isTableDescriptor(entry, level) || (isCacheable(entry) && getAttrIndex(entry) != getAttrIndex(new_entry)))
+            {
+                recordFlushRange(entry_start, block_size);
+            }
+
+            entry = new_entry;
+        }
+        else
+        {
+            uint64_t* next;
+
+            if (isTableDescriptor(entry, level))
+            {
+                next = (uint64_t*) (entry & DESC_ADDRESS_MASK);
+
+                if (!isOwnTable(next))
+                {
+                    // Copy on write
+                    auto copy = allocateTable();
+
+                    if (!copy)
+                    {
+                        return false;
+                    }
+
+                    memcpy(copy, next, sizeof(table_pool[0]));
+                    next = copy;
+                    entry = (uintptr_t) next | DESC_TABLE;
+                }
+            }
+            else
+            {
+                // Split a block (or an unmapped entry) into a table with the same attributes
+                next = allocateTable();
+
+                if (!next)
+                {
+                    return false;
+                }
+
+                for (int i = 0; i < NUM_ENTRIES; i++)
+                {
+                    next[i] = splitBlockDescriptor(entry, level + 1, i);
+                }
+
+                entry = (uintptr_t) next | DESC_TABLE;
+            }
+
+            if (!mapBlock(next, level + 1, addr, chunk_end - addr, type, min_block_level))
+            {
+                return false;
+            }
+        }
+
+        addr = chunk_end;
+    }
+
+    return true;
+}
+
+void TranslationTableBuilder::recordFlushRange(uintptr_t address, size_t size)
+{
+    if (num_flush_ranges > 0)
+    {
+        auto& last = flush_ranges[num_flush_ranges - 1];
+
+        if (last.address + last.size == address)
+        {
+            last.size += size;
+            return;
+        }
+    }
+
+    if (num_flush_ranges == MAX_FLUSH_RANGES)
+    {
+        flush_everything = true;
+        return;
+    }
+
+    flush_ranges[num_flush_ranges++] = Range { address, size };
+}
+
+void TranslationTableBuilder::activate()
+{
+    if (!isOwnTable(root))
+    {
+        // nothing has been changed
+        return;
+    }
+
+    size_t flush_total = 0;
+
+    for (int i = 0; i < num_flush_ranges; i++)
+    {
+        flush_total += flush_ranges[i].size;
+    }
+
+    auto flush = [&] {
+        if (flush_everything || flush_total > DCACHE_SET_WAY_THRESHOLD)
+        {
+            cleanInvalidateDcacheAll();
+        }
+        else
+        {
+            for (int i = 0; i < num_flush_ranges; i++)
+            {
+                cleanInvalidateDcacheRange((void const*) flush_ranges[i].address, flush_ranges[i].size);
+            }
+        }
+    };
+
+    {
+        CriticalSection cs;
+
+        // Make the new tables visible to the table walker
+        cleanDcacheRange(first_table, num_tables_allocated * sizeof(table_pool[0]));
+
+        // Write back dirty lines while they are still mapped as cacheable
+        flush();
+
+        writeSysReg(TTBR0_EL1, (uintptr_t) root);
+        // Broadcast: tables modified in place by a previous builder may be in use by the other cores of an SMP payload
+        asm volatile("isb; tlbi vmalle1is; dsb ish; isb" : : : "memory");
+
+        // Drop any lines that could have been (speculatively) allocated through the old mapping in the meantime
+        flush();
+
+        asm volatile("ic iallu; dsb ish; isb" : : : "memory");
+    }
+
+    // In an SMP payload, wait for the other cores to switch as well
+    internal::shareTranslationTables((uintptr_t) root);
+}
+
+// ************************************************************
+
+namespace
+{
+
+struct MappingPrinter
+{
+    uintptr_t run_start = 0;
+    uintptr_t run_end = 0;
+    int run_level = -1;
+    uint64_t run_kind = ~0ull;
+
+    void add(uintptr_t address, int level, uint64_t desc)
+    {
+        // fault entries are merged regardless of level
+        uint64_t kind = (desc & 1) ? (desc & ~DESC_ADDRESS_MASK & ~DESC_TYPE_MASK) : 0;
+        int effective_level = (desc & 1) ? level : -2;
+
+        if (kind != run_kind || effective_level != run_level || address != run_end)
+        {
+            flush();
+            run_start = address;
+            run_kind = kind;
+            run_level = effective_level;
+        }
+
+        run_end = address + ((size_t) 1 << getLevelShift(level));
+    }
+
+    void flush()
+    {
+        if (run_end == run_start)
+        {
+            return;
+        }
+
+        static char const* const block_sizes[] = { "512G", "1G", "2M", "4K" };
+
+        if (run_level < 0)
+        {
+            printf("0x%010lX - 0x%010lX        -\n", run_start, run_end - 1);
+        }
+        else
+        {
+            printf("0x%010lX - 0x%010lX  %4s  %s%s\n", run_start, run_end - 1, block_sizes[run_level],
+                   getAttrIndexName(getAttrIndex(run_kind)),
+                   (run_kind & DESC_UXN) ? ", execute-never" : "");
+        }
+
+        run_start = run_end;
+    }
+
+    void walk(uint64_t const* table, int level, uintptr_t base)
+    {
+        for (int i = 0; i < NUM_ENTRIES; i++)
+        {
+            auto address = base + ((uintptr_t) i << getLevelShift(level));
+
+            if (address >= (1ull << VA_BITS))
+            {
+                break;
+            }
+
+            if (isTableDescriptor(table[i], level))
+            {
+                walk((uint64_t const*) (table[i] & DESC_ADDRESS_MASK), level + 1, address);
+            }
+            else
+            {
+                add(address, level, table[i]);
+            }
+        }
+    }
+};
+
+}
+
+void TranslationTableBuilder::printMapping() const
+{
+    MappingPrinter printer;
+    printer.walk(root, 0, 0);
+    printer.flush();
+}
+
+// ************************************************************
+// C API
+// ************************************************************
+
+static_assert((int) MemoryType::normal_write_back == BM_MEMORY_TYPE_NORMAL_WRITE_BACK);
+static_assert((int) MemoryType::normal_write_through == BM_MEMORY_TYPE_NORMAL_WRITE_THROUGH);
+static_assert((int) MemoryType::normal_non_cacheable == BM_MEMORY_TYPE_NORMAL_NON_CACHEABLE);
+static_assert((int) MemoryType::device_nGnRnE == BM_MEMORY_TYPE_DEVICE_nGnRnE);
+static_assert((int) MemoryType::device_nGnRE == BM_MEMORY_TYPE_DEVICE_nGnRE);
+static_assert((int) MemoryType::device_GRE == BM_MEMORY_TYPE_DEVICE_GRE);
+static_assert((int) MemoryType::fault == BM_MEMORY_TYPE_FAULT);
+static_assert((int) PageSize::size_4k == BM_PAGE_SIZE_4K);
+static_assert((int) PageSize::size_1g == BM_PAGE_SIZE_1G);
+
+extern "C" int bmMmuMap(uintptr_t address, size_t size, BmMemoryType type, BmPageSize max_page_size)
+{
+    TranslationTableBuilder mmu;
+
+    if (!mmu.map(address, size, (MemoryType) type, (PageSize) max_page_size))
+    {
+        return 0;
+    }
+
+    mmu.activate();
+    return 1;
+}
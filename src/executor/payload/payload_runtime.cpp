@@ -2,6 +2,8 @@
 //! @brief  Runtime functions for the payload
 //! @author Martin Cejp
 
+#include <bmboot/cache.hpp>
+#include <bmboot/payload_runtime.h>
 #include <bmboot/payload_runtime.hpp>
 
 #include "armv8a.hpp"
@@ -17,6 +19,9 @@ static uint64_t timer_period_ticks;
 static InterruptHandler timer_irq_handler;
 
 InterruptHandler internal::user_interrupt_handlers[(GIC_MAX_USER_INTERRUPT_ID + 1) - GIC_MIN_USER_INTERRUPT_ID];
+uint8_t internal::user_interrupt_priorities[(GIC_MAX_USER_INTERRUPT_ID + 1) - GIC_MIN_USER_INTERRUPT_ID];
+uint8_t internal::irq_nesting_level = 0;
+uint8_t internal::running_irq_priority = 0xFF;
 
 void bmboot::disableInterruptHandling(int interruptId)
 {
@@ -44,6 +49,7 @@ bool bmboot::setupInterruptHandling(int interruptId, PayloadInterruptPriority pr
     }
 
     user_interrupt_handlers[interruptId - GIC_MIN_USER_INTERRUPT_ID] = std::move(handler);
+    user_interrupt_priorities[interruptId - GIC_MIN_USER_INTERRUPT_ID] = (uint8_t) priority;
 
     smc(SMC_ZYNQMP_GIC_IRQ_CONFIGURE, interruptId, (int) priority);
 
@@ -134,7 +140,33 @@ void bmboot::notifyPayloadStarted()
 
 int bmboot::writeToStdout(void const* data, size_t size)
 {
-    return smc(SMC_WRITE_STDOUT, data, size);
+    // Timestamped here rather than in the monitor, to be as close as possible to the moment of the write
+    return smc(SMC_WRITE_STDOUT_TIMESTAMPED, data, size, readSysReg(CNTPCT_EL0));
+}
+
+extern "C" void bmCleanDcacheRange(void const* address, size_t size)
+{
+    cleanDcacheRange(address, size);
+}
+
+extern "C" void bmCleanInvalidateDcacheRange(void const* address, size_t size)
+{
+    cleanInvalidateDcacheRange(address, size);
+}
+
+extern "C" uintptr_t bmGetPayloadArgument()
+{
+    return getPayloadArgument();
+}
+
+extern "C" void bmInvalidateDcacheRange(void const* address, size_t size)
+{
+    invalidateDcacheRange(address, size);
+}
+
+extern "C" void bmInvalidateIcacheRange(void const* address, size_t size)
+{
+    invalidateIcacheRange(address, size);
 }
 
 extern "C" void bmNotifyPayloadStarted()
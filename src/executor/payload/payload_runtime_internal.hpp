@@ -6,11 +6,29 @@
 
 #include "bmboot_internal.hpp"
 
+struct stat;
+
 namespace bmboot::internal
 {
 
 extern InterruptHandler user_interrupt_handlers[(GIC_MAX_USER_INTERRUPT_ID + 1) - GIC_MIN_USER_INTERRUPT_ID];
+extern uint8_t user_interrupt_priorities[(GIC_MAX_USER_INTERRUPT_ID + 1) - GIC_MIN_USER_INTERRUPT_ID];
+
+// Maintained by IRQInterrupt for the tracer; 0 and 0xFF respectively in the main program
+extern uint8_t irq_nesting_level;
+extern uint8_t running_irq_priority;
 
 void handleTimerIrq();
 
+// Have the other cores of an SMP payload switch to the translation tables just activated on cpu1 (smp.cpp)
+void shareTranslationTables(uintptr_t ttbr0);
+
+// File operations served by the manager (host_io.cpp), for the syscalls. Each returns a non-negative result or -errno.
+int hostOpen(char const* path, int flags, int mode);
+int hostClose(int fd);
+int hostRead(int fd, void* data, size_t size);
+int hostWrite(int fd, void const* data, size_t size);
+int hostLseek(int fd, int offset, int whence);
+int hostFstat(int fd, struct stat* st);
+
 }
@@ -0,0 +1,212 @@
+//! @file
+//! @brief  Performance Monitor Unit event counters
+//! @author Martin Cejp
+
+#include <bmboot/payload_runtime.h>
+#include <bmboot/payload_runtime.hpp>
+#include <bmboot/pmu.hpp>
+
+#include "armv8a.hpp"
+#include "zynqmp.hpp"
+
+#include <algorithm>
+
+using namespace bmboot;
+
+// ************************************************************
+
+// PMCR_EL0 bits
+constexpr uint64_t PMCR_E =         (1 << 0);       // enable
+constexpr uint64_t PMCR_P =         (1 << 1);       // event counter reset
+constexpr uint64_t PMCR_C =         (1 << 2);       // cycle counter reset
+constexpr uint64_t PMCR_LC =        (1 << 6);       // cycle counter overflows at 64 bits
+constexpr int PMCR_N_SHIFT =        11;
+
+// PMCNTENSET_EL0 etc.
+constexpr uint32_t CYCLE_COUNTER_BIT = (1u << 31);
+
+static int num_events_configured;
+static uint32_t event_counter_mask;
+
+// Upper 32 bits of each event counter, incremented by the overflow interrupt
+static uint64_t event_counter_high[PMU_MAX_EVENT_COUNTERS];
+
+// ************************************************************
+
+// PMEVCNTRn_EL0 could also be accessed indirectly through PMSELR_EL0, but that would add state shared with interrupt
+// handlers
+static uint32_t readEventCounter(int index)
+{
+    switch (index)
+    {
+        case 0: return readSysReg(PMEVCNTR0_EL0);
+        case 1: return readSysReg(PMEVCNTR1_EL0);
+        case 2: return readSysReg(PMEVCNTR2_EL0);
+        case 3: return readSysReg(PMEVCNTR3_EL0);
+        case 4: return readSysReg(PMEVCNTR4_EL0);
+        case 5: return readSysReg(PMEVCNTR5_EL0);
+        default: return 0;
+    }
+}
+
+static void writeEventType(int index, PmuEvent event)
+{
+    // Filter bits (P, U, NSK, NSU, NSH, M) are all zero: count in EL0 and EL1, not in EL2
+    auto value = (uint64_t) event;
+
+    switch (index)
+    {
+        case 0: writeSysReg(PMEVTYPER0_EL0, value); break;
+        case 1: writeSysReg(PMEVTYPER1_EL0, value); break;
+        case 2: writeSysReg(PMEVTYPER2_EL0, value); break;
+        case 3: writeSysReg(PMEVTYPER3_EL0, value); break;
+        case 4: writeSysReg(PMEVTYPER4_EL0, value); break;
+        case 5: writeSysReg(PMEVTYPER5_EL0, value); break;
+    }
+}
+
+static void handlePmuOverflowIrq()
+{
+    // The PMU interrupt is level-sensitive, but configured as edge-triggered in the GIC. Keep going until no overflow
+    // flag is set, so that the line is really released and the next overflow produces a new edge.
+    for (;;)
+    {
+        uint32_t overflowed = readSysReg(PMOVSSET_EL0) & event_counter_mask;
+
+        if (overflowed == 0)
+        {
+            break;
+        }
+
+        writeSysReg(PMOVSCLR_EL0, overflowed);
+
+        for (int i = 0; i < num_events_configured; i++)
+        {
+            if (overflowed & (1u << i))
+            {
+                event_counter_high[i] += (1ull << 32);
+            }
+        }
+    }
+
+    asm volatile("isb");
+}
+
+// ************************************************************
+
+int bmboot::getNumPmuEventCounters()
+{
+    return std::min<int>((readSysReg(PMCR_EL0) >> PMCR_N_SHIFT) & 0x1f, PMU_MAX_EVENT_COUNTERS);
+}
+
+bool bmboot::configurePmu(std::span<PmuEvent const> events)
+{
+    if ((int) events.size() > getNumPmuEventCounters())
+    {
+        return false;
+    }
+
+    int irq_id = zynqmp::scugic::APU_PMU0_INTERRUPT_ID + getCpuIndex();
+
+    CriticalSection cs;
+
+    // Stop & reset everything
+    writeSysReg(PMCNTENCLR_EL0, ~0u);
+    writeSysReg(PMINTENCLR_EL1, ~0u);
+    writeSysReg(PMOVSCLR_EL0, ~0u);
+    writeSysReg(PMCR_EL0, (readSysReg(PMCR_EL0) & ~PMCR_E) | PMCR_P | PMCR_C | PMCR_LC);
+
+    num_events_configured = events.size();
+    event_counter_mask = (1u << num_events_configured) - 1;
+
+    for (int i = 0; i < PMU_MAX_EVENT_COUNTERS; i++)
+    {
+        event_counter_high[i] = 0;
+    }
+
+    for (int i = 0; i < num_events_configured; i++)
+    {
+        writeEventType(i, events[i]);
+    }
+
+    // Count cycles in EL0 and EL1
+    writeSysReg(PMCCFILTR_EL0, 0);
+
+    writeSysReg(PMINTENSET_EL1, event_counter_mask);
+    asm volatile("isb");
+
+    setupInterruptHandling(irq_id, PayloadInterruptPriority::p7_max, handlePmuOverflowIrq);
+    enableInterruptHandling(irq_id);
+
+    return true;
+}
+
+void bmboot::startPmu()
+{
+    writeSysReg(PMCNTENSET_EL0, event_counter_mask | CYCLE_COUNTER_BIT);
+    writeSysReg(PMCR_EL0, readSysReg(PMCR_EL0) | PMCR_E);
+    asm volatile("isb");
+}
+
+void bmboot::stopPmu()
+{
+    writeSysReg(PMCR_EL0, readSysReg(PMCR_EL0) & ~PMCR_E);
+    asm volatile("isb");
+}
+
+PmuCounts bmboot::readPmu()
+{
+    PmuCounts counts;
+
+    CriticalSection cs;
+
+    counts.cycles = getCycleCounterValue();
+
+    for (int i = 0; i < num_events_configured; i++)
+    {
+        uint64_t value = readEventCounter(i);
+
+        // An overflow might have happened since the last interrupt (or might be pending right now, since IRQs are
+        // masked). If the flag is set, the counter has wrapped, but the value read above could be from either side
+        // of the wrap; read it again to be sure.
+        asm volatile("isb");
+        if (readSysReg(PMOVSSET_EL0) & (1u << i))
+        {
+            value = readEventCounter(i) + (1ull << 32);
+        }
+
+        counts.events[i] = event_counter_high[i] + value;
+    }
+
+    return counts;
+}
+
+// ************************************************************
+// C API
+// ************************************************************
+
+static_assert(BM_PMU_MAX_EVENT_COUNTERS == PMU_MAX_EVENT_COUNTERS);
+static_assert(sizeof(BmPmuCounts) == sizeof(PmuCounts));
+
+extern "C" int bmConfigurePmu(uint16_t const* events, size_t num_events)
+{
+    return configurePmu(std::span((PmuEvent const*) events, num_events)) ? 1 : 0;
+}
+
+extern "C" void bmReadPmu(BmPmuCounts* counts_out)
+{
+    auto counts = readPmu();
+
+    counts_out->cycles = counts.cycles;
+    std::copy(std::begin(counts.events), std::end(counts.events), counts_out->events);
+}
+
+extern "C" void bmStartPmu()
+{
+    startPmu();
+}
+
+extern "C" void bmStopPmu()
+{
+    stopPmu();
+}
@@ -0,0 +1,406 @@
+//! @file
+//! @brief  Payloads running on several cores at once
+//! @author Martin Cejp
+
+#include <bmboot/cache.hpp>
+#include <bmboot/payload_runtime.hpp>
+#include <bmboot/smp.hpp>
+
+#include "armv8a.hpp"
+#include "executor.hpp"
+#include "payload_runtime_internal.hpp"
+
+#include <algorithm>
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+// Number of cores and distance between their stacks, defined by the linker script
+extern "C" uint64_t const __smp_config[2];
+
+// ************************************************************
+
+static void sendEvent()
+{
+    // The stores which the waiting cores are interested in must be visible before they wake up
+    asm volatile("dsb ish; sev" ::: "memory");
+}
+
+static void waitForEvent()
+{
+    asm volatile("wfe" ::: "memory");
+}
+
+int bmboot::getSmpCoreCount()
+{
+    return (int) __smp_config[0];
+}
+
+int bmboot::getSmpCoreIndex()
+{
+    return (getSmpCoreCount() > 1) ? internal::getCpuIndex() - 1 : 0;
+}
+
+// ************************************************************
+
+void Spinlock::lock()
+{
+    auto ticket = m_next_ticket.fetch_add(1, std::memory_order_relaxed);
+
+    while (m_now_serving.load(std::memory_order_acquire) != ticket)
+    {
+        waitForEvent();
+    }
+}
+
+bool Spinlock::try_lock()
+{
+    // Only if nobody holds the lock or waits for it, in which case m_now_serving cannot change under our hands
+    auto serving = m_now_serving.load(std::memory_order_acquire);
+    auto expected = serving;
+
+    return m_next_ticket.compare_exchange_strong(expected, serving + 1, std::memory_order_relaxed);
+}
+
+void Spinlock::unlock()
+{
+    m_now_serving.store(m_now_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    sendEvent();
+}
+
+// ************************************************************
+
+void Barrier::arriveAndWait()
+{
+    // Cannot advance before we have arrived
+    auto generation = m_generation.load(std::memory_order_acquire);
+
+    if (m_arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == m_num_cores)
+    {
+        // Last one in; the counter must be reset before anybody can arrive for the next round
+        m_arrived.store(0, std::memory_order_relaxed);
+        m_generation.store(generation + 1, std::memory_order_release);
+        sendEvent();
+    }
+    else
+    {
+        while (m_generation.load(std::memory_order_acquire) == generation)
+        {
+            waitForEvent();
+        }
+    }
+}
+
+// ************************************************************
+// Work-stealing deques (Chase & Lev, with the memory orderings of Le et al., "Correct and Efficient Work-Stealing
+// for Weak Memory Models", 2013). The owner pushes and pops at the bottom, thieves take from the top.
+//
+// An element is an index range, packed as (begin << 32 | end). Ranges are never empty, so 0 means "nothing".
+// ************************************************************
+
+constexpr uint64_t NO_RANGE = 0;
+
+// Each split pushes one range, and a core pops its own ranges before splitting again, so the depth stays below the
+// number of bits of an index; a push into a full deque is not an error anyway (the range is just not split further)
+constexpr int64_t DEQUE_CAPACITY = 64;
+
+struct WorkDeque
+{
+    alignas(64) std::atomic<int64_t> top;           // contended by thieves
+    alignas(64) std::atomic<int64_t> bottom;        // written by the owner only
+    std::atomic<uint64_t> ranges[DEQUE_CAPACITY];
+};
+
+static WorkDeque deques[MAX_SMP_CORES];
+
+static uint64_t packRange(uint32_t begin, uint32_t end)
+{
+    return (uint64_t) begin << 32 | end;
+}
+
+static bool push(WorkDeque& deque, uint64_t range)
+{
+    auto bottom = deque.bottom.load(std::memory_order_relaxed);
+    auto top = deque.top.load(std::memory_order_acquire);
+
+    if (bottom - top >= DEQUE_CAPACITY)
+    {
+        return false;
+    }
+
+    deque.ranges[bottom % DEQUE_CAPACITY].store(range, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    deque.bottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+static uint64_t pop(WorkDeque& deque)
+{
+    auto bottom = deque.bottom.load(std::memory_order_relaxed) - 1;
+    deque.bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = deque.top.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        // Empty
+        deque.bottom.store(bottom + 1, std::memory_order_relaxed);
+        return NO_RANGE;
+    }
+
+    auto range = deque.ranges[bottom % DEQUE_CAPACITY].load(std::memory_order_relaxed);
+
+    if (top == bottom)
+    {
+        // The last element; a thief may be after it as well
+        if (!deque.top.compare_exchange_strong(top, top + 1,
+                                               std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            range = NO_RANGE;
+        }
+
+        deque.bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return range;
+}
+
+static uint64_t steal(WorkDeque& deque)
+{
+    auto top = deque.top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto bottom = deque.bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+    {
+        return NO_RANGE;
+    }
+
+    auto range = deque.ranges[top % DEQUE_CAPACITY].load(std::memory_order_relaxed);
+
+    if (!deque.top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        // Lost to the owner or to another thief
+        return NO_RANGE;
+    }
+
+    return range;
+}
+
+// ************************************************************
+
+struct ParallelJob
+{
+    ParallelForBody body;
+    void* context;
+    uint32_t grain;
+    int max_cores;
+    uint32_t sequence;
+
+    //! Number of indices not processed yet; all deques are empty once it reaches 0
+    std::atomic<uint32_t> remaining;
+};
+
+// Published by cpu1 for the duration of a parallelFor. The job lives on the stack of cpu1, so it is only retired once
+// no other core holds a reference to it.
+static std::atomic<ParallelJob*> current_job {nullptr};
+static std::atomic<int> cores_in_job {0};
+
+// Used by cpu1 only, to let the workers tell a new job from the previous one at the same address
+static uint32_t job_sequence;
+
+// The initial value places it in .data rather than .bss, so it is valid from the moment the image has been loaded,
+// before cpu1 gets to clear .bss
+static std::atomic<bool> secondary_cores_held {true};
+
+// Keep splitting off the upper half for others to steal, for as long as the rest is worth splitting
+static void processRange(ParallelJob& job, WorkDeque& own, uint32_t begin, uint32_t end)
+{
+    while (end - begin > job.grain)
+    {
+        auto middle = begin + (end - begin) / 2;
+
+        if (!push(own, packRange(middle, end)))
+        {
+            break;
+        }
+
+        end = middle;
+    }
+
+    job.body(job.context, begin, end);
+    job.remaining.fetch_sub(end - begin, std::memory_order_acq_rel);
+}
+
+static void work(ParallelJob& job, int core_index)
+{
+    auto& own = deques[core_index];
+
+    while (job.remaining.load(std::memory_order_acquire) != 0)
+    {
+        auto range = pop(own);
+
+        // Out of work of our own; try the other cores in turn
+        for (int i = 1; i < job.max_cores && range == NO_RANGE; i++)
+        {
+            range = steal(deques[(core_index + i) % job.max_cores]);
+        }
+
+        if (range != NO_RANGE)
+        {
+            processRange(job, own, (uint32_t)(range >> 32), (uint32_t) range);
+        }
+        else
+        {
+            // Everything left is being processed already
+            asm volatile("yield");
+        }
+    }
+}
+
+void internal::runParallelFor(uint32_t begin, uint32_t end, uint32_t grain, ParallelForBody body, void* context,
+                              int max_cores)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    grain = std::max<uint32_t>(grain, 1);
+    max_cores = std::min(max_cores, getSmpCoreCount());
+
+    if (max_cores <= 1 || end - begin <= grain || getSmpCoreIndex() != 0
+            || current_job.load(std::memory_order_relaxed) != nullptr)
+    {
+        body(context, begin, end);
+        return;
+    }
+
+    ParallelJob job {body, context, grain, max_cores, ++job_sequence, {end - begin}};
+
+    current_job.store(&job, std::memory_order_seq_cst);
+    sendEvent();
+
+    processRange(job, deques[0], begin, end);
+    work(job, 0);
+
+    // No more takers; wait for those which have picked up the job to let go of it
+    current_job.store(nullptr, std::memory_order_seq_cst);
+
+    while (cores_in_job.load(std::memory_order_seq_cst) != 0)
+    {
+    }
+}
+
+// ************************************************************
+// Translation tables. TranslationTableBuilder::activate switches cpu1 to new tables; the other cores follow here, so
+// that all of them see the same memory types.
+// ************************************************************
+
+static std::atomic<uint64_t> shared_ttbr0;
+static std::atomic<uint32_t> ttbr0_generation;
+static std::atomic<uint32_t> ttbr0_generation_followed[MAX_SMP_CORES];
+
+static void followTranslationTables(int core_index)
+{
+    auto generation = ttbr0_generation.load(std::memory_order_acquire);
+
+    if (generation == ttbr0_generation_followed[core_index].load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    // As in TranslationTableBuilder::activate. Set/way operations only reach the caches of the calling core (and the
+    // shared L2), so cpu1 cannot do this on our behalf.
+    cleanInvalidateDcacheAll();
+
+    writeSysReg(TTBR0_EL1, shared_ttbr0.load(std::memory_order_relaxed));
+    asm volatile("isb; tlbi vmalle1; dsb nsh; isb" : : : "memory");
+
+    cleanInvalidateDcacheAll();
+    asm volatile("ic iallu; dsb nsh; isb" : : : "memory");
+
+    ttbr0_generation_followed[core_index].store(generation, std::memory_order_release);
+    sendEvent();
+}
+
+void internal::shareTranslationTables(uintptr_t ttbr0)
+{
+    if (getSmpCoreCount() <= 1)
+    {
+        return;
+    }
+
+    shared_ttbr0.store(ttbr0, std::memory_order_relaxed);
+    auto generation = ttbr0_generation.fetch_add(1, std::memory_order_release) + 1;
+    sendEvent();
+
+    // Cores still held in smpSecondaryCoreMain (when called from a global constructor) follow once released
+    if (secondary_cores_held.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    for (int core_index = 1; core_index < getSmpCoreCount(); core_index++)
+    {
+        while (ttbr0_generation_followed[core_index].load(std::memory_order_acquire) != generation)
+        {
+            waitForEvent();
+        }
+    }
+}
+
+// ************************************************************
+
+[[noreturn]] static void serveParallelFor(int core_index)
+{
+    uint32_t last_sequence = 0;
+
+    for (;;)
+    {
+        followTranslationTables(core_index);
+
+        if (auto job = current_job.load(std::memory_order_acquire))
+        {
+            cores_in_job.fetch_add(1, std::memory_order_seq_cst);
+
+            // The job is only pinned if it has not been retired in the meantime
+            if (current_job.load(std::memory_order_seq_cst) == job && job->sequence != last_sequence)
+            {
+                last_sequence = job->sequence;
+
+                if (core_index < job->max_cores)
+                {
+                    work(*job, core_index);
+                }
+            }
+
+            cores_in_job.fetch_sub(1, std::memory_order_release);
+        }
+
+        // Woken up by the next job, or by new translation tables
+        waitForEvent();
+    }
+}
+
+// ************************************************************
+
+// Called by xil-crt0.S on cpu1, once global constructors have run
+extern "C" void releaseSmpSecondaryCores()
+{
+    secondary_cores_held.store(false, std::memory_order_release);
+    sendEvent();
+}
+
+// Entered by xil-crt0.S on the cores other than cpu1, in place of main
+extern "C" [[noreturn]] void smpSecondaryCoreMain()
+{
+    while (secondary_cores_held.load(std::memory_order_acquire))
+    {
+        waitForEvent();
+    }
+
+    notifyPayloadStarted();
+
+    serveParallelFor(getSmpCoreIndex());
+}
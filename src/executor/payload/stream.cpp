@@ -0,0 +1,131 @@
+//! @file
+//! @brief  Streaming of fixed-size records from the payload to files on the Linux side
+//! @author Martin Cejp
+
+#include <bmboot/payload_runtime.h>
+#include <bmboot/shared_memory.hpp>
+#include <bmboot/stream.hpp>
+
+#include "bmboot_internal.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+// Defined by the linker script
+extern "C" char __stream_ring_start[], __stream_ring_end[];
+
+// ************************************************************
+
+static StreamRingHeader& getRing()
+{
+    return *(StreamRingHeader*) __stream_ring_start;
+}
+
+static uint8_t* getRingData()
+{
+    return (uint8_t*) __stream_ring_start + STREAM_RING_HEADER_SIZE;
+}
+
+// ************************************************************
+
+bool bmboot::startStream(size_t record_size)
+{
+    auto& ring = getRing();
+    size_t data_size = (__stream_ring_end - __stream_ring_start) - STREAM_RING_HEADER_SIZE;
+
+    if (record_size == 0 || record_size > data_size)
+    {
+        return false;
+    }
+
+    // The ring is not cleared when a payload is loaded, so carry on with the session numbering (and the drop count,
+    // which the recorder may not have seen in full yet) only if the header is valid
+    bool valid = (sharedLoad(ring.magic) == STREAM_RING_MAGIC);
+    uint32_t session = valid ? ring.session + 1 : 1;
+    uint64_t records_dropped = valid ? ring.records_dropped : 0;
+
+    if (session == 0)
+    {
+        session = 1;
+    }
+
+    // Invalidate the header first, so that the recorder never sees a half-initialized one
+    sharedStore(ring.magic, 0);
+    sharedMemoryWriteBarrier();
+
+    sharedStore(ring.record_size, record_size);
+    sharedStore(ring.session, session);
+    sharedStore(ring.capacity, data_size - data_size % record_size);
+    sharedStore(ring.write_position, 0);
+    sharedStore(ring.records_written, 0);
+    sharedStore(ring.records_dropped, records_dropped);
+
+    sharedMemoryWriteBarrier();
+    sharedStore(ring.magic, STREAM_RING_MAGIC);
+    return true;
+}
+
+bool bmboot::writeStreamRecords(void const* records, size_t count)
+{
+    auto& ring = getRing();
+
+    if (ring.magic != STREAM_RING_MAGIC || sharedLoad(ring.attached_session) != ring.session)
+    {
+        return false;
+    }
+
+    // Attachment (above) before the read position set up by it
+    sharedMemoryReadBarrier();
+
+    auto write_position = ring.write_position;
+    auto capacity = ring.capacity;
+    size_t size = count * ring.record_size;
+
+    auto free_space = capacity - (write_position - sharedLoad(ring.read_position));
+
+    // The recorder must be done reading the space before we overwrite it
+    sharedMemoryReadBarrier();
+
+    if (size > free_space)
+    {
+        sharedStore(ring.records_dropped, ring.records_dropped + count);
+        return false;
+    }
+
+    auto offset = write_position % capacity;
+    auto first_part = std::min<size_t>(size, capacity - offset);
+
+    memcpy(getRingData() + offset, records, first_part);
+    memcpy(getRingData(), (uint8_t const*) records + first_part, size - first_part);
+
+    // Data before the position that publishes it
+    sharedMemoryWriteBarrier();
+
+    sharedStore(ring.write_position, write_position + size);
+    sharedStore(ring.records_written, ring.records_written + count);
+    return true;
+}
+
+bool bmboot::isStreamRecorderAttached()
+{
+    auto& ring = getRing();
+
+    return ring.magic == STREAM_RING_MAGIC && sharedLoad(ring.attached_session) == ring.session;
+}
+
+// ************************************************************
+// C API
+// ************************************************************
+
+extern "C" int bmStartStream(size_t record_size)
+{
+    return startStream(record_size);
+}
+
+extern "C" int bmWriteStreamRecords(void const* records, size_t count)
+{
+    return writeStreamRecords(records, count);
+}
@@ -1,5 +1,7 @@
 //! @file
 //! @brief  Retargeting functions for standard I/O
+//!
+//! The standard streams go to the console; other file descriptors are files served by the manager (see host_io.cpp).
 //! @author Martin Cejp
 
 #include <bmboot/payload_runtime.hpp>
@@ -14,6 +16,7 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "payload_runtime_internal.hpp"
 #include "syscalls.h"
 
 #define STDIN_FILENO  0
@@ -21,6 +24,21 @@
 #define STDERR_FILENO 2
 
 using namespace bmboot;
+using namespace bmboot::internal;
+
+// **********************************************************
+
+// Converts the result of a host I/O function to the syscall convention
+static int toSyscallResult(int result)
+{
+    if (result < 0)
+    {
+        errno = -result;
+        return -1;
+    }
+
+    return result;
+}
 
 // **********************************************************
 
@@ -29,14 +47,24 @@ extern "C" int _isatty(int fd)
     if (fd >= STDIN_FILENO && fd <= STDERR_FILENO)
         return 1;
 
-    errno = EBADF;
+    errno = (fd > STDERR_FILENO) ? ENOTTY : EBADF;
     return 0;
 }
 
 // **********************************************************
 
+extern "C" int _open(char const* path, int flags, int mode)
+{
+    return toSyscallResult(hostOpen(path, flags, mode));
+}
+
+// **********************************************************
+
 extern "C" int _write(int fd, char *ptr, int len)
 {
+    if (fd > STDERR_FILENO)
+        return toSyscallResult(hostWrite(fd, ptr, len));
+
     return writeToStdout(ptr, len);
 }
 
@@ -47,6 +75,9 @@ extern "C" int _close(int fd)
     if (fd >= STDIN_FILENO && fd <= STDERR_FILENO)
         return 0;
 
+    if (fd > STDERR_FILENO)
+        return toSyscallResult(hostClose(fd));
+
     errno = EBADF;
     return -1;
 }
@@ -55,11 +86,10 @@ extern "C" int _close(int fd)
 
 extern "C" int _lseek(int fd, int ptr, int dir)
 {
-    (void) fd;
-    (void) ptr;
-    (void) dir;
+    if (fd > STDERR_FILENO)
+        return toSyscallResult(hostLseek(fd, ptr, dir));
 
-    errno = EBADF;
+    errno = (fd >= STDIN_FILENO) ? ESPIPE : EBADF;
     return -1;
 }
 
@@ -71,6 +101,10 @@ extern "C" int _read(int fd, char* ptr, int len)
     {
         return EIO;
     }
+    if (fd > STDERR_FILENO)
+    {
+        return toSyscallResult(hostRead(fd, ptr, len));
+    }
     errno = EBADF;
     return -1;
 }
@@ -85,6 +119,11 @@ extern "C" int _fstat(int fd, struct stat* st)
         return 0;
     }
 
+    if (fd > STDERR_FILENO)
+    {
+        return toSyscallResult(hostFstat(fd, st));
+    }
+
     errno = EBADF;
     return 0;
 }
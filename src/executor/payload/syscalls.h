@@ -11,6 +11,7 @@ extern "C" {
 #endif
 
 int _isatty(int fd);
+int _open(char const* path, int flags, int mode);
 int _write(int fd, char* ptr, int len);
 int _close(int fd);
 int _lseek(int fd, int ptr, int dir);
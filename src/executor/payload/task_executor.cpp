@@ -0,0 +1,174 @@
+//! @file
+//! @brief  Priority-driven preemptive task executor
+//! @author Martin Cejp
+
+#include <bmboot/task_executor.hpp>
+
+#include "zynqmp.hpp"
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+struct ReadyQueue
+{
+    TaskSlot* head;
+    TaskSlot* tail;
+};
+
+static ReadyQueue ready_queues[NUM_TASK_PRIORITY_LEVELS];
+static bool dispatcher_configured[NUM_TASK_PRIORITY_LEVELS];
+
+// ************************************************************
+
+// p0_min (0xF0) -> 0, p7_max (0x80) -> 7
+static int getPriorityLevel(PayloadInterruptPriority priority)
+{
+    return ((int) PayloadInterruptPriority::p0_min - (int) priority) / 0x10;
+}
+
+static PayloadInterruptPriority getPriorityForLevel(int priority_level)
+{
+    return (PayloadInterruptPriority) ((int) PayloadInterruptPriority::p0_min - priority_level * 0x10);
+}
+
+static void triggerDispatcher(int priority_level)
+{
+    zynqmp::scugic::GICD->SGIR = arm::gicv2::GICD::SGIR_TargetListFilter_SELF |
+                                 (TASK_DISPATCH_FIRST_SGI + priority_level);
+    asm volatile("dsb sy" ::: "memory");
+}
+
+// ************************************************************
+
+void internal::dispatchReadyTasks(int priority_level)
+{
+    auto& queue = ready_queues[priority_level];
+
+    for (;;)
+    {
+        TaskSlot* slot;
+
+        {
+            CriticalSection cs;
+
+            slot = queue.head;
+
+            if (!slot)
+            {
+                return;
+            }
+
+            queue.head = static_cast<TaskSlot*>(slot->next);
+
+            if (!queue.head)
+            {
+                queue.tail = nullptr;
+            }
+        }
+
+        slot->owner->run(*slot);
+    }
+}
+
+// ************************************************************
+
+static void configureDispatcher(int priority_level)
+{
+    if (dispatcher_configured[priority_level])
+    {
+        return;
+    }
+
+    int interrupt_id = TASK_DISPATCH_FIRST_SGI + priority_level;
+
+    setupInterruptHandling(interrupt_id,
+                           getPriorityForLevel(priority_level),
+                           [priority_level] { dispatchReadyTasks(priority_level); });
+    enableInterruptHandling(interrupt_id);
+
+    dispatcher_configured[priority_level] = true;
+}
+
+void bmboot::initializeTaskExecutor()
+{
+    for (int priority_level = 0; priority_level < NUM_TASK_PRIORITY_LEVELS; priority_level++)
+    {
+        configureDispatcher(priority_level);
+    }
+}
+
+// ************************************************************
+
+TaskSlot* TaskBase::acquireSlot()
+{
+    CriticalSection cs;
+
+    auto slot = free_slots;
+
+    if (slot)
+    {
+        free_slots = static_cast<TaskSlot*>(slot->next);
+        slot->next = nullptr;
+    }
+
+    return slot;
+}
+
+void TaskBase::releaseSlot(TaskSlot& slot)
+{
+    CriticalSection cs;
+
+    slot.next = free_slots;
+    free_slots = &slot;
+}
+
+// ************************************************************
+
+void TaskBase::makeReady(TaskSlot& slot)
+{
+    int priority_level = getPriorityLevel(priority);
+
+    configureDispatcher(priority_level);
+
+    {
+        CriticalSection cs;
+
+        auto& queue = ready_queues[priority_level];
+
+        slot.next = nullptr;
+
+        if (queue.tail)
+        {
+            queue.tail->next = &slot;
+        }
+        else
+        {
+            queue.head = &slot;
+        }
+
+        queue.tail = &slot;
+    }
+
+    // If the dispatcher is already pending or running, this has no effect besides re-pending it after it finishes
+    // (in which case it will find the queue empty and return immediately)
+    triggerDispatcher(priority_level);
+}
+
+void TaskBase::makeReadyAt(TaskSlot& slot, uint64_t deadline)
+{
+    // Configure the dispatcher now, rather than from the timer interrupt
+    configureDispatcher(getPriorityLevel(priority));
+
+    slot.deadline = deadline;
+    slot.on_expired = [](DeadlineTimerNode& node) {
+        auto& slot = static_cast<TaskSlot&>(node);
+        slot.owner->makeReady(slot);
+    };
+
+    scheduleDeadline(slot);
+}
+
+uint64_t TaskBase::deadlineAfter(std::chrono::microseconds delay)
+{
+    return getBuiltinTimerValue() + (uint64_t) delay.count() * getBuiltinTimerFrequency() / 1'000'000;
+}
@@ -0,0 +1,810 @@
+//! @file
+//! @brief  TLSF (Two-Level Segregated Fit) heap replacing newlib's malloc
+//! @author Martin Cejp
+//!
+//! Based on the algorithm described in M. Masmano et al., "TLSF: a New Dynamic Memory Allocator for Real-Time
+//! Systems" (ECRTS 2004). All operations run in bounded time (no list walks), with the obvious exception of the
+//! copying done by realloc and the zeroing done by calloc.
+//!
+//! Block layout: every block starts with a 16-byte header, followed by the payload. Free blocks additionally
+//! keep the free list links in the first 16 bytes of the payload. Payload sizes are multiples of 16, which keeps
+//! all payloads aligned to 16 bytes (the alignment of max_align_t on AArch64).
+//!
+//! The heap covers [_heap_start, _heap_end) as defined by the linker script.
+
+#include <bmboot/payload_runtime.hpp>
+
+#include "executor.hpp"
+#include "executor_asm.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <reent.h>
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+extern "C" char _heap_start[];
+extern "C" char _heap_end[];
+
+// ************************************************************
+
+namespace
+{
+
+constexpr size_t ALIGN_SIZE_LOG2 = 4;
+constexpr size_t ALIGN_SIZE = (1 << ALIGN_SIZE_LOG2);
+
+// Number of second-level subdivisions of each first-level class
+constexpr int SL_INDEX_COUNT_LOG2 = 5;
+constexpr int SL_INDEX_COUNT = (1 << SL_INDEX_COUNT_LOG2);
+
+// Blocks below SMALL_BLOCK_SIZE are all in first-level class 0, subdivided linearly in steps of ALIGN_SIZE
+constexpr int FL_INDEX_SHIFT = (SL_INDEX_COUNT_LOG2 + ALIGN_SIZE_LOG2);
+constexpr size_t SMALL_BLOCK_SIZE = (1 << FL_INDEX_SHIFT);
+
+// Largest supported block is just below 4 GiB, way more than any payload window
+constexpr int FL_INDEX_MAX = 32;
+constexpr int FL_INDEX_COUNT = (FL_INDEX_MAX - FL_INDEX_SHIFT + 1);
+
+static_assert(FL_INDEX_COUNT == HEAP_NUM_SIZE_CLASSES);
+static_assert(SMALL_BLOCK_SIZE / SL_INDEX_COUNT == ALIGN_SIZE);
+
+constexpr size_t BLOCK_SIZE_MIN = 2 * sizeof(void*);       // enough to hold the free list links
+constexpr size_t BLOCK_SIZE_MAX = (size_t(1) << FL_INDEX_MAX) - ALIGN_SIZE;
+
+// Flags stored in the low bits of BlockHeader::size
+constexpr size_t BLOCK_FREE_BIT = (1 << 0);
+constexpr size_t BLOCK_PREV_FREE_BIT = (1 << 1);
+constexpr size_t BLOCK_FLAGS_MASK = (BLOCK_FREE_BIT | BLOCK_PREV_FREE_BIT);
+
+// prev_phys + size
+constexpr size_t HEADER_SIZE = 2 * sizeof(size_t);
+
+struct BlockHeader
+{
+    BlockHeader* prev_phys;     // physically preceding block; nullptr for the first block
+    size_t size;                // payload size | flags
+
+    // Only valid for free blocks (overlaps the payload)
+    BlockHeader* next_free;
+    BlockHeader* prev_free;
+
+    size_t getSize() const { return size & ~BLOCK_FLAGS_MASK; }
+    void setSize(size_t new_size) { size = new_size | (size & BLOCK_FLAGS_MASK); }
+
+    bool isFree() const { return size & BLOCK_FREE_BIT; }
+    bool isPrevFree() const { return size & BLOCK_PREV_FREE_BIT; }
+
+    void setFree(bool free) { size = free ? (size | BLOCK_FREE_BIT) : (size & ~BLOCK_FREE_BIT); }
+    void setPrevFree(bool free) { size = free ? (size | BLOCK_PREV_FREE_BIT) : (size & ~BLOCK_PREV_FREE_BIT); }
+
+    void* payload() { return reinterpret_cast<char*>(this) + HEADER_SIZE; }
+    BlockHeader* next() { return reinterpret_cast<BlockHeader*>(reinterpret_cast<char*>(payload()) + getSize()); }
+
+    static BlockHeader* fromPayload(void* ptr)
+    {
+        return reinterpret_cast<BlockHeader*>(reinterpret_cast<char*>(ptr) - HEADER_SIZE);
+    }
+};
+
+static_assert(offsetof(BlockHeader, next_free) == HEADER_SIZE);
+static_assert(HEADER_SIZE == ALIGN_SIZE);
+
+struct Control
+{
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[FL_INDEX_COUNT];
+    BlockHeader* blocks[FL_INDEX_COUNT][SL_INDEX_COUNT];
+};
+
+}
+
+static Control control;
+static bool heap_initialized;
+
+// Local copy of the statistics, published into the IPC block on request (or after each operation, if enabled)
+static HeapStatisticsBlock stats;
+static bool auto_publish_statistics;
+
+// ************************************************************
+// Bit manipulation & size mapping
+// ************************************************************
+
+static int fls(size_t word)         // index of most significant set bit
+{
+    return 63 - __builtin_clzl(word);
+}
+
+static int ffs(uint32_t word)       // index of least significant set bit
+{
+    return __builtin_ctz(word);
+}
+
+static size_t alignUp(size_t x, size_t align)
+{
+    return (x + (align - 1)) & ~(align - 1);
+}
+
+static void mappingInsert(size_t size, int& fl, int& sl)
+{
+    if (size < SMALL_BLOCK_SIZE)
+    {
+        fl = 0;
+        sl = size / (SMALL_BLOCK_SIZE / SL_INDEX_COUNT);
+    }
+    else
+    {
+        int msb = fls(size);
+        sl = (size >> (msb - SL_INDEX_COUNT_LOG2)) ^ (1 << SL_INDEX_COUNT_LOG2);
+        fl = msb - (FL_INDEX_SHIFT - 1);
+    }
+}
+
+// Round up to the next list, so that any block in it is large enough
+static void mappingSearch(size_t size, int& fl, int& sl)
+{
+    if (size >= SMALL_BLOCK_SIZE)
+    {
+        size += (size_t(1) << (fls(size) - SL_INDEX_COUNT_LOG2)) - 1;
+    }
+
+    mappingInsert(size, fl, sl);
+}
+
+// ************************************************************
+// Free lists
+// ************************************************************
+
+static void removeFreeBlock(BlockHeader* block, int fl, int sl)
+{
+    auto prev = block->prev_free;
+    auto next = block->next_free;
+
+    if (next) { next->prev_free = prev; }
+    if (prev) { prev->next_free = next; }
+
+    if (control.blocks[fl][sl] == block)
+    {
+        control.blocks[fl][sl] = next;
+
+        if (!next)
+        {
+            control.sl_bitmap[fl] &= ~(1u << sl);
+
+            if (!control.sl_bitmap[fl])
+            {
+                control.fl_bitmap &= ~(1u << fl);
+            }
+        }
+    }
+}
+
+static void insertFreeBlock(BlockHeader* block, int fl, int sl)
+{
+    auto current = control.blocks[fl][sl];
+
+    block->next_free = current;
+    block->prev_free = nullptr;
+
+    if (current) { current->prev_free = block; }
+
+    control.blocks[fl][sl] = block;
+    control.fl_bitmap |= (1u << fl);
+    control.sl_bitmap[fl] |= (1u << sl);
+}
+
+static void removeBlock(BlockHeader* block)
+{
+    int fl, sl;
+    mappingInsert(block->getSize(), fl, sl);
+    removeFreeBlock(block, fl, sl);
+}
+
+static void insertBlock(BlockHeader* block)
+{
+    int fl, sl;
+    mappingInsert(block->getSize(), fl, sl);
+    insertFreeBlock(block, fl, sl);
+}
+
+static BlockHeader* findSuitableBlock(size_t size)
+{
+    int fl, sl;
+    mappingSearch(size, fl, sl);
+
+    if (fl >= FL_INDEX_COUNT)
+    {
+        return nullptr;
+    }
+
+    uint32_t sl_map = control.sl_bitmap[fl] & (~0u << sl);
+
+    if (!sl_map)
+    {
+        // No block in this first-level class; try the next non-empty one
+        uint32_t fl_map = (fl + 1 < 32) ? (control.fl_bitmap & (~0u << (fl + 1))) : 0;
+
+        if (!fl_map)
+        {
+            return nullptr;
+        }
+
+        fl = ffs(fl_map);
+        sl_map = control.sl_bitmap[fl];
+    }
+
+    sl = ffs(sl_map);
+
+    auto block = control.blocks[fl][sl];
+    removeFreeBlock(block, fl, sl);
+    return block;
+}
+
+// ************************************************************
+// Block splitting & merging
+// ************************************************************
+
+static void markAsFree(BlockHeader* block)
+{
+    auto next = block->next();
+    next->prev_phys = block;
+    next->setPrevFree(true);
+    block->setFree(true);
+}
+
+static void markAsUsed(BlockHeader* block)
+{
+    block->next()->setPrevFree(false);
+    block->setFree(false);
+}
+
+static bool canSplit(BlockHeader* block, size_t size)
+{
+    return block->getSize() >= size + HEADER_SIZE + BLOCK_SIZE_MIN;
+}
+
+// Split the block at `size` bytes; the remainder becomes a new free block (not yet inserted in a free list)
+static BlockHeader* split(BlockHeader* block, size_t size)
+{
+    auto remaining = reinterpret_cast<BlockHeader*>(reinterpret_cast<char*>(block->payload()) + size);
+    size_t remaining_size = block->getSize() - (size + HEADER_SIZE);
+
+    remaining->size = remaining_size;
+    remaining->prev_phys = block;
+    block->setSize(size);
+
+    remaining->next()->prev_phys = remaining;
+    markAsFree(remaining);
+    return remaining;
+}
+
+// Absorb `next` (physically following `block`) into `block`
+static BlockHeader* absorb(BlockHeader* block, BlockHeader* next)
+{
+    block->setSize(block->getSize() + next->getSize() + HEADER_SIZE);
+    block->next()->prev_phys = block;
+    return block;
+}
+
+static BlockHeader* mergePrev(BlockHeader* block)
+{
+    if (block->isPrevFree())
+    {
+        auto prev = block->prev_phys;
+        removeBlock(prev);
+        block = absorb(prev, block);
+    }
+
+    return block;
+}
+
+static BlockHeader* mergeNext(BlockHeader* block)
+{
+    auto next = block->next();
+
+    if (next->isFree())
+    {
+        removeBlock(next);
+        block = absorb(block, next);
+    }
+
+    return block;
+}
+
+// Give back the tail of a used block if it is large enough to form a block of its own
+static void trimUsed(BlockHeader* block, size_t size)
+{
+    if (canSplit(block, size))
+    {
+        auto remaining = split(block, size);
+        // the remainder follows a used block
+        remaining->setPrevFree(false);
+        remaining = mergeNext(remaining);
+        insertBlock(remaining);
+    }
+}
+
+static size_t adjustRequestSize(size_t size)
+{
+    if (size > BLOCK_SIZE_MAX)
+    {
+        return 0;
+    }
+
+    size_t adjusted = alignUp(size, ALIGN_SIZE);
+    return adjusted < BLOCK_SIZE_MIN ? BLOCK_SIZE_MIN : adjusted;
+}
+
+// ************************************************************
+// Statistics
+// ************************************************************
+
+static int getSizeClass(size_t size)
+{
+    int fl, sl;
+    mappingInsert(size, fl, sl);
+    return fl;
+}
+
+static void publishStatistics()
+{
+    // Approximate the largest free block by the head of the highest non-empty list.
+    // Within a list, block sizes differ by at most 1/32, so this is accurate to about 3%.
+    stats.largest_free_block = 0;
+
+    if (control.fl_bitmap)
+    {
+        int fl = fls(control.fl_bitmap);
+        int sl = fls(control.sl_bitmap[fl]);
+        stats.largest_free_block = control.blocks[fl][sl]->getSize();
+    }
+
+    auto& shared = getIpcBlock().heap_statistics;
+
+    // Seqlock-style publication: readers retry if the sequence number is odd or has changed during the read
+    auto seq = shared.seq;
+    stats.seq = seq + 1;
+    shared.seq = seq + 1;
+    memory_write_reorder_barrier();
+
+    memcpy((void*) &shared, &stats, sizeof(shared));
+    memory_write_reorder_barrier();
+
+    shared.seq = seq + 2;
+}
+
+// Called at the end of each heap operation. Only the counters in `stats` are maintained on the hot path; copying them
+// out is left to publishHeapStatistics unless enabled explicitly.
+static void maybePublishStatistics()
+{
+    if (auto_publish_statistics)
+    {
+        publishStatistics();
+    }
+}
+
+static void recordAllocation(BlockHeader* block)
+{
+    auto size_class = getSizeClass(block->getSize());
+
+    stats.num_allocations++;
+    stats.bytes_in_use += block->getSize();
+    stats.bytes_free -= block->getSize() + HEADER_SIZE;
+
+    if (stats.bytes_in_use > stats.bytes_in_use_high_water)
+    {
+        stats.bytes_in_use_high_water = stats.bytes_in_use;
+    }
+
+    if (++stats.blocks_in_use[size_class] > stats.blocks_in_use_high_water[size_class])
+    {
+        stats.blocks_in_use_high_water[size_class] = stats.blocks_in_use[size_class];
+    }
+}
+
+static void recordFree(BlockHeader* block)
+{
+    stats.num_frees++;
+    stats.bytes_in_use -= block->getSize();
+    stats.bytes_free += block->getSize() + HEADER_SIZE;
+    stats.blocks_in_use[getSizeClass(block->getSize())]--;
+}
+
+// ************************************************************
+// Initialization
+// ************************************************************
+
+static void initializeHeap()
+{
+    auto start = alignUp((uintptr_t) _heap_start, ALIGN_SIZE);
+    auto end = ((uintptr_t) _heap_end) & ~(ALIGN_SIZE - 1);
+
+    // One big free block, followed by a zero-sized used sentinel block
+    auto block = reinterpret_cast<BlockHeader*>(start);
+    size_t size = end - start - 2 * HEADER_SIZE;
+
+    if (size > BLOCK_SIZE_MAX)
+    {
+        size = BLOCK_SIZE_MAX;
+    }
+
+    block->prev_phys = nullptr;
+    block->size = size;
+
+    auto sentinel = block->next();
+    sentinel->size = 0;
+    sentinel->prev_phys = block;
+
+    markAsFree(block);
+    insertBlock(block);
+
+    stats = {};
+    stats.valid = 1;
+    stats.heap_size = size + HEADER_SIZE;
+    stats.bytes_free = stats.heap_size;
+
+    heap_initialized = true;
+    publishStatistics();
+}
+
+// Publish the (empty) statistics early, even if the payload never allocates
+__attribute__((constructor(101))) static void initializeHeapEarly()
+{
+    CriticalSection cs;
+
+    if (!heap_initialized)
+    {
+        initializeHeap();
+    }
+}
+
+// ************************************************************
+// Allocator entry points (to be called with IRQs masked)
+// ************************************************************
+
+static void* tlsfMalloc(size_t size)
+{
+    if (!heap_initialized)
+    {
+        initializeHeap();
+    }
+
+    size_t adjusted = adjustRequestSize(size);
+    BlockHeader* block = adjusted ? findSuitableBlock(adjusted) : nullptr;
+
+    if (!block)
+    {
+        stats.num_failed_allocations++;
+        maybePublishStatistics();
+        return nullptr;
+    }
+
+    markAsUsed(block);
+    trimUsed(block, adjusted);
+
+    recordAllocation(block);
+    maybePublishStatistics();
+    return block->payload();
+}
+
+static void tlsfFree(void* ptr)
+{
+    if (!ptr)
+    {
+        return;
+    }
+
+    auto block = BlockHeader::fromPayload(ptr);
+    recordFree(block);
+
+    markAsFree(block);
+    block = mergePrev(block);
+    block = mergeNext(block);
+    insertBlock(block);
+
+    maybePublishStatistics();
+}
+
+static void* tlsfMemalign(size_t alignment, size_t size)
+{
+    if (alignment <= ALIGN_SIZE)
+    {
+        return tlsfMalloc(size);
+    }
+
+    if (!heap_initialized)
+    {
+        initializeHeap();
+    }
+
+    // Reserve enough space for an aligned block plus a leading free block in front of it
+    size_t adjusted = adjustRequestSize(size);
+    size_t gap_minimum = HEADER_SIZE + BLOCK_SIZE_MIN;
+    size_t with_gap = adjustRequestSize(adjusted + alignment + gap_minimum);
+
+    BlockHeader* block = (adjusted && with_gap) ? findSuitableBlock(with_gap) : nullptr;
+
+    if (!block)
+    {
+        stats.num_failed_allocations++;
+        maybePublishStatistics();
+        return nullptr;
+    }
+
+    auto payload = (uintptr_t) block->payload();
+    auto aligned = alignUp(payload, alignment);
+    size_t gap = aligned - payload;
+
+    if (gap && gap < gap_minimum)
+    {
+        // Too small to form a block; move to the next aligned position
+        aligned = alignUp(payload + gap_minimum, alignment);
+        gap = aligned - payload;
+    }
+
+    if (gap)
+    {
+        // Split off the leading part as a free block of its own
+        auto leading = block;
+        auto aligned_block = split(leading, gap - HEADER_SIZE);
+        // split() marked the aligned block as free and leading as its predecessor; leading must become free too
+        markAsFree(leading);
+        leading = mergePrev(leading);
+        insertBlock(leading);
+
+        block = aligned_block;
+    }
+
+    markAsUsed(block);
+    trimUsed(block, adjusted);
+
+    recordAllocation(block);
+    maybePublishStatistics();
+    return block->payload();
+}
+
+static void* tlsfRealloc(void* ptr, size_t size)
+{
+    if (!ptr)
+    {
+        return tlsfMalloc(size);
+    }
+
+    if (size == 0)
+    {
+        tlsfFree(ptr);
+        return nullptr;
+    }
+
+    auto block = BlockHeader::fromPayload(ptr);
+    size_t adjusted = adjustRequestSize(size);
+
+    if (!adjusted)
+    {
+        return nullptr;
+    }
+
+    auto next = block->next();
+    size_t current_size = block->getSize();
+    size_t combined_size = current_size + (next->isFree() ? next->getSize() + HEADER_SIZE : 0);
+
+    if (adjusted > current_size && adjusted > combined_size)
+    {
+        // Must move
+        auto new_ptr = tlsfMalloc(size);
+
+        if (new_ptr)
+        {
+            memcpy(new_ptr, ptr, current_size);
+            tlsfFree(ptr);
+        }
+
+        return new_ptr;
+    }
+
+    // Resize in place
+    recordFree(block);
+    stats.num_frees--;              // not a real free
+
+    if (adjusted > current_size)
+    {
+        mergeNext(block);
+        markAsUsed(block);
+    }
+
+    trimUsed(block, adjusted);
+
+    recordAllocation(block);
+    stats.num_allocations--;        // not a real allocation
+    maybePublishStatistics();
+    return ptr;
+}
+
+// ************************************************************
+// C library interface
+// ************************************************************
+
+// Both the plain and the reentrant (_r) variants are provided, so that newlib's own allocator is never pulled in.
+// The corresponding --undefined link options are set in CMakeLists.txt.
+
+extern "C" void* malloc(size_t size)
+{
+    CriticalSection cs;
+    return tlsfMalloc(size);
+}
+
+extern "C" void free(void* ptr)
+{
+    CriticalSection cs;
+    tlsfFree(ptr);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+    size_t total;
+
+    if (__builtin_mul_overflow(count, size, &total))
+    {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    void* ptr;
+
+    {
+        CriticalSection cs;
+        ptr = tlsfMalloc(total);
+    }
+
+    if (ptr)
+    {
+        memset(ptr, 0, total);
+    }
+
+    return ptr;
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+    CriticalSection cs;
+    return tlsfRealloc(ptr, size);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size)
+{
+    if (alignment & (alignment - 1))
+    {
+        errno = EINVAL;
+        return nullptr;
+    }
+
+    CriticalSection cs;
+    return tlsfMemalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** memptr, size_t alignment, size_t size)
+{
+    if ((alignment & (alignment - 1)) || alignment < sizeof(void*))
+    {
+        return EINVAL;
+    }
+
+    auto ptr = memalign(alignment, size);
+
+    if (!ptr)
+    {
+        return ENOMEM;
+    }
+
+    *memptr = ptr;
+    return 0;
+}
+
+extern "C" size_t malloc_usable_size(void* ptr)
+{
+    return ptr ? BlockHeader::fromPayload(ptr)->getSize() : 0;
+}
+
+extern "C" void* _malloc_r(struct _reent* reent, size_t size)
+{
+    auto ptr = malloc(size);
+
+    if (!ptr)
+    {
+        reent->_errno = ENOMEM;
+    }
+
+    return ptr;
+}
+
+extern "C" void _free_r(struct _reent*, void* ptr)
+{
+    free(ptr);
+}
+
+extern "C" void* _calloc_r(struct _reent* reent, size_t count, size_t size)
+{
+    auto ptr = calloc(count, size);
+
+    if (!ptr)
+    {
+        reent->_errno = ENOMEM;
+    }
+
+    return ptr;
+}
+
+extern "C" void* _realloc_r(struct _reent* reent, void* ptr, size_t size)
+{
+    auto new_ptr = realloc(ptr, size);
+
+    if (!new_ptr && size)
+    {
+        reent->_errno = ENOMEM;
+    }
+
+    return new_ptr;
+}
+
+extern "C" void* _memalign_r(struct _reent* reent, size_t alignment, size_t size)
+{
+    auto ptr = memalign(alignment, size);
+
+    if (!ptr)
+    {
+        reent->_errno = ENOMEM;
+    }
+
+    return ptr;
+}
+
+extern "C" size_t _malloc_usable_size_r(struct _reent*, void* ptr)
+{
+    return malloc_usable_size(ptr);
+}
+
+// ************************************************************
+// Statistics interface
+// ************************************************************
+
+void bmboot::publishHeapStatistics()
+{
+    CriticalSection cs;
+
+    if (!heap_initialized)
+    {
+        initializeHeap();
+    }
+
+    publishStatistics();
+}
+
+void bmboot::setHeapStatisticsAutoPublish(bool enable)
+{
+    CriticalSection cs;
+
+    auto_publish_statistics = enable;
+
+    if (enable && heap_initialized)
+    {
+        // Bring the manager's view up to date right away
+        publishStatistics();
+    }
+}
+
+extern "C" void bmPublishHeapStatistics()
+{
+    publishHeapStatistics();
+}
+
+extern "C" void bmSetHeapStatisticsAutoPublish(int enable)
+{
+    setHeapStatisticsAutoPublish(enable != 0);
+}
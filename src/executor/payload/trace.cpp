@@ -0,0 +1,55 @@
+//! @file
+//! @brief  Scoped timing tracer
+//! @author Martin Cejp
+
+#include <bmboot/payload_runtime.hpp>
+#include <bmboot/trace.hpp>
+
+#include "armv8a.hpp"
+#include "executor.hpp"
+#include "executor_asm.hpp"
+#include "payload_runtime_internal.hpp"
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+// ************************************************************
+
+static TraceBlock* trace_block;
+
+// The hot path: no function calls, IRQs masked for about ten instructions.
+// Masking makes the core the only writer even in the presence of nested interrupts; the manager only ever reads, and
+// does not touch the ring until num_events has been published.
+static inline void recordEvent(char const* name, uint64_t begin_flag)
+{
+    if (trace_block == nullptr)
+    {
+        trace_block = &getDiagnosticsBlock().trace;
+    }
+
+    uint64_t info = ((uintptr_t) name & TRACE_INFO_NAME_MASK) |
+                    ((uint64_t) running_irq_priority << TRACE_INFO_PRIORITY_SHIFT) |
+                    ((uint64_t) irq_nesting_level << TRACE_INFO_NESTING_SHIFT) |
+                    begin_flag;
+
+    CriticalSection cs;
+
+    auto index = trace_block->num_events;
+    auto& record = trace_block->events[index % TRACE_RING_SIZE];
+
+    record.timestamp = readSysReg(CNTPCT_EL0);
+    record.info = info;
+
+    memory_write_reorder_barrier();
+    ((volatile TraceBlock*) trace_block)->num_events = index + 1;
+}
+
+void bmboot::traceBegin(char const* name)
+{
+    recordEvent(name, TRACE_INFO_BEGIN);
+}
+
+void bmboot::traceEnd(char const* name)
+{
+    recordEvent(name, 0);
+}
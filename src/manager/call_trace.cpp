@@ -0,0 +1,157 @@
+//! @file
+//! @brief  Function call traces of payloads built with INSTRUMENT_FUNCTIONS
+//! @author Martin Cejp
+
+#include "../bmboot_internal.hpp"
+#include "bmboot/call_trace.hpp"
+#include "ring_copy.hpp"
+
+#include <memory>
+#include <optional>
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+// ************************************************************
+
+MaybeError bmboot::readCallTrace(IDomain& domain, ElfSymbolizer const& symbols, std::vector<CallTraceRecord>& records_out)
+{
+    auto address = symbols.findObject(CALL_TRACE_SYMBOL);
+
+    if (!address.has_value())
+    {
+        return ErrorCode::invalid_argument;
+    }
+
+    auto buffer = std::make_unique<CallTraceBuffer>();
+
+    if (auto err = domain.readPayloadMemory(*address, std::span((uint8_t*) buffer.get(), sizeof(CallTraceBuffer))))
+    {
+        return err;
+    }
+
+    // The payload might still be running and overwriting the oldest records while we were copying.
+    // Find out how far it has got and throw away anything that could have been affected.
+    uint64_t num_records_after;
+
+    if (auto err = domain.readPayloadMemory(*address, std::span((uint8_t*) &num_records_after, sizeof(num_records_after))))
+    {
+        return err;
+    }
+
+    uint64_t end = buffer->num_records;
+    uint64_t start = (end > CALL_TRACE_RING_SIZE) ? end - CALL_TRACE_RING_SIZE : 0;
+
+    start += countOverwrittenRecords(start, end, num_records_after, CALL_TRACE_RING_SIZE);
+
+    records_out.clear();
+
+    for (auto i = start; i < end; i++)
+    {
+        auto const& record = buffer->records[i % CALL_TRACE_RING_SIZE];
+
+        records_out.push_back(CallTraceRecord {
+            .timestamp = record.timestamp,
+            .function = (uintptr_t)(record.info & TRACE_INFO_NAME_MASK),
+            .enter = (record.info & TRACE_INFO_BEGIN) != 0,
+            .nesting_level = (int)((record.info >> TRACE_INFO_NESTING_SHIFT) & 0xff),
+            .priority = (int)((record.info >> TRACE_INFO_PRIORITY_SHIFT) & 0xff),
+        });
+    }
+
+    return {};
+}
+
+// ************************************************************
+
+void bmboot::printCallTrace(FILE* file,
+                            std::span<CallTraceRecord const> records,
+                            ElfSymbolizer const& symbols,
+                            uint32_t timer_frequency)
+{
+    struct Line
+    {
+        uint64_t timestamp;
+        std::optional<uint64_t> duration;      // empty if the function had not returned by the end of the trace
+        int depth;
+        int priority;
+        std::string text;
+    };
+
+    struct Frame
+    {
+        uintptr_t function;
+        size_t line_index;
+    };
+
+    if (records.empty())
+    {
+        return;
+    }
+
+    std::vector<Line> lines;
+    std::vector<std::vector<Frame>> stacks;         // per nesting level
+
+    for (auto const& record : records)
+    {
+        if (record.nesting_level >= (int) stacks.size())
+        {
+            stacks.resize(record.nesting_level + 1);
+        }
+
+        auto& stack = stacks[record.nesting_level];
+
+        if (record.enter)
+        {
+            stack.push_back(Frame { record.function, lines.size() });
+            lines.push_back(Line { record.timestamp, {}, (int) stack.size() - 1, record.priority,
+                                   symbols.symbolize(record.function) });
+        }
+        else if (!stack.empty() && stack.back().function == record.function)
+        {
+            auto& line = lines[stack.back().line_index];
+            line.duration = record.timestamp - line.timestamp;
+            stack.pop_back();
+        }
+        else
+        {
+            // Entered before the start of the trace (or the records of the enclosing calls were lost)
+            stack.clear();
+            lines.push_back(Line { record.timestamp, {}, 0, record.priority,
+                                   "<- " + symbols.symbolize(record.function) + " (entered before start of trace)" });
+        }
+    }
+
+    double us_per_tick = 1e6 / timer_frequency;
+    auto first_timestamp = records.front().timestamp;
+
+    fprintf(file, "%12s %12s  %s\n", "time [us]", "dur. [us]", "function");
+
+    for (auto const& line : lines)
+    {
+        char duration[32];
+
+        if (line.duration.has_value())
+        {
+            snprintf(duration, sizeof(duration), "%12.3f", *line.duration * us_per_tick);
+        }
+        else
+        {
+            snprintf(duration, sizeof(duration), "%12s", "?");
+        }
+
+        char context[16] = "";
+
+        if (line.priority != 0xFF)
+        {
+            snprintf(context, sizeof(context), "[IRQ 0x%02X] ", line.priority);
+        }
+
+        fprintf(file, "%12.3f %s  %s%*s%s\n",
+                (line.timestamp - first_timestamp) * us_per_tick,
+                duration,
+                context,
+                line.depth * 2, "",
+                line.text.c_str());
+    }
+}
@@ -0,0 +1,117 @@
+//! @file
+//! @brief  Writer for the Chrome trace event format
+//! @author Martin Cejp
+
+#include "bmboot/chrome_trace.hpp"
+
+using namespace bmboot;
+
+// ************************************************************
+
+ChromeTraceWriter::ChromeTraceWriter(FILE* file) : file(file)
+{
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file);
+}
+
+ChromeTraceWriter::~ChromeTraceWriter()
+{
+    finish();
+}
+
+void ChromeTraceWriter::finish()
+{
+    if (!finished)
+    {
+        fputs("\n]}\n", file);
+        fflush(file);
+        finished = true;
+    }
+}
+
+// ************************************************************
+
+void ChromeTraceWriter::setProcessName(int pid, std::string_view name)
+{
+    beginEvent();
+    fprintf(file, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":", pid);
+    writeString(name);
+    fputs("}}", file);
+}
+
+void ChromeTraceWriter::setThreadName(int pid, int tid, std::string_view name, int sort_index)
+{
+    beginEvent();
+    fprintf(file, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", pid, tid);
+    writeString(name);
+    fputs("}},\n", file);
+    fprintf(file, "{\"ph\":\"M\",\"name\":\"thread_sort_index\",\"pid\":%d,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+            pid, tid, sort_index);
+}
+
+void ChromeTraceWriter::addBeginEvent(int pid, int tid, double timestamp_us, std::string_view name)
+{
+    beginEvent();
+    fprintf(file, "{\"ph\":\"B\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"name\":", pid, tid, timestamp_us);
+    writeString(name);
+    fputc('}', file);
+}
+
+void ChromeTraceWriter::addEndEvent(int pid, int tid, double timestamp_us, std::string_view name)
+{
+    beginEvent();
+    fprintf(file, "{\"ph\":\"E\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"name\":", pid, tid, timestamp_us);
+    writeString(name);
+    fputc('}', file);
+}
+
+void ChromeTraceWriter::addInstantEvent(int pid, int tid, double timestamp_us, std::string_view name)
+{
+    beginEvent();
+    fprintf(file, "{\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"name\":", pid, tid, timestamp_us);
+    writeString(name);
+    fputc('}', file);
+}
+
+void ChromeTraceWriter::addCounterEvent(int pid, double timestamp_us, std::string_view name, double value)
+{
+    beginEvent();
+    fprintf(file, "{\"ph\":\"C\",\"pid\":%d,\"ts\":%.3f,\"name\":", pid, timestamp_us);
+    writeString(name);
+    fprintf(file, ",\"args\":{\"value\":%g}}", value);
+}
+
+// ************************************************************
+
+void ChromeTraceWriter::beginEvent()
+{
+    if (!first_event)
+    {
+        fputs(",\n", file);
+    }
+
+    first_event = false;
+}
+
+void ChromeTraceWriter::writeString(std::string_view str)
+{
+    fputc('"', file);
+
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            fputc('\\', file);
+            fputc(c, file);
+        }
+        else if ((unsigned char) c < 0x20)
+        {
+            fprintf(file, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, file);
+        }
+    }
+
+    fputc('"', file);
+}
@@ -0,0 +1,204 @@
+//! @file
+//! @brief  Correlation of executor timestamps with Linux clocks
+//! @author Martin Cejp
+
+#include "bmboot/clock_sync.hpp"
+
+#include <time.h>
+
+using namespace bmboot;
+
+// ************************************************************
+
+static int64_t readClockNs(clockid_t clock)
+{
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t) ts.tv_sec * 1'000'000'000 + ts.tv_nsec;
+}
+
+uint64_t ClockSync::readCounter()
+{
+#if defined(__aarch64__)
+    uint64_t value;
+    // The ISB keeps the read from being performed early, outside of the bracketing clock readings
+    __asm__ __volatile__("isb; mrs %0, CNTVCT_EL0" : "=r" (value) :: "memory");
+    return value;
+#else
+    // Not running on the target (e.g. unit tests on a PC): pretend that the counter ticks in nanoseconds
+    return (uint64_t) readClockNs(CLOCK_MONOTONIC);
+#endif
+}
+
+// ************************************************************
+
+ClockSync::ClockSync(uint32_t nominal_frequency_hz)
+        : nominal_ns_per_tick(1e9 / nominal_frequency_hz),
+          ns_per_tick(nominal_ns_per_tick)
+{
+}
+
+ClockSync::~ClockSync()
+{
+    stopPeriodicSampling();
+}
+
+// ************************************************************
+
+void ClockSync::sample()
+{
+    constexpr int NUM_ATTEMPTS = 5;
+
+    Sample best;
+    int64_t best_bracket_ns = INT64_MAX;
+    int64_t realtime_offset = 0;
+
+    // Keep the attempt with the narrowest bracket, which is the least likely to have been interrupted
+    for (int attempt = 0; attempt < NUM_ATTEMPTS; attempt++)
+    {
+        auto before = readClockNs(CLOCK_MONOTONIC);
+        auto counter = readCounter();
+        auto after = readClockNs(CLOCK_MONOTONIC);
+        auto realtime = readClockNs(CLOCK_REALTIME);
+
+        if (after - before < best_bracket_ns)
+        {
+            best = Sample { .counter = counter, .monotonic_ns = before + (after - before) / 2 };
+            best_bracket_ns = after - before;
+            realtime_offset = realtime - after;
+        }
+    }
+
+    std::lock_guard lock(mutex);
+
+    if (!samples.empty() && best.counter <= samples.back().counter)
+    {
+        // Counter went backwards? Something is seriously off; start over
+        samples.clear();
+    }
+
+    samples.push_back(best);
+
+    if (samples.size() > MAX_SAMPLES)
+    {
+        samples.pop_front();
+    }
+
+    realtime_offset_ns = realtime_offset;
+    fit();
+}
+
+// Least-squares fit of monotonic time against counter value. Coordinates are taken relative to the oldest sample to
+// keep the sums well within double precision.
+void ClockSync::fit()
+{
+    auto const& origin = samples.front();
+    auto const& latest = samples.back();
+
+    if ((double)(latest.counter - origin.counter) * nominal_ns_per_tick < 1e9)
+    {
+        // Too short a baseline to measure the frequency; anchor the nominal rate at the latest sample
+        ns_per_tick = nominal_ns_per_tick;
+        reference_counter = latest.counter;
+        reference_ns = latest.monotonic_ns;
+        return;
+    }
+
+    double mean_x = 0, mean_y = 0;
+
+    for (auto const& sample : samples)
+    {
+        mean_x += (double)(sample.counter - origin.counter);
+        mean_y += (double)(sample.monotonic_ns - origin.monotonic_ns);
+    }
+
+    mean_x /= samples.size();
+    mean_y /= samples.size();
+
+    double sum_xy = 0, sum_xx = 0;
+
+    for (auto const& sample : samples)
+    {
+        double dx = (double)(sample.counter - origin.counter) - mean_x;
+        double dy = (double)(sample.monotonic_ns - origin.monotonic_ns) - mean_y;
+        sum_xy += dx * dy;
+        sum_xx += dx * dx;
+    }
+
+    ns_per_tick = sum_xy / sum_xx;
+
+    // The fitted line passes through the centroid
+    reference_counter = origin.counter + (uint64_t) mean_x;
+    reference_ns = origin.monotonic_ns + (int64_t)(mean_y - (mean_x - (double)(uint64_t) mean_x) * ns_per_tick);
+}
+
+// ************************************************************
+
+void ClockSync::startPeriodicSampling(std::chrono::milliseconds period)
+{
+    stopPeriodicSampling();
+
+    stop_requested = false;
+    thread = std::thread([this, period]
+    {
+        std::unique_lock lock(mutex);
+
+        while (!stop_requested)
+        {
+            lock.unlock();
+            sample();
+            lock.lock();
+
+            stop_condition.wait_for(lock, period, [this] { return stop_requested; });
+        }
+    });
+}
+
+void ClockSync::stopPeriodicSampling()
+{
+    if (!thread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        stop_requested = true;
+    }
+
+    stop_condition.notify_all();
+    thread.join();
+}
+
+// ************************************************************
+
+std::chrono::steady_clock::time_point ClockSync::toMonotonic(uint64_t counter) const
+{
+    std::lock_guard lock(mutex);
+
+    auto ns = reference_ns + (int64_t)((double)(int64_t)(counter - reference_counter) * ns_per_tick);
+    return std::chrono::steady_clock::time_point(std::chrono::nanoseconds(ns));
+}
+
+std::chrono::system_clock::time_point ClockSync::toRealtime(uint64_t counter) const
+{
+    std::lock_guard lock(mutex);
+
+    auto ns = reference_ns + realtime_offset_ns + (int64_t)((double)(int64_t)(counter - reference_counter) * ns_per_tick);
+    return std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ns)));
+}
+
+double ClockSync::toSeconds(int64_t ticks) const
+{
+    std::lock_guard lock(mutex);
+
+    return (double) ticks * ns_per_tick * 1e-9;
+}
+
+double ClockSync::getFrequency() const
+{
+    std::lock_guard lock(mutex);
+
+    return 1e9 / ns_per_tick;
+}
@@ -3,9 +3,12 @@
 //! @author Martin Cejp
 
 #include "../bmboot_internal.hpp"
+#include "bmboot/clock_sync.hpp"
 #include "bmboot/domain.hpp"
 #include "bmboot/manager_configuration.hpp"
 #include "coredump_linux.hpp"
+#include "ring_copy.hpp"
+#include "../utility/crc32.hpp"
 #include "../utility/mmap.hpp"
 
 #include "monitor_zynqmp_cpu1.hpp"
@@ -15,8 +18,12 @@
 // This, of course, negates any attempt to keep platform-specific stuff contained.
 #include "zynqmp_manager.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <unordered_map>
 #include <variant>
+#include <vector>
 
 #include <fcntl.h>
 #include <sys/mman.h>
@@ -51,18 +58,37 @@ struct PhysicalMemoryRanges
     size_t monitor_size;
     intptr_t monitor_ipc_address;
     size_t monitor_ipc_size;
+    intptr_t diagnostics_address;
+    size_t diagnostics_size;
     intptr_t payload_address;
     size_t payload_size;
+    intptr_t payload_b_address;
+    size_t payload_b_size;
+    intptr_t ocm_address;
+    size_t ocm_size;
+    intptr_t ddr_uncached_address;
+    size_t ddr_uncached_size;
+    intptr_t stream_address;
+    size_t stream_size;
+    intptr_t host_io_address;
+    size_t host_io_size;
 };
 
 static PhysicalMemoryRanges const& getPhysicalMemoryRanges(DomainIndex domain);
 
+struct PayloadWindow
+{
+    intptr_t address;
+    size_t size;
+};
+
 // ************************************************************
 
 class Domain : public IDomain
 {
 public:
-    Domain(DomainIndex domain, IpcBlock& ipc_block) : m_domain(domain), m_ipc_block(ipc_block) {}
+    Domain(DomainIndex domain, IpcBlock& ipc_block, DiagnosticsBlock& diagnostics_block)
+            : m_domain(domain), m_ipc_block(ipc_block), m_diagnostics_block(diagnostics_block) {}
 
     MaybeError dumpCore(char const* filename) final;
     void dumpDebugInfo() final;
@@ -72,12 +98,45 @@ public:
                                    uintptr_t payload_argument) final;
     MaybeError loadElfPayload(std::span<uint8_t const> payload_binary,
                               uintptr_t payload_argument) final;
+    MaybeError preloadPayload(std::span<uint8_t const> payload_binary,
+                              uint32_t payload_crc32,
+                              uintptr_t payload_argument) final;
+    MaybeError preloadElfPayload(std::span<uint8_t const> payload_binary,
+                                 uintptr_t payload_argument) final;
+    MaybeError swapPayload() final;
+    PayloadSlot getActivePayloadSlot() final;
+    MaybeError loadAndArmPayload(std::span<uint8_t const> payload_binary,
+                                 uint32_t payload_crc32,
+                                 uintptr_t payload_argument,
+                                 uint64_t start_time) final;
+    MaybeError loadElfAndArmPayload(std::span<uint8_t const> payload_binary,
+                                    uintptr_t payload_argument,
+                                    uint64_t start_time) final;
+    MaybeError awaitPayloadStart() final;
+    uint64_t getPayloadStartTimestamp() final;
+    MaybeError armPayloadOf(IDomain& loader, uint64_t start_time) final;
     int getchar() final;
+    uint64_t getConsoleLineTimestamp() final { return m_console_line_timestamp; }
     CrashInfo getCrashInfo() final;
+    std::optional<HeapStatistics> getHeapStatistics() final;
     DomainIndex getIndex() const final { return m_domain; }
     DomainState getState() final;
     MaybeError terminatePayload() final;
+    MaybeError restartMonitor() final;
     MaybeError startup() final;
+    MaybeError startProfiler(int sampling_rate_hz) final;
+    MaybeError stopProfiler() final;
+    uint64_t readProfileSamples(std::vector<ProfileSample>& samples) final;
+    ProfilerStatus getProfilerStatus() final;
+    uint64_t readTraceEvents(std::vector<TraceEvent>& events) final;
+    std::vector<MonitorEvent> getMonitorEvents() final;
+    std::optional<TelemetrySnapshot> getTelemetry() final;
+    std::optional<BootTiming> getBootTiming() final;
+    uint32_t getTimerFrequency() final;
+    MaybeError readPayloadMemory(uintptr_t address, std::span<uint8_t> buffer) final;
+    std::variant<std::span<uint8_t>, ErrorCode> mapUncachedMemory(uintptr_t address, size_t size) final;
+    std::variant<std::span<uint8_t>, ErrorCode> mapStreamRing() final;
+    std::variant<std::span<uint8_t>, ErrorCode> mapHostIoArea() final;
 
     void startDummyPayload() final
     {
@@ -86,12 +145,54 @@ public:
     }
 
 private:
+    // A payload loaded into the inactive slot, waiting for swapPayload
+    struct PreloadedPayload
+    {
+        uintptr_t entry_address;
+        size_t size;
+        uint32_t crc32;
+        uintptr_t argument;
+    };
+
+    // A payload loaded from ELF. The image spans from the entry point to the end of the last segment in the payload
+    // window, so that the monitor can check it like a raw binary.
+    struct LoadedElf
+    {
+        uintptr_t entry_address;
+        size_t image_size;
+        uint32_t image_crc32;
+    };
+
     MaybeError awaitMonitorStartup();
+    MaybeError awaitStartResponse();
+    MaybeError canPreloadPayload();
+    MaybeError sendKillRequest(uint32_t request);
+    MaybeError sendProfilerRequest(uint32_t period_us);
+    std::string const& readTraceEventName(uintptr_t address);
+    std::optional<PayloadSlot> findPayloadSlot(uintptr_t address, size_t size);
+    uint8_t const* getPayloadArea(PayloadSlot slot);
+    PayloadWindow getPayloadWindow(PayloadSlot slot);
     PhysicalMemoryRanges const& getPhysicalMemoryRanges() { return ::getPhysicalMemoryRanges(m_domain); }
+    std::variant<LoadedElf, ErrorCode> loadElfToSlot(std::span<uint8_t const> payload_binary,
+                                                     PayloadSlot slot,
+                                                     bool allow_ocm);
+    MaybeError loadBinaryAndStart(std::span<uint8_t const> payload_binary,
+                                  uint32_t payload_crc32,
+                                  uintptr_t payload_argument,
+                                  std::optional<uint64_t> start_time);
+    MaybeError loadElfAndStart(std::span<uint8_t const> payload_binary,
+                               uintptr_t payload_argument,
+                               std::optional<uint64_t> start_time);
+    void postStartCommand(uintptr_t entry_address,
+                          size_t payload_size,
+                          uint32_t payload_crc32,
+                          uintptr_t payload_argument,
+                          std::optional<uint64_t> start_time = {});
     MaybeError startPayloadAt(uintptr_t entry_address,
                               size_t payload_size,
                               uint32_t payload_crc32,
-                              uintptr_t payload_argument);
+                              uintptr_t payload_argument,
+                              std::optional<uint64_t> start_time = {});
     MaybeError startup(std::span<uint8_t const> monitor_binary);
 
 //    volatile IpcBlock& getIpcBlock()
@@ -116,6 +217,20 @@ private:
 
     DomainIndex m_domain;
     IpcBlock& m_ipc_block;
+    DiagnosticsBlock& m_diagnostics_block;
+
+    uint64_t m_console_line_timestamp = 0;
+
+    uint64_t m_profiler_read_position = 0;
+
+    uint64_t m_trace_read_position = 0;
+    std::unique_ptr<Mmap> m_payload_area[2];        // per slot, mapped on demand, to read trace event names
+    std::unique_ptr<Mmap> m_uncached_area;          // mapped on demand, see mapUncachedMemory
+    std::unique_ptr<Mmap> m_stream_area;            // mapped on demand, see mapStreamRing
+    std::unique_ptr<Mmap> m_host_io_area;           // mapped on demand, see mapHostIoArea
+    std::unordered_map<uintptr_t, std::string> m_trace_names;
+
+    std::optional<PreloadedPayload> m_preloaded_payload;
 };
 
 // ************************************************************
@@ -143,8 +258,20 @@ static PhysicalMemoryRanges const& getPhysicalMemoryRanges(DomainIndex domain)
         .monitor_size = bmboot_cpu1_monitor_SIZE,
         .monitor_ipc_address = bmboot_cpu1_monitor_ipc_ADDRESS,
         .monitor_ipc_size = bmboot_cpu1_monitor_ipc_SIZE,
+        .diagnostics_address = bmboot_cpu1_diagnostics_ADDRESS,
+        .diagnostics_size = bmboot_cpu1_diagnostics_SIZE,
         .payload_address = bmboot_cpu1_payload_ADDRESS,
         .payload_size = bmboot_cpu1_payload_SIZE,
+        .payload_b_address = bmboot_cpu1_payload_b_ADDRESS,
+        .payload_b_size = bmboot_cpu1_payload_b_SIZE,
+        .ocm_address = bmboot_cpu1_ocm_ADDRESS,
+        .ocm_size = bmboot_cpu1_ocm_SIZE,
+        .ddr_uncached_address = bmboot_cpu1_ddr_uncached_ADDRESS,
+        .ddr_uncached_size = bmboot_cpu1_ddr_uncached_SIZE,
+        .stream_address = bmboot_cpu1_stream_ADDRESS,
+        .stream_size = bmboot_cpu1_stream_SIZE,
+        .host_io_address = bmboot_cpu1_host_io_ADDRESS,
+        .host_io_size = bmboot_cpu1_host_io_SIZE,
     };
 
     static PhysicalMemoryRanges cpu2
@@ -153,8 +280,20 @@ static PhysicalMemoryRanges const& getPhysicalMemoryRanges(DomainIndex domain)
         .monitor_size = bmboot_cpu2_monitor_SIZE,
         .monitor_ipc_address = bmboot_cpu2_monitor_ipc_ADDRESS,
         .monitor_ipc_size = bmboot_cpu2_monitor_ipc_SIZE,
+        .diagnostics_address = bmboot_cpu2_diagnostics_ADDRESS,
+        .diagnostics_size = bmboot_cpu2_diagnostics_SIZE,
         .payload_address = bmboot_cpu2_payload_ADDRESS,
         .payload_size = bmboot_cpu2_payload_SIZE,
+        .payload_b_address = bmboot_cpu2_payload_b_ADDRESS,
+        .payload_b_size = bmboot_cpu2_payload_b_SIZE,
+        .ocm_address = bmboot_cpu2_ocm_ADDRESS,
+        .ocm_size = bmboot_cpu2_ocm_SIZE,
+        .ddr_uncached_address = bmboot_cpu2_ddr_uncached_ADDRESS,
+        .ddr_uncached_size = bmboot_cpu2_ddr_uncached_SIZE,
+        .stream_address = bmboot_cpu2_stream_ADDRESS,
+        .stream_size = bmboot_cpu2_stream_SIZE,
+        .host_io_address = bmboot_cpu2_host_io_ADDRESS,
+        .host_io_size = bmboot_cpu2_host_io_SIZE,
     };
 
     static PhysicalMemoryRanges cpu3
@@ -163,8 +302,20 @@ static PhysicalMemoryRanges const& getPhysicalMemoryRanges(DomainIndex domain)
         .monitor_size = bmboot_cpu3_monitor_SIZE,
         .monitor_ipc_address = bmboot_cpu3_monitor_ipc_ADDRESS,
         .monitor_ipc_size = bmboot_cpu3_monitor_ipc_SIZE,
+        .diagnostics_address = bmboot_cpu3_diagnostics_ADDRESS,
+        .diagnostics_size = bmboot_cpu3_diagnostics_SIZE,
         .payload_address = bmboot_cpu3_payload_ADDRESS,
         .payload_size = bmboot_cpu3_payload_SIZE,
+        .payload_b_address = bmboot_cpu3_payload_b_ADDRESS,
+        .payload_b_size = bmboot_cpu3_payload_b_SIZE,
+        .ocm_address = bmboot_cpu3_ocm_ADDRESS,
+        .ocm_size = bmboot_cpu3_ocm_SIZE,
+        .ddr_uncached_address = bmboot_cpu3_ddr_uncached_ADDRESS,
+        .ddr_uncached_size = bmboot_cpu3_ddr_uncached_SIZE,
+        .stream_address = bmboot_cpu3_stream_ADDRESS,
+        .stream_size = bmboot_cpu3_stream_SIZE,
+        .host_io_address = bmboot_cpu3_host_io_ADDRESS,
+        .host_io_size = bmboot_cpu3_host_io_SIZE,
     };
 
     switch (domain)
@@ -176,6 +327,12 @@ static PhysicalMemoryRanges const& getPhysicalMemoryRanges(DomainIndex domain)
     }
 }
 
+// The DDR scratch region (MemoryTier::ddr_scratch) is remapped and overwritten freely by benchmarks, so it must stay
+// clear of the areas shared with the manager and of the second payload slots
+static_assert(bmboot_ddr_scratch_ADDRESS >= bmboot_cpu3_stream_ADDRESS + bmboot_cpu3_stream_SIZE);
+static_assert(bmboot_ddr_scratch_ADDRESS >= bmboot_cpu3_host_io_ADDRESS + bmboot_cpu3_host_io_SIZE);
+static_assert(bmboot_ddr_scratch_ADDRESS >= bmboot_cpu3_payload_b_ADDRESS + bmboot_cpu3_payload_b_SIZE);
+
 static MaybeError load_to_physical_memory(uintptr_t address, std::span<uint8_t const> binary)
 {
     auto devmem = get_devmem_handle();
@@ -215,13 +372,14 @@ static MaybeError load_to_physical_memory(uintptr_t address, std::span<uint8_t c
 
 MaybeError Domain::awaitMonitorStartup()
 {
-    // wait up to 0.5sec for monitor to come to life; should normally take around 130 ms
-    constexpr int timeout_msec = 500;
-    constexpr int poll_period_msec = 10;
+    // wait up to 0.5sec for monitor to come to life (see getBootTiming for where a cold start spends its time); a return
+    // to the monitor after terminatePayload takes a few microseconds. Poll finely enough not to dominate the latter.
+    constexpr int timeout_usec = 500'000;
+    constexpr int poll_period_usec = 50;
 
-    for (int i = 0; i < timeout_msec / poll_period_msec; i++)
+    for (int i = 0; i < timeout_usec / poll_period_usec; i++)
     {
-        usleep(poll_period_msec * 1000);
+        usleep(poll_period_usec);
 
         if (getState() == DomainState::monitor_ready)
         {
@@ -251,13 +409,14 @@ MaybeError Domain::dumpCore(char const* filename)
     }
 
     auto& ranges = getPhysicalMemoryRanges();
+    auto window = getPayloadWindow(getActivePayloadSlot());
 
     Mmap code_area(nullptr,
-                   ranges.payload_size,
+                   window.size,
                    PROT_READ | PROT_WRITE,
                    MAP_SHARED,
                    std::get<int>(devmem),
-                   ranges.payload_address);
+                   window.address);
 
     if (!code_area)
     {
@@ -266,9 +425,11 @@ MaybeError Domain::dumpCore(char const* filename)
 
     auto& inbox = getInboxNonvolatile();
 
-    static const MemorySegment segments[]
+    // The diagnostics region is included for the sake of the monitor event log
+    const MemorySegment segments[]
     {
-            { ranges.payload_address, ranges.payload_size, code_area.data() },
+            { window.address, window.size, code_area.data() },
+            { ranges.diagnostics_address, ranges.diagnostics_size, &m_diagnostics_block },
     };
 
     writeCoreDump(filename,
@@ -325,6 +486,66 @@ CrashInfo Domain::getCrashInfo()
 
 // ************************************************************
 
+std::optional<HeapStatistics> Domain::getHeapStatistics()
+{
+    auto const& shared = (volatile HeapStatisticsBlock const&) m_ipc_block.heap_statistics;
+    HeapStatisticsBlock copy;
+
+    // The payload may be in the middle of an update; retry until we get a consistent snapshot.
+    // Give up eventually, since the payload might have crashed inside the heap.
+    for (int attempt = 0; ; attempt++)
+    {
+        uint32_t seq_before = shared.seq;
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        memcpy(&copy, (void const*) &shared, sizeof(copy));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (seq_before % 2 == 0 && shared.seq == seq_before)
+        {
+            break;
+        }
+
+        if (attempt == 1000)
+        {
+            return {};
+        }
+    }
+
+    if (!copy.valid)
+    {
+        return {};
+    }
+
+    HeapStatistics stats {
+        .heap_size = copy.heap_size,
+        .bytes_in_use = copy.bytes_in_use,
+        .bytes_in_use_high_water = copy.bytes_in_use_high_water,
+        .bytes_free = copy.bytes_free,
+        .largest_free_block = copy.largest_free_block,
+        .num_allocations = copy.num_allocations,
+        .num_frees = copy.num_frees,
+        .num_failed_allocations = copy.num_failed_allocations,
+        .fragmentation = copy.bytes_free ? 1.0f - (float) copy.largest_free_block / copy.bytes_free : 0.0f,
+    };
+
+    // Must match the mapping in tlsf_heap.cpp
+    for (int i = 0; i < HEAP_NUM_SIZE_CLASSES; i++)
+    {
+        stats.size_classes.push_back(HeapStatistics::SizeClass {
+            .min_size = (i == 0) ? 0 : (size_t(1) << (i + 8)),
+            .max_size = (size_t(1) << (i + 9)) - 1,
+            .blocks_in_use = copy.blocks_in_use[i],
+            .blocks_in_use_high_water = copy.blocks_in_use_high_water[i],
+        });
+    }
+
+    return stats;
+}
+
+// ************************************************************
+
 DomainState Domain::getState()
 {
     // FIXME: domain_general_state must take precedence
@@ -364,16 +585,39 @@ int Domain::getchar()
         outbox.stdout_rdpos = 0;
     }
 
-    if (outbox.stdout_rdpos != inbox.stdout_wrpos)
-    {
-        unsigned char c = inbox.stdout_buf[outbox.stdout_rdpos];
-        outbox.stdout_rdpos = (outbox.stdout_rdpos + 1) % sizeof(inbox.stdout_buf);
-        return c;
-    }
-    else
+    constexpr size_t BUFFER_SIZE = sizeof(inbox.stdout_buf);
+
+    while (outbox.stdout_rdpos != inbox.stdout_wrpos)
     {
-        return -1;
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        size_t rdpos = outbox.stdout_rdpos;
+        unsigned char c = inbox.stdout_buf[rdpos];
+
+        if (c != STDOUT_TIMESTAMP_MARKER)
+        {
+            outbox.stdout_rdpos = (rdpos + 1) % BUFFER_SIZE;
+            return c;
+        }
+
+        // The monitor publishes timestamp records as a whole, but better safe than sorry
+        if ((inbox.stdout_wrpos + BUFFER_SIZE - rdpos) % BUFFER_SIZE < STDOUT_TIMESTAMP_RECORD_SIZE)
+        {
+            return -1;
+        }
+
+        uint64_t timestamp = 0;
+
+        for (size_t i = 0; i < sizeof(timestamp); i++)
+        {
+            timestamp |= (uint64_t) inbox.stdout_buf[(rdpos + 1 + i) % BUFFER_SIZE] << (i * 8);
+        }
+
+        m_console_line_timestamp = timestamp;
+        outbox.stdout_rdpos = (rdpos + STDOUT_TIMESTAMP_RECORD_SIZE) % BUFFER_SIZE;
     }
+
+    return -1;
 }
 
 // ************************************************************
@@ -381,6 +625,22 @@ int Domain::getchar()
 MaybeError Domain::loadAndStartPayload(std::span<uint8_t const> payload_binary,
                                        uint32_t payload_crc32,
                                        uintptr_t payload_argument)
+{
+    return loadBinaryAndStart(payload_binary, payload_crc32, payload_argument, {});
+}
+
+MaybeError Domain::loadAndArmPayload(std::span<uint8_t const> payload_binary,
+                                     uint32_t payload_crc32,
+                                     uintptr_t payload_argument,
+                                     uint64_t start_time)
+{
+    return loadBinaryAndStart(payload_binary, payload_crc32, payload_argument, start_time);
+}
+
+MaybeError Domain::loadBinaryAndStart(std::span<uint8_t const> payload_binary,
+                                      uint32_t payload_crc32,
+                                      uintptr_t payload_argument,
+                                      std::optional<uint64_t> start_time)
 {
     // First, ensure we are in 'ready' state
     if (getState() != DomainState::monitor_ready)
@@ -405,7 +665,44 @@ MaybeError Domain::loadAndStartPayload(std::span<uint8_t const> payload_binary,
     return startPayloadAt(ranges.payload_address,
                           payload_binary.size(),
                           payload_crc32,
-                          payload_argument);
+                          payload_argument,
+                          start_time);
+}
+
+// ************************************************************
+
+// OCM is not RAM as far as Linux is concerned, so /dev/mem maps it as Device memory. There, unaligned accesses fault
+// and so memcpy cannot be used -- copy by aligned words instead.
+static MaybeError load_to_ocm(PhysicalMemoryRanges const& ranges, std::span<uint8_t const> image)
+{
+    auto devmem = get_devmem_handle();
+    if (std::holds_alternative<ErrorCode>(devmem))
+    {
+        return std::get<ErrorCode>(devmem);
+    }
+
+    Mmap ocm_area(nullptr,
+                  ranges.ocm_size,
+                  PROT_READ | PROT_WRITE,
+                  MAP_SHARED,
+                  std::get<int>(devmem),
+                  ranges.ocm_address);
+
+    if (!ocm_area)
+    {
+        return ErrorCode::mmap_failed;
+    }
+
+    for (size_t offset = 0; offset < image.size(); offset += sizeof(uint32_t))
+    {
+        uint32_t word = 0;
+        memcpy(&word, &image[offset], std::min(sizeof(word), image.size() - offset));
+        ocm_area.write32(offset, word);
+    }
+
+    ocm_area.unmap();
+
+    return {};
 }
 
 // ************************************************************
@@ -416,15 +713,45 @@ extern "C" {
 
 MaybeError Domain::loadElfPayload(std::span<uint8_t const> payload_binary, uintptr_t payload_argument)
 {
-    constexpr auto elf_debug = false;
+    return loadElfAndStart(payload_binary, payload_argument, {});
+}
+
+MaybeError Domain::loadElfAndArmPayload(std::span<uint8_t const> payload_binary,
+                                        uintptr_t payload_argument,
+                                        uint64_t start_time)
+{
+    return loadElfAndStart(payload_binary, payload_argument, start_time);
+}
 
+MaybeError Domain::loadElfAndStart(std::span<uint8_t const> payload_binary,
+                                   uintptr_t payload_argument,
+                                   std::optional<uint64_t> start_time)
+{
     // First, ensure we are in 'ready' state
     if (getState() != DomainState::monitor_ready)
     {
         return ErrorCode::bad_domain_state;
     }
 
+    auto loaded = loadElfToSlot(payload_binary, PayloadSlot::a, true);
+
+    if (std::holds_alternative<ErrorCode>(loaded))
+    {
+        return std::get<ErrorCode>(loaded);
+    }
+
+    // Started right away, so there is nothing that could have damaged the image in the meantime
+    return startPayloadAt(std::get<LoadedElf>(loaded).entry_address, 0, 0, payload_argument, start_time);
+}
+
+std::variant<Domain::LoadedElf, ErrorCode> Domain::loadElfToSlot(std::span<uint8_t const> payload_binary,
+                                                         PayloadSlot slot,
+                                                         bool allow_ocm)
+{
+    constexpr auto elf_debug = false;
+
     auto& ranges = getPhysicalMemoryRanges();
+    auto window = getPayloadWindow(slot);
     auto devmem = get_devmem_handle();
 
     if (std::holds_alternative<ErrorCode>(devmem))
@@ -433,11 +760,11 @@ MaybeError Domain::loadElfPayload(std::span<uint8_t const> payload_binary, uintp
     }
 
     Mmap code_area(nullptr,
-                   ranges.payload_size,
+                   window.size,
                    PROT_READ | PROT_WRITE,
                    MAP_SHARED,
                    std::get<int>(devmem),
-                   ranges.payload_address);
+                   window.address);
 
     if (!code_area)
     {
@@ -448,7 +775,19 @@ MaybeError Domain::loadElfPayload(std::span<uint8_t const> payload_binary, uintp
     {
         std::span<uint8_t const> payload_binary;
         PhysicalMemoryRanges const& ranges;
+        PayloadWindow window;
+        bool allow_ocm;
         Mmap& code_area;
+
+        // Segments targeting OCM (BMBOOT_FAST_CODE/DATA) are assembled here and written out at the end
+        std::vector<uint8_t> ocm_image;
+        size_t ocm_image_end;
+
+        // Segments in the uncached DDR block (BMBOOT_SHARED_DATA) are NOLOAD, the payload initializes them itself
+        std::vector<std::vector<uint8_t>> discarded_segments;
+
+        // End of the last segment placed in the payload window
+        uintptr_t window_image_end;
     };
 
 //    el_ctx ctx;
@@ -456,7 +795,13 @@ MaybeError Domain::loadElfPayload(std::span<uint8_t const> payload_binary, uintp
     MyElfCtx ctx = {
             .payload_binary = payload_binary,
             .ranges = ranges,
+            .window = window,
+            .allow_ocm = allow_ocm,
             .code_area = code_area,
+            .ocm_image = std::vector<uint8_t>(ranges.ocm_size),
+            .ocm_image_end = 0,
+            .discarded_segments = {},
+            .window_image_end = 0,
     };
 
     ctx.pread = [](el_ctx *ctx_in, void *dest, size_t nb, size_t offset) -> bool
@@ -493,16 +838,41 @@ MaybeError Domain::loadElfPayload(std::span<uint8_t const> payload_binary, uintp
 
         if constexpr (elf_debug) { printf("alloc request: %08lX bytes @ %08lX phys %08lX virt\n", size, phys, virt); }
 
-        if (phys < (uintptr_t) ctx.ranges.payload_address ||
-            phys + size > ctx.ranges.payload_address + ctx.ranges.payload_size)
+        if (phys >= (uintptr_t) ctx.ranges.ocm_address &&
+            phys + size <= ctx.ranges.ocm_address + ctx.ranges.ocm_size)
+        {
+            if (!ctx.allow_ocm)
+            {
+                // The OCM slice is in use by the payload which is still running
+                fprintf(stderr, "bmboot: ELF: a preloaded payload cannot have segments in OCM "
+                                "(BMBOOT_FAST_CODE/BMBOOT_FAST_DATA)\n");
+                return nullptr;
+            }
+
+            auto offset = phys - ctx.ranges.ocm_address;
+            ctx.ocm_image_end = std::max(ctx.ocm_image_end, offset + size);
+            return ctx.ocm_image.data() + offset;
+        }
+
+        if (phys >= (uintptr_t) ctx.ranges.ddr_uncached_address &&
+            phys + size <= ctx.ranges.ddr_uncached_address + ctx.ranges.ddr_uncached_size)
+        {
+            return ctx.discarded_segments.emplace_back(size).data();
+        }
+
+        if (phys < (uintptr_t) ctx.window.address ||
+            phys + size > ctx.window.address + ctx.window.size)
         {
             fprintf(stderr, "bmboot: ELF: requested physical memory allocation [0x%010lX .. 0x%010lX]\n"
-                            "             is out of the range for this domain: [0x%010lX .. 0x%010lX]\n",
-                    phys, phys + size, ctx.ranges.payload_address, ctx.ranges.payload_address + ctx.ranges.payload_size);
+                            "             is out of the range for this payload slot: [0x%010lX .. 0x%010lX]\n"
+                            "             or its OCM slice: [0x%010lX .. 0x%010lX]\n",
+                    phys, phys + size, ctx.window.address, ctx.window.address + ctx.window.size,
+                    ctx.ranges.ocm_address, ctx.ranges.ocm_address + ctx.ranges.ocm_size);
             return nullptr;
         }
 
-        return (uint8_t *) ctx.code_area.data() + phys - ctx.ranges.payload_address;
+        ctx.window_image_end = std::max<uintptr_t>(ctx.window_image_end, phys + size);
+        return (uint8_t *) ctx.code_area.data() + phys - ctx.window.address;
     });
 
     if (err)
@@ -512,9 +882,109 @@ MaybeError Domain::loadElfPayload(std::span<uint8_t const> payload_binary, uintp
 
     __clear_cache(code_area.data(), (uint8_t*) code_area.data() + code_area.size());
 
+    auto entry_address = (uintptr_t) (ctx.ehdr.e_entry + ctx.base_load_paddr);
+    LoadedElf loaded { .entry_address = entry_address, .image_size = 0, .image_crc32 = 0 };
+
+    // With the entry point outside of the window, the image is left unchecked
+    if (entry_address >= (uintptr_t) ctx.window.address && entry_address < ctx.window_image_end)
+    {
+        loaded.image_size = ctx.window_image_end - entry_address;
+        loaded.image_crc32 = crc32(0, (uint8_t const*) code_area.data() + (entry_address - ctx.window.address),
+                                   loaded.image_size);
+    }
+
     code_area.unmap();
 
-    return startPayloadAt(ctx.ehdr.e_entry + ctx.base_load_paddr, 0, 0, payload_argument);
+    if (ctx.ocm_image_end > 0)
+    {
+        if (auto error = load_to_ocm(ranges, std::span(ctx.ocm_image).first(ctx.ocm_image_end)))
+        {
+            return *error;
+        }
+    }
+
+    return loaded;
+}
+
+// ************************************************************
+
+MaybeError Domain::canPreloadPayload()
+{
+    auto state = getState();
+
+    // Not while a payload is being started: the monitor might still be looking at the previous command
+    if (state != DomainState::monitor_ready &&
+        state != DomainState::running_payload &&
+        state != DomainState::crashed_payload)
+    {
+        return ErrorCode::bad_domain_state;
+    }
+
+    return {};
+}
+
+MaybeError Domain::preloadPayload(std::span<uint8_t const> payload_binary,
+                                  uint32_t payload_crc32,
+                                  uintptr_t payload_argument)
+{
+    if (auto error = canPreloadPayload())
+    {
+        return error;
+    }
+
+    m_preloaded_payload.reset();
+
+    auto window = getPayloadWindow(getActivePayloadSlot() == PayloadSlot::a ? PayloadSlot::b : PayloadSlot::a);
+
+    if (payload_binary.size() > window.size)
+    {
+        return ErrorCode::program_too_large;
+    }
+
+    if (auto error = load_to_physical_memory(window.address, payload_binary))
+    {
+        return error;
+    }
+
+    m_preloaded_payload = PreloadedPayload {
+        .entry_address = (uintptr_t) window.address,
+        .size = payload_binary.size(),
+        .crc32 = payload_crc32,
+        .argument = payload_argument,
+    };
+
+    return {};
+}
+
+MaybeError Domain::preloadElfPayload(std::span<uint8_t const> payload_binary, uintptr_t payload_argument)
+{
+    if (auto error = canPreloadPayload())
+    {
+        return error;
+    }
+
+    m_preloaded_payload.reset();
+
+    auto slot = (getActivePayloadSlot() == PayloadSlot::a) ? PayloadSlot::b : PayloadSlot::a;
+    auto loaded = loadElfToSlot(payload_binary, slot, false);
+
+    if (std::holds_alternative<ErrorCode>(loaded))
+    {
+        return std::get<ErrorCode>(loaded);
+    }
+
+    // The image sits in memory next to the running payload until swapPayload; have the monitor check it then, like
+    // a preloaded raw binary
+    auto const& elf = std::get<LoadedElf>(loaded);
+
+    m_preloaded_payload = PreloadedPayload {
+        .entry_address = elf.entry_address,
+        .size = elf.image_size,
+        .crc32 = elf.image_crc32,
+        .argument = payload_argument,
+    };
+
+    return {};
 }
 
 // ************************************************************
@@ -540,6 +1010,17 @@ DomainInstanceOrErrorCode IDomain::open(DomainIndex domain)
         return ErrorCode::mmap_failed;
     }
 
+    auto diagnostics_block = (DiagnosticsBlock*) mmap(nullptr,
+                                                      ranges.diagnostics_size,
+                                                      PROT_READ | PROT_WRITE,
+                                                      MAP_SHARED,
+                                                      std::get<int>(devmem),
+                                                      ranges.diagnostics_address);
+    if (diagnostics_block == MAP_FAILED)
+    {
+        return ErrorCode::mmap_failed;
+    }
+
     auto code_area = (uint8_t*) mmap(nullptr,
                                      ranges.monitor_size,
                                      PROT_READ | PROT_WRITE,
@@ -586,7 +1067,7 @@ DomainInstanceOrErrorCode IDomain::open(DomainIndex domain)
 
     munmap(code_area, ranges.monitor_size);
 
-    return std::make_unique<Domain>(domain, *ipc_block);
+    return std::make_unique<Domain>(domain, *ipc_block, *diagnostics_block);
 }
 
 // ************************************************************
@@ -594,7 +1075,8 @@ DomainInstanceOrErrorCode IDomain::open(DomainIndex domain)
 MaybeError Domain::startPayloadAt(uintptr_t entry_address,
                                   size_t payload_size,
                                   uint32_t payload_crc32,
-                                  uintptr_t payload_argument)
+                                  uintptr_t payload_argument,
+                                  std::optional<uint64_t> start_time)
 {
     // First, ensure we are in 'ready' state
     if (getState() != DomainState::monitor_ready)
@@ -602,24 +1084,121 @@ MaybeError Domain::startPayloadAt(uintptr_t entry_address,
         return ErrorCode::bad_domain_state;
     }
 
-    auto const& inbox = getInbox();
-    auto& outbox = getOutbox();
-
-    if (inbox.cmd_ack != outbox.cmd_seq)
+    if (getInbox().cmd_ack != getOutbox().cmd_seq)
     {
         return ErrorCode::bad_domain_state;
     }
 
+    postStartCommand(entry_address, payload_size, payload_crc32, payload_argument, start_time);
+
+    if (start_time.has_value())
+    {
+        // Armed; the caller waits for the start separately
+        return awaitStartResponse();
+    }
+
+    return awaitPayloadStart();
+}
+
+void Domain::postStartCommand(uintptr_t entry_address,
+                              size_t payload_size,
+                              uint32_t payload_crc32,
+                              uintptr_t payload_argument,
+                              std::optional<uint64_t> start_time)
+{
+    auto const& inbox = getInbox();
+    auto& outbox = getOutbox();
+
     // flush any residual content of the stdout buffer by setting our read position equal to the write position
     outbox.stdout_rdpos = inbox.stdout_wrpos;
 
+    // the new payload starts with an empty trace, and its strings will be elsewhere
+    m_trace_read_position = 0;
+    m_trace_names.clear();
+
     outbox.payload_entry_address = entry_address;
     outbox.payload_size = payload_size;
     outbox.payload_crc = payload_crc32;
     outbox.payload_argument = payload_argument;
-    outbox.cmd = Command::start_payload;
+
+    if (start_time.has_value())
+    {
+        ((volatile PayloadStartBlock&) m_ipc_block.payload_start).start_time = *start_time;
+        outbox.cmd = Command::start_payload_at;
+    }
+    else
+    {
+        outbox.cmd = Command::start_payload;
+    }
+
     memory_write_reorder_barrier();
     outbox.cmd_seq = (outbox.cmd_seq + 1);
+}
+
+// Translates the response of the monitor to a start command
+static MaybeError checkStartResponse(Response response)
+{
+    switch (response)
+    {
+        case Response::crc_ok:
+            return {};
+
+        case Response::crc_mismatched:
+            return ErrorCode::payload_checksum_mismatch;
+
+        case Response::image_malformed:
+            return ErrorCode::payload_image_malformed;
+
+        case Response::abi_incompatible:
+            return ErrorCode::payload_abi_incompatible;
+
+        case Response::start_time_passed:
+            return ErrorCode::payload_start_time_passed;
+
+        default:
+            return ErrorCode::unknown_error;
+    }
+}
+
+MaybeError Domain::awaitStartResponse()
+{
+    auto const& inbox = getInbox();
+    auto& outbox = getOutbox();
+
+    // wait up to 1sec for the monitor to validate the payload, which takes time in proportion to its size
+    constexpr int timeout_usec = 1'000'000;
+    constexpr int poll_period_usec = 100;
+
+    for (int i = 0; i < timeout_usec / poll_period_usec; i++)
+    {
+        if (inbox.cmd_ack == outbox.cmd_seq)
+        {
+            return checkStartResponse(inbox.cmd_resp);
+        }
+
+        usleep(poll_period_usec);
+    }
+
+    return ErrorCode::payload_start_timed_out;
+}
+
+MaybeError Domain::awaitPayloadStart()
+{
+    auto const& inbox = getInbox();
+    auto& outbox = getOutbox();
+
+    if (outbox.cmd == Command::start_payload_at)
+    {
+        // The payload is not going to run before its start time; the timeout only begins then
+        auto start_time = ((volatile PayloadStartBlock const&) m_ipc_block.payload_start).start_time;
+        auto now = ClockSync::readCounter();
+        auto cntfrq = getTimerFrequency();
+
+        if (cntfrq != 0 && start_time > now)
+        {
+            usleep((start_time - now) * 1'000'000 / cntfrq);
+        }
+    }
 
     // wait up to 1sec for domain to come to life
     constexpr int timeout_msec = 1000;
@@ -629,28 +1208,18 @@ MaybeError Domain::startPayloadAt(uintptr_t entry_address,
     {
         usleep(poll_period_msec * 1000);
 
-        if (inbox.cmd_ack == outbox.cmd_seq)
+        if (inbox.cmd_ack != outbox.cmd_seq)
         {
-            switch (inbox.cmd_resp)
-            {
-                case Response::crc_ok:
-                    // Good, but we are waiting for DomainState::running_payload
-                    break;
-
-                case Response::crc_mismatched:
-                    return ErrorCode::payload_checksum_mismatch;
-
-                case Response::image_malformed:
-                    return ErrorCode::payload_image_malformed;
-
-                case Response::abi_incompatible:
-                    return ErrorCode::payload_abi_incompatible;
+            // Not picked up yet. When swapping, the state is still that of the previous payload.
+            continue;
+        }
 
-                default:
-                    return ErrorCode::unknown_error;
-            }
+        if (auto error = checkStartResponse(inbox.cmd_resp))
+        {
+            return error;
         }
 
+        // Good, but we are waiting for DomainState::running_payload
         auto state = getState();
 
         if (state == DomainState::running_payload)
@@ -738,6 +1307,14 @@ MaybeError Domain::startup(std::span<uint8_t const> monitor_binary)
     // flush the IPC region to DDR (since the SCU is not in effect yet and CPUn will come up with cold caches)
     __clear_cache(&m_ipc_block, (uint8_t*) &m_ipc_block + ranges.monitor_ipc_size);
 
+    // the monitor event log is kept across monitor restarts, so this is the one place where it is cleared
+    auto& monitor_events = m_diagnostics_block.monitor_events;
+    memset((void*) &monitor_events, 0, sizeof(monitor_events));
+    __clear_cache(&monitor_events, (uint8_t*) &monitor_events + sizeof(monitor_events));
+
+    auto& boot_timing = (volatile BootTimingBlock&) m_ipc_block.boot_timing;
+    boot_timing.manager_reset_released = ClockSync::readCounter();
+
     // Set the reset vector registers and give it the the monitor address
     auto maybe_error = zynqmp::bootCore(std::get<int>(devmem), m_domain, ranges.monitor_address);
     if (maybe_error.has_value())
@@ -748,12 +1325,29 @@ MaybeError Domain::startup(std::span<uint8_t const> monitor_binary)
     // TODO: maybe we should only do this after state goes to ready
     domain_general_state[m_domain] = DomainGeneralState::monitorStarted;
 
-    return awaitMonitorStartup();
-}
+    maybe_error = awaitMonitorStartup();
 
-// ************************************************************
+    if (!maybe_error.has_value())
+    {
+        boot_timing.manager_ready_observed = ClockSync::readCounter();
+    }
+
+    return maybe_error;
+}
+
+// ************************************************************
 
 MaybeError Domain::terminatePayload()
+{
+    return sendKillRequest(IPI_REQ_KILL);
+}
+
+MaybeError Domain::restartMonitor()
+{
+    return sendKillRequest(IPI_REQ_RESTART);
+}
+
+MaybeError Domain::sendKillRequest(uint32_t request)
 {
     if (domain_general_state[m_domain] != DomainGeneralState::monitorStarted)
     {
@@ -769,10 +1363,616 @@ MaybeError Domain::terminatePayload()
     // Clear any pending command (although none should have been sent in the current state)
     getOutbox().cmd = Command::noop;
 
-    // TODO: Clean up a bit; these values have no meaning, but if/when we have multiple different IPIs, we will use
-    //       this buffer to signal which one is being invoked.
-    uint8_t message[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20};
-    zynqmp::sendIpiMessage(std::get<int>(devmem), m_domain, message);
+    if (request == IPI_REQ_RESTART)
+    {
+        // The manager timestamps of the boot timing belong to startup
+        auto& boot_timing = (volatile BootTimingBlock&) m_ipc_block.boot_timing;
+        boot_timing.manager_reset_released = 0;
+        boot_timing.manager_ready_observed = 0;
+
+        ((volatile PayloadStartBlock&) m_ipc_block.payload_start).payload_entered = 0;
+    }
+
+    uint32_t message[] = { request };
+    zynqmp::sendIpiMessage(std::get<int>(devmem), m_domain, std::span((uint8_t const*) message, sizeof(message)));
 
     return awaitMonitorStartup();
 }
+
+// ************************************************************
+
+MaybeError Domain::swapPayload()
+{
+    if (!m_preloaded_payload.has_value())
+    {
+        return ErrorCode::bad_domain_state;
+    }
+
+    auto payload = *m_preloaded_payload;
+    m_preloaded_payload.reset();
+
+    auto state = getState();
+
+    if (state == DomainState::monitor_ready)
+    {
+        // Nothing to terminate
+        return startPayloadAt(payload.entry_address, payload.size, payload.crc32, payload.argument);
+    }
+    else if (state != DomainState::running_payload && state != DomainState::crashed_payload)
+    {
+        return ErrorCode::bad_domain_state;
+    }
+
+    auto devmem = get_devmem_handle();
+    if (std::holds_alternative<ErrorCode>(devmem))
+    {
+        return std::get<ErrorCode>(devmem);
+    }
+
+    if (getInbox().cmd_ack != getOutbox().cmd_seq)
+    {
+        return ErrorCode::bad_domain_state;
+    }
+
+    // While a payload runs, the monitor does not look at the command; the restart triggered by the IPI is the first
+    // occasion, and the new payload is entered straight from there.
+    postStartCommand(payload.entry_address, payload.size, payload.crc32, payload.argument);
+
+    uint32_t message[] = { IPI_REQ_SWAP };
+
+    if (auto error = zynqmp::sendIpiMessage(std::get<int>(devmem), m_domain,
+                                            std::span((uint8_t const*) message, sizeof(message))))
+    {
+        // Make sure that the command does not start the payload later, on an unrelated restart of the monitor
+        getOutbox().cmd = Command::noop;
+        return error;
+    }
+
+    return awaitPayloadStart();
+}
+
+// ************************************************************
+
+MaybeError Domain::sendProfilerRequest(uint32_t period_us)
+{
+    if (domain_general_state[m_domain] != DomainGeneralState::monitorStarted)
+    {
+        return ErrorCode::bad_domain_state;
+    }
+
+    auto devmem = get_devmem_handle();
+    if (std::holds_alternative<ErrorCode>(devmem))
+    {
+        return std::get<ErrorCode>(devmem);
+    }
+
+    uint32_t message[] = { IPI_REQ_PROFILER, period_us };
+    return zynqmp::sendIpiMessage(std::get<int>(devmem), m_domain, std::span((uint8_t const*) message, sizeof(message)));
+}
+
+MaybeError Domain::startProfiler(int sampling_rate_hz)
+{
+    if (sampling_rate_hz < 1 || sampling_rate_hz > 100'000)
+    {
+        return ErrorCode::invalid_argument;
+    }
+
+    // Only samples taken from now on are of interest
+    m_profiler_read_position = ((volatile ProfilerBlock const&) m_diagnostics_block.profiler).num_samples;
+
+    return sendProfilerRequest(1'000'000 / sampling_rate_hz);
+}
+
+MaybeError Domain::stopProfiler()
+{
+    return sendProfilerRequest(0);
+}
+
+uint64_t Domain::readProfileSamples(std::vector<ProfileSample>& samples)
+{
+    auto const& profiler = (volatile ProfilerBlock const&) m_diagnostics_block.profiler;
+
+    uint64_t end = profiler.num_samples;
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (end < m_profiler_read_position)
+    {
+        // the monitor has been restarted in the meantime
+        m_profiler_read_position = 0;
+    }
+
+    auto num_lost = copyRingSince(m_profiler_read_position, end, [&] { return (uint64_t) profiler.num_samples; },
+                                  PROFILER_RING_SIZE, samples, [&](uint64_t i)
+    {
+        auto const& record = profiler.samples[i % PROFILER_RING_SIZE];
+
+        ProfileSample sample { .pc = (uintptr_t) record.pc };
+
+        for (int j = 0; j < PROFILER_MAX_CALLERS && record.callers[j] != 0; j++)
+        {
+            sample.callers.push_back((uintptr_t) record.callers[j]);
+        }
+
+        return sample;
+    });
+
+    m_profiler_read_position = end;
+    return num_lost;
+}
+
+ProfilerStatus Domain::getProfilerStatus()
+{
+    auto const& profiler = (volatile ProfilerBlock const&) m_diagnostics_block.profiler;
+
+    uint32_t period_us = profiler.period_us;
+    uint64_t num_samples = profiler.num_samples;
+    uint64_t handler_ticks = profiler.handler_ticks;
+    uint32_t cntfrq = getOutbox().cntfrq;
+
+    return ProfilerStatus {
+        .sampling_rate_hz = (period_us != 0) ? (int)(1'000'000 / period_us) : 0,
+        .num_samples = num_samples,
+        .time_per_sample_us = (num_samples != 0 && cntfrq != 0) ? (double) handler_ticks / num_samples / cntfrq * 1e6
+                                                                : 0,
+    };
+}
+
+// ************************************************************
+
+uint64_t Domain::readTraceEvents(std::vector<TraceEvent>& events)
+{
+    auto const& trace = (volatile TraceBlock const&) m_diagnostics_block.trace;
+
+    uint64_t end = trace.num_events;
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (end < m_trace_read_position)
+    {
+        // a new payload has been started in the meantime
+        m_trace_read_position = 0;
+        m_trace_names.clear();
+    }
+
+    auto num_lost = copyRingSince(m_trace_read_position, end, [&] { return (uint64_t) trace.num_events; },
+                                  TRACE_RING_SIZE, events, [&](uint64_t i)
+    {
+        auto const& record = trace.events[i % TRACE_RING_SIZE];
+        uint64_t info = record.info;
+
+        return TraceEvent {
+            .timestamp = record.timestamp,
+            .name = readTraceEventName(info & TRACE_INFO_NAME_MASK),
+            .begin = (info & TRACE_INFO_BEGIN) != 0,
+            .nesting_level = (int)((info >> TRACE_INFO_NESTING_SHIFT) & 0xff),
+            .priority = (int)((info >> TRACE_INFO_PRIORITY_SHIFT) & 0xff),
+        };
+    });
+
+    m_trace_read_position = end;
+    return num_lost;
+}
+
+static std::string getSmcName(uint32_t function_id)
+{
+    switch (function_id)
+    {
+        case SMC_GET_ABI_VERSION: return "SMC_GET_ABI_VERSION";
+        case SMC_NOTIFY_PAYLOAD_STARTED: return "SMC_NOTIFY_PAYLOAD_STARTED";
+        case SMC_NOTIFY_PAYLOAD_CRASHED: return "SMC_NOTIFY_PAYLOAD_CRASHED";
+        case SMC_WRITE_STDOUT: return "SMC_WRITE_STDOUT";
+        case SMC_WRITE_STDOUT_TIMESTAMPED: return "SMC_WRITE_STDOUT_TIMESTAMPED";
+        case SMC_ZYNQMP_GIC_IRQ_CONFIGURE: return "SMC_ZYNQMP_GIC_IRQ_CONFIGURE";
+        case SMC_ZYNQMP_GIC_IRQ_ENABLE: return "SMC_ZYNQMP_GIC_IRQ_ENABLE";
+        case SMC_ZYNQMP_GIC_IRQ_DISABLE: return "SMC_ZYNQMP_GIC_IRQ_DISABLE";
+        default:
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "SMC 0x%08x", function_id);
+            return buffer;
+    }
+}
+
+static std::string describeMonitorEvent(MonitorEventType type, uint32_t arg0, uint64_t arg1)
+{
+    char buffer[64];
+
+    switch (type)
+    {
+        case MonitorEventType::monitor_started:
+            return "previous state " + toString((DomainState) arg0);
+
+        case MonitorEventType::state_changed:
+            return toString((DomainState) arg0);
+
+        case MonitorEventType::command:
+            switch (arg0)
+            {
+                case Command::noop: return "noop";
+                case Command::start_payload:
+                    snprintf(buffer, sizeof(buffer), "start_payload at 0x%llx", (unsigned long long) arg1);
+                    return buffer;
+                case Command::start_payload_at:
+                    snprintf(buffer, sizeof(buffer), "start_payload_at at 0x%llx", (unsigned long long) arg1);
+                    return buffer;
+                default: return "unknown command " + std::to_string(arg0);
+            }
+
+        case MonitorEventType::command_response:
+            switch (arg0)
+            {
+                case Response::crc_ok: return "crc_ok";
+                case Response::crc_mismatched: return "crc_mismatched";
+                case Response::image_malformed: return "image_malformed";
+                case Response::abi_incompatible: return "abi_incompatible";
+                case Response::start_time_passed: return "start_time_passed";
+                default: return "unknown response " + std::to_string(arg0);
+            }
+
+        case MonitorEventType::smc:
+            switch (arg0)
+            {
+                case SMC_ZYNQMP_GIC_IRQ_CONFIGURE:
+                case SMC_ZYNQMP_GIC_IRQ_ENABLE:
+                case SMC_ZYNQMP_GIC_IRQ_DISABLE:
+                    return getSmcName(arg0) + " " + std::to_string(arg1);
+                default:
+                    return getSmcName(arg0);
+            }
+
+        case MonitorEventType::fiq:
+            snprintf(buffer, sizeof(buffer), "interrupt %u at pc=0x%llx", arg0, (unsigned long long) arg1);
+            return buffer;
+
+        case MonitorEventType::ipi_request:
+            switch (arg0)
+            {
+                case IPI_REQ_KILL: return "kill";
+                case IPI_REQ_SWAP: return "swap";
+                case IPI_REQ_RESTART: return "restart";
+                case IPI_REQ_PROFILER: return "profiler, period " + std::to_string((uint32_t) arg1) + " us";
+                default: return "unknown request " + std::to_string(arg0);
+            }
+
+        case MonitorEventType::crash:
+            snprintf(buffer, sizeof(buffer), "%s at 0x%llx", arg0 ? "monitor" : "payload", (unsigned long long) arg1);
+            return buffer;
+
+        default:
+            return {};
+    }
+}
+
+std::vector<MonitorEvent> Domain::getMonitorEvents()
+{
+    auto const& log = (volatile MonitorEventBlock const&) m_diagnostics_block.monitor_events;
+
+    uint64_t end = log.num_events;
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    std::vector<MonitorEvent> events;
+
+    // Everything still in the ring; older events are not missed by anyone
+    copyRingSince(0, end, [&] { return (uint64_t) log.num_events; }, MONITOR_EVENT_RING_SIZE, events, [&](uint64_t i)
+    {
+        auto const& record = log.events[i % MONITOR_EVENT_RING_SIZE];
+        auto type = (MonitorEventType) record.type;
+        uint32_t arg0 = record.arg0;
+        uint64_t arg1 = record.arg1;
+
+        return MonitorEvent {
+            .timestamp = record.timestamp,
+            .type = type,
+            .arg0 = arg0,
+            .arg1 = arg1,
+            .description = describeMonitorEvent(type, arg0, arg1),
+        };
+    });
+
+    return events;
+}
+
+// ************************************************************
+
+std::optional<TelemetrySnapshot> Domain::getTelemetry()
+{
+    auto& telemetry = m_ipc_block.telemetry;
+
+    if (((volatile TelemetryBlock const&) telemetry).version != TELEMETRY_VERSION)
+    {
+        return {};
+    }
+
+    auto read = [](uint64_t& counter)
+    {
+        return std::atomic_ref<uint64_t>(counter).load(std::memory_order_relaxed);
+    };
+
+    auto cntfrq = getOutbox().cntfrq;
+
+    TelemetrySnapshot snapshot {
+        .time = std::chrono::steady_clock::now(),
+        .monitor_starts = read(telemetry.monitor_starts),
+        .payload_starts = read(telemetry.payload_starts),
+        .payload_crashes = read(telemetry.payload_crashes),
+        .monitor_time_s = cntfrq ? (double) read(telemetry.monitor_ticks) / cntfrq : 0,
+        .fiqs = read(telemetry.fiqs),
+        .ipi_requests = read(telemetry.ipi_requests),
+        .stdout_bytes_written = read(telemetry.stdout_bytes_written),
+        .stdout_bytes_dropped = read(telemetry.stdout_bytes_dropped),
+    };
+
+    for (int i = 0; i < 2 * TELEMETRY_SMC_RANGE_SIZE; i++)
+    {
+        uint32_t function_id = (i < TELEMETRY_SMC_RANGE_SIZE)
+                             ? SMC_GET_ABI_VERSION + i
+                             : SMC_ZYNQMP_GIC_IRQ_CONFIGURE + (i - TELEMETRY_SMC_RANGE_SIZE);
+
+        if (auto count = read(telemetry.smc_calls[i]); count != 0)
+        {
+            snapshot.smc_calls[getSmcName(function_id)] = count;
+        }
+    }
+
+    if (auto count = read(telemetry.smc_calls_other); count != 0)
+    {
+        snapshot.smc_calls["other"] = count;
+    }
+
+    for (int i = 0; i < (int) std::size(telemetry.irqs); i++)
+    {
+        if (auto count = read(telemetry.irqs[i]); count != 0)
+        {
+            snapshot.irqs[GIC_MIN_USER_INTERRUPT_ID + i] = count;
+        }
+    }
+
+    return snapshot;
+}
+
+// ************************************************************
+
+std::optional<BootTiming> Domain::getBootTiming()
+{
+    auto const& timing = (volatile BootTimingBlock const&) m_ipc_block.boot_timing;
+
+    if (timing.checkpoints[BOOT_CHECKPOINT_ENTRY] == 0)
+    {
+        return {};
+    }
+
+    return BootTiming {
+        .reset_released = timing.manager_reset_released,
+        .entry = timing.checkpoints[BOOT_CHECKPOINT_ENTRY],
+        .caches_invalidated = timing.checkpoints[BOOT_CHECKPOINT_CACHES_INVALIDATED],
+        .mmu_enabled = timing.checkpoints[BOOT_CHECKPOINT_MMU_ENABLED],
+        .main_entered = timing.checkpoints[BOOT_CHECKPOINT_MAIN],
+        .interrupts_set_up = timing.checkpoints[BOOT_CHECKPOINT_INTERRUPTS],
+        .ready = timing.checkpoints[BOOT_CHECKPOINT_READY],
+        .ready_observed = timing.manager_ready_observed,
+    };
+}
+
+// ************************************************************
+
+uint64_t Domain::getPayloadStartTimestamp()
+{
+    return ((volatile PayloadStartBlock const&) m_ipc_block.payload_start).payload_entered;
+}
+
+MaybeError Domain::armPayloadOf(IDomain& loader, uint64_t start_time)
+{
+    // There is no other implementation of IDomain
+    auto& loader_outbox = static_cast<Domain&>(loader).getOutbox();
+
+    if (&loader == this || loader_outbox.cmd != Command::start_payload_at)
+    {
+        return ErrorCode::bad_domain_state;
+    }
+
+    // The image has been validated by the monitor of the loader already, but it is cheap enough to do it again
+    return startPayloadAt(loader_outbox.payload_entry_address,
+                          loader_outbox.payload_size,
+                          loader_outbox.payload_crc,
+                          loader_outbox.payload_argument,
+                          start_time);
+}
+
+// ************************************************************
+
+uint32_t Domain::getTimerFrequency()
+{
+    return getOutbox().cntfrq;
+}
+
+std::string const& Domain::readTraceEventName(uintptr_t address)
+{
+    constexpr size_t MAX_NAME_LENGTH = 128;
+
+    auto it = m_trace_names.find(address);
+
+    if (it != m_trace_names.end())
+    {
+        return it->second;
+    }
+
+    auto slot = findPayloadSlot(address, 1);
+    auto payload_area = slot.has_value() ? getPayloadArea(*slot) : nullptr;
+
+    std::string name;
+
+    if (payload_area != nullptr)
+    {
+        auto window = getPayloadWindow(*slot);
+        auto offset = address - window.address;
+        auto str = (char const*) payload_area + offset;
+        name.assign(str, strnlen(str, std::min(MAX_NAME_LENGTH, window.size - offset)));
+    }
+    else
+    {
+        // Not in the payload memory (e.g. in OCM); identify it at least by its address
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "0x%zx", address);
+        name = buffer;
+    }
+
+    return m_trace_names.emplace(address, std::move(name)).first->second;
+}
+
+// ************************************************************
+
+uint8_t const* Domain::getPayloadArea(PayloadSlot slot)
+{
+    auto& area = m_payload_area[(int) slot];
+
+    if (!area)
+    {
+        auto devmem = get_devmem_handle();
+
+        if (std::holds_alternative<ErrorCode>(devmem))
+        {
+            return nullptr;
+        }
+
+        auto window = getPayloadWindow(slot);
+
+        area = std::make_unique<Mmap>(nullptr,
+                                      window.size,
+                                      PROT_READ,
+                                      MAP_SHARED,
+                                      std::get<int>(devmem),
+                                      window.address);
+    }
+
+    return *area ? (uint8_t const*) area->data() : nullptr;
+}
+
+PayloadWindow Domain::getPayloadWindow(PayloadSlot slot)
+{
+    auto& ranges = getPhysicalMemoryRanges();
+
+    if (slot == PayloadSlot::b)
+    {
+        return { ranges.payload_b_address, ranges.payload_b_size };
+    }
+
+    return { ranges.payload_address, ranges.payload_size };
+}
+
+std::optional<PayloadSlot> Domain::findPayloadSlot(uintptr_t address, size_t size)
+{
+    for (auto slot : { PayloadSlot::a, PayloadSlot::b })
+    {
+        auto window = getPayloadWindow(slot);
+
+        if (address >= (uintptr_t) window.address &&
+            address - window.address <= window.size &&
+            size <= window.size - (address - window.address))
+        {
+            return slot;
+        }
+    }
+
+    return {};
+}
+
+PayloadSlot Domain::getActivePayloadSlot()
+{
+    // The last payload started tells, even if it was started by another process
+    return findPayloadSlot(getOutbox().payload_entry_address, 0).value_or(PayloadSlot::a);
+}
+
+MaybeError Domain::readPayloadMemory(uintptr_t address, std::span<uint8_t> buffer)
+{
+    auto slot = findPayloadSlot(address, buffer.size());
+
+    if (!slot.has_value())
+    {
+        return ErrorCode::invalid_argument;
+    }
+
+    auto payload_area = getPayloadArea(*slot);
+
+    if (payload_area == nullptr)
+    {
+        return ErrorCode::mmap_failed;
+    }
+
+    memcpy(buffer.data(), payload_area + (address - getPayloadWindow(*slot).address), buffer.size());
+    return {};
+}
+
+std::variant<std::span<uint8_t>, ErrorCode> Domain::mapUncachedMemory(uintptr_t address, size_t size)
+{
+    auto& ranges = getPhysicalMemoryRanges();
+
+    if (address < (uintptr_t) ranges.ddr_uncached_address ||
+        address - ranges.ddr_uncached_address > ranges.ddr_uncached_size ||
+        size > ranges.ddr_uncached_size - (address - ranges.ddr_uncached_address))
+    {
+        return ErrorCode::invalid_argument;
+    }
+
+    if (!m_uncached_area)
+    {
+        auto devmem = get_devmem_handle();
+
+        if (std::holds_alternative<ErrorCode>(devmem))
+        {
+            return std::get<ErrorCode>(devmem);
+        }
+
+        m_uncached_area = std::make_unique<Mmap>(nullptr,
+                                                 ranges.ddr_uncached_size,
+                                                 PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED,
+                                                 std::get<int>(devmem),
+                                                 ranges.ddr_uncached_address);
+    }
+
+    if (!*m_uncached_area)
+    {
+        m_uncached_area.reset();
+        return ErrorCode::mmap_failed;
+    }
+
+    return std::span((uint8_t*) m_uncached_area->data() + (address - ranges.ddr_uncached_address), size);
+}
+
+// Map a whole region shared with the payload, once
+static std::variant<std::span<uint8_t>, ErrorCode> mapSharedRegion(std::unique_ptr<Mmap>& area,
+                                                                   intptr_t address,
+                                                                   size_t size)
+{
+    if (!area)
+    {
+        auto devmem = get_devmem_handle();
+
+        if (std::holds_alternative<ErrorCode>(devmem))
+        {
+            return std::get<ErrorCode>(devmem);
+        }
+
+        area = std::make_unique<Mmap>(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, std::get<int>(devmem), address);
+    }
+
+    if (!*area)
+    {
+        area.reset();
+        return ErrorCode::mmap_failed;
+    }
+
+    return std::span((uint8_t*) area->data(), area->size());
+}
+
+std::variant<std::span<uint8_t>, ErrorCode> Domain::mapStreamRing()
+{
+    auto& ranges = getPhysicalMemoryRanges();
+
+    return mapSharedRegion(m_stream_area, ranges.stream_address, ranges.stream_size);
+}
+
+std::variant<std::span<uint8_t>, ErrorCode> Domain::mapHostIoArea()
+{
+    auto& ranges = getPhysicalMemoryRanges();
+
+    return mapSharedRegion(m_host_io_area, ranges.host_io_address, ranges.host_io_size);
+}
@@ -1,4 +1,6 @@
+#include <bmboot/clock_sync.hpp>
 #include <bmboot/domain_helpers.hpp>
+#include <bmboot/synchronized_start.hpp>
 
 #include "../utility/crc32.hpp"
 
@@ -30,16 +32,33 @@ static void runConsole(IDomain& domain)
 
     auto domain_name = toString(domain.getIndex());
 
+    // Lines are stamped with the time at which the payload wrote them, relative to the start of the console
+    auto start_counter = ClockSync::readCounter();
+    auto cntfrq = domain.getTimerFrequency();
+    uint64_t line_timestamp = 0;
+
     auto start = std::chrono::system_clock::now();
 
     std::stringstream stdout_accum;
 
     auto flush = [&]()
     {
-        auto now = std::chrono::system_clock::now();
-        printf("[%s %7.3f] %s\n",
+        double time;
+
+        if (line_timestamp != 0 && cntfrq != 0)
+        {
+            time = (double)(int64_t)(line_timestamp - start_counter) / cntfrq;
+        }
+        else
+        {
+            // Timestamp not available, fall back to the time of reception
+            auto now = std::chrono::system_clock::now();
+            time = duration_cast<std::chrono::duration<double>>((now - start)).count();
+        }
+
+        printf("[%s %11.6f] %s\n",
                domain_name.c_str(),
-               duration_cast<std::chrono::duration<float>>((now - start)).count(),
+               time,
                stdout_accum.str().c_str());
         std::stringstream().swap(stdout_accum);         // https://stackoverflow.com/a/23266418
     };
@@ -50,6 +69,11 @@ static void runConsole(IDomain& domain)
 
         if (c >= 0)
         {
+            if (stdout_accum.tellp() == 0)
+            {
+                line_timestamp = domain.getConsoleLineTimestamp();
+            }
+
             if (c == '\n')
             {
                 flush();
@@ -96,7 +120,7 @@ void bmboot::runConsoleUntilInterrupted(IDomain& domain)
     console_threads[domain.getIndex()].join();
 }
 
-void bmboot::loadPayloadFromFileOrThrow(IDomain& domain, std::filesystem::path const& path)
+static std::vector<uint8_t> readFileOrThrow(std::filesystem::path const& path)
 {
     std::ifstream file(path, std::ios::binary);
 
@@ -105,8 +129,13 @@ void bmboot::loadPayloadFromFileOrThrow(IDomain& domain, std::filesystem::path c
         throw std::runtime_error("failed to open " + path.string());
     }
 
-    std::vector<uint8_t> program((std::istreambuf_iterator<char>(file)),
-                                 std::istreambuf_iterator<char>());
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)),
+                                std::istreambuf_iterator<char>());
+}
+
+void bmboot::loadPayloadFromFileOrThrow(IDomain& domain, std::filesystem::path const& path)
+{
+    auto program = readFileOrThrow(path);
 
     if (path.extension() == ".elf")
     {
@@ -119,6 +148,47 @@ void bmboot::loadPayloadFromFileOrThrow(IDomain& domain, std::filesystem::path c
     }
 }
 
+void bmboot::preloadPayloadFromFileOrThrow(IDomain& domain, std::filesystem::path const& path)
+{
+    auto program = readFileOrThrow(path);
+
+    if (path.extension() == ".elf")
+    {
+        throwOnError(domain.preloadElfPayload(program, 1234), "preloadElfPayload");
+    }
+    else
+    {
+        auto crc = crc32(0, program.data(), program.size());
+        throwOnError(domain.preloadPayload(program, crc, 123), "preloadPayload");
+    }
+}
+
+void bmboot::startSmpPayloadFromFileOrThrow(IDomain& cpu1, std::span<IDomain* const> other_domains,
+                                            std::filesystem::path const& path)
+{
+    auto program = readFileOrThrow(path);
+
+    SynchronizedStart payload {.domain = &cpu1, .payload_binary = program};
+
+    if (path.extension() == ".elf")
+    {
+        payload.elf = true;
+        payload.payload_argument = 1234;
+    }
+    else
+    {
+        payload.payload_crc32 = crc32(0, program.data(), program.size());
+        payload.payload_argument = 123;
+    }
+
+    auto start_time = startSmpPayload(payload, other_domains, 200ms);
+
+    if (std::holds_alternative<ErrorCode>(start_time))
+    {
+        throwOnError(MaybeError(std::get<ErrorCode>(start_time)), "startSmpPayload");
+    }
+}
+
 void bmboot::startConsoleThread(IDomain& domain)
 {
     auto& thread = console_threads[domain.getIndex()];
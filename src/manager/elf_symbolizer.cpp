@@ -0,0 +1,163 @@
+//! @file
+//! @brief  Address-to-function lookup in a payload ELF
+//! @author Martin Cejp
+
+#include "bmboot/elf_symbolizer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <cxxabi.h>
+#include <elf.h>
+
+using namespace bmboot;
+
+// ************************************************************
+
+static std::string demangle(char const* name)
+{
+    int status;
+    char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+
+    if (status != 0 || demangled == nullptr)
+    {
+        return name;
+    }
+
+    std::string result(demangled);
+    free(demangled);
+    return result;
+}
+
+// ************************************************************
+
+std::optional<ElfSymbolizer> ElfSymbolizer::load(std::filesystem::path const& path)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file)
+    {
+        return {};
+    }
+
+    std::vector<uint8_t> elf((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    auto in_bounds = [&elf](size_t offset, size_t size) { return offset <= elf.size() && size <= elf.size() - offset; };
+
+    if (!in_bounds(0, sizeof(Elf64_Ehdr)) || memcmp(elf.data(), ELFMAG, SELFMAG) != 0 || elf[EI_CLASS] != ELFCLASS64)
+    {
+        return {};
+    }
+
+    auto ehdr = (Elf64_Ehdr const*) elf.data();
+
+    if (ehdr->e_shentsize != sizeof(Elf64_Shdr) || !in_bounds(ehdr->e_shoff, ehdr->e_shnum * sizeof(Elf64_Shdr)))
+    {
+        return {};
+    }
+
+    auto sections = (Elf64_Shdr const*) (elf.data() + ehdr->e_shoff);
+
+    ElfSymbolizer symbolizer;
+    bool have_symtab = false;
+
+    for (int i = 0; i < ehdr->e_shnum; i++)
+    {
+        auto const& symtab = sections[i];
+
+        if (symtab.sh_type != SHT_SYMTAB || symtab.sh_link >= ehdr->e_shnum)
+        {
+            continue;
+        }
+
+        auto const& strtab = sections[symtab.sh_link];
+
+        if (!in_bounds(symtab.sh_offset, symtab.sh_size) || !in_bounds(strtab.sh_offset, strtab.sh_size))
+        {
+            continue;
+        }
+
+        have_symtab = true;
+
+        auto symbols = (Elf64_Sym const*) (elf.data() + symtab.sh_offset);
+        auto num_symbols = symtab.sh_size / sizeof(Elf64_Sym);
+        auto strings = (char const*) (elf.data() + strtab.sh_offset);
+
+        for (size_t j = 0; j < num_symbols; j++)
+        {
+            auto const& sym = symbols[j];
+
+            auto type = ELF64_ST_TYPE(sym.st_info);
+
+            if ((type != STT_FUNC && type != STT_OBJECT) || sym.st_value == 0 || sym.st_name >= strtab.sh_size)
+            {
+                continue;
+            }
+
+            // make sure the name is terminated within the string table
+            if (memchr(strings + sym.st_name, 0, strtab.sh_size - sym.st_name) == nullptr)
+            {
+                continue;
+            }
+
+            if (type == STT_FUNC)
+            {
+                symbolizer.m_symbols.push_back(Symbol { sym.st_value, sym.st_size, demangle(strings + sym.st_name) });
+            }
+            else
+            {
+                symbolizer.m_objects.emplace(strings + sym.st_name, sym.st_value);
+            }
+        }
+    }
+
+    if (!have_symtab)
+    {
+        return {};
+    }
+
+    std::sort(symbolizer.m_symbols.begin(), symbolizer.m_symbols.end(),
+              [](Symbol const& a, Symbol const& b) { return a.address < b.address; });
+
+    return symbolizer;
+}
+
+// ************************************************************
+
+std::string ElfSymbolizer::symbolize(uintptr_t address) const
+{
+    // find the last symbol starting at or before the address
+    auto it = std::upper_bound(m_symbols.begin(), m_symbols.end(), address,
+                               [](uintptr_t address, Symbol const& sym) { return address < sym.address; });
+
+    if (it != m_symbols.begin())
+    {
+        --it;
+
+        // symbols of unknown size (typically hand-written assembly) extend up to the next symbol
+        if (it->size == 0 || address < it->address + it->size)
+        {
+            return it->name;
+        }
+    }
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "0x%zx", address);
+    return buffer;
+}
+
+std::optional<uintptr_t> ElfSymbolizer::findObject(std::string_view name) const
+{
+    auto it = m_objects.find(name);
+
+    if (it == m_objects.end())
+    {
+        return {};
+    }
+
+    return it->second;
+}
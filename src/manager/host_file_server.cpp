@@ -0,0 +1,392 @@
+//! @file
+//! @brief  Serving file operations of a payload from a Linux directory
+//! @author Martin Cejp
+
+#include "../bmboot_internal.hpp"
+#include "bmboot/host_file_server.hpp"
+#include "bmboot/shared_memory.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if __has_include(<linux/openat2.h>)
+#include <linux/openat2.h>
+#endif
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+// Descriptors handed out to the payload; 0-2 are the standard streams there
+static constexpr int FIRST_FD = 3;
+static constexpr int MAX_OPEN_FILES = 64;
+
+// ************************************************************
+
+static HostIoError toHostIoError(int error)
+{
+    switch (error)
+    {
+        case EBADF:         return HostIoError::bad_file;
+        case ENOENT:        return HostIoError::not_found;
+        case EACCES:
+        case EPERM:
+        case ELOOP:                     // symlink refused by openBeneath
+        case EXDEV:                     // path resolution would leave the served directory
+        case EROFS:         return HostIoError::access_denied;
+        case EEXIST:        return HostIoError::exists;
+        case EINVAL:        return HostIoError::invalid_argument;
+        case ENOSPC:
+        case EDQUOT:
+        case EFBIG:         return HostIoError::no_space;
+        case EISDIR:        return HostIoError::is_directory;
+        case ENOTDIR:       return HostIoError::not_directory;
+        case EMFILE:
+        case ENFILE:        return HostIoError::too_many_open_files;
+        case ENAMETOOLONG:  return HostIoError::name_too_long;
+        default:            return HostIoError::io_error;
+    }
+}
+
+// Only paths leading into the served directory are allowed
+static bool isPathAllowed(std::string const& path)
+{
+    if (path.empty() || path.find('\0') != std::string::npos)
+    {
+        return false;
+    }
+
+    std::filesystem::path fs_path(path);
+
+    if (fs_path.is_absolute())
+    {
+        return false;
+    }
+
+    return std::none_of(fs_path.begin(), fs_path.end(), [](auto const& component) { return component == ".."; });
+}
+
+// Open a path accepted by isPathAllowed, without letting a symlink lead out of the served directory
+static int openBeneath(int root_fd, std::string const& path, int flags, mode_t mode)
+{
+#if defined(SYS_openat2) && defined(RESOLVE_BENEATH)
+    open_how how {};
+    how.flags = (uint64_t) flags;
+    how.mode = (flags & O_CREAT) ? mode : 0;       // a mode without O_CREAT is rejected
+    how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+
+    int fd = (int) syscall(SYS_openat2, root_fd, path.c_str(), &how, sizeof(how));
+
+    if (fd >= 0 || errno != ENOSYS)
+    {
+        return fd;
+    }
+#endif
+
+    // No openat2 (Linux < 5.6): walk the path one component at a time and refuse symlinks altogether
+    std::vector<std::string> components;
+
+    for (auto const& component : std::filesystem::path(path))
+    {
+        if (!component.empty() && component != ".")
+        {
+            components.push_back(component.string());
+        }
+    }
+
+    if (components.empty())
+    {
+        components.push_back(".");
+    }
+
+    int dir_fd = root_fd;
+
+    for (size_t i = 0; i < components.size(); i++)
+    {
+        bool last = (i == components.size() - 1);
+
+        // O_DIRECTORY makes a symlink fail with ENOTDIR, O_NOFOLLOW on the file itself with ELOOP
+        int fd = last ? openat(dir_fd, components[i].c_str(), flags | O_NOFOLLOW, mode)
+                      : openat(dir_fd, components[i].c_str(), O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        int saved_errno = errno;
+
+        if (dir_fd != root_fd)
+        {
+            close(dir_fd);
+        }
+
+        if (fd < 0 || last)
+        {
+            errno = saved_errno;
+            return fd;
+        }
+
+        dir_fd = fd;
+    }
+
+    return -1;      // not reached
+}
+
+static int toLinuxOpenFlags(uint32_t flags)
+{
+    int linux_flags;
+
+    switch (flags & HOST_IO_O_ACCMODE)
+    {
+        case HOST_IO_O_WRONLY:  linux_flags = O_WRONLY; break;
+        case HOST_IO_O_RDWR:    linux_flags = O_RDWR; break;
+        default:                linux_flags = O_RDONLY; break;
+    }
+
+    if (flags & HOST_IO_O_CREAT)  { linux_flags |= O_CREAT; }
+    if (flags & HOST_IO_O_TRUNC)  { linux_flags |= O_TRUNC; }
+    if (flags & HOST_IO_O_APPEND) { linux_flags |= O_APPEND; }
+    if (flags & HOST_IO_O_EXCL)   { linux_flags |= O_EXCL; }
+
+    return linux_flags | O_CLOEXEC;
+}
+
+// ************************************************************
+
+std::variant<std::unique_ptr<HostFileServer>, ErrorCode> HostFileServer::start(IDomain& domain,
+                                                                                std::filesystem::path const& root,
+                                                                                std::chrono::microseconds poll_interval)
+{
+    auto area = domain.mapHostIoArea();
+
+    if (std::holds_alternative<ErrorCode>(area))
+    {
+        return std::get<ErrorCode>(area);
+    }
+
+    int root_fd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (root_fd < 0)
+    {
+        return ErrorCode::file_access_failed;
+    }
+
+    std::unique_ptr<HostFileServer> server(new HostFileServer(std::get<std::span<uint8_t>>(area),
+                                                              root_fd,
+                                                              poll_interval));
+    server->m_thread = std::thread([server = server.get()] { server->run(); });
+    return server;
+}
+
+HostFileServer::HostFileServer(std::span<uint8_t> area, int root_fd, std::chrono::microseconds poll_interval)
+        : m_area(area),
+          m_root_fd(root_fd),
+          m_poll_interval(poll_interval),
+          m_files(MAX_OPEN_FILES, -1),
+          m_buffer(area.size() - HOST_IO_HEADER_SIZE)
+{
+}
+
+HostFileServer::~HostFileServer()
+{
+    stop();
+    close(m_root_fd);
+}
+
+void HostFileServer::stop()
+{
+    m_stop_requested = true;
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+// ************************************************************
+
+void HostFileServer::run()
+{
+    auto& header = *(HostIoHeader*) m_area.data();
+
+    // Do not repeat a request served by an earlier server
+    auto last_request = sharedLoad(header.response);
+
+    sharedStore(header.server_attached, 1);
+
+    while (!m_stop_requested)
+    {
+        auto request = sharedLoad(header.request);
+
+        if (sharedLoad(header.magic) != HOST_IO_MAGIC || request == last_request || (uint32_t) request == 0)
+        {
+            std::this_thread::sleep_for(m_poll_interval);
+            continue;
+        }
+
+        // Request word before the request it publishes
+        sharedMemoryReadBarrier();
+
+        auto session = (uint32_t)(request >> 32);
+
+        if (session != m_session)
+        {
+            // A new payload; the files of the previous one are not its business
+            closeAllFiles();
+            m_session = session;
+        }
+
+        serveRequest();
+        last_request = request;
+        m_num_requests_served++;
+
+        // Reads of the request and writes of the response before handing the slot back
+        sharedMemoryFullBarrier();
+        sharedStore(header.response, request);
+    }
+
+    sharedStore(header.server_attached, 0);
+    closeAllFiles();
+}
+
+void HostFileServer::serveRequest()
+{
+    auto& header = *(HostIoHeader*) m_area.data();
+    auto transfer_buffer = m_area.data() + HOST_IO_HEADER_SIZE;
+
+    auto op = sharedLoad(header.op);
+    auto fd = sharedLoad(header.fd);
+    auto size = sharedLoad(header.size);
+
+    int64_t result = 0;
+    int error = 0;
+
+    // Look up the Linux descriptor of a payload descriptor; -1 if invalid
+    auto file_index = fd - FIRST_FD;
+    int file = (file_index >= 0 && file_index < (int) m_files.size()) ? m_files[file_index] : -1;
+
+    if (size > m_buffer.size())
+    {
+        error = EINVAL;
+    }
+    else if (op != HostIoOp::open && file < 0)
+    {
+        error = EBADF;
+    }
+    else
+    {
+        switch (op)
+        {
+            case HostIoOp::open:
+            {
+                std::string path(size, '\0');
+                copyFromSharedMemory(path.data(), transfer_buffer, size);
+
+                auto free_slot = std::find(m_files.begin(), m_files.end(), -1);
+
+                if (!isPathAllowed(path))
+                {
+                    error = EACCES;
+                }
+                else if (free_slot == m_files.end())
+                {
+                    error = EMFILE;
+                }
+                else
+                {
+                    int new_file = openBeneath(m_root_fd, path, toLinuxOpenFlags(sharedLoad(header.flags)),
+                                               sharedLoad(header.mode));
+
+                    if (new_file < 0)
+                    {
+                        error = errno;
+                    }
+                    else
+                    {
+                        *free_slot = new_file;
+                        result = FIRST_FD + (free_slot - m_files.begin());
+                    }
+                }
+                break;
+            }
+
+            case HostIoOp::close:
+                m_files[file_index] = -1;
+
+                if (close(file) < 0)
+                {
+                    error = errno;
+                }
+                break;
+
+            case HostIoOp::read:
+                result = read(file, m_buffer.data(), size);
+
+                if (result < 0)
+                {
+                    error = errno;
+                }
+                else
+                {
+                    copyToSharedMemory(transfer_buffer, m_buffer.data(), result);
+                }
+                break;
+
+            case HostIoOp::write:
+                copyFromSharedMemory(m_buffer.data(), transfer_buffer, size);
+                result = write(file, m_buffer.data(), size);
+
+                if (result < 0)
+                {
+                    error = errno;
+                }
+                break;
+
+            case HostIoOp::lseek:
+                result = lseek(file, sharedLoad(header.offset), sharedLoad(header.whence));
+
+                if (result < 0)
+                {
+                    error = errno;
+                }
+                break;
+
+            case HostIoOp::fstat:
+            {
+                struct stat st;
+
+                if (fstat(file, &st) < 0)
+                {
+                    error = errno;
+                    break;
+                }
+
+                sharedStore(header.file_type, S_ISREG(st.st_mode) ? HostIoFileType::regular
+                                              : S_ISDIR(st.st_mode) ? HostIoFileType::directory
+                                              : HostIoFileType::other);
+                sharedStore(header.file_size, st.st_size);
+                break;
+            }
+
+            default:
+                error = EINVAL;
+                break;
+        }
+    }
+
+    sharedStore(header.result, (error == 0) ? result : -1);
+    sharedStore(header.error, (error == 0) ? HostIoError::none : toHostIoError(error));
+}
+
+void HostFileServer::closeAllFiles()
+{
+    for (auto& file : m_files)
+    {
+        if (file >= 0)
+        {
+            close(file);
+            file = -1;
+        }
+    }
+}
@@ -0,0 +1,70 @@
+//! @file
+//! @brief  Copying records out of a ring buffer which is being written concurrently
+//! @author Martin Cejp
+//!
+//! The rings in the diagnostics block and in payload memory all work the same way: the producer writes record n into
+//! slot n % ring_size, then publishes its write position as n + 1. The reader cannot stop the producer, so it copies
+//! the records first, then reads the write position again and discards those that might have been overwritten.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace bmboot::internal
+{
+
+//! Number of records at the start of [begin, end) which the producer might have overwritten while they were being
+//! copied, given its write position after the copy.
+//!
+//! Record n is written before the write position becomes n + 1, so the record at @p end_after_copy itself might be
+//! in the middle of being written, too.
+inline uint64_t countOverwrittenRecords(uint64_t begin, uint64_t end, uint64_t end_after_copy, uint64_t ring_size)
+{
+    if (end_after_copy + 1 <= begin + ring_size)
+    {
+        return 0;
+    }
+
+    return std::min(end_after_copy + 1 - ring_size - begin, end - begin);
+}
+
+//! Copy the records from @p read_position up to @p end (the write position, loaded with acquire semantics) and
+//! append the valid ones to @p records_out.
+//!
+//! @param load_end Re-reads the write position after the copy
+//! @param copy_record Converts the record with the given index; called for each index in the range, in order
+//! @return Number of records lost, because they had been overwritten before or during the copy
+template <typename Record, typename LoadEnd, typename CopyRecord>
+uint64_t copyRingSince(uint64_t read_position,
+                       uint64_t end,
+                       LoadEnd&& load_end,
+                       uint64_t ring_size,
+                       std::vector<Record>& records_out,
+                       CopyRecord&& copy_record)
+{
+    uint64_t num_lost = 0;
+
+    if (end - read_position > ring_size)
+    {
+        num_lost += end - read_position - ring_size;
+        read_position = end - ring_size;
+    }
+
+    auto first_new = records_out.size();
+
+    for (auto i = read_position; i < end; i++)
+    {
+        records_out.push_back(copy_record(i));
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto num_overwritten = countOverwrittenRecords(read_position, end, load_end(), ring_size);
+
+    records_out.erase(records_out.begin() + first_new, records_out.begin() + first_new + num_overwritten);
+    return num_lost + num_overwritten;
+}
+
+}
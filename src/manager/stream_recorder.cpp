@@ -0,0 +1,311 @@
+//! @file
+//! @brief  Recording of the record stream of a payload into files
+//! @author Martin Cejp
+
+#include "../bmboot_internal.hpp"
+#include "bmboot/shared_memory.hpp"
+#include "bmboot/stream_recorder.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace bmboot;
+using namespace bmboot::internal;
+
+// O_DIRECT requires the buffer address, the file offset and the size of each write to be multiples of the block size
+static constexpr size_t DIRECT_IO_ALIGNMENT = 4096;
+
+// How long to wait when the ring is empty, or when the payload has not started the stream yet
+static constexpr auto POLL_INTERVAL = std::chrono::milliseconds(1);
+
+// ************************************************************
+
+std::variant<std::unique_ptr<StreamRecorder>, ErrorCode> StreamRecorder::start(IDomain& domain,
+                                                                              StreamRecorderOptions options)
+{
+    if (options.path_prefix.empty() || options.chunk_size == 0)
+    {
+        return ErrorCode::invalid_argument;
+    }
+
+    auto ring = domain.mapStreamRing();
+
+    if (std::holds_alternative<ErrorCode>(ring))
+    {
+        return std::get<ErrorCode>(ring);
+    }
+
+    // Round the chunk size up to the alignment required by O_DIRECT
+    options.chunk_size = (options.chunk_size + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+
+    std::unique_ptr<StreamRecorder> recorder(new StreamRecorder(std::get<std::span<uint8_t>>(ring), options));
+
+    if (!recorder->m_buffer)
+    {
+        return ErrorCode::unknown_error;
+    }
+
+    recorder->m_thread = std::thread([recorder = recorder.get()] { recorder->run(); });
+    return recorder;
+}
+
+StreamRecorder::StreamRecorder(std::span<uint8_t> ring, StreamRecorderOptions options)
+        : m_ring(ring),
+          m_options(std::move(options)),
+          m_buffer((uint8_t*) aligned_alloc(DIRECT_IO_ALIGNMENT, m_options.chunk_size), free)
+{
+}
+
+StreamRecorder::~StreamRecorder()
+{
+    stop();
+}
+
+void StreamRecorder::stop()
+{
+    m_stop_requested = true;
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+StreamRecorderStatistics StreamRecorder::getStatistics() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_statistics;
+}
+
+// ************************************************************
+
+void StreamRecorder::run()
+{
+    auto& header = *(StreamRingHeader*) m_ring.data();
+
+    while (!m_stop_requested)
+    {
+        if (sharedLoad(header.magic) != STREAM_RING_MAGIC)
+        {
+            std::this_thread::sleep_for(POLL_INTERVAL);
+            continue;
+        }
+
+        auto session = sharedLoad(header.session);
+
+        if (session != m_session)
+        {
+            // The payload has (re)started the stream. Anything left unread from the previous session is gone.
+            sharedMemoryReadBarrier();
+
+            m_session = session;
+            m_read_position = sharedLoad(header.write_position);
+
+            // Write whole records, so that a file never ends in the middle of one
+            auto record_size = sharedLoad(header.record_size);
+            m_granularity = (record_size <= m_options.chunk_size) ? record_size : 1;
+            m_direct_io = m_options.direct_io;
+
+            if (m_direct_io && std::lcm(record_size, DIRECT_IO_ALIGNMENT) > m_options.chunk_size)
+            {
+                // Can't write whole records in whole blocks with the buffer we have
+                m_direct_io = false;
+            }
+
+            if (m_direct_io)
+            {
+                m_granularity = std::lcm(record_size, DIRECT_IO_ALIGNMENT);
+            }
+
+            // Each session goes into a new file, so that all records in a file have the same size
+            closeFile();
+
+            // Read position before announcing the attachment
+            sharedStore(header.read_position, m_read_position);
+            sharedMemoryFullBarrier();
+            sharedStore(header.attached_session, session);
+
+            std::lock_guard lock(m_mutex);
+            m_statistics.record_size = record_size;
+            m_statistics.ring_capacity = sharedLoad(header.capacity);
+            m_statistics.sessions++;
+        }
+
+        if (!drain(false))
+        {
+            closeFile();
+            return;
+        }
+    }
+
+    // Detach, so that the payload stops writing, and give a write in progress a moment to be published
+    sharedStore(header.attached_session, 0);
+    sharedMemoryFullBarrier();
+    std::this_thread::sleep_for(POLL_INTERVAL);
+
+    if (m_session != 0 && sharedLoad(header.magic) == STREAM_RING_MAGIC && sharedLoad(header.session) == m_session)
+    {
+        drain(true);
+    }
+
+    closeFile();
+}
+
+// Returns false on a write error
+bool StreamRecorder::drain(bool final)
+{
+    auto& header = *(StreamRingHeader*) m_ring.data();
+    auto data = m_ring.data() + STREAM_RING_HEADER_SIZE;
+
+    do
+    {
+        auto write_position = sharedLoad(header.write_position);
+        auto records_dropped = sharedLoad(header.records_dropped);
+        auto capacity = sharedLoad(header.capacity);
+
+        // Position before the data it covers, and before checking that it still belongs to our session
+        sharedMemoryReadBarrier();
+
+        if (sharedLoad(header.magic) != STREAM_RING_MAGIC || sharedLoad(header.session) != m_session)
+        {
+            return true;
+        }
+
+        auto available = write_position - m_read_position;
+
+        if (!m_dropped_baseline.has_value() || records_dropped < *m_dropped_baseline)
+        {
+            // First look at the counter, or the ring header has been reinitialized
+            m_dropped_previous = m_statistics.records_dropped;
+            m_dropped_baseline = records_dropped;
+        }
+
+        {
+            std::lock_guard lock(m_mutex);
+            m_statistics.records_dropped = m_dropped_previous + (records_dropped - *m_dropped_baseline);
+            m_statistics.ring_fill = available;
+            m_statistics.max_ring_fill = std::max(m_statistics.max_ring_fill, available);
+        }
+
+        size_t amount = std::min<uint64_t>(available, m_options.chunk_size / m_granularity * m_granularity);
+
+        if (!final)
+        {
+            amount -= amount % m_granularity;
+        }
+
+        if (amount == 0)
+        {
+            if (!final)
+            {
+                std::this_thread::sleep_for(POLL_INTERVAL);
+            }
+
+            return true;
+        }
+
+        auto offset = m_read_position % capacity;
+        auto first_part = std::min<size_t>(amount, capacity - offset);
+
+        copyFromSharedMemory(m_buffer.get(), data + offset, first_part);
+        copyFromSharedMemory(m_buffer.get() + first_part, data, amount - first_part);
+
+        // Reads of the data before handing the space back to the payload
+        sharedMemoryFullBarrier();
+
+        m_read_position += amount;
+        sharedStore(header.read_position, m_read_position);
+
+        if (!writeToFile(m_buffer.get(), amount, final))
+        {
+            std::lock_guard lock(m_mutex);
+            m_statistics.write_error = true;
+            return false;
+        }
+    }
+    while (final || !m_stop_requested);
+
+    return true;
+}
+
+bool StreamRecorder::writeToFile(uint8_t const* data, size_t size, bool final)
+{
+    if (m_fd >= 0 && m_options.max_file_size != 0 && m_file_size >= m_options.max_file_size)
+    {
+        closeFile();
+    }
+
+    if (m_fd < 0)
+    {
+        int file_index;
+
+        {
+            std::lock_guard lock(m_mutex);
+            file_index = m_statistics.num_files;
+        }
+
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), "_%04d.bin", file_index);
+
+        auto path = m_options.path_prefix + suffix;
+        m_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | (m_direct_io ? O_DIRECT : 0), 0644);
+
+        if (m_fd < 0)
+        {
+            fprintf(stderr, "bmboot: failed to create %s: %s\n", path.c_str(), strerror(errno));
+            return false;
+        }
+
+        m_file_size = 0;
+
+        std::lock_guard lock(m_mutex);
+        m_statistics.num_files++;
+    }
+
+    if (m_direct_io && final && size % DIRECT_IO_ALIGNMENT != 0)
+    {
+        // The tail of the recording is not a whole number of blocks
+        fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) & ~O_DIRECT);
+    }
+
+    while (size > 0)
+    {
+        auto written = write(m_fd, data, size);
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            fprintf(stderr, "bmboot: failed to write recording: %s\n", strerror(errno));
+            return false;
+        }
+
+        data += written;
+        size -= written;
+        m_file_size += written;
+
+        std::lock_guard lock(m_mutex);
+        m_statistics.bytes_recorded += written;
+    }
+
+    return true;
+}
+
+void StreamRecorder::closeFile()
+{
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
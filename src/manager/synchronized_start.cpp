@@ -0,0 +1,135 @@
+//! @file
+//! @brief  Starting payloads on several domains at the same time
+//! @author Martin Cejp
+
+#include "bmboot/clock_sync.hpp"
+#include "bmboot/synchronized_start.hpp"
+
+#include <algorithm>
+#include <vector>
+
+using namespace bmboot;
+
+// ************************************************************
+
+static MaybeError arm(SynchronizedStart const& payload, uint64_t start_time)
+{
+    if (payload.elf)
+    {
+        return payload.domain->loadElfAndArmPayload(payload.payload_binary, payload.payload_argument, start_time);
+    }
+    else
+    {
+        return payload.domain->loadAndArmPayload(payload.payload_binary,
+                                                 payload.payload_crc32,
+                                                 payload.payload_argument,
+                                                 start_time);
+    }
+}
+
+// Arm all domains with a common start time, @p lead_time from now, and wait until they have started.
+// arm(i, start_time) arms domains[i].
+template <typename ArmFunc>
+static std::variant<uint64_t, ErrorCode> startTogether(std::span<IDomain* const> domains,
+                                                       std::chrono::microseconds lead_time,
+                                                       ArmFunc const& arm)
+{
+    if (domains.empty() || lead_time.count() <= 0)
+    {
+        return ErrorCode::invalid_argument;
+    }
+
+    for (auto domain : domains)
+    {
+        if (domain == nullptr)
+        {
+            return ErrorCode::invalid_argument;
+        }
+
+        // Check them all up front, rather than having to back out of a partial start
+        if (domain->getState() != DomainState::monitor_ready)
+        {
+            return ErrorCode::bad_domain_state;
+        }
+    }
+
+    auto cntfrq = domains[0]->getTimerFrequency();
+
+    if (cntfrq == 0)
+    {
+        return ErrorCode::bad_domain_state;
+    }
+
+    auto start_time = ClockSync::readCounter() + (uint64_t) lead_time.count() * cntfrq / 1'000'000;
+
+    for (size_t i = 0; i < domains.size(); i++)
+    {
+        if (auto error = arm(i, start_time))
+        {
+            // Disarm the ones armed so far: the kill request brings a waiting monitor back to its command loop
+            for (size_t j = 0; j < i; j++)
+            {
+                domains[j]->terminatePayload();
+            }
+
+            return *error;
+        }
+    }
+
+    for (auto domain : domains)
+    {
+        if (auto error = domain->awaitPayloadStart())
+        {
+            return *error;
+        }
+    }
+
+    return start_time;
+}
+
+std::variant<uint64_t, ErrorCode> bmboot::startPayloadsSynchronized(std::span<SynchronizedStart const> payloads,
+                                                                    std::chrono::microseconds lead_time)
+{
+    std::vector<IDomain*> domains;
+
+    for (auto const& payload : payloads)
+    {
+        domains.push_back(payload.domain);
+    }
+
+    return startTogether(domains, lead_time, [&](size_t i, uint64_t start_time)
+    {
+        return arm(payloads[i], start_time);
+    });
+}
+
+std::variant<uint64_t, ErrorCode> bmboot::startSmpPayload(SynchronizedStart const& payload,
+                                                          std::span<IDomain* const> other_domains,
+                                                          std::chrono::microseconds lead_time)
+{
+    // The image is linked to run from the payload window of cpu1
+    if (payload.domain == nullptr || payload.domain->getIndex() != DomainIndex::cpu1)
+    {
+        return ErrorCode::invalid_argument;
+    }
+
+    std::vector<IDomain*> domains {payload.domain};
+
+    for (auto domain : other_domains)
+    {
+        if (domain == nullptr || std::find_if(domains.begin(), domains.end(), [=](IDomain* other)
+        {
+            return other->getIndex() == domain->getIndex();
+        }) != domains.end())
+        {
+            return ErrorCode::invalid_argument;
+        }
+
+        domains.push_back(domain);
+    }
+
+    return startTogether(domains, lead_time, [&](size_t i, uint64_t start_time)
+    {
+        return (i == 0) ? arm(payload, start_time) : domains[i]->armPayloadOf(*payload.domain, start_time);
+    });
+}
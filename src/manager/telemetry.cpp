@@ -0,0 +1,60 @@
+//! @file
+//! @brief  Operational counters of a domain
+//! @author Martin Cejp
+
+#include "bmboot/telemetry.hpp"
+
+using namespace bmboot;
+
+// ************************************************************
+
+template <typename Key>
+static std::map<Key, double> computeRates(std::map<Key, uint64_t> const& earlier,
+                                          std::map<Key, uint64_t> const& later,
+                                          double interval_s)
+{
+    std::map<Key, double> rates;
+
+    for (auto const& [key, count] : later)
+    {
+        auto it = earlier.find(key);
+        uint64_t earlier_count = (it != earlier.end()) ? it->second : 0;
+
+        rates[key] = (double)(count - earlier_count) / interval_s;
+    }
+
+    return rates;
+}
+
+TelemetryRates bmboot::computeTelemetryRates(TelemetrySnapshot const& earlier, TelemetrySnapshot const& later)
+{
+    auto interval_s = std::chrono::duration<double>(later.time - earlier.time).count();
+
+    // A reboot of the monitor resets all counters
+    static const TelemetrySnapshot zero {};
+    bool rebooted = later.monitor_starts < earlier.monitor_starts;
+    auto const& base = rebooted ? zero : earlier;
+
+    if (interval_s <= 0)
+    {
+        return TelemetryRates {};
+    }
+
+    auto rate = [&](uint64_t TelemetrySnapshot::* counter)
+    {
+        return (double)(later.*counter - base.*counter) / interval_s;
+    };
+
+    return TelemetryRates {
+        .interval_s = interval_s,
+        .payload_starts = rate(&TelemetrySnapshot::payload_starts),
+        .payload_crashes = rate(&TelemetrySnapshot::payload_crashes),
+        .monitor_load = (later.monitor_time_s - base.monitor_time_s) / interval_s,
+        .fiqs = rate(&TelemetrySnapshot::fiqs),
+        .ipi_requests = rate(&TelemetrySnapshot::ipi_requests),
+        .smc_calls = computeRates(base.smc_calls, later.smc_calls, interval_s),
+        .irqs = computeRates(base.irqs, later.irqs, interval_s),
+        .stdout_bytes_written = rate(&TelemetrySnapshot::stdout_bytes_written),
+        .stdout_bytes_dropped = rate(&TelemetrySnapshot::stdout_bytes_dropped),
+    };
+}
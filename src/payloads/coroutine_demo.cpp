@@ -0,0 +1,63 @@
+#include <bmboot/coroutines.hpp>
+#include <bmboot/payload_runtime.hpp>
+
+#include <cstdio>
+
+using namespace std::chrono_literals;
+
+static bmboot::InterruptEvent tick_event;
+static bmboot::MessageQueue<int, 8> numbers;
+
+static bmboot::Coroutine blink(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        printf("blink %d\n", i);
+        co_await bmboot::sleepFor(250ms);
+    }
+}
+
+static bmboot::Coroutine producer()
+{
+    for (int i = 0; i < 5; i++)
+    {
+        // woken up by the periodic interrupt
+        co_await tick_event.wait();
+        numbers.push(i * i);
+    }
+
+    bmboot::stopPeriodicInterrupt();
+}
+
+static bmboot::Coroutine consumer()
+{
+    for (int i = 0; i < 5; i++)
+    {
+        int value = co_await numbers.receive();
+        printf("received %d\n", value);
+    }
+
+    // awaiting another coroutine runs it to completion before continuing
+    co_await blink(3);
+    printf("consumer done\n");
+}
+
+int main(int argc, char** argv)
+{
+    bmboot::notifyPayloadStarted();
+
+    printf("coroutine demo\n");
+
+    bmboot::setupPeriodicInterrupt(100ms, [] { tick_event.signal(); });
+    bmboot::startPeriodicInterrupt();
+
+    bmboot::spawnCoroutine(producer());
+    bmboot::spawnCoroutine(consumer());
+
+    // returns once all coroutines have finished
+    bmboot::runCoroutineScheduler();
+
+    printf("all coroutines finished\n");
+
+    for (;;) {}
+}
@@ -0,0 +1,61 @@
+#include <array>
+#include <cstdint>
+#include <cstdio>
+
+#include <bmboot/payload_runtime.hpp>
+
+// Checks that the initialized data of the image is intact when the payload starts, i.e. that nothing left in the
+// caches by a previous payload has been written back over it. Crashes if it is not.
+//
+// With a payload argument of 1, the payload then keeps overwriting that data, so that its cache lines are dirty when it
+// gets terminated; the next payload loaded into the same window must not see any of it.
+
+constexpr int NUM_WORDS = 64 * 1024;            // 256 KiB: many cache lines, but well within the L2 cache
+
+static constexpr uint32_t patternAt(int index)
+{
+    return (uint32_t) index * 2654435761u ^ 0x5A5A5A5Au;
+}
+
+static constexpr std::array<uint32_t, NUM_WORDS> makePattern()
+{
+    std::array<uint32_t, NUM_WORDS> words {};
+
+    for (int i = 0; i < NUM_WORDS; i++)
+    {
+        words[i] = patternAt(i);
+    }
+
+    return words;
+}
+
+// Not const, so that it goes into .data
+static std::array<uint32_t, NUM_WORDS> pattern = makePattern();
+
+int main(int argc, char** argv)
+{
+    bmboot::notifyPayloadStarted();
+
+    for (int i = 0; i < NUM_WORDS; i++)
+    {
+        if (pattern[i] != patternAt(i))
+        {
+            printf("initialized data corrupted at word %d: %08x instead of %08x\n", i, pattern[i], patternAt(i));
+            bmboot::notifyPayloadCrashed("initialized data corrupted", (uintptr_t) &pattern[i]);
+            return 1;
+        }
+    }
+
+    printf("initialized data intact\n");
+
+    if (bmboot::getPayloadArgument() == 1)
+    {
+        for (uint32_t generation = 1; ; generation++)
+        {
+            for (auto& word : pattern)
+            {
+                ((volatile uint32_t&) word) = ~generation;
+            }
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#include <bmboot/host_io.hpp>
+#include <bmboot/payload_runtime.hpp>
+
+#include <cstdio>
+#include <cstring>
+
+// Run with: bmctl run <cpu> payload_file_io_demo.bin --files <directory>
+//
+// Writes a table into the served directory using stdio, reads it back, then appends to it asynchronously while
+// "doing other work".
+
+int main(int argc, char** argv)
+{
+    bmboot::notifyPayloadStarted();
+
+    if (!bmboot::isHostIoServerAttached())
+    {
+        printf("no file server; run with `bmctl run ... --files <directory>`\n");
+        return 0;
+    }
+
+    // Blocking I/O through the C library
+
+    auto file = fopen("squares.txt", "w");
+
+    if (file == nullptr)
+    {
+        perror("squares.txt");
+        return 0;
+    }
+
+    for (int i = 0; i < 10; i++)
+    {
+        fprintf(file, "%d %d\n", i, i * i);
+    }
+
+    fclose(file);
+
+    file = fopen("squares.txt", "r");
+    int x, y, sum = 0;
+
+    while (fscanf(file, "%d %d", &x, &y) == 2)
+    {
+        sum += y;
+    }
+
+    fclose(file);
+    printf("sum of squares read back: %d\n", sum);
+
+    // Asynchronous write, with the data placed straight into the transfer buffer
+
+    file = fopen("squares.txt", "a");
+    auto buffer = bmboot::getHostIoBuffer();
+    auto length = snprintf((char*) buffer.data(), buffer.size(), "# sum %d\n", sum);
+
+    bmboot::startHostWrite(fileno(file), length);
+
+    auto start = bmboot::getBuiltinTimerValue();
+    int polls = 0;
+    std::optional<int> result;
+
+    while (!(result = bmboot::pollHostIo()).has_value())
+    {
+        polls++;        // a control loop would be running here
+    }
+
+    auto elapsed_us = (bmboot::getBuiltinTimerValue() - start) * 1'000'000 / bmboot::getBuiltinTimerFrequency();
+    printf("asynchronous write: result %d after %d polls, %u us\n", *result, polls, (unsigned) elapsed_us);
+
+    fclose(file);
+}
@@ -1,10 +1,25 @@
 #include <bmboot/payload_runtime.hpp>
+#include <bmboot/pmu.hpp>
+#include <iterator>
 #include <unistd.h>
 
 #include "../executor/armv8a.hpp"
 
 static void myHandler();
 
+static volatile uint32_t sink;
+
+// Strided reads over a buffer larger than the L1 data cache (32 KiB)
+static void touchBuffer()
+{
+    static uint32_t buffer[64 * 1024 / sizeof(uint32_t)];
+
+    for (size_t i = 0; i < std::size(buffer); i += 16)
+    {
+        sink = buffer[i];
+    }
+}
+
 int main(int argc, char** argv)
 {
     bmboot::notifyPayloadStarted();
@@ -21,4 +36,40 @@ int main(int argc, char** argv)
     auto after = bmboot::getCycleCounterValue();
 
     printf("before: %ld, after: %ld, delta: %ld\n", before, after, after - before);
+
+    // Event counters
+    bmboot::PmuEvent events[] {
+        bmboot::PmuEvent::inst_retired,
+        bmboot::PmuEvent::l1d_cache,
+        bmboot::PmuEvent::l1d_cache_refill,
+        bmboot::PmuEvent::l2d_cache_refill,
+        bmboot::PmuEvent::br_mis_pred,
+        bmboot::PmuEvent::a53_stall_load_miss,
+    };
+
+    printf("%d event counters available\n", bmboot::getNumPmuEventCounters());
+
+    if (!bmboot::configurePmu(events))
+    {
+        printf("configurePmu failed\n");
+        return 1;
+    }
+
+    bmboot::startPmu();
+
+    bmboot::PmuCounts counts;
+
+    for (int i = 0; i < 100; i++)
+    {
+        bmboot::PmuScope scope(counts);
+        touchBuffer();
+    }
+
+    printf("cycles:            %lu\n", counts.cycles);
+    printf("instructions:      %lu\n", counts.events[0]);
+    printf("L1D accesses:      %lu\n", counts.events[1]);
+    printf("L1D refills:       %lu\n", counts.events[2]);
+    printf("L2D refills:       %lu\n", counts.events[3]);
+    printf("branch mispredict: %lu\n", counts.events[4]);
+    printf("load-miss stalls:  %lu\n", counts.events[5]);
 }
@@ -0,0 +1,64 @@
+#include "../executor/armv8a.hpp"
+#include <bmboot/payload_runtime.hpp>
+#include <bmboot/task_executor.hpp>
+
+#include <cstdio>
+
+using bmboot::PayloadInterruptPriority;
+
+struct Sample
+{
+    int index;
+    uint64_t latency_ticks;
+};
+
+static void onTick(bmboot::NoMessage);
+static void onSample(Sample sample);
+
+static bmboot::Task<bmboot::NoMessage, 1> tick_task(PayloadInterruptPriority::p6, onTick);
+static bmboot::Task<Sample, 4> report_task(PayloadInterruptPriority::p1, onSample);
+
+static int tick_count;
+static uint64_t next_tick_deadline;
+static uint64_t tick_period_ticks;
+
+int main(int argc, char** argv)
+{
+    bmboot::notifyPayloadStarted();
+
+    printf("task executor demo\n");
+
+    bmboot::initializeTaskExecutor();
+
+    // 10 ticks, 100 ms apart, scheduled with absolute deadlines to avoid drift
+    tick_period_ticks = bmboot::getBuiltinTimerFrequency() / 10;
+    next_tick_deadline = bmboot::getBuiltinTimerValue() + tick_period_ticks;
+    tick_task.spawnAt(next_tick_deadline);
+
+    // the main loop is the lowest-priority context; it only runs when no task is ready
+    for (;;) {
+        arm::armv8a::waitForInterrupt();
+    }
+}
+
+static void onTick(bmboot::NoMessage)
+{
+    auto now = bmboot::getBuiltinTimerValue();
+
+    // the high-priority task only hands over the data; printing happens at a lower priority
+    if (!report_task.spawn(Sample { tick_count, now - next_tick_deadline }))
+    {
+        // report_task is not keeping up; drop the sample
+    }
+
+    if (++tick_count < 10)
+    {
+        next_tick_deadline += tick_period_ticks;
+        tick_task.spawnAt(next_tick_deadline);
+    }
+}
+
+static void onSample(Sample sample)
+{
+    printf("tick %d, latency %d ticks\n", sample.index, (int) sample.latency_ticks);
+}
@@ -0,0 +1,53 @@
+#include <chrono>
+
+#include "../executor/armv8a.hpp"
+#include <bmboot/payload_runtime.hpp>
+#include <bmboot/trace.hpp>
+
+// Produces a timeline for `bmctl timeline`: a busy main loop, preempted by a 1 kHz timer interrupt
+
+static void myHandler();
+static void spin(uint64_t ticks);
+
+int main(int argc, char** argv)
+{
+    bmboot::notifyPayloadStarted();
+
+    printf("tracing; capture with bmctl timeline\n");
+
+    bmboot::setupPeriodicInterrupt(std::chrono::microseconds(1'000), myHandler);
+    bmboot::startPeriodicInterrupt();
+
+    auto ticks_per_us = bmboot::getBuiltinTimerFrequency() / 1'000'000;
+
+    for (;;)
+    {
+        BMBOOT_TRACE_SCOPE("main loop");
+
+        {
+            BMBOOT_TRACE_SCOPE("compute");
+            spin(300 * ticks_per_us);
+        }
+
+        {
+            BMBOOT_TRACE_SCOPE("idle");
+            arm::armv8a::waitForInterrupt();
+        }
+    }
+}
+
+static void myHandler()
+{
+    BMBOOT_TRACE_SCOPE("timer IRQ");
+
+    spin(50 * bmboot::getBuiltinTimerFrequency() / 1'000'000);
+}
+
+static void spin(uint64_t ticks)
+{
+    auto end = bmboot::getBuiltinTimerValue() + ticks;
+
+    while (bmboot::getBuiltinTimerValue() < end)
+    {
+    }
+}
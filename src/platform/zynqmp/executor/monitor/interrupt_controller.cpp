@@ -75,6 +75,22 @@ static void enableIpiReception(IpiChannel src_channel, IpiChannel dst_channel)
 
 // ************************************************************
 
+void bmboot::platform::enableProfilerTimerInterrupt()
+{
+    // Below the IPI, so that the manager can always get through to the monitor
+    configurePrivatePeripheralInterrupt(zynqmp::scugic::CNTPS_INTERRUPT_ID,
+                                        InterruptGroup::group0_fiq_el3,
+                                        MonitorInterruptPriority::m6);
+    enableInterrupt(zynqmp::scugic::CNTPS_INTERRUPT_ID);
+}
+
+void bmboot::platform::disableProfilerTimerInterrupt()
+{
+    disableInterrupt(zynqmp::scugic::CNTPS_INTERRUPT_ID);
+}
+
+// ************************************************************
+
 void bmboot::platform::flushICache() {
     // Adapted from Xil_ICacheInvalidate in BSP lib/bsp/standalone/src/arm/ARMv8/64bit/xil_cache.c
     // This code seems rather weird -- compare with __asm_invalidate_icache_all in U-Boot arch/arm/cpu/armv8/cache.S
@@ -159,7 +175,15 @@ void bmboot::platform::enableInterrupt(int interrupt_id)
     // We don't know what happened in the past, a previous payload might have been terminated during the handling this
     // interrupt, in which case the interrupt would remain in an Active state in the GIC.
 
-    GICD->clearPending(interrupt_id);
+    if (interrupt_id < gicv2::GICD::NUM_SGIS)
+    {
+        GICD->clearPendingSgi(interrupt_id);
+    }
+    else
+    {
+        GICD->clearPending(interrupt_id);
+    }
+
     GICD->clearActive(interrupt_id);
     GICD->setEnable(interrupt_id);
 }
@@ -182,6 +206,14 @@ void bmboot::platform::teardownEl1Interrupts()
         {
             disableInterrupt(int_id);
 
+            // SGIs cannot be disabled on the GIC-400; instead, make sure that nothing generated by the previous
+            // payload is left pending
+            if (int_id < gicv2::GICD::NUM_SGIS)
+            {
+                GICD->clearPendingSgi(int_id);
+                GICD->clearActive(int_id);
+            }
+
             interrupt_routed_to_el1[int_id - GIC_MIN_USER_INTERRUPT_ID] = false;
         }
     }
@@ -18,13 +18,26 @@ using namespace zynqmp::scugic;
 
 // ************************************************************
 
-extern "C" void FIQInterrupt(void)
+extern "C" void FIQInterrupt(FiqFrame const& frame)
 {
+    MonitorTimeScope time_scope;
+
     auto iar = GICC->IAR;
     auto interrupt_id = (iar & arm::gicv2::GICC::IAR_INTERRUPT_ID_MASK);
 
     auto my_ipi = getIpiChannelForCpu(getCpuIndex());
 
+    if (interrupt_id == CNTPS_INTERRUPT_ID) {
+        handleProfilerTimer(frame);
+
+        GICC->EOIR = iar;
+        return;
+    }
+
+    // Profiler ticks are not logged, they would flush everything else out of the ring
+    logEvent(MonitorEventType::fiq, interrupt_id, frame.elr);
+    incrementCounter(getTelemetry().fiqs);
+
     if (interrupt_id == getInterruptIdForIpi(my_ipi)) {
         auto ipi = ipipsu::getIpi(my_ipi);
 
@@ -37,10 +50,29 @@ extern "C" void FIQInterrupt(void)
 
         // IRQ triggered by APU?
         if (source_mask & getIpiPeerMask(internal::IPI_SRC_BMBOOT_MANAGER)) {
+            auto message = (uint32_t const volatile*) ipipsu::getIpiMessageBufferAddress(my_ipi);
+
+            logEvent(MonitorEventType::ipi_request, message[0], message[1]);
+            incrementCounter(getTelemetry().ipi_requests);
+
+            if (message[0] == IPI_REQ_PROFILER) {
+                configureProfiler(message[1]);
+                return;
+            }
+
             platform::teardownEl1Interrupts();
 
-            // reset monitor by jumping to entry point
-            _boot();
+            // Neither of the paths below returns, so the destructor would never run
+            time_scope.finish();
+
+            if (message[0] == IPI_REQ_RESTART) {
+                // reset monitor by jumping to entry point
+                _boot();
+            }
+
+            // Back to the command loop, skipping the boot code (cache invalidation, MMU and GIC set-up). On
+            // IPI_REQ_SWAP, the monitor finds the next payload's start_payload command already waiting.
+            returnToMonitor();
         }
     }
 
@@ -75,6 +107,7 @@ extern "C" void SynchronousInterrupt(Aarch64_Regs& saved_regs)
 
     if (ec == EC_SMC)
     {
+        MonitorTimeScope time_scope;
         handleSmc(saved_regs);
         return;
     }
@@ -44,11 +44,21 @@ extern "C" void IRQInterrupt(void)
         // https://github.com/Xilinx/embeddedsw/blob/8fca1ac929453ba06613b5417141483b4c2d8cf3/lib/bsp/standalone/src/arm/common/xil_exception.h#L371
         uint64_t spsr = readSysReg(SPSR_EL1);
         uint64_t elr = readSysReg(ELR_EL1);
+
+        // Bookkeeping for the tracer
+        auto preempted_priority = running_irq_priority;
+        running_irq_priority = user_interrupt_priorities[interrupt_id - GIC_MIN_USER_INTERRUPT_ID];
+        irq_nesting_level++;
+
+        incrementCounter(getIpcBlock().telemetry.irqs[interrupt_id - GIC_MIN_USER_INTERRUPT_ID]);
+
         writeSysReg(DAIF, readSysReg(DAIF) & ~DAIF_I_MASK);
 
         user_interrupt_handlers[interrupt_id - GIC_MIN_USER_INTERRUPT_ID]();
 
         writeSysReg(DAIF, readSysReg(DAIF) | DAIF_I_MASK);              // mask IRQs again
+        irq_nesting_level--;
+        running_irq_priority = preempted_priority;
         writeSysReg(SPSR_EL1, spsr);
         writeSysReg(ELR_EL1, elr);
 
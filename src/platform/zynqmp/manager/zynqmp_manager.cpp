@@ -78,50 +78,14 @@ std::optional<ErrorCode> zynqmp::bootCore(int devmem_fd, DomainIndex domain_inde
 // ************************************************************
 
 std::optional<ErrorCode> zynqmp::sendIpiMessage(int devmem_fd, DomainIndex domain_index, std::span<const uint8_t> message) {
-    off_t message_buffer_base;
-
-    // Mapping of IPI channels to base addresses can be found in UG1085, Table 13-3: IPI Channel and Message Buffer Default Associations
-
-    switch (internal::getIpiChannelForCpu(getCpuIndex(domain_index)))
-    {
-        case IpiChannel::ch0:
-            message_buffer_base = 0xFF99'0400;
-            break;
-
-        case IpiChannel::ch1:
-            message_buffer_base = 0xFF99'0000;
-            break;
-
-        case IpiChannel::ch2:
-            message_buffer_base = 0xFF99'0200;
-            break;
-
-        case IpiChannel::ch7:
-            message_buffer_base = 0xFF99'0600;
-            break;
-
-        case IpiChannel::ch8:
-            message_buffer_base = 0xFF99'0800;
-            break;
-
-        case IpiChannel::ch9:
-            message_buffer_base = 0xFF99'0A00;
-            break;
-
-        case IpiChannel::ch10:
-            message_buffer_base = 0xFF99'0C00;
-            break;
-
-        default:
-            return ErrorCode::hw_resource_unavailable;
-    }
+    off_t message_buffer_base = getIpiMessageBufferAddress(internal::getIpiChannelForCpu(getCpuIndex(domain_index)));
 
     off_t irq_base = getIpiBaseAddress(internal::IPI_SRC_BMBOOT_MANAGER);
 
     Mmap base_0xFF990000(nullptr, 0x1000, PROT_READ | PROT_WRITE, MAP_SHARED, devmem_fd, 0xFF990000);
     Mmap irq_mmap(nullptr, 0x1000, PROT_READ | PROT_WRITE, MAP_SHARED, devmem_fd, irq_base);
 
-    uint32_t message_mirror[BUF_SIZE / 4];
+    uint32_t message_mirror[BUF_SIZE / 4] {};
     memcpy(message_mirror, message.data(), std::min<size_t>(message.size(), BUF_SIZE));
 
     // must be done with 32-bit access; memcpy will crash
@@ -57,6 +57,23 @@ namespace zynqmp
             }
         }
 
+        // The manager places messages for a channel at the start of its message buffer, where the receiving monitor
+        // picks them up. Mapping of IPI channels to base addresses can be found in UG1085, Table 13-3: IPI Channel
+        // and Message Buffer Default Associations
+        inline uintptr_t getIpiMessageBufferAddress(IpiChannel ipi_channel)
+        {
+            switch (ipi_channel)
+            {
+                case IpiChannel::ch0:   return 0xFF99'0400;
+                case IpiChannel::ch1:   return 0xFF99'0000;
+                case IpiChannel::ch2:   return 0xFF99'0200;
+                case IpiChannel::ch7:   return 0xFF99'0600;
+                case IpiChannel::ch8:   return 0xFF99'0800;
+                case IpiChannel::ch9:   return 0xFF99'0A00;
+                case IpiChannel::ch10:  return 0xFF99'0C00;
+            }
+        }
+
         inline auto getIpi(IpiChannel ipi_channel)
         {
             return (zynqmp::ipipsu::IPIPSU*) getIpiBaseAddress(ipi_channel);
@@ -86,8 +103,13 @@ namespace zynqmp
         constexpr inline uintptr_t CPU_BASEADDR = 0xF9020000U;
 
         // UG1085, Table 13-4: APU Private Peripheral Interrupts
+        constexpr inline int CNTV_INTERRUPT_ID = 27;
+        constexpr inline int CNTPS_INTERRUPT_ID = 29;
         constexpr inline int CNTPNS_INTERRUPT_ID = 30;
 
+        // UG1085, Table 13-1: System Interrupts (APU_PMU0..3, one per core; level-sensitive)
+        constexpr inline int APU_PMU0_INTERRUPT_ID = 175;
+
         inline auto GICD = (arm::gicv2::GICD*) DIST_BASEADDR;
 
         inline auto GICC = (arm::gicv2::GICC*) CPU_BASEADDR;
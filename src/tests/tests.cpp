@@ -1,8 +1,13 @@
+#include "bmboot/clock_sync.hpp"
 #include "bmboot/domain.hpp"
+#include "bmboot/parameter_block.hpp"
+#include "bmboot/snapshot_channel.hpp"
+#include "bmboot/synchronized_start.hpp"
 #include "../utility/crc32.hpp"
 
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <fstream>
 #include <stdexcept>
 #include <thread>
@@ -15,8 +20,12 @@ struct BmbootFixture : public ::testing::Test
 {
     void SetUp() override
     {
-        auto which_domain = bmboot::DomainIndex::cpu1;
+        this->domain = open_ready_domain(bmboot::DomainIndex::cpu1);
+    }
 
+    // Open a domain, and boot it or terminate its payload as needed to get it to monitor_ready
+    static std::unique_ptr<IDomain> open_ready_domain(DomainIndex which_domain)
+    {
         auto maybe_domain = IDomain::open(which_domain);
 
         if (!std::holds_alternative<std::unique_ptr<IDomain>>(maybe_domain))
@@ -24,7 +33,7 @@ struct BmbootFixture : public ::testing::Test
             throw std::runtime_error("IDomain::open: error: " + toString(std::get<bmboot::ErrorCode>(maybe_domain)));
         }
 
-        this->domain = std::move(std::get<std::unique_ptr<IDomain>>(maybe_domain));
+        auto domain = std::move(std::get<std::unique_ptr<IDomain>>(maybe_domain));
 
         auto state = domain->getState();
 
@@ -57,6 +66,8 @@ struct BmbootFixture : public ::testing::Test
         {
             throw std::runtime_error("ensure_monitor_ready: bad state " + toString(state));
         }
+
+        return domain;
     }
 
     void TearDown() override
@@ -95,7 +106,7 @@ struct BmbootFixture : public ::testing::Test
         return output_stream.str();
     }
 
-    void execute_payload(const char* filename) const
+    static std::vector<uint8_t> read_payload(const char* filename)
     {
         std::ifstream file(filename, std::ios::binary);
 
@@ -104,11 +115,24 @@ struct BmbootFixture : public ::testing::Test
             throw std::runtime_error((std::string) "failed to open " + filename);
         }
 
-        std::vector<uint8_t> program((std::istreambuf_iterator<char>(file)),
-                                     std::istreambuf_iterator<char>());
+        return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)),
+                                    std::istreambuf_iterator<char>());
+    }
+
+    void execute_payload(const char* filename, uintptr_t argument = 0) const
+    {
+        auto program = read_payload(filename);
 
         auto crc = crc32(0, program.data(), program.size());
-        throw_for_err(domain->loadAndStartPayload(program, crc, 0));
+        throw_for_err(domain->loadAndStartPayload(program, crc, argument));
+    }
+
+    void preload_payload(const char* filename) const
+    {
+        auto program = read_payload(filename);
+
+        auto crc = crc32(0, program.data(), program.size());
+        throw_for_err(domain->preloadPayload(program, crc, 0));
     }
 
     std::unique_ptr<IDomain> domain;
@@ -173,3 +197,352 @@ TEST_F(BmbootFixture, access_violation)
     state = domain->getState();
     ASSERT_EQ(state, DomainState::running_payload);
 }
+
+TEST_F(BmbootFixture, hot_swap)
+{
+    // synopsis of test:
+    // 1. load payload_hello_world into slot a
+    // 2. preload its slot b build while it runs, and swap
+    // 3. assert that the new payload runs from slot b
+    // 4. swap back to slot a
+
+    execute_payload("payload_hello_world_cpu1.bin");
+    ASSERT_EQ(domain->getActivePayloadSlot(), PayloadSlot::a);
+
+    // nothing preloaded yet
+    ASSERT_EQ(domain->swapPayload(), ErrorCode::bad_domain_state);
+
+    preload_payload("payload_hello_world_cpu1_b.bin");
+    ASSERT_EQ(domain->getState(), DomainState::running_payload);
+
+    throw_for_err(domain->swapPayload());
+    ASSERT_EQ(domain->getState(), DomainState::running_payload);
+    ASSERT_EQ(domain->getActivePayloadSlot(), PayloadSlot::b);
+
+    preload_payload("payload_hello_world_cpu1.bin");
+    throw_for_err(domain->swapPayload());
+    ASSERT_EQ(domain->getState(), DomainState::running_payload);
+    ASSERT_EQ(domain->getActivePayloadSlot(), PayloadSlot::a);
+}
+
+// Host-only stress test of the sequence lock: one writer and several readers hammer the same block, and the readers
+// check that they never see a mixture of two updates.
+TEST(ParameterBlock, no_torn_reads)
+{
+    struct Parameters
+    {
+        uint64_t values[13];
+        uint32_t last;
+    };
+
+    constexpr int NUM_READERS = 3;
+    constexpr uint64_t NUM_UPDATES = 2'000'000;
+
+    auto fill = [](uint64_t generation)
+    {
+        Parameters parameters;
+
+        for (auto& value : parameters.values)
+        {
+            value = generation;
+        }
+
+        parameters.last = (uint32_t) generation;
+        return parameters;
+    };
+
+    auto block = std::make_unique<ParameterBlock<Parameters, 1>>();
+    block->initialize(fill(0));
+    ASSERT_TRUE(block->isCompatible());
+    static_assert(ParameterBlock<Parameters, 1>::LAYOUT != ParameterBlock<Parameters, 2>::LAYOUT);
+
+    std::atomic<bool> done = false;
+    std::atomic<uint64_t> num_torn = 0, num_failed = 0, num_read = 0;
+
+    std::vector<std::thread> readers;
+
+    for (int i = 0; i < NUM_READERS; i++)
+    {
+        readers.emplace_back([&]
+        {
+            uint64_t previous_generation = 0;
+
+            while (!done)
+            {
+                Parameters parameters;
+
+                if (!block->readConsistent(parameters))
+                {
+                    num_failed++;
+                    continue;
+                }
+
+                auto generation = parameters.values[0];
+
+                for (auto value : parameters.values)
+                {
+                    if (value != generation)
+                    {
+                        num_torn++;
+                    }
+                }
+
+                if (parameters.last != (uint32_t) generation || generation < previous_generation)
+                {
+                    num_torn++;
+                }
+
+                previous_generation = generation;
+                num_read++;
+            }
+        });
+    }
+
+    for (uint64_t generation = 1; generation <= NUM_UPDATES; generation++)
+    {
+        block->write(fill(generation));
+    }
+
+    done = true;
+
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    Parameters final_parameters;
+    ASSERT_TRUE(block->readConsistent(final_parameters));
+    EXPECT_EQ(final_parameters.values[0], NUM_UPDATES);
+
+    EXPECT_EQ(num_torn, 0);
+    EXPECT_GT(num_read, 0);
+
+    printf("%lu consistent reads, %lu gave up\n", num_read.load(), num_failed.load());
+}
+
+// Host-only check of the clock fit: starting from a nominal frequency which is far off, the measured frequency must
+// converge on the actual rate of the counter, and a fresh counter reading must convert to (nearly) the current time.
+TEST(ClockSync, fit_and_round_trip)
+{
+    // Well below any real counter rate (on a PC, readCounter ticks in nanoseconds), so that the fit kicks in early
+    constexpr uint32_t NOMINAL_FREQUENCY_HZ = 1'000'000;
+    constexpr int NUM_SAMPLES = 30;
+
+    ClockSync clock_sync(NOMINAL_FREQUENCY_HZ);
+
+    clock_sync.sample();
+    EXPECT_EQ(clock_sync.getFrequency(), NOMINAL_FREQUENCY_HZ);
+
+    auto first_counter = ClockSync::readCounter();
+    auto first_time = std::chrono::steady_clock::now();
+
+    for (int i = 1; i < NUM_SAMPLES; i++)
+    {
+        std::this_thread::sleep_for(50ms);
+        clock_sync.sample();
+    }
+
+    auto last_counter = ClockSync::readCounter();
+    auto last_time = std::chrono::steady_clock::now();
+
+    double actual_frequency = (double)(last_counter - first_counter) /
+                              std::chrono::duration<double>(last_time - first_time).count();
+
+    EXPECT_NEAR(clock_sync.getFrequency(), actual_frequency, actual_frequency * 1e-3);
+    EXPECT_NEAR(clock_sync.toSeconds((int64_t) actual_frequency), 1.0, 1e-3);
+
+    auto counter = ClockSync::readCounter();
+    auto now = std::chrono::steady_clock::now();
+    auto error = clock_sync.toMonotonic(counter) - now;
+
+    EXPECT_LT(std::chrono::abs(error), 1ms);
+
+    printf("frequency %.0f Hz (actual %.0f Hz), round-trip error %ld ns\n", clock_sync.getFrequency(),
+           actual_frequency, (long) std::chrono::duration_cast<std::chrono::nanoseconds>(error).count());
+}
+
+// Host-only stress test of the triple buffer: the reader must always get a complete snapshot, and never an older one
+// than before.
+TEST(SnapshotChannel, latest_complete_snapshot)
+{
+    struct Snapshot
+    {
+        uint64_t signals[512];
+    };
+
+    constexpr uint64_t NUM_SNAPSHOTS = 200'000;
+
+    auto channel = std::make_unique<SnapshotChannel<Snapshot>>();
+    channel->initialize();
+
+    uint64_t sequence;
+    ASSERT_EQ(channel->acquireLatest(sequence), -1);
+
+    std::atomic<bool> done = false;
+
+    std::thread writer([&]
+    {
+        for (uint64_t generation = 1; generation <= NUM_SNAPSHOTS; generation++)
+        {
+            auto& snapshot = channel->getWriteBuffer();
+
+            for (auto& signal : snapshot.signals)
+            {
+                internal::sharedStore(signal, generation);
+            }
+
+            channel->publish();
+        }
+
+        done = true;
+    });
+
+    uint64_t num_torn = 0, num_read = 0, previous_sequence = 0;
+
+    while (!done)
+    {
+        auto index = channel->acquireLatest(sequence);
+
+        if (index < 0)
+        {
+            continue;
+        }
+
+        auto const& snapshot = channel->buffers[index];
+
+        for (auto const& signal : snapshot.signals)
+        {
+            if (internal::sharedLoad(signal) != sequence)
+            {
+                num_torn++;
+            }
+        }
+
+        if (sequence < previous_sequence)
+        {
+            num_torn++;
+        }
+
+        previous_sequence = sequence;
+        num_read++;
+    }
+
+    writer.join();
+
+    ASSERT_GE(channel->acquireLatest(sequence), 0);
+    EXPECT_EQ(sequence, NUM_SNAPSHOTS);
+    EXPECT_EQ(num_torn, 0);
+
+    printf("%lu snapshots read\n", num_read);
+}
+
+TEST_F(BmbootFixture, terminate_and_restart)
+{
+    // synopsis of test:
+    // 1. terminate a running payload, both with and without a full restart of the monitor
+    // 2. assert that the monitor comes back each time, and that a payload can be started again
+    // 3. assert that the full restart has recorded its boot timing
+
+    execute_payload("payload_hello_world_cpu1.bin");
+    throw_for_err(domain->terminatePayload());
+    ASSERT_EQ(domain->getState(), DomainState::monitor_ready);
+
+    execute_payload("payload_hello_world_cpu1.bin");
+    throw_for_err(domain->restartMonitor());
+    ASSERT_EQ(domain->getState(), DomainState::monitor_ready);
+
+    // the full restart has gone through all boot checkpoints, in order
+    auto timing = domain->getBootTiming();
+    ASSERT_TRUE(timing.has_value());
+    EXPECT_EQ(timing->reset_released, 0);
+    EXPECT_GT(timing->entry, 0);
+    EXPECT_LE(timing->entry, timing->caches_invalidated);
+    EXPECT_LE(timing->caches_invalidated, timing->mmu_enabled);
+    EXPECT_LE(timing->mmu_enabled, timing->main_entered);
+    EXPECT_LE(timing->main_entered, timing->interrupts_set_up);
+    EXPECT_LE(timing->interrupts_set_up, timing->ready);
+
+    execute_payload("payload_hello_world_cpu1.bin");
+    ASSERT_EQ(domain->getState(), DomainState::running_payload);
+}
+
+TEST_F(BmbootFixture, terminate_with_dirty_caches)
+{
+    // synopsis of test:
+    // 1. start payload_data_integrity, having it overwrite its initialized data continuously
+    // 2. terminate it while the overwritten data is still dirty in the caches
+    // 3. load a fresh copy of payload_data_integrity, checking its initialized data only
+    // 4. assert that it runs, i.e. that no stale line of the terminated payload has been written back over the image
+
+    execute_payload("payload_data_integrity_cpu1.bin", 1);
+    std::this_thread::sleep_for(50ms);
+    ASSERT_EQ(domain->getState(), DomainState::running_payload);
+    throw_for_err(domain->terminatePayload());
+
+    execute_payload("payload_data_integrity_cpu1.bin");
+    std::this_thread::sleep_for(50ms);
+    ASSERT_EQ(domain->getState(), DomainState::running_payload);
+}
+
+TEST_F(BmbootFixture, timed_start)
+{
+    // synopsis of test:
+    // 1. arm a payload with a start time 100 ms in the future
+    // 2. assert that it is not entered before the start time, and is entered shortly after
+    // 3. arm it with a start time already in the past and assert that it is refused
+
+    auto program = read_payload("payload_hello_world_cpu1.bin");
+    auto crc = crc32(0, program.data(), program.size());
+    auto cntfrq = domain->getTimerFrequency();
+
+    auto start_time = ClockSync::readCounter() + cntfrq / 10;
+    throw_for_err(domain->loadAndArmPayload(program, crc, 0, start_time));
+    ASSERT_EQ(domain->getState(), DomainState::starting_payload);
+
+    throw_for_err(domain->awaitPayloadStart());
+    ASSERT_EQ(domain->getState(), DomainState::running_payload);
+
+    auto entered = domain->getPayloadStartTimestamp();
+    EXPECT_GE(entered, start_time);
+    EXPECT_LT(entered, start_time + cntfrq / 10'000);        // within 100 us
+
+    throw_for_err(domain->terminatePayload());
+
+    auto err = domain->loadAndArmPayload(program, crc, 0, ClockSync::readCounter());
+    ASSERT_EQ(err, ErrorCode::payload_start_time_passed);
+    EXPECT_EQ(domain->getPayloadStartTimestamp(), entered);
+}
+
+TEST_F(BmbootFixture, smp_payload)
+{
+    // synopsis of test:
+    // 1. bring cpu2 and cpu3 to monitor_ready as well
+    // 2. start payload_smp_scaling_smp on all three
+    // 3. assert that it is running on all three (cpu2 and cpu3 only report so once cpu1 has released them)
+    // 4. terminate it on all three
+
+    std::unique_ptr<IDomain> others[] { open_ready_domain(DomainIndex::cpu2), open_ready_domain(DomainIndex::cpu3) };
+    IDomain* other_domains[] { others[0].get(), others[1].get() };
+
+    auto program = read_payload("payload_smp_scaling_smp.bin");
+    auto crc = crc32(0, program.data(), program.size());
+
+    auto start_time = startSmpPayload({ .domain = domain.get(), .payload_binary = program, .payload_crc32 = crc },
+                                      other_domains, 100ms);
+    ASSERT_TRUE(std::holds_alternative<uint64_t>(start_time));
+
+    ASSERT_EQ(domain->getState(), DomainState::running_payload);
+
+    for (auto other : other_domains)
+    {
+        ASSERT_EQ(other->getState(), DomainState::running_payload);
+        EXPECT_GE(other->getPayloadStartTimestamp(), std::get<uint64_t>(start_time));
+    }
+
+    throw_for_err(domain->terminatePayload());
+
+    for (auto other : other_domains)
+    {
+        throw_for_err(other->terminatePayload());
+    }
+}
@@ -2,11 +2,27 @@
 //! @brief  bmctl utility
 //! @author Martin Cejp
 
+#include "bmboot/call_trace.hpp"
+#include "bmboot/chrome_trace.hpp"
+#include "bmboot/clock_sync.hpp"
 #include "bmboot/domain.hpp"
 #include "bmboot/domain_helpers.hpp"
-
+#include "bmboot/elf_symbolizer.hpp"
+#include "bmboot/host_file_server.hpp"
+#include "bmboot/stream_recorder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <csignal>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <map>
+#include <set>
+#include <string_view>
+#include <thread>
 
 using namespace bmboot;
 
@@ -14,13 +30,21 @@ using namespace bmboot;
 
 static int usage()
 {
-    fprintf(stderr, "usage: bmctl boot <domain>\n");
+    fprintf(stderr, "usage: bmctl boot <domain> [--timing]\n");
+    fprintf(stderr, "usage: bmctl calltrace <domain> <elf>\n");
     fprintf(stderr, "usage: bmctl core <domain>\n");
     fprintf(stderr, "usage: bmctl debuginfo <domain>\n");
-    fprintf(stderr, "usage: bmctl run <domain> <payload>\n");
+    fprintf(stderr, "usage: bmctl profile <domain> <seconds> <elf> [--rate <Hz>] [--folded <file>]\n");
+    fprintf(stderr, "usage: bmctl record <domain> <path_prefix> [--duration <seconds>] [--file-size <MiB>] [--direct]\n");
+    fprintf(stderr, "usage: bmctl run <domain> <payload> [--files <directory>]\n");
     fprintf(stderr, "usage: bmctl start <domain> <payload>\n");
+    fprintf(stderr, "usage: bmctl start cpu1,cpu2,cpu3 <payload_smp>\n");
+    fprintf(stderr, "usage: bmctl stats <domain> [--watch]\n");
     fprintf(stderr, "usage: bmctl status <domain>\n");
-    fprintf(stderr, "usage: bmctl terminate <domain>\n");
+    fprintf(stderr, "usage: bmctl swap <domain> <payload> <payload_b>\n");
+    fprintf(stderr, "usage: bmctl terminate <domain> [--restart]\n");
+    fprintf(stderr, "usage: bmctl timeline <domain>[,<domain>...] <seconds> <output.json>\n");
+    fprintf(stderr, "usage: bmctl trace <domain>\n");
     return -1;
 }
 
@@ -42,6 +66,692 @@ static void display_domain_state(IDomain& domain)
 
 // ************************************************************
 
+static void printBootTiming(IDomain& domain)
+{
+    auto timing = domain.getBootTiming();
+    auto cntfrq = domain.getTimerFrequency();
+
+    if (!timing.has_value() || cntfrq == 0)
+    {
+        printf("no boot timing available\n");
+        return;
+    }
+
+    std::pair<char const*, uint64_t> const checkpoints[] {
+        { "reset released", timing->reset_released },
+        { "monitor entry", timing->entry },
+        { "caches invalidated", timing->caches_invalidated },
+        { "MMU enabled", timing->mmu_enabled },
+        { "main entered", timing->main_entered },
+        { "interrupts set up", timing->interrupts_set_up },
+        { "monitor ready", timing->ready },
+        { "ready observed", timing->ready_observed },
+    };
+
+    auto to_us = [=](uint64_t ticks) { return (double) ticks / cntfrq * 1e6; };
+
+    printf("%-20s %12s %12s\n", "checkpoint", "time (us)", "phase (us)");
+
+    uint64_t start = 0, previous = 0;
+
+    for (auto [name, timestamp] : checkpoints)
+    {
+        if (timestamp == 0)
+        {
+            // Not reached, or a manager timestamp of a restartMonitor boot
+            printf("%-20s %12s %12s\n", name, "-", "-");
+            continue;
+        }
+
+        if (start == 0)
+        {
+            start = previous = timestamp;
+        }
+
+        printf("%-20s %12.1f %12.1f\n", name, to_us(timestamp - start), to_us(timestamp - previous));
+        previous = timestamp;
+    }
+}
+
+// ************************************************************
+
+static int calltrace(IDomain& domain, int argc, char** argv)
+{
+    // bmctl calltrace <domain> <elf>
+    if (argc != 4)
+    {
+        return usage();
+    }
+
+    auto elf_filename = argv[3];
+    auto symbolizer = ElfSymbolizer::load(elf_filename);
+
+    if (!symbolizer.has_value())
+    {
+        fprintf(stderr, "bmctl: failed to load symbols from '%s'\n", elf_filename);
+        return -1;
+    }
+
+    std::vector<CallTraceRecord> records;
+    auto err = readCallTrace(domain, *symbolizer, records);
+
+    if (err == ErrorCode::invalid_argument)
+    {
+        fprintf(stderr, "bmctl: '%s' is not built with INSTRUMENT_FUNCTIONS\n", elf_filename);
+        return -1;
+    }
+    else if (err.has_value())
+    {
+        fprintf(stderr, "readCallTrace: error: %s\n", toString(*err).c_str());
+        return -1;
+    }
+
+    printCallTrace(stdout, records, *symbolizer, domain.getTimerFrequency());
+    return 0;
+}
+
+// ************************************************************
+
+static int profile(IDomain& domain, int argc, char** argv)
+{
+    // bmctl profile <domain> <seconds> <elf> [--rate <Hz>] [--folded <file>]
+    if (argc < 5)
+    {
+        return usage();
+    }
+
+    double duration_s = atof(argv[3]);
+    auto elf_filename = argv[4];
+    int rate_hz = 1000;
+    char const* folded_filename = nullptr;
+
+    for (int i = 5; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+        {
+            rate_hz = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--folded") == 0 && i + 1 < argc)
+        {
+            folded_filename = argv[++i];
+        }
+        else
+        {
+            return usage();
+        }
+    }
+
+    auto symbolizer = ElfSymbolizer::load(elf_filename);
+
+    if (!symbolizer.has_value())
+    {
+        fprintf(stderr, "bmctl: failed to load symbols from '%s'\n", elf_filename);
+        return -1;
+    }
+
+    if (domain.getState() != DomainState::running_payload)
+    {
+        fprintf(stderr, "cannot profile: domain state %s != runningPayload\n", toString(domain.getState()).c_str());
+        return -1;
+    }
+
+    throwOnError(domain.startProfiler(rate_hz), "IDomain::startProfiler");
+
+    // Drain the ring often enough that it does not overflow even at the highest rate
+    std::vector<ProfileSample> samples;
+    uint64_t num_lost = 0;
+
+    auto end_time = std::chrono::steady_clock::now() + std::chrono::duration<double>(duration_s);
+
+    while (std::chrono::steady_clock::now() < end_time)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        num_lost += domain.readProfileSamples(samples);
+    }
+
+    auto status = domain.getProfilerStatus();
+    throwOnError(domain.stopProfiler(), "IDomain::stopProfiler");
+    num_lost += domain.readProfileSamples(samples);
+
+    if (samples.empty())
+    {
+        fprintf(stderr, "bmctl: no samples collected\n");
+        return -1;
+    }
+
+    // Return addresses point after the call instruction; look up the call itself
+    auto symbolize_pc = [&](uintptr_t pc) { return (pc == 0) ? std::string("[monitor]") : symbolizer->symbolize(pc); };
+    auto symbolize_caller = [&](uintptr_t ra) { return symbolizer->symbolize(ra - 4); };
+
+    std::map<std::string, uint64_t> self_counts, total_counts;
+    std::map<std::string, uint64_t> folded_stacks;
+
+    for (auto const& sample : samples)
+    {
+        auto function = symbolize_pc(sample.pc);
+        self_counts[function]++;
+
+        // count each function at most once per sample, even if recursive
+        std::set<std::string> on_stack { function };
+        std::string stack = function;
+
+        for (auto ra : sample.callers)
+        {
+            auto caller = symbolize_caller(ra);
+            on_stack.insert(caller);
+            stack = caller + ";" + stack;
+        }
+
+        for (auto const& name : on_stack)
+        {
+            total_counts[name]++;
+        }
+
+        folded_stacks[stack]++;
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> by_self(self_counts.begin(), self_counts.end());
+    std::sort(by_self.begin(), by_self.end(), [](auto const& a, auto const& b) { return a.second > b.second; });
+
+    printf("%zu samples at %d Hz, %" PRIu64 " lost, overhead %.2f%% (%.2f us/sample)\n\n",
+           samples.size(), rate_hz, num_lost,
+           status.time_per_sample_us * rate_hz / 1e4, status.time_per_sample_us);
+    printf("  self%%  total%%  function\n");
+
+    for (auto const& [name, self] : by_self)
+    {
+        printf("%6.2f  %6.2f  %s\n",
+               100.0 * self / samples.size(),
+               100.0 * total_counts[name] / samples.size(),
+               name.c_str());
+    }
+
+    if (folded_filename != nullptr)
+    {
+        auto file = fopen(folded_filename, "wt");
+
+        if (file == nullptr)
+        {
+            perror(folded_filename);
+            return -1;
+        }
+
+        for (auto const& [stack, count] : folded_stacks)
+        {
+            fprintf(file, "%s %" PRIu64 "\n", stack.c_str(), count);
+        }
+
+        fclose(file);
+    }
+
+    return 0;
+}
+
+// ************************************************************
+
+static volatile sig_atomic_t record_interrupted = false;
+
+static int record(IDomain& domain, int argc, char** argv)
+{
+    // bmctl record <domain> <path_prefix> [--duration <seconds>] [--file-size <MiB>] [--direct]
+    if (argc < 4)
+    {
+        return usage();
+    }
+
+    StreamRecorderOptions options;
+    options.path_prefix = argv[3];
+    double duration_s = 0;
+
+    for (int i = 4; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc)
+        {
+            duration_s = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--file-size") == 0 && i + 1 < argc)
+        {
+            options.max_file_size = strtoull(argv[++i], nullptr, 0) * 1024 * 1024;
+        }
+        else if (strcmp(argv[i], "--direct") == 0)
+        {
+            options.direct_io = true;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+
+    // Stop cleanly on Ctrl+C, so that the tail of the stream is written out
+    struct sigaction sa {};
+    sa.sa_handler = [](int signal) { record_interrupted = true; };
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+
+    auto recorder = StreamRecorder::start(domain, options);
+
+    if (std::holds_alternative<ErrorCode>(recorder))
+    {
+        fprintf(stderr, "StreamRecorder::start: error: %s\n", toString(std::get<ErrorCode>(recorder)).c_str());
+        return -1;
+    }
+
+    auto& the_recorder = *std::get<std::unique_ptr<StreamRecorder>>(recorder);
+
+    auto start_time = std::chrono::steady_clock::now();
+    auto last_time = start_time;
+    uint64_t last_bytes = 0;
+
+    while (!record_interrupted)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        auto now = std::chrono::steady_clock::now();
+        auto stats = the_recorder.getStatistics();
+
+        if (stats.write_error)
+        {
+            break;
+        }
+
+        double interval = std::chrono::duration<double>(now - last_time).count();
+
+        printf("%8.1f MB/s  %" PRIu64 " records dropped  ring %5.1f%% full (max %5.1f%%)\n",
+               (stats.bytes_recorded - last_bytes) / interval / 1e6,
+               stats.records_dropped,
+               stats.ring_capacity ? 100.0 * stats.ring_fill / stats.ring_capacity : 0.0,
+               stats.ring_capacity ? 100.0 * stats.max_ring_fill / stats.ring_capacity : 0.0);
+        fflush(stdout);
+
+        last_time = now;
+        last_bytes = stats.bytes_recorded;
+
+        if (duration_s > 0 && std::chrono::duration<double>(now - start_time).count() >= duration_s)
+        {
+            break;
+        }
+    }
+
+    the_recorder.stop();
+
+    auto stats = the_recorder.getStatistics();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    printf("recorded %" PRIu64 " bytes in %d file(s), %.1f MB/s sustained, %" PRIu64 " records dropped "
+           "in %u session(s)\n",
+           stats.bytes_recorded, stats.num_files, stats.bytes_recorded / elapsed / 1e6,
+           stats.records_dropped, stats.sessions);
+
+    return stats.write_error ? -1 : 0;
+}
+
+// ************************************************************
+
+// Open each domain of a comma-separated list
+static bool openDomainList(std::string_view domain_list, std::vector<std::unique_ptr<IDomain>>& domains)
+{
+    while (!domain_list.empty())
+    {
+        auto comma = domain_list.find(',');
+        auto name = domain_list.substr(0, comma);
+        auto domain_index = parseDomainIndex(name);
+
+        if (!domain_index.has_value())
+        {
+            fprintf(stderr, "bmctl: unknown domain '%.*s'\n", (int) name.size(), name.data());
+            return false;
+        }
+
+        domains.push_back(throwOnError(IDomain::open(*domain_index), "IDomain::open"));
+        domain_list = (comma == std::string_view::npos) ? std::string_view() : domain_list.substr(comma + 1);
+    }
+
+    return true;
+}
+
+// ************************************************************
+
+static int startSmp(int argc, char** argv)
+{
+    // bmctl start cpu1,<domain>[,<domain>] <payload>
+    if (argc != 4)
+    {
+        return usage();
+    }
+
+    std::vector<std::unique_ptr<IDomain>> domains;
+
+    if (!openDomainList(argv[2], domains))
+    {
+        return -1;
+    }
+
+    std::vector<IDomain*> other_domains;
+
+    for (auto& domain : domains)
+    {
+        auto state = domain->getState();
+
+        if (state != DomainState::monitor_ready)
+        {
+            fprintf(stderr, "cannot execute payload: domain %s state %s != monitorReady\n",
+                    toString(domain->getIndex()).c_str(), toString(state).c_str());
+            return -1;
+        }
+
+        if (domain != domains.front())
+        {
+            other_domains.push_back(domain.get());
+        }
+    }
+
+    // The payload runs from the memory of the first domain, which must be cpu1 (checked by startSmpPayload)
+    startSmpPayloadFromFileOrThrow(*domains.front(), other_domains, argv[3]);
+    return 0;
+}
+
+// ************************************************************
+
+static int timeline(int argc, char** argv)
+{
+    // bmctl timeline <domain>[,<domain>...] <seconds> <output.json>
+    if (argc != 5)
+    {
+        return usage();
+    }
+
+    std::vector<std::unique_ptr<IDomain>> domains;
+
+    if (!openDomainList(argv[2], domains))
+    {
+        return -1;
+    }
+
+    double duration_s = atof(argv[3]);
+    auto output_filename = argv[4];
+
+    auto file = fopen(output_filename, "wt");
+
+    if (file == nullptr)
+    {
+        perror(output_filename);
+        return -1;
+    }
+
+    ChromeTraceWriter writer(file);
+
+    // One process per domain, one thread per interrupt priority (tid 0 = main program)
+    std::set<std::pair<int, int>> named_tracks;
+
+    for (auto& domain : domains)
+    {
+        if (domain->getTimerFrequency() == 0)
+        {
+            fprintf(stderr, "bmctl: domain %s has not been started up\n", toString(domain->getIndex()).c_str());
+            return -1;
+        }
+
+        // Discard whatever has accumulated before we started
+        std::vector<TraceEvent> stale_events;
+        domain->readTraceEvents(stale_events);
+
+        writer.setProcessName(domain->getIndex() + 1, toString(domain->getIndex()));
+    }
+
+    uint64_t num_events = 0, num_lost = 0;
+    std::vector<TraceEvent> events;
+
+    auto end_time = std::chrono::steady_clock::now() + std::chrono::duration<double>(duration_s);
+
+    while (std::chrono::steady_clock::now() < end_time)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        for (auto& domain : domains)
+        {
+            int pid = domain->getIndex() + 1;
+            double us_per_tick = 1e6 / domain->getTimerFrequency();
+
+            events.clear();
+            num_lost += domain->readTraceEvents(events);
+            num_events += events.size();
+
+            for (auto const& event : events)
+            {
+                int tid = (event.nesting_level == 0) ? 0 : event.priority;
+
+                if (named_tracks.emplace(pid, tid).second)
+                {
+                    char track_name[32];
+                    snprintf(track_name, sizeof(track_name), tid == 0 ? "main" : "IRQ priority 0x%02X", tid);
+                    writer.setThreadName(pid, tid, track_name, tid);
+                }
+
+                if (event.begin)
+                {
+                    writer.addBeginEvent(pid, tid, event.timestamp * us_per_tick, event.name);
+                }
+                else
+                {
+                    writer.addEndEvent(pid, tid, event.timestamp * us_per_tick, event.name);
+                }
+            }
+        }
+    }
+
+    writer.finish();
+    fclose(file);
+
+    printf("%" PRIu64 " events written to %s, %" PRIu64 " lost\n", num_events, output_filename, num_lost);
+    return 0;
+}
+
+// ************************************************************
+
+static void printStatsLine(char const* name, uint64_t count, TelemetryRates const* rates, double rate)
+{
+    if (rates)
+    {
+        printf("  %-32s %14" PRIu64 " %14.1f/s\n", name, count, rate);
+    }
+    else
+    {
+        printf("  %-32s %14" PRIu64 "\n", name, count);
+    }
+}
+
+static void printStats(TelemetrySnapshot const& snapshot, TelemetryRates const* rates)
+{
+    printStatsLine("monitor starts", snapshot.monitor_starts, nullptr, 0);
+    printStatsLine("payload starts", snapshot.payload_starts, rates, rates ? rates->payload_starts : 0);
+    printStatsLine("payload crashes", snapshot.payload_crashes, rates, rates ? rates->payload_crashes : 0);
+
+    if (rates)
+    {
+        printf("  %-32s %14.6f %14.3f %%\n", "time in monitor [s]", snapshot.monitor_time_s, rates->monitor_load * 100);
+    }
+    else
+    {
+        printf("  %-32s %14.6f\n", "time in monitor [s]", snapshot.monitor_time_s);
+    }
+
+    printStatsLine("FIQs", snapshot.fiqs, rates, rates ? rates->fiqs : 0);
+    printStatsLine("IPI requests", snapshot.ipi_requests, rates, rates ? rates->ipi_requests : 0);
+    printStatsLine("stdout bytes written", snapshot.stdout_bytes_written, rates, rates ? rates->stdout_bytes_written : 0);
+    printStatsLine("stdout bytes dropped", snapshot.stdout_bytes_dropped, rates, rates ? rates->stdout_bytes_dropped : 0);
+
+    printf("secure monitor calls:\n");
+
+    for (auto const& [name, count] : snapshot.smc_calls)
+    {
+        printStatsLine(name.c_str(), count, rates, rates ? rates->smc_calls.at(name) : 0);
+    }
+
+    printf("payload interrupts:\n");
+
+    for (auto const& [interrupt_id, count] : snapshot.irqs)
+    {
+        auto name = "IRQ " + std::to_string(interrupt_id);
+        printStatsLine(name.c_str(), count, rates, rates ? rates->irqs.at(interrupt_id) : 0);
+    }
+}
+
+static int stats(IDomain& domain, int argc, char** argv)
+{
+    // bmctl stats <domain> [--watch]
+    bool watch = (argc == 4 && strcmp(argv[3], "--watch") == 0);
+
+    if (argc != 3 && !watch)
+    {
+        return usage();
+    }
+
+    auto snapshot = domain.getTelemetry();
+
+    if (!snapshot.has_value())
+    {
+        fprintf(stderr, "bmctl: no telemetry available (is the monitor running?)\n");
+        return -1;
+    }
+
+    if (!watch)
+    {
+        printStats(*snapshot, nullptr);
+        return 0;
+    }
+
+    // Until interrupted
+    for (;;)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        auto next_snapshot = domain.getTelemetry();
+
+        if (!next_snapshot.has_value())
+        {
+            fprintf(stderr, "bmctl: telemetry no longer available\n");
+            return -1;
+        }
+
+        auto rates = computeTelemetryRates(*snapshot, *next_snapshot);
+
+        printf("\n--- %s ---\n", toString(domain.getIndex()).c_str());
+        printStats(*next_snapshot, &rates);
+        fflush(stdout);
+
+        snapshot = next_snapshot;
+    }
+}
+
+// ************************************************************
+
+static int swap(IDomain& domain, int argc, char** argv)
+{
+    if (argc != 5)
+    {
+        return usage();
+    }
+
+    // Each slot needs its own build of the payload
+    auto inactive_slot = (domain.getActivePayloadSlot() == PayloadSlot::a) ? PayloadSlot::b : PayloadSlot::a;
+    auto payload_filename = (inactive_slot == PayloadSlot::a) ? argv[3] : argv[4];
+
+    preloadPayloadFromFileOrThrow(domain, payload_filename);
+
+    auto err = domain.swapPayload();
+
+    if (err.has_value())
+    {
+        fprintf(stderr, "IDomain::swapPayload: error: %s\n", toString(*err).c_str());
+        return -1;
+    }
+
+    // The monitor event log tells how long the core was without a payload: from the arrival of the request until
+    // the new payload reported that it is running
+    auto events = domain.getMonitorEvents();
+    auto cntfrq = domain.getTimerFrequency();
+
+    auto request = std::find_if(events.rbegin(), events.rend(), [](MonitorEvent const& event)
+    {
+        return event.type == MonitorEventType::ipi_request && event.description == "swap";
+    });
+
+    auto running = std::find_if(events.rbegin(), request, [](MonitorEvent const& event)
+    {
+        return event.type == MonitorEventType::state_changed && event.arg0 == DomainState::running_payload;
+    });
+
+    printf("%s: now running %s from slot %s\n",
+           toString(domain.getIndex()).c_str(),
+           payload_filename,
+           (inactive_slot == PayloadSlot::a) ? "a" : "b");
+
+    if (request != events.rend() && running != request && cntfrq != 0)
+    {
+        printf("payload downtime: %.1f us\n", (double) (running->timestamp - request->timestamp) / cntfrq * 1e6);
+    }
+
+    return 0;
+}
+
+// ************************************************************
+
+// HH:MM:SS.uuuuuu in local time
+static std::string formatTimeOfDay(std::chrono::system_clock::time_point time)
+{
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    time_t seconds = us / 1'000'000;
+
+    tm local;
+    localtime_r(&seconds, &local);
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d.%06d",
+             local.tm_hour, local.tm_min, local.tm_sec, (int)(us % 1'000'000));
+    return buffer;
+}
+
+static int trace(IDomain& domain)
+{
+    auto events = domain.getMonitorEvents();
+
+    if (events.empty())
+    {
+        return 0;
+    }
+
+    auto cntfrq = domain.getTimerFrequency();
+
+    if (cntfrq == 0)
+    {
+        fprintf(stderr, "bmctl: timer frequency unknown (has the domain been booted?)\n");
+        return -1;
+    }
+
+    // Over the time span of the log, the nominal frequency is accurate enough; a single sample anchors the mapping
+    ClockSync clock_sync(cntfrq);
+    clock_sync.sample();
+
+    // Times are shown as wall-clock time and relative to the most recent event, which is usually the one of interest
+    auto last_timestamp = events.back().timestamp;
+
+    for (auto const& event : events)
+    {
+        double time_ms = -clock_sync.toSeconds(last_timestamp - event.timestamp) * 1e3;
+
+        printf("%s %14.6f ms  %-17s %s\n",
+               formatTimeOfDay(clock_sync.toRealtime(event.timestamp)).c_str(),
+               time_ms,
+               toString(event.type).c_str(),
+               event.description.c_str());
+    }
+
+    return 0;
+}
+
+// ************************************************************
+
 int main(int argc, char** argv)
 {
     // each sub-command takes domain as 1st parameter
@@ -50,6 +760,17 @@ int main(int argc, char** argv)
         return usage();
     }
 
+    // ...which may also be a list of domains
+    if (strcmp(argv[1], "timeline") == 0)
+    {
+        return timeline(argc, argv);
+    }
+
+    if (strcmp(argv[1], "start") == 0 && strchr(argv[2], ',') != nullptr)
+    {
+        return startSmp(argc, argv);
+    }
+
     auto domain_index = parseDomainIndex(argv[2]);
 
     if (!domain_index.has_value())
@@ -62,6 +783,13 @@ int main(int argc, char** argv)
 
     if (strcmp(argv[1], "boot") == 0)
     {
+        bool timing = (argc == 4 && strcmp(argv[3], "--timing") == 0);
+
+        if (argc != 3 && !timing)
+        {
+            return usage();
+        }
+
         auto state = domain->getState();
 
         if (state == DomainState::in_reset)
@@ -78,10 +806,20 @@ int main(int argc, char** argv)
 
             printf("domain state: %s\n", toString(state).c_str());
         }
-        else
+        else if (!timing)
         {
             fprintf(stderr, "cannot start domain up: domain state %s != inReset\n", toString(state).c_str());
         }
+
+        // With the domain already up, --timing shows how its last boot went
+        if (timing)
+        {
+            printBootTiming(*domain);
+        }
+    }
+    else if (strcmp(argv[1], "calltrace") == 0)
+    {
+        return calltrace(*domain, argc, argv);
     }
     else if (strcmp(argv[1], "core") == 0)
     {
@@ -97,9 +835,19 @@ int main(int argc, char** argv)
     {
         domain->dumpDebugInfo();
     }
+    else if (strcmp(argv[1], "profile") == 0)
+    {
+        return profile(*domain, argc, argv);
+    }
+    else if (strcmp(argv[1], "record") == 0)
+    {
+        return record(*domain, argc, argv);
+    }
     else if (strcmp(argv[1], "run") == 0)
     {
-        if (argc != 4)
+        bool serve_files = (argc == 6 && strcmp(argv[4], "--files") == 0);
+
+        if (argc != 4 && !serve_files)
         {
             return usage();
         }
@@ -123,6 +871,24 @@ int main(int argc, char** argv)
             state = domain->getState();
         }
 
+        // file server, before the payload gets a chance to open anything
+
+        std::unique_ptr<HostFileServer> file_server;
+
+        if (serve_files)
+        {
+            auto maybe_server = HostFileServer::start(*domain, argv[5]);
+
+            if (std::holds_alternative<ErrorCode>(maybe_server))
+            {
+                fprintf(stderr, "HostFileServer::start: error: %s\n",
+                        toString(std::get<ErrorCode>(maybe_server)).c_str());
+                return -1;
+            }
+
+            file_server = std::move(std::get<std::unique_ptr<HostFileServer>>(maybe_server));
+        }
+
         // start
 
         if (state != DomainState::monitor_ready)
@@ -170,20 +936,42 @@ int main(int argc, char** argv)
             loadPayloadFromFileOrThrow(*domain, payload_filename);
         }
     }
+    else if (strcmp(argv[1], "stats") == 0)
+    {
+        return stats(*domain, argc, argv);
+    }
     else if (strcmp(argv[1], "status") == 0)
     {
         display_domain_state(*domain);
     }
+    else if (strcmp(argv[1], "swap") == 0)
+    {
+        return swap(*domain, argc, argv);
+    }
     else if (strcmp(argv[1], "terminate") == 0)
     {
-        auto err = domain->terminatePayload();
+        // --restart: also re-run the complete boot sequence of the monitor
+        bool restart = (argc == 4 && strcmp(argv[3], "--restart") == 0);
+
+        if (argc != 3 && !restart)
+        {
+            return usage();
+        }
+
+        auto err = restart ? domain->restartMonitor() : domain->terminatePayload();
 
         if (err.has_value())
         {
-            fprintf(stderr, "IDomain::reset_domain: error: %s\n", toString(*err).c_str());
+            fprintf(stderr, "%s: error: %s\n",
+                    restart ? "IDomain::restartMonitor" : "IDomain::terminatePayload",
+                    toString(*err).c_str());
             return -1;
         }
     }
+    else if (strcmp(argv[1], "trace") == 0)
+    {
+        return trace(*domain);
+    }
     else
     {
         usage();
@@ -63,14 +63,33 @@ std::string bmboot::toString(ErrorCode err) {
     switch (err) {
         case ErrorCode::bad_domain_state: return "bad domain state";
         case ErrorCode::configuration_file_error: return "/etc/bmboot.conf not found or malformed (see docs)";
+        case ErrorCode::file_access_failed: return "file could not be created or written";
         case ErrorCode::hw_resource_unavailable: return "a requested hardware resource is not available";
+        case ErrorCode::invalid_argument: return "invalid argument";
         case ErrorCode::payload_abi_incompatible: return "payload was built against an incompatible ABI version";
         case ErrorCode::payload_crashed_during_startup: return "payload crashed during startup";
         case ErrorCode::payload_image_malformed: return "provided file is not a valid Bmboot payload";
         case ErrorCode::payload_start_timed_out: return "payload startup timed out";
+        case ErrorCode::payload_start_time_passed: return "start time passed before the payload was ready to start";
         case ErrorCode::program_too_large: return "program too large, or wrong load address";
         case ErrorCode::monitor_start_timed_out: return "monitor startup timed out";
         case ErrorCode::unknown_error: return "unknown error";
         default: return "error " + std::to_string((int) err);
     }
 }
+
+// ************************************************************
+
+std::string bmboot::toString(MonitorEventType type) {
+    switch (type) {
+        case MonitorEventType::monitor_started: return "monitor_started";
+        case MonitorEventType::state_changed: return "state_changed";
+        case MonitorEventType::command: return "command";
+        case MonitorEventType::command_response: return "command_response";
+        case MonitorEventType::smc: return "smc";
+        case MonitorEventType::fiq: return "fiq";
+        case MonitorEventType::ipi_request: return "ipi_request";
+        case MonitorEventType::crash: return "crash";
+        default: return "unknown event " + std::to_string((int) type);
+    }
+}